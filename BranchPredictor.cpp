@@ -0,0 +1,245 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "BranchPredictor.hpp"
+
+
+using namespace WdRiscv;
+
+
+/// Return largest power of 2 less than or equal to the given
+/// value. Return 1 if value is zero.
+static size_t
+floorPowerOf2(size_t value)
+{
+  if (value == 0)
+    return 1;
+  size_t p2 = 1;
+  while (p2 <= value / 2)
+    p2 *= 2;
+  return p2;
+}
+
+
+BranchPredictor::BranchPredictor(Type type, unsigned phtSize,
+				 unsigned historyBits, unsigned btbSize,
+				 unsigned rasSize)
+  : type_(type), historyBits_(historyBits)
+{
+  if (historyBits_ > 32)
+    historyBits_ = 32;
+
+  pht_.resize(floorPowerOf2(phtSize));
+  btb_.resize(floorPowerOf2(btbSize));
+  ras_.resize(rasSize);
+
+  reset();
+}
+
+
+void
+BranchPredictor::reset()
+{
+  // Initialize counters to weakly not-taken.
+  for (auto& ctr : pht_)
+    ctr = 1;
+
+  for (auto& entry : btb_)
+    entry = BtbEntry();
+
+  history_ = 0;
+  rasTop_ = 0;
+  rasCount_ = 0;
+
+  branchCount_ = 0;
+  mispredictCount_ = 0;
+  stats_.clear();
+}
+
+
+bool
+BranchPredictor::btbLookup(uint64_t pc, uint64_t& target) const
+{
+  const BtbEntry& entry = btb_[btbIndex(pc)];
+  if (not entry.valid_ or entry.tag_ != pc)
+    return false;
+  target = entry.target_;
+  return true;
+}
+
+
+void
+BranchPredictor::btbInsert(uint64_t pc, uint64_t target)
+{
+  BtbEntry& entry = btb_[btbIndex(pc)];
+  entry.tag_ = pc;
+  entry.target_ = target;
+  entry.valid_ = true;
+}
+
+
+void
+BranchPredictor::rasPush(uint64_t addr)
+{
+  if (ras_.empty())
+    return;
+  ras_[rasTop_] = addr;
+  rasTop_ = (rasTop_ + 1) % ras_.size();
+  if (rasCount_ < ras_.size())
+    rasCount_++;
+}
+
+
+bool
+BranchPredictor::rasPop(uint64_t& addr)
+{
+  if (rasCount_ == 0)
+    return false;
+  rasTop_ = (rasTop_ + unsigned(ras_.size()) - 1) % ras_.size();
+  addr = ras_[rasTop_];
+  rasCount_--;
+  return true;
+}
+
+
+bool
+BranchPredictor::update(uint64_t pc, BranchKind kind, bool taken,
+			uint64_t target, uint64_t fallThrough)
+{
+  bool predTaken = false;
+  uint64_t predTarget = fallThrough;
+
+  bool conditional = kind == BranchKind::Conditional;
+  size_t phtIx = phtIndex(pc);
+
+  if (type_ == Type::Swerv)
+    {
+      // Fetch-stage prediction: Nothing is predicted taken unless it
+      // hits in the BTB. Returns get their target from the RAS.
+      uint64_t btbTarget = 0;
+      if (btbLookup(pc, btbTarget))
+	{
+	  predTaken = conditional ? pht_[phtIx] >= 2 : true;
+	  predTarget = btbTarget;
+	  if (kind == BranchKind::Return)
+	    rasPop(predTarget);
+	}
+      else if (kind == BranchKind::Return)
+	{
+	  uint64_t dummy = 0;
+	  rasPop(dummy);  // Keep stack in sync with call depth.
+	}
+    }
+  else
+    {
+      // Decode-stage prediction: Direct targets are known.
+      switch (kind)
+	{
+	case BranchKind::Conditional:
+	  if (type_ == Type::Static)
+	    predTaken = target < pc;
+	  else
+	    predTaken = pht_[phtIx] >= 2;
+	  predTarget = target;
+	  break;
+
+	case BranchKind::Jump:
+	case BranchKind::Call:
+	  predTaken = true;
+	  predTarget = target;
+	  break;
+
+	case BranchKind::Return:
+	  predTaken = rasPop(predTarget);
+	  break;
+
+	case BranchKind::IndirectCall:
+	case BranchKind::Indirect:
+	  predTaken = btbLookup(pc, predTarget);
+	  break;
+	}
+    }
+
+  bool mispredict = predTaken != taken;
+  if (taken and predTaken and predTarget != target)
+    mispredict = true;
+
+  // Train.
+  if (conditional)
+    {
+      if (type_ != Type::Static)
+	trainCounter(phtIx, taken);
+      uint64_t mask = (uint64_t(1) << historyBits_) - 1;
+      history_ = ((history_ << 1) | (taken ? 1 : 0)) & mask;
+    }
+
+  if (kind == BranchKind::Call or kind == BranchKind::IndirectCall)
+    rasPush(fallThrough);
+
+  if (taken)
+    {
+      if (type_ == Type::Swerv or kind == BranchKind::IndirectCall or
+	  kind == BranchKind::Indirect)
+	btbInsert(pc, target);
+    }
+
+  // Collect stats.
+  BranchStats& bs = stats_[pc];
+  bs.count_++;
+  branchCount_++;
+  if (taken)
+    bs.taken_++;
+  if (mispredict)
+    {
+      bs.mispredicts_++;
+      mispredictCount_++;
+    }
+
+  return mispredict;
+}
+
+
+bool
+BranchPredictor::parseType(const std::string& name, Type& type)
+{
+  if (name == "static")
+    type = Type::Static;
+  else if (name == "bimodal")
+    type = Type::Bimodal;
+  else if (name == "gshare")
+    type = Type::Gshare;
+  else if (name == "swerv")
+    type = Type::Swerv;
+  else
+    return false;
+  return true;
+}
+
+
+const char*
+BranchPredictor::typeName(Type type)
+{
+  switch (type)
+    {
+    case Type::Static:  return "static";
+    case Type::Bimodal: return "bimodal";
+    case Type::Gshare:  return "gshare";
+    case Type::Swerv:   return "swerv";
+    }
+  return "unknown";
+}
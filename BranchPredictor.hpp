@@ -0,0 +1,178 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+namespace WdRiscv
+{
+
+  /// Classification of a control transfer instruction as seen by a
+  /// branch predictor.
+  enum class BranchKind
+    {
+      Conditional,   // beq, bne, ..., c.beqz, c.bnez
+      Jump,          // jal/c.j with rd not a link register.
+      Call,          // jal/c.jal with rd a link register.
+      IndirectCall,  // jalr/c.jalr with rd a link register.
+      Return,        // jalr/c.jr with rs1 a link register and rd not.
+      Indirect       // Any other jalr/c.jr.
+    };
+
+
+  /// Per branch-instruction outcome statistics.
+  struct BranchStats
+  {
+    uint64_t count_ = 0;        // Times branch was executed.
+    uint64_t taken_ = 0;        // Times branch was taken.
+    uint64_t mispredicts_ = 0;  // Times branch was mispredicted.
+  };
+
+
+  /// Model a branch predictor: direction predictor, branch target
+  /// buffer and return address stack. The predictor is presented
+  /// with the outcome of each retired control transfer instruction
+  /// and it counts the cases where its prediction did not match.
+  class BranchPredictor
+  {
+  public:
+
+    enum class Type
+      {
+	Static,    // Backward taken, forward not-taken.
+	Bimodal,   // Table of 2-bit counters indexed by pc.
+	Gshare,    // Table of 2-bit counters indexed by pc xor history.
+	Swerv      // Gshare BHT plus tagged BTB: predict only on BTB hit.
+      };
+
+    /// Constructor: Define a predictor of the given type with a
+    /// pattern history table of the given size (rounded down to a
+    /// power of 2), a global history of the given number of bits, a
+    /// branch target buffer of the given size (rounded down to a
+    /// power of 2) and a return address stack of the given size.
+    BranchPredictor(Type type = Type::Gshare, unsigned phtSize = 256,
+		    unsigned historyBits = 8, unsigned btbSize = 512,
+		    unsigned rasSize = 4);
+
+    /// Return the type of this predictor.
+    Type type() const
+    { return type_; }
+
+    /// Predict the outcome of the control transfer instruction at the
+    /// given pc, compare prediction to actual outcome (taken flag and
+    /// target) and train the predictor. For a conditional branch, the
+    /// target is the taken-target even if the branch is not taken. The
+    /// fall-through address is that of the instruction following the
+    /// branch. Return true if branch was mispredicted and false
+    /// otherwise.
+    bool update(uint64_t pc, BranchKind kind, bool taken, uint64_t target,
+		uint64_t fallThrough);
+
+    /// Clear predictor state and collected statistics.
+    void reset();
+
+    /// Return the statistics collected so far: Map branch pc to its
+    /// statistics.
+    const std::unordered_map<uint64_t, BranchStats>& stats() const
+    { return stats_; }
+
+    /// Return total number of control transfer instructions seen.
+    uint64_t branchCount() const
+    { return branchCount_; }
+
+    /// Return total number of mispredicted control transfers.
+    uint64_t mispredictCount() const
+    { return mispredictCount_; }
+
+    /// Set type to the predictor type corresponding to the given name
+    /// (static, bimodal, gshare or swerv). Return true on success and
+    /// false if name does not correspond to a predictor type.
+    static bool parseType(const std::string& name, Type& type);
+
+    /// Return the name of the given predictor type.
+    static const char* typeName(Type type);
+
+  protected:
+
+    /// Return index into the pattern history table for given pc.
+    size_t phtIndex(uint64_t pc) const
+    {
+      uint64_t ix = pc >> 1;
+      if (type_ == Type::Gshare or type_ == Type::Swerv)
+	ix ^= history_;
+      return ix & (pht_.size() - 1);
+    }
+
+    /// Return index into the branch target buffer for given pc.
+    size_t btbIndex(uint64_t pc) const
+    { return (pc >> 1) & (btb_.size() - 1); }
+
+    /// Return true if the given pc hits in the branch target buffer
+    /// setting target to the corresponding target.
+    bool btbLookup(uint64_t pc, uint64_t& target) const;
+
+    /// Record the target of the given pc in the branch target buffer.
+    void btbInsert(uint64_t pc, uint64_t target);
+
+    /// Push given return address on the return address stack.
+    void rasPush(uint64_t addr);
+
+    /// Pop top of return address stack into addr. Return false if
+    /// stack is empty.
+    bool rasPop(uint64_t& addr);
+
+    /// Update the 2-bit counter at the given pht index.
+    void trainCounter(size_t ix, bool taken)
+    {
+      uint8_t& ctr = pht_[ix];
+      if (taken)
+	{ if (ctr < 3) ctr++; }
+      else
+	{ if (ctr > 0) ctr--; }
+    }
+
+  private:
+
+    struct BtbEntry
+    {
+      uint64_t tag_ = 0;
+      uint64_t target_ = 0;
+      bool valid_ = false;
+    };
+
+    Type type_;
+    unsigned historyBits_;
+    uint64_t history_ = 0;          // Global branch history.
+
+    std::vector<uint8_t> pht_;      // Pattern history: 2-bit counters.
+    std::vector<BtbEntry> btb_;     // Branch target buffer.
+
+    std::vector<uint64_t> ras_;     // Return address stack (circular).
+    unsigned rasTop_ = 0;           // Index of next free ras entry.
+    unsigned rasCount_ = 0;         // Number of valid ras entries.
+
+    uint64_t branchCount_ = 0;
+    uint64_t mispredictCount_ = 0;
+    std::unordered_map<uint64_t, BranchStats> stats_;
+  };
+}
@@ -0,0 +1,347 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <cstring>
+#include "CodeCoverage.hpp"
+#include "DwarfLine.hpp"
+
+
+using namespace WdRiscv;
+
+
+// Coverage file layout: magic, version, region count, then for each
+// region: base address, size in bytes, and one flag byte per
+// half-word. Integers are little-endian.
+static const char coverageMagic[8] = { 'W', 'H', 'C', 'O', 'V', 'M', 'A', 'P' };
+static const uint32_t coverageVersion = 1;
+
+
+static void
+writeInt(std::ostream& out, uint64_t value, unsigned size)
+{
+  for (unsigned i = 0; i < size; ++i)
+    out.put(char((value >> (8*i)) & 0xff));
+}
+
+
+static bool
+readInt(std::istream& in, uint64_t& value, unsigned size)
+{
+  value = 0;
+  for (unsigned i = 0; i < size; ++i)
+    {
+      int c = in.get();
+      if (c == EOF)
+	return false;
+      value |= uint64_t(uint8_t(c)) << (8*i);
+    }
+  return true;
+}
+
+
+void
+CodeCoverage::addRegion(uint64_t addr, uint64_t size)
+{
+  if (size == 0)
+    return;
+
+  Region region;
+  region.base_ = addr;
+  region.size_ = size;
+  region.flags_.resize((size + 1) / 2);
+  regions_.push_back(std::move(region));
+
+  // Vector may have been reallocated: Drop cached region.
+  curBase_ = curSize_ = 0;
+  curFlags_ = nullptr;
+}
+
+
+bool
+CodeCoverage::selectRegion(uint64_t addr)
+{
+  for (auto& region : regions_)
+    if (addr - region.base_ < region.size_)
+      {
+	curBase_ = region.base_;
+	curSize_ = region.size_;
+	curFlags_ = region.flags_.data();
+	return true;
+      }
+  return false;
+}
+
+
+uint8_t
+CodeCoverage::flags(uint64_t addr) const
+{
+  for (const auto& region : regions_)
+    if (addr - region.base_ < region.size_)
+      return region.flags_.at((addr - region.base_) >> 1);
+  return 0;
+}
+
+
+void
+CodeCoverage::merge(const CodeCoverage& other)
+{
+  for (const auto& src : other.regions_)
+    {
+      bool found = false;
+      for (auto& dest : regions_)
+	if (dest.base_ == src.base_ and dest.size_ == src.size_)
+	  {
+	    for (size_t i = 0; i < src.flags_.size(); ++i)
+	      dest.flags_[i] |= src.flags_[i];
+	    found = true;
+	    break;
+	  }
+      if (found)
+	continue;
+
+      // Regions overlapping src (directly or through a region already
+      // collected) are replaced by one region covering all of them.
+      std::vector<Region> parts;
+      parts.push_back(src);
+      uint64_t base = src.base_, end = src.base_ + src.size_;
+      for (bool widened = true; widened; )
+	{
+	  widened = false;
+	  for (auto iter = regions_.begin(); iter != regions_.end(); ++iter)
+	    if (iter->base_ < end and base < iter->base_ + iter->size_)
+	      {
+		base = std::min(base, iter->base_);
+		end = std::max(end, iter->base_ + iter->size_);
+		parts.push_back(std::move(*iter));
+		regions_.erase(iter);
+		widened = true;
+		break;
+	      }
+	}
+
+      Region region;
+      region.base_ = base;
+      region.size_ = end - base;
+      region.flags_.resize((region.size_ + 1) / 2);
+      for (const auto& part : parts)
+	{
+	  size_t offset = (part.base_ - base) >> 1;
+	  for (size_t i = 0; i < part.flags_.size(); ++i)
+	    region.flags_.at(offset + i) |= part.flags_[i];
+	}
+      regions_.push_back(std::move(region));
+    }
+
+  curBase_ = curSize_ = 0;
+  curFlags_ = nullptr;
+}
+
+
+bool
+CodeCoverage::save(const std::string& path) const
+{
+  std::ofstream out(path, std::ios::binary);
+  if (not out)
+    {
+      std::cerr << "Failed to open coverage file '" << path
+		<< "' for output\n";
+      return false;
+    }
+
+  out.write(coverageMagic, sizeof(coverageMagic));
+  writeInt(out, coverageVersion, 4);
+  writeInt(out, regions_.size(), 4);
+  for (const auto& region : regions_)
+    {
+      writeInt(out, region.base_, 8);
+      writeInt(out, region.size_, 8);
+      out.write(reinterpret_cast<const char*>(region.flags_.data()),
+		region.flags_.size());
+    }
+
+  if (not out)
+    {
+      std::cerr << "Failed to write coverage file '" << path << "'\n";
+      return false;
+    }
+  return true;
+}
+
+
+bool
+CodeCoverage::load(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (not in)
+    {
+      std::cerr << "Failed to open coverage file '" << path
+		<< "' for input\n";
+      return false;
+    }
+
+  in.seekg(0, std::ios::end);
+  uint64_t fileSize = uint64_t(in.tellg());
+  in.seekg(0, std::ios::beg);
+
+  char magic[sizeof(coverageMagic)];
+  uint64_t version = 0, count = 0;
+  if (not in.read(magic, sizeof(magic)) or
+      memcmp(magic, coverageMagic, sizeof(magic)) != 0 or
+      not readInt(in, version, 4) or version != coverageVersion or
+      not readInt(in, count, 4))
+    {
+      std::cerr << "File '" << path << "' is not a coverage file\n";
+      return false;
+    }
+
+  // Sizes in the file are checked against the bytes left in it before
+  // allocating anything.
+  const uint64_t regionHeaderSize = 16;
+  uint64_t left = fileSize - uint64_t(in.tellg());
+  if (count > left / regionHeaderSize)
+    {
+      std::cerr << "Coverage file '" << path << "' is truncated\n";
+      return false;
+    }
+
+  CodeCoverage other;
+  for (uint64_t i = 0; i < count; ++i)
+    {
+      Region region;
+      if (not readInt(in, region.base_, 8) or not readInt(in, region.size_, 8))
+	break;
+      left = fileSize - uint64_t(in.tellg());
+      if (region.size_ == 0 or region.base_ + region.size_ < region.base_ or
+	  (region.size_ - 1) / 2 + 1 > left)
+	{
+	  std::cerr << "Coverage file '" << path << "': Invalid region size "
+		    << region.size_ << '\n';
+	  return false;
+	}
+      region.flags_.resize((region.size_ + 1) / 2);
+      if (not in.read(reinterpret_cast<char*>(region.flags_.data()),
+		      region.flags_.size()))
+	break;
+      other.regions_.push_back(std::move(region));
+    }
+
+  if (other.regions_.size() != count)
+    {
+      std::cerr << "Coverage file '" << path << "' is truncated\n";
+      return false;
+    }
+
+  merge(other);
+  return true;
+}
+
+
+bool
+CodeCoverage::writeLcov(std::ostream& out, const DwarfLineTable& lines,
+			const InstClassifier& classify) const
+{
+  struct BranchInfo
+  {
+    unsigned line_;
+    uint8_t flags_;
+  };
+
+  struct FileInfo
+  {
+    std::map<unsigned, bool> lineHit_;  // Line to executed flag.
+    std::vector<BranchInfo> branches_;
+  };
+
+  // Walk the address ranges of the line table, one instruction at a
+  // time, collecting per-line hits and conditional branch outcomes.
+  std::map<std::string, FileInfo> files;
+
+  const auto& rows = lines.rows();
+  for (size_t i = 0; i + 1 < rows.size(); ++i)
+    {
+      const auto& row = rows.at(i);
+      uint64_t end = rows.at(i + 1).addr_;
+      if (row.endSeq_ or end <= row.addr_)
+	continue;
+
+      bool covered = false;
+      for (const auto& region : regions_)
+	if (row.addr_ - region.base_ < region.size_)
+	  covered = true;
+      if (not covered)
+	continue;
+
+      FileInfo& fi = files[lines.fileName(row.file_)];
+      bool& hit = fi.lineHit_[row.line_];
+
+      for (uint64_t addr = row.addr_; addr < end; )
+	{
+	  bool isCondBranch = false;
+	  unsigned size = classify(addr, isCondBranch);
+	  if (size == 0)
+	    break;
+	  uint8_t fl = flags(addr);
+	  if (fl & Executed)
+	    hit = true;
+	  if (isCondBranch)
+	    fi.branches_.push_back(BranchInfo{row.line_, fl});
+	  addr += size;
+	}
+    }
+
+  out << "TN:\n";
+  for (const auto& kv : files)
+    {
+      const FileInfo& fi = kv.second;
+      out << "SF:" << kv.first << '\n';
+
+      unsigned brFound = 0, brHit = 0;
+      std::map<unsigned, unsigned> lineBranches;  // Line to branch count.
+      for (const auto& br : fi.branches_)
+	{
+	  unsigned block = lineBranches[br.line_]++;
+	  bool executed = br.flags_ & Executed;
+	  bool taken = br.flags_ & Taken;
+	  bool notTaken = br.flags_ & FallThrough;
+	  out << "BRDA:" << br.line_ << ',' << block << ",0,";
+	  if (executed) out << (taken? 1 : 0); else out << '-';
+	  out << "\nBRDA:" << br.line_ << ',' << block << ",1,";
+	  if (executed) out << (notTaken? 1 : 0); else out << '-';
+	  out << '\n';
+	  brFound += 2;
+	  brHit += unsigned(taken) + unsigned(notTaken);
+	}
+      if (brFound)
+	out << "BRF:" << brFound << "\nBRH:" << brHit << '\n';
+
+      unsigned linesHit = 0;
+      for (const auto& lh : fi.lineHit_)
+	{
+	  out << "DA:" << lh.first << ',' << (lh.second? 1 : 0) << '\n';
+	  linesHit += lh.second;
+	}
+      out << "LF:" << fi.lineHit_.size() << "\nLH:" << linesHit << '\n';
+      out << "end_of_record\n";
+    }
+
+  return bool(out);
+}
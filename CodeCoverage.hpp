@@ -0,0 +1,116 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <functional>
+
+
+namespace WdRiscv
+{
+
+  class DwarfLineTable;
+
+  /// Record which instruction addresses of a set of code regions were
+  /// executed and, for each executed instruction, whether it was
+  /// observed to transfer control (taken) and/or to fall through to
+  /// the next sequential instruction. One flag byte is kept per
+  /// half-word of code.
+  class CodeCoverage
+  {
+  public:
+
+    enum Flags : uint8_t { Executed = 1, Taken = 2, FallThrough = 4 };
+
+    /// Add the code region of the given size at the given address to
+    /// the set of covered regions. Regions are expected not to overlap.
+    void addRegion(uint64_t addr, uint64_t size);
+
+    /// Record the execution of the instruction at the given address.
+    /// The taken flag indicates whether the next executed instruction
+    /// is not the sequential one. Addresses outside the covered
+    /// regions are ignored.
+    void record(uint64_t pc, bool taken)
+    {
+      uint64_t offset = pc - curBase_;
+      if (offset >= curSize_)
+	{
+	  if (not selectRegion(pc))
+	    return;
+	  offset = pc - curBase_;
+	}
+      curFlags_[offset >> 1] |= taken? Executed | Taken : Executed | FallThrough;
+    }
+
+    /// Return the flags of the given address (zero if address is not
+    /// in a covered region).
+    uint8_t flags(uint64_t addr) const;
+
+    /// Or the flags of the given coverage into this one. Regions of
+    /// other that are not in this object are added. Overlapping
+    /// regions of different extent are widened into a single region.
+    void merge(const CodeCoverage& other);
+
+    /// Save coverage in binary format to the given file. Return true
+    /// on success and false on failure.
+    bool save(const std::string& path) const;
+
+    /// Read a coverage file previously produced by save and merge its
+    /// contents into this object. Return true on success and false on
+    /// failure.
+    bool load(const std::string& path);
+
+    /// Callback used by writeLcov to classify the instruction at a
+    /// given address: Return the size of the instruction (0 if it
+    /// cannot be read) and set isCondBranch to true if it is a
+    /// conditional branch.
+    typedef std::function<unsigned(uint64_t addr, bool& isCondBranch)> InstClassifier;
+
+    /// Write line and branch coverage in lcov tracefile format using
+    /// the given line table to map addresses to source lines. Return
+    /// true on success and false if the stream becomes bad.
+    bool writeLcov(std::ostream& out, const DwarfLineTable& lines,
+		   const InstClassifier& classify) const;
+
+  protected:
+
+    /// Make the region containing the given address the current one.
+    /// Return false if no such region.
+    bool selectRegion(uint64_t addr);
+
+  private:
+
+    struct Region
+    {
+      uint64_t base_ = 0;
+      uint64_t size_ = 0;
+      std::vector<uint8_t> flags_;  // One entry per half-word.
+    };
+
+    std::vector<Region> regions_;
+
+    // Cached region for fast lookup in record.
+    uint64_t curBase_ = 0;
+    uint64_t curSize_ = 0;
+    uint8_t* curFlags_ = nullptr;
+  };
+}
@@ -35,6 +35,10 @@
   boost::multiprecision::uint128_t Uint128;
 #endif
 
+#ifdef __PCLMUL__
+  #include <wmmintrin.h>
+#endif
+
 #include <string.h>
 #include <time.h>
 #include <fcntl.h>
@@ -48,6 +52,7 @@
 #include <inttypes.h>
 
 #include "Core.hpp"
+#include "FpRound.hpp"
 #include "instforms.hpp"
 
 using namespace WdRiscv;
@@ -81,11 +86,19 @@ parseNumber(const std::string& numberStr, TYPE& number)
 
 template <typename URV>
 Core<URV>::Core(unsigned hartId, Memory& memory, unsigned intRegCount)
-  : hartId_(hartId), memory_(memory), intRegs_(intRegCount), fpRegs_(32)
+  : hartId_(hartId), memory_(memory), intRegs_(intRegCount), fpRegs_(32),
+    virtMem_(memory, pmpManager_)
 {
   regionHasLocalMem_.resize(16);
   regionHasLocalDataMem_.resize(16);
 
+  memory_.defineReservationHarts(hartId + 1);
+
+  decodeCache_.resize(4096);  // Must be a power of 2.
+  decodeCacheMask_ = unsigned(decodeCache_.size() - 1);
+
+  setupRvcExpansion();
+
   // Tie the retired instruction and cycle counter CSRs to variables
   // held in the core.
   if constexpr (sizeof(URV) == 4)
@@ -157,6 +170,7 @@ Core<URV>::reset(bool resetMemoryMappedRegs)
 
   storeQueue_.clear();
   loadQueue_.clear();
+  cancelLr();
 
   pc_ = resetPc_;
   currPc_ = resetPc_;
@@ -165,13 +179,18 @@ Core<URV>::reset(bool resetMemoryMappedRegs)
   // D requires F and is enabled only if F is enabled.
   rvm_ = false;
   rvc_ = false;
+  rvv_ = false;
 
   URV value = 0;
+  bool rvb = false;
   if (peekCsr(CsrNumber::MISA, value))
     {
       if (value & 1)    // Atomic ('a') option.
 	rva_ = true;
 
+      if (value & (URV(1) << ('b' - 'a')))  // Bit manipulation option.
+	rvb = true;
+
       if (value & (URV(1) << ('c' - 'a')))  // Compress option.
 	rvc_ = true;
 
@@ -209,11 +228,35 @@ Core<URV>::reset(bool resetMemoryMappedRegs)
       if (value & (URV(1) << ('u' - 'a')))  // User-mode option.
 	rvu_ = true;
 
+      if (value & (URV(1) << ('v' - 'a')))  // Vector option.
+	{
+	  rvv_ = true;
+
+	  bool isDebug = false;
+	  URV wam = ~URV(0);
+	  URV vill = URV(1) << (8*sizeof(URV) - 1);
+
+	  // Make sure the vector CSRs are enabled if V extension is on.
+	  if (not csRegs_.getImplementedCsr(CsrNumber::VSTART))
+	    csRegs_.configCsr("vstart", true, 0, wam, wam, isDebug);
+	  if (not csRegs_.getImplementedCsr(CsrNumber::VXSAT))
+	    csRegs_.configCsr("vxsat", true, 0, 1, 1, isDebug);
+	  if (not csRegs_.getImplementedCsr(CsrNumber::VXRM))
+	    csRegs_.configCsr("vxrm", true, 0, 3, 3, isDebug);
+	  if (not csRegs_.getImplementedCsr(CsrNumber::VCSR))
+	    csRegs_.configCsr("vcsr", true, 0, 7, 7, isDebug);
+	  csRegs_.configCsr("vl", true, 0, 0, wam, isDebug);
+	  csRegs_.configCsr("vtype", true, vill, 0, wam, isDebug);
+	  csRegs_.configCsr("vlenb", true, vecRegs_.bytesPerReg(), 0, 0,
+			    isDebug);
+	  vecRegs_.reset();
+	}
+
       if (value & (URV(1) << ('s' - 'a')))  // Supervisor-mode option.
 	rvs_ = true;
 
-      for (auto ec : { 'b', 'e', 'g', 'h', 'j', 'k', 'l', 'n', 'o', 'p',
-	    'q', 'r', 't', 'v', 'w', 'x', 'y', 'z' } )
+      for (auto ec : { 'e', 'g', 'h', 'j', 'k', 'l', 'n', 'o', 'p',
+	    'q', 'r', 't', 'w', 'x', 'y', 'z' } )
 	{
 	  unsigned bit = ec - 'a';
 	  if (value & (URV(1) << bit))
@@ -222,7 +265,28 @@ Core<URV>::reset(bool resetMemoryMappedRegs)
 		      << "-- ignored\n";
 	}
     }
-  
+
+  // The b extension is zba, zbb and zbs. Zbc is enabled only by
+  // configuration.
+  rvzba_ = rvb or enableZba_;
+  rvzbb_ = rvb or enableZbb_;
+  rvzbc_ = enableZbc_;
+  rvzbs_ = rvb or enableZbs_;
+
+  // Instructions of the disabled extensions decode as illegal.
+  instTypesOn_ = ~0u;
+  for (auto [type, on] : { std::make_pair(InstType::Multiply, rvm_),
+	std::make_pair(InstType::Divide, rvm_),
+	std::make_pair(InstType::Atomic, rva_),
+	std::make_pair(InstType::Fp, rvf_),
+	std::make_pair(InstType::Vector, rvv_),
+	std::make_pair(InstType::Zba, rvzba_),
+	std::make_pair(InstType::Zbb, rvzbb_),
+	std::make_pair(InstType::Zbc, rvzbc_),
+	std::make_pair(InstType::Zbs, rvzbs_) } )
+    if (not on)
+      instTypesOn_ &= ~(1u << unsigned(type));
+
   prevCountersCsrOn_ = true;
   countersCsrOn_ = true;
   if (peekCsr(CsrNumber::MGPMC, value))
@@ -242,6 +306,49 @@ Core<URV>::reset(bool resetMemoryMappedRegs)
       dcsrStep_ = (value >> 2) & 1;
       dcsrStepIe_ = (value >> 11) & 1;
     }
+
+  if (rvs_)
+    csRegs_.enableSupervisorMode();
+
+  updatePmp();
+  updateTranslation();
+
+  // Decoding depends on the enabled extensions.
+  invalidateDecodeCache();
+  setupRvcExpansion();
+}
+
+
+template <typename URV>
+void
+Core<URV>::setupRvcExpansion()
+{
+  int key = (rvf_ ? 1 : 0) | (rvd_ ? 2 : 0);
+  if (key == rvcExpansionKey_)
+    return;
+
+  // One immutable table per XLEN (URV) and F/D combination shared by
+  // all the cores: Built by the first core needing it.
+  static std::vector<uint32_t> tables[4];
+  static std::mutex tablesMutex;
+
+  std::lock_guard<std::mutex> lock(tablesMutex);
+
+  auto& table = tables[key];
+  if (table.empty())
+    {
+      table.resize(size_t(1) << 16);
+      for (size_t code16 = 0; code16 < table.size(); ++code16)
+	{
+	  uint32_t code32 = 0;
+	  if (not expandInst(uint16_t(code16), code32))
+	    code32 = 0;
+	  table.at(code16) = code32;
+	}
+    }
+
+  rvcExpansion_ = table.data();
+  rvcExpansionKey_ = key;
 }
 
 
@@ -322,13 +429,12 @@ template <typename URV>
 bool
 Core<URV>::pokeMemory(size_t addr, uint8_t val)
 {
-  if (hasLr_)
-    {
-      if (addr >= lrAddr_ and (addr - lrAddr_) < lrSize_)
-	hasLr_ = false;
-    }
+  if (not memory_.pokeByte(addr, val))
+    return false;
 
-  return memory_.pokeByte(addr, val);
+  // Lose load reservations (of any hart) on the poked bytes.
+  memory_.invalidateReservations(addr, sizeof(val));
+  return true;
 }
 
 
@@ -336,19 +442,12 @@ template <typename URV>
 bool
 Core<URV>::pokeMemory(size_t addr, uint16_t val)
 {
-  if (hasLr_)
-    {
-      // If poke starts at any of the reserved bytes: lose reservation.
-      if (addr >= lrAddr_ and (addr - lrAddr_) < lrSize_)
-	hasLr_ = false;
-
-      // If poke starts before reserved bytes but spills into them:
-      // lose reservation.
-      if (addr < lrAddr_ and (lrAddr_ - addr) < 2)
-	hasLr_ = false;
-    }
+  if (not memory_.poke(addr, val))
+    return false;
 
-  return memory_.poke(addr, val);
+  // Lose load reservations (of any hart) on the poked bytes.
+  memory_.invalidateReservations(addr, sizeof(val));
+  return true;
 }
 
 
@@ -360,19 +459,12 @@ Core<URV>::pokeMemory(size_t addr, uint32_t val)
   // otherwise, there is no way for external driver to clear bits that
   // are read-only to this core.
 
-  if (hasLr_)
-    {
-      // If poke starts at any of the reserved bytes: lose reservation.
-      if (addr >= lrAddr_ and (addr - lrAddr_) < lrSize_)
-	hasLr_ = false;
-
-      // If poke starts before reserved bytes but spills into them:
-      // lose reservation.
-      if (addr < lrAddr_ and (lrAddr_ - addr) < 4)
-	hasLr_ = false;
-    }
+  if (not memory_.poke(addr, val))
+    return false;
 
-  return memory_.poke(addr, val);
+  // Lose load reservations (of any hart) on the poked bytes.
+  memory_.invalidateReservations(addr, sizeof(val));
+  return true;
 }
 
 
@@ -380,19 +472,12 @@ template <typename URV>
 bool
 Core<URV>::pokeMemory(size_t addr, uint64_t val)
 {
-  if (hasLr_)
-    {
-      // If poke starts at any of the reserved bytes: lose reservation.
-      if (addr >= lrAddr_ and (addr - lrAddr_) < lrSize_)
-	hasLr_ = false;
-
-      // If poke starts before reserved bytes but spills into them:
-      // lose reservation.
-      if (addr < lrAddr_ and (lrAddr_ - addr) < 8)
-	hasLr_ = false;
-    }
+  if (not memory_.poke(addr, val))
+    return false;
 
-  return memory_.poke(addr, val);
+  // Lose load reservations (of any hart) on the poked bytes.
+  memory_.invalidateReservations(addr, sizeof(val));
+  return true;
 }
 
 
@@ -457,7 +542,7 @@ void
 Core<URV>::putInStoreQueue(unsigned size, size_t addr, uint64_t data,
 			   uint64_t prevData)
 {
-  if (maxStoreQueueSize_ == 0 or memory_.isLastWriteToDccm())
+  if (maxStoreQueueSize_ == 0 or lastWrite_.isDccm_)
     return;
 
   if (storeQueue_.size() >= maxStoreQueueSize_)
@@ -975,9 +1060,38 @@ printSignedHisto(const char* tag, const std::vector<uint64_t>& histo,
 
 
 template <typename URV>
-inline
 void
 Core<URV>::reportInstructionFrequency(FILE* file) const
+{
+  reportInstructionFrequency(file, instProfileVec_);
+}
+
+
+template <typename URV>
+void
+Core<URV>::mergeInstructionFrequency(std::vector<InstProfile>& prof) const
+{
+  if (prof.size() < instProfileVec_.size())
+    prof.resize(instProfileVec_.size());
+
+  for (size_t i = 0; i < instProfileVec_.size(); ++i)
+    mergeInstProfile(prof[i], instProfileVec_[i]);
+}
+
+
+template <typename URV>
+bool
+Core<URV>::reportInstructionFrequencyJson(std::ostream& out,
+					  const std::vector<InstProfile>& prof) const
+{
+  return printInstProfileJson(out, prof, instTable_);
+}
+
+
+template <typename URV>
+void
+Core<URV>::reportInstructionFrequency(FILE* file,
+				      const std::vector<InstProfile>& profileVec) const
 {
   struct CompareFreq
   {
@@ -991,10 +1105,10 @@ Core<URV>::reportInstructionFrequency(FILE* file) const
     const std::vector<InstProfile>& profileVec;
   };
 
-  std::vector<size_t> indices(instProfileVec_.size());
+  std::vector<size_t> indices(profileVec.size());
   for (size_t i = 0; i < indices.size(); ++i)
     indices.at(i) = i;
-  std::sort(indices.begin(), indices.end(), CompareFreq(instProfileVec_));
+  std::sort(indices.begin(), indices.end(), CompareFreq(profileVec));
 
   for (size_t i = 0; i < indices.size(); ++i)
     {
@@ -1002,7 +1116,7 @@ Core<URV>::reportInstructionFrequency(FILE* file) const
       InstId id = InstId(ix);
 
       const InstInfo& info = instTable_.getInstInfo(id);
-      const InstProfile& prof = instProfileVec_.at(ix);
+      const InstProfile& prof = profileVec.at(ix);
       uint64_t freq = prof.freq_;
       if (not freq)
 	continue;
@@ -1065,6 +1179,126 @@ Core<URV>::reportInstructionFrequency(FILE* file) const
 }
 
 
+template <typename URV>
+void
+Core<URV>::reportBranchPrediction(FILE* file) const
+{
+  if (not branchPred_)
+    return;
+
+  const BranchPredictor& bp = *branchPred_;
+  uint64_t count = bp.branchCount(), misses = bp.mispredictCount();
+  double rate = count ? 100.0 * double(misses) / double(count) : 0.0;
+
+  fprintf(file, "Predictor %s\n",
+	  BranchPredictor::typeName(bp.type()));
+  fprintf(file, "Branches %" PRIu64 " mispredicts %" PRIu64 " (%.2f%%)\n",
+	  count, misses, rate);
+
+  // Accumulate per function stats.
+  std::map<std::string, BranchStats> funcStats;
+  for (const auto& kv : bp.stats())
+    {
+      std::string name = "?";
+      ElfSymbol sym;
+      memory_.findElfFunction(kv.first, name, sym);
+      BranchStats& fs = funcStats[name];
+      fs.count_ += kv.second.count_;
+      fs.taken_ += kv.second.taken_;
+      fs.mispredicts_ += kv.second.mispredicts_;
+    }
+
+  typedef std::pair<std::string, BranchStats> FuncItem;
+  std::vector<FuncItem> funcs(funcStats.begin(), funcStats.end());
+  std::stable_sort(funcs.begin(), funcs.end(),
+		   [] (const FuncItem& a, const FuncItem& b) {
+		     return a.second.mispredicts_ > b.second.mispredicts_;
+		   });
+
+  fprintf(file, "\nPer function: mispredicts branches taken name\n");
+  for (const auto& item : funcs)
+    fprintf(file, "  %" PRIu64 " %" PRIu64 " %" PRIu64 " %s\n",
+	    item.second.mispredicts_, item.second.count_, item.second.taken_,
+	    item.first.c_str());
+
+  typedef std::pair<uint64_t, BranchStats> PcItem;
+  std::vector<PcItem> pcs(bp.stats().begin(), bp.stats().end());
+  std::sort(pcs.begin(), pcs.end(),
+	    [] (const PcItem& a, const PcItem& b) {
+	      if (a.second.mispredicts_ != b.second.mispredicts_)
+		return a.second.mispredicts_ > b.second.mispredicts_;
+	      return a.first < b.first;
+	    });
+
+  fprintf(file, "\nPer branch: pc mispredicts branches taken [source]\n");
+  for (const auto& item : pcs)
+    {
+      if (item.second.mispredicts_ == 0)
+	break;
+      fprintf(file, "  0x%" PRIx64 " %" PRIu64 " %" PRIu64 " %" PRIu64,
+	      item.first, item.second.mispredicts_, item.second.count_,
+	      item.second.taken_);
+      std::string srcFile;
+      unsigned srcLine = 0;
+      if (memory_.findSourceLine(item.first, srcFile, srcLine))
+	fprintf(file, " %s:%u", srcFile.c_str(), srcLine);
+      fprintf(file, "\n");
+    }
+}
+
+
+template <typename URV>
+bool
+Core<URV>::enableCodeCoverage(const std::string& elfFile)
+{
+  std::vector<ElfSymbol> sections;
+  if (not Memory::getElfFileCodeSections(elfFile, sections))
+    return false;
+
+  if (not coverage_)
+    coverage_ = std::make_unique<CodeCoverage>();
+
+  for (const auto& sec : sections)
+    coverage_->addRegion(sec.addr_, sec.size_);
+  return true;
+}
+
+
+template <typename URV>
+void
+Core<URV>::enableFunctionalCoverage(bool flag)
+{
+  if (flag and not funcCov_)
+    funcCov_ = std::make_unique<FuncCoverage>();
+  else if (not flag)
+    funcCov_.reset();
+}
+
+
+template <typename URV>
+unsigned
+Core<URV>::classifyInstruction(size_t addr, bool& isCondBranch)
+{
+  isCondBranch = false;
+
+  uint32_t inst = 0;
+  if (not readInst(addr, inst))
+    return 0;
+
+  uint32_t op0 = 0, op1 = 0;
+  int32_t op2 = 0, op3 = 0;
+  const InstInfo& info = decode(inst, op0, op1, op2, op3);
+
+  InstId id = info.instId();
+  if (info.isBranch() and id != InstId::jal and id != InstId::jalr and
+      id != InstId::c_j and id != InstId::c_jal and id != InstId::c_jr and
+      id != InstId::c_jalr)
+    isCondBranch = true;
+
+  return instructionSize(inst);
+}
+
+
 template <typename URV>
 bool
 Core<URV>::misalignedAccessCausesException(URV addr, unsigned accessSize) const
@@ -1178,7 +1412,11 @@ Core<URV>::load(uint32_t rd, uint32_t rs1, int32_t imm)
     }
 
   ULT uval = 0;
-  if (not forceAccessFail_ and memory_.read(addr, uval))
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::LOAD_ACC_FAULT;
+  if (not forceAccessFail_ and
+      translateData(addr, ldSize, PmpManager::Read, pa, cause) and
+      pmpAllows(pa, ldSize, PmpManager::Read) and memory_.read(pa, uval))
     {
       URV value;
       if constexpr (std::is_same<ULT, LOAD_TYPE>::value)
@@ -1195,7 +1433,7 @@ Core<URV>::load(uint32_t rd, uint32_t rs1, int32_t imm)
     }
 
   // Either force-fail or load failed. Take exception.
-  initiateLoadException(ExceptionCause::LOAD_ACC_FAULT, addr, ldSize);
+  initiateLoadException(cause, addr, ldSize);
   return false;
 }
 
@@ -1328,25 +1566,13 @@ Core<URV>::fetchInst(URV addr, uint32_t& inst)
       return false;
     }
 
-  if (memory_.readInstWord(addr, inst))
-    return true;
-
-  uint16_t half;
-  if (not memory_.readInstHalfWord(addr, half))
-    {
-      initiateException(ExceptionCause::INST_ACC_FAULT, addr, addr);
-      return false;
-    }
-
-  inst = half;
-  if (isCompressedInst(inst))
+  // Common case: The instruction is in the window of the last fetch
+  // and needs no translation or PMP check.
+  URV offset = addr - fetchVa_;
+  if (offset < fetchSpan_ and memory_.readInstWord(fetchPa_ + offset, inst))
     return true;
 
-  // 4-byte instruction: 4-byte fetch failed but 1st 2-byte fetch
-  // succeeded. Problem must be in 2nd half of instruction.
-  initiateException(ExceptionCause::INST_ACC_FAULT, addr, addr + 2);
-
-  return false;
+  return fetchInstSlow(addr, inst);
 }
 
 
@@ -1357,17 +1583,27 @@ Core<URV>::fetchInstPostTrigger(URV addr, uint32_t& inst, FILE* traceFile)
   URV info = addr;
 
   // Fetch will fail if forced or if address is misaligned or if
-  // memory read fails.
-  if (not forceFetchFail_ and (addr & 1) == 0)
+  // translation or memory read fails.
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::INST_ACC_FAULT;
+  if (not forceFetchFail_ and (addr & 1) == 0 and
+      (not virtMem_.isInstActive() or translateInstAddr(addr, pa, cause)))
     {
-      if (memory_.readInstWord(addr, inst))
-	return true;  // Read 4 bytes: success.
-
-      uint16_t half;
-      if (memory_.readInstHalfWord(addr, half))
+      if (memory_.readInstWord(pa, inst))
+	{
+	  unsigned size = isCompressedInst(inst) ? 2 : 4;
+	  if (pmpAllowsFetch(pa, size))
+	    return true;  // Read 4 bytes: success.
+	}
+      else
 	{
-	  if (isCompressedInst(inst))
-	    return true; // Read 2 bytes and compressed inst: success.
+	  uint16_t half;
+	  if (memory_.readInstHalfWord(pa, half) and
+	      pmpAllowsFetch(pa, 2))
+	    {
+	      if (isCompressedInst(inst))
+		return true; // Read 2 bytes and compressed inst: success.
+	    }
 	}
     }
 
@@ -1463,7 +1699,7 @@ template <typename URV>
 void
 Core<URV>::initiateTrap(bool interrupt, URV cause, URV pcToSave, URV info)
 {
-  hasLr_ = false;  // Load-reservation lost.
+  cancelLr();  // Load-reservation lost.
 
   PrivilegeMode origMode = privMode_;
 
@@ -1471,8 +1707,15 @@ Core<URV>::initiateTrap(bool interrupt, URV cause, URV pcToSave, URV info)
   privMode_ = PrivilegeMode::Machine;
   PrivilegeMode nextMode = PrivilegeMode::Machine;
 
-  // But they can be delegated. TBD: handle delegation to S/U modes
-  // updating nextMode.
+  // But exceptions and interrupts occurring in supervisor or user
+  // mode can be delegated to supervisor mode.
+  if (rvs_ and origMode != PrivilegeMode::Machine)
+    {
+      URV deleg = 0;
+      CsrNumber delegNum = interrupt? CsrNumber::MIDELEG : CsrNumber::MEDELEG;
+      if (peekCsr(delegNum, deleg) and ((deleg >> cause) & 1))
+	nextMode = PrivilegeMode::Supervisor;
+    }
 
   CsrNumber epcNum = CsrNumber::MEPC;
   CsrNumber causeNum = CsrNumber::MCAUSE;
@@ -1502,7 +1745,7 @@ Core<URV>::initiateTrap(bool interrupt, URV cause, URV pcToSave, URV info)
   // Save the exception cause.
   URV causeRegVal = cause;
   if (interrupt)
-    causeRegVal |= 1 << (mxlen_ - 1);
+    causeRegVal |= URV(1) << (mxlen_ - 1);
   if (not csRegs_.write(causeNum, privMode_, debugMode_, causeRegVal))
     assert(0 and "Failed to write CAUSE register");
 
@@ -1556,6 +1799,7 @@ Core<URV>::initiateTrap(bool interrupt, URV cause, URV pcToSave, URV info)
 
   // Change privilege mode.
   privMode_ = nextMode;
+  updateTranslation();
 }
 
 
@@ -1563,7 +1807,7 @@ template <typename URV>
 void
 Core<URV>::initiateNmi(URV cause, URV pcToSave)
 {
-  hasLr_ = false;  // Load-reservation lost.
+  cancelLr();  // Load-reservation lost.
 
   PrivilegeMode origMode = privMode_;
 
@@ -1610,6 +1854,7 @@ Core<URV>::initiateNmi(URV cause, URV pcToSave)
     }
 
   pc_ = (nmiPc_ >> 1) << 1;  // Clear least sig bit
+  updateTranslation();
 }
 
 
@@ -1776,6 +2021,20 @@ Core<URV>::pokeCsr(CsrNumber csr, URV val)
 	  prevCountersCsrOn_ = countersCsrOn_;
 	}
     }
+  else if (isPmpCsr(csr))
+    updatePmp();
+  else if (csr == CsrNumber::SATP or csr == CsrNumber::MSTATUS or
+	   csr == CsrNumber::SSTATUS)
+    updateTranslation();
+  else if (csr == CsrNumber::VL or csr == CsrNumber::VTYPE)
+    {
+      // Refresh the decoded vector configuration.
+      URV vl = 0, vtype = 0;
+      csRegs_.peek(CsrNumber::VL, vl);
+      csRegs_.peek(CsrNumber::VTYPE, vtype);
+      constexpr URV villBit = URV(1) << (8*sizeof(URV) - 1);
+      vecRegs_.setVtype(vtype & ~villBit, vtype & villBit, vl);
+    }
 
   return result;
 }
@@ -1893,6 +2152,18 @@ Core<URV>::configMachineModePerfCounters(unsigned numCounters)
 }
 
 
+template <typename URV>
+bool
+Core<URV>::configPmpEntries(unsigned count)
+{
+  if (not csRegs_.configPmpEntries(count))
+    return false;
+  pmpEntries_ = count;
+  updatePmp();
+  return true;
+}
+
+
 template <typename URV>
 void
 formatInstTrace(FILE* out, uint64_t tag, unsigned hartId, URV currPc,
@@ -1963,6 +2234,39 @@ formatFpInstTrace<uint64_t>(FILE* out, uint64_t tag, unsigned hartId, uint64_t c
 }
 
 
+template <typename URV>
+void
+formatVecInstTrace(FILE* out, uint64_t tag, unsigned hartId, URV currPc,
+		   const char* opcode, unsigned vecReg, const uint8_t* data,
+		   unsigned byteCount, const char* assembly);
+
+template <>
+void
+formatVecInstTrace<uint32_t>(FILE* out, uint64_t tag, unsigned hartId, uint32_t currPc,
+		   const char* opcode, unsigned vecReg, const uint8_t* data,
+		   unsigned byteCount, const char* assembly)
+{
+  fprintf(out, "#%" PRId64 " %d %08x %8s v %02x ",
+          tag, hartId, currPc, opcode, vecReg);
+  for (unsigned i = byteCount; i > 0; --i)
+    fprintf(out, "%02x", data[i-1]);
+  fprintf(out, "  %s", assembly);
+}
+
+template <>
+void
+formatVecInstTrace<uint64_t>(FILE* out, uint64_t tag, unsigned hartId, uint64_t currPc,
+		   const char* opcode, unsigned vecReg, const uint8_t* data,
+		   unsigned byteCount, const char* assembly)
+{
+  fprintf(out, "#%" PRId64 " %d %016" PRIx64 " %8s v %016" PRIx64 " ",
+          tag, hartId, currPc, opcode, uint64_t(vecReg));
+  for (unsigned i = byteCount; i > 0; --i)
+    fprintf(out, "%02x", data[i-1]);
+  fprintf(out, "  %s", assembly);
+}
+
+
 static std::mutex printInstTraceMutex;
 
 template <typename URV>
@@ -1984,6 +2288,11 @@ Core<URV>::printInstTrace(uint32_t inst, uint64_t tag, std::string& tmp,
       tmp += " [" + oss.str() + "]";
     }
 
+  std::string srcFile;
+  unsigned srcLine = 0;
+  if (traceSource_ and memory_.findSourceLine(currPc_, srcFile, srcLine))
+    tmp += " (" + srcFile + ":" + std::to_string(srcLine) + ")";
+
   char instBuff[128];
   if ((inst & 0x3) == 3)
     sprintf(instBuff, "%08x", inst);
@@ -2019,65 +2328,50 @@ Core<URV>::printInstTrace(uint32_t inst, uint64_t tag, std::string& tmp,
       pending = true;
     }
 
-  // Process CSR diffs.
-  std::vector<CsrNumber> csrs;
-  std::vector<unsigned> triggers;
-  csRegs_.getLastWrittenRegs(csrs, triggers);
-
-  std::vector<bool> tdataChanged(3);
-
-  std::map<URV, URV> csrMap; // Map csr-number to its value.
-
-  for (CsrNumber csr : csrs)
-    {
-      if (not csRegs_.read(csr, PrivilegeMode::Machine, debugMode_, value))
-	continue;
-
-      if (csr >= CsrNumber::TDATA1 and csr <= CsrNumber::TDATA3)
-	{
-	  size_t ix = size_t(csr) - size_t(CsrNumber::TDATA1);
-	  tdataChanged.at(ix) = true;
-	  continue; // Debug triggers printed separately below
-	}
-      csrMap[URV(csr)] = value;
-    }
-
-  // Process trigger register diffs.
-  for (unsigned trigger : triggers)
+  // Process vector register diff: One record per register of the
+  // written group, most significant byte first.
+  unsigned groupSize = 0;
+  int vecReg = vecRegs_.getLastWrittenReg(groupSize);
+  for (unsigned i = 0; vecReg >= 0 and i < groupSize; ++i)
     {
-      URV data1(0), data2(0), data3(0);
-      if (not peekTrigger(trigger, data1, data2, data3))
-	continue;
-      if (tdataChanged.at(0))
-	{
-	  URV ecsr = (trigger << 16) | URV(CsrNumber::TDATA1);
-	  csrMap[ecsr] = data1;
-	}
-      if (tdataChanged.at(1))
-	{
-	  URV ecsr = (trigger << 16) | URV(CsrNumber::TDATA2);
-	  csrMap[ecsr] = data2;
-	}
-      if (tdataChanged.at(2))
-	{
-	  URV ecsr = (trigger << 16) | URV(CsrNumber::TDATA3);
-	  csrMap[ecsr] = data3;
-	}
+      if (pending) fprintf(out, "  +\n");
+      formatVecInstTrace<URV>(out, tag, hartId_, currPc_, instBuff, vecReg + i,
+			      vecRegs_.regData(vecReg + i), vecRegs_.bytesPerReg(),
+			      tmp.c_str());
+      pending = true;
     }
 
-  for (const auto& [key, val] : csrMap)
-    {
+  // Process CSR and trigger diffs in increasing order.
+  auto readCsr = [this] (CsrNumber csr, URV& val) {
+    return csRegs_.read(csr, PrivilegeMode::Machine, debugMode_, val);
+  };
+  forEachCsrChange(readCsr, [&] (URV key, URV val) {
       if (pending) fprintf(out, "  +\n");
       formatInstTrace<URV>(out, tag, hartId_, currPc_, instBuff, 'c',
 			   key, val, tmp.c_str());
       pending = true;
+    });
+
+  // Process memory diff. A vector store has one record per element
+  // (64-bit elements are split in two on a 32-bit hart).
+  for (const auto& info : vecWrites_)
+    {
+      unsigned words = (info.size_ > sizeof(URV)) ? 2 : 1;
+      for (unsigned i = 0; i < words; ++i)
+	{
+	  if (pending) fprintf(out, "  +\n");
+	  URV elemValue = URV(info.value_ >> (i * 8 * sizeof(URV)));
+	  formatInstTrace<URV>(out, tag, hartId_, currPc_, instBuff, 'm',
+			       URV(info.addr_ + i * sizeof(URV)), elemValue,
+			       tmp.c_str());
+	  pending = true;
+	}
     }
 
-  // Process memory diff.
   size_t address = 0;
   uint64_t memValue = 0;
-  unsigned writeSize = memory_.getLastWriteNewValue(address, memValue);
-  if (writeSize > 0)
+  unsigned writeSize = getLastWriteNewValue(address, memValue);
+  if (writeSize > 0 and vecWrites_.empty())
     {
       if (pending)
 	fprintf(out, "  +\n");
@@ -2160,188 +2454,348 @@ addToUnsignedHistogram(std::vector<uint64_t>& histo, uint64_t val)
 
 template <typename URV>
 void
-Core<URV>::updatePerformanceCounters(uint32_t inst, const InstInfo& info,
-				     uint32_t op0, uint32_t op1)
+Core<URV>::fillDecodedInst(uint32_t inst, DecodedInst& di)
 {
-  // We do not update the performance counters if an instruction
-  // causes an exception unless it is an ebreak or an ecall.
-  InstId id = info.instId();
-  if (hasException_ and id != InstId::ecall and id != InstId::ebreak and
-      id != InstId::c_ebreak)
-    return;
+  const InstInfo& info = decode(inst, di.op0_, di.op1_, di.op2_, di.op3_);
+  di.inst_ = inst;
+  di.info_ = &info;
 
-  PerfRegs& pregs = csRegs_.mPerfRegs_;
-  pregs.updateCounters(EventNumber::InstCommited);
+  // Compute the events implied by the instruction encoding. Events
+  // depending on the execution (misaligned access, taken branch ...)
+  // are added when the instruction retires.
+  auto bit = PerfRegs::eventBit;
+  uint64_t events = bit(EventNumber::InstCommited);
 
   if (isCompressedInst(inst))
-    pregs.updateCounters(EventNumber::Inst16Commited);
+    events |= bit(EventNumber::Inst16Commited);
   else
-    pregs.updateCounters(EventNumber::Inst32Commited);
+    events |= bit(EventNumber::Inst32Commited);
 
-  if ((currPc_ & 3) == 0)
-    pregs.updateCounters(EventNumber::InstAligned);
+  InstId id = info.instId();
 
   if (info.type() == InstType::Int)
     {
       if (id == InstId::ebreak or id == InstId::c_ebreak)
-	pregs.updateCounters(EventNumber::Ebreak);
+	events |= bit(EventNumber::Ebreak);
       else if (id == InstId::ecall)
-	pregs.updateCounters(EventNumber::Ecall);
+	events |= bit(EventNumber::Ecall);
       else if (id == InstId::fence)
-	pregs.updateCounters(EventNumber::Fence);
+	events |= bit(EventNumber::Fence);
       else if (id == InstId::fencei)
-	pregs.updateCounters(EventNumber::Fencei);
+	events |= bit(EventNumber::Fencei);
       else if (id == InstId::mret)
-	pregs.updateCounters(EventNumber::Mret);
+	events |= bit(EventNumber::Mret);
       else if (id != InstId::illegal)
-	pregs.updateCounters(EventNumber::Alu);
+	events |= bit(EventNumber::Alu);
     }
   else if (info.isMultiply())
-    {
-      pregs.updateCounters(EventNumber::Mult);
-    }
+    events |= bit(EventNumber::Mult);
   else if (info.isDivide())
-    {
-      pregs.updateCounters(EventNumber::Div);
-    }
+    events |= bit(EventNumber::Div);
   else if (info.isLoad())
-    {
-      pregs.updateCounters(EventNumber::Load);
-      if (misalignedLdSt_)
-	pregs.updateCounters(EventNumber::MisalignLoad);
-    }
+    events |= bit(EventNumber::Load);
   else if (info.isStore())
-    {
-      pregs.updateCounters(EventNumber::Store);
-      if (misalignedLdSt_)
-	pregs.updateCounters(EventNumber::MisalignStore);
-    }
+    events |= bit(EventNumber::Store);
   else if (info.isAtomic())
     {
       if (id == InstId::lr_w or id == InstId::lr_d)
-	pregs.updateCounters(EventNumber::Lr);
+	events |= bit(EventNumber::Lr);
       else if (id == InstId::sc_w or id == InstId::sc_d)
-	pregs.updateCounters(EventNumber::Sc);
+	events |= bit(EventNumber::Sc);
       else
-	pregs.updateCounters(EventNumber::Atomic);
+	events |= bit(EventNumber::Atomic);
     }
-  else if (info.isCsr() and not hasException_)
+  else if (info.isCsr())
     {
       if ((id == InstId::csrrw or id == InstId::csrrwi))
 	{
-	  if (op0 == 0)
-	    pregs.updateCounters(EventNumber::CsrWrite);
+	  if (di.op0_ == 0)
+	    events |= bit(EventNumber::CsrWrite);
 	  else
-	    pregs.updateCounters(EventNumber::CsrReadWrite);
+	    events |= bit(EventNumber::CsrReadWrite);
 	}
       else
 	{
-	  if (op1 == 0)
-	    pregs.updateCounters(EventNumber::CsrRead);
+	  if (di.op1_ == 0)
+	    events |= bit(EventNumber::CsrRead);
 	  else
-	    pregs.updateCounters(EventNumber::CsrReadWrite);
+	    events |= bit(EventNumber::CsrReadWrite);
 	}
-
-      // Counter modified by csr instruction is not updated.
-      std::vector<CsrNumber> csrs;
-      std::vector<unsigned> triggers;
-      csRegs_.getLastWrittenRegs(csrs, triggers);
-      for (auto& csr : csrs)
-	if (pregs.isModified(unsigned(csr) - unsigned(CsrNumber::MHPMCOUNTER3)))
-	  {
-	    URV val;
-	    peekCsr(csr, val);
-	    pokeCsr(csr, val - 1);
-	  }
-	else if (csr >= CsrNumber::MHPMEVENT3 and csr <= CsrNumber::MHPMEVENT31)
-	  {
-	    unsigned id = unsigned(csr) - unsigned(CsrNumber::MHPMEVENT3);
-	    if (pregs.isModified(id))
-	      {
-		URV val;
-		CsrNumber csr2 = CsrNumber(id + unsigned(CsrNumber::MHPMCOUNTER3));
-		if (pregs.isModified(unsigned(csr2) - unsigned(CsrNumber::MHPMCOUNTER3)))
-		  {
-		    peekCsr(csr2, val);
-		    pokeCsr(csr2, val - 1);
-		  }
-	      }
-	  }
     }
   else if (info.isBranch())
-    {
-      pregs.updateCounters(EventNumber::Branch);
-      if (lastBranchTaken_)
-	pregs.updateCounters(EventNumber::BranchTaken);
-    }
+    events |= bit(EventNumber::Branch);
 
-  pregs.clearModified();
+  di.events_ = events;
 }
 
 
 template <typename URV>
 void
-Core<URV>::accumulateInstructionStats(uint32_t inst)
+Core<URV>::updatePerformanceCounters(const DecodedInst& di)
 {
-  uint32_t op0 = 0, op1 = 0; int32_t op2 = 0, op3 = 0;
-  const InstInfo& info = decode(inst, op0, op1, op2, op3);
-
-  if (enableCounters_ and prevCountersCsrOn_)
-    updatePerformanceCounters(inst, info, op0, op1);
-  prevCountersCsrOn_ = countersCsrOn_;
-
-  // We do not update the instruction stats if an instruction causes
-  // an exception unless it is an ebreak or an ecall.
+  // We do not update the performance counters if an instruction
+  // causes an exception unless it is an ebreak or an ecall.
+  const InstInfo& info = *di.info_;
   InstId id = info.instId();
   if (hasException_ and id != InstId::ecall and id != InstId::ebreak and
       id != InstId::c_ebreak)
     return;
 
-  misalignedLdSt_ = false;
-  lastBranchTaken_ = false;
-
-  if (not instFreq_)
-    return;
-
-  InstProfile& entry = instProfileVec_.at(size_t(id));
+  PerfRegs& pregs = csRegs_.mPerfRegs_;
 
-  entry.freq_++;
+  // Add the events that depend on execution to those implied by the
+  // encoding. Only branches set lastBranchTaken_/lastBranchMiss_.
+  auto bit = PerfRegs::eventBit;
+  uint64_t events = di.events_;
 
-  bool hasRd = false;
+  if ((currPc_ & 3) == 0)
+    events |= bit(EventNumber::InstAligned);
+  if (lastBranchTaken_)
+    events |= bit(EventNumber::BranchTaken);
+  if (lastBranchMiss_)
+    events |= bit(EventNumber::BranchMiss);
+  if (misalignedLdSt_)
+    {
+      if (info.isLoad())
+	events |= bit(EventNumber::MisalignLoad);
+      else if (info.isStore())
+	events |= bit(EventNumber::MisalignStore);
+    }
 
-  unsigned rs1 = 0, rs2 = 0;
-  bool hasRs1 = false, hasRs2 = false;
+  pregs.updateCounters(events);
 
-  if (info.ithOperandType(0) == OperandType::IntReg)
+  // Counter modified by csr instruction is not updated.
+  uint64_t csrWrite = bit(EventNumber::CsrWrite) | bit(EventNumber::CsrReadWrite);
+  if (info.isCsr() and (events & csrWrite))
     {
-      hasRd = info.isIthOperandWrite(0);
-      if (hasRd)
-	entry.rd_.at(op0)++;
-      else
+      CsrNumber csr = CsrNumber(di.op2_);
+      unsigned counterIx = ~0u;
+      if (csr >= CsrNumber::MHPMCOUNTER3 and csr <= CsrNumber::MHPMCOUNTER31)
+	counterIx = unsigned(csr) - unsigned(CsrNumber::MHPMCOUNTER3);
+      else if (csr >= CsrNumber::MHPMEVENT3 and csr <= CsrNumber::MHPMEVENT31)
+	counterIx = unsigned(csr) - unsigned(CsrNumber::MHPMEVENT3);
+
+      if (pregs.isModified(counterIx))
 	{
-	  rs1 = op0;
-	  entry.rs1_.at(rs1)++;
-	  hasRs1 = true;
+	  URV val;
+	  CsrNumber counter = CsrNumber(counterIx + unsigned(CsrNumber::MHPMCOUNTER3));
+	  peekCsr(counter, val);
+	  pokeCsr(counter, val - 1);
 	}
     }
 
-  bool hasImm = false;  // True if instruction has an immediate operand.
-  int32_t imm = 0;     // Value of immediate operand.
+  pregs.clearModified();
+}
 
-  if (info.ithOperandType(1) == OperandType::IntReg)
-    {
-      if (hasRd)
-	{
-	  rs1 = op1;
-	  entry.rs1_.at(rs1)++;
-	  hasRs1 = true;
-	}
+
+template <typename URV>
+void
+Core<URV>::updateBranchPredictor(uint32_t inst, const InstInfo& info,
+				 uint32_t op0, uint32_t op1, int32_t op2)
+{
+  InstId id = info.instId();
+  URV fallThrough = currPc_ + instructionSize(inst);
+  URV target = pc_;
+  BranchKind kind = BranchKind::Conditional;
+
+  auto isLink = [] (unsigned reg) -> bool {
+		  return reg == RegRa or reg == RegT0;
+		};
+
+  if (id == InstId::jal or id == InstId::c_jal or id == InstId::c_j)
+    kind = isLink(op0) ? BranchKind::Call : BranchKind::Jump;
+  else if (id == InstId::jalr or id == InstId::c_jr or id == InstId::c_jalr)
+    {
+      if (isLink(op0))
+	kind = BranchKind::IndirectCall;
+      else if (isLink(op1))
+	kind = BranchKind::Return;
       else
-	{
-	  rs2 = op1;
-	  entry.rs2_.at(rs2)++;
-	  hasRs2 = true;
-	}
+	kind = BranchKind::Indirect;
+    }
+  else
+    target = currPc_ + SRV(op2);  // Taken-target of conditional branch.
+
+  lastBranchMiss_ = branchPred_->update(currPc_, kind, lastBranchTaken_,
+					target, fallThrough);
+}
+
+
+template <typename URV>
+void
+Core<URV>::updateFunctionalCoverage(uint32_t inst, const DecodedInst& di)
+{
+  typedef FuncCoverage FC;
+
+  const InstInfo& info = *di.info_;
+  uint32_t ops[4] = { di.op0_, di.op1_, uint32_t(di.op2_), uint32_t(di.op3_) };
+
+  uint32_t bins = FC::binMask(FC::Executed);
+
+  bool hasRd = (info.ithOperandType(0) == OperandType::IntReg and
+		info.isIthOperandWrite(0));
+  unsigned sources[2] = { 0, 0 };
+  unsigned sourceCount = 0;
+  bool hasImm = false;
+  unsigned immIx = 0;
+
+  for (unsigned i = 0; i < info.operandCount(); ++i)
+    {
+      if (info.isIthOperandIntRegSource(i))
+	{
+	  if (sourceCount < 2)
+	    sources[sourceCount] = ops[i];
+	  sourceCount++;
+	  if (ops[i] == 0)
+	    bins |= FC::binMask(FC::SrcX0);
+	}
+      else if (info.ithOperandType(i) == OperandType::Imm and not hasImm)
+	{
+	  hasImm = true;
+	  immIx = i;
+	}
+    }
+
+  if (hasRd and ops[0] == 0)
+    bins |= FC::binMask(FC::RdX0);
+  if (hasRd and sourceCount >= 1 and sources[0] == ops[0])
+    bins |= FC::binMask(FC::RdEqRs1);
+  if (sourceCount >= 2 and sources[0] == sources[1])
+    bins |= FC::binMask(FC::Rs1EqRs2);
+
+  if (hasImm)
+    {
+      int32_t imm = int32_t(ops[immIx]);
+      if (imm == 0)
+	bins |= FC::binMask(FC::ImmZero);
+      else if (imm < 0)
+	bins |= FC::binMask(FC::ImmNegative);
+
+      // Extreme values are checked on the encoded field.
+      uint32_t mask = info.ithOperandMask(immIx);
+      if (mask)
+	{
+	  uint32_t field = inst & mask;
+	  bool isSigned = mask >> 31;
+	  uint32_t top = uint32_t(1) << (31 - __builtin_clz(mask));
+	  if (isSigned and field == top)
+	    bins |= FC::binMask(FC::ImmMin);
+	  if (field == (isSigned ? mask & ~top : mask))
+	    bins |= FC::binMask(FC::ImmMax);
+	}
+    }
+
+  if (misalignedLdSt_)
+    bins |= FC::binMask(FC::Misaligned);
+
+  if (info.type() == InstType::Fp and isFullSizeInst(inst) and
+      (info.codeMask() & 0x7000) == 0 and not info.isLoad() and
+      not info.isStore())
+    {
+      unsigned rm = (inst >> 12) & 7;
+      if (rm <= 4)
+	bins |= FC::binMask(FC::Bin(FC::RmNearestEven + rm));
+      else if (rm == 7)
+	bins |= FC::binMask(FC::RmDynamic);
+    }
+
+  InstId id = info.instId();
+  funcCov_->record(id, bins);
+
+  if (info.isCsr())
+    {
+      // csrrw/csrrwi with rd=x0 do not read. Set/clear with rs1=x0 or
+      // zero immediate do not write.
+      unsigned csr = unsigned(di.op2_);
+      if (id == InstId::csrrw or id == InstId::csrrwi)
+	funcCov_->recordCsr(csr, di.op0_ != 0, true);
+      else
+	funcCov_->recordCsr(csr, true, di.op1_ != 0);
+    }
+}
+
+
+template <typename URV>
+void
+Core<URV>::accumulateInstructionStats(uint32_t inst)
+{
+  const DecodedInst& di = decodeCached(inst);
+  const InstInfo& info = *di.info_;
+  uint32_t op0 = di.op0_, op1 = di.op1_;
+  int32_t op2 = di.op2_;
+
+  if (branchPred_ and info.isBranch() and not hasException_)
+    updateBranchPredictor(inst, info, op0, op1, op2);
+
+  if (funcCov_ and not hasException_)
+    updateFunctionalCoverage(inst, di);
+
+  if (enableCounters_ and prevCountersCsrOn_ and
+      csRegs_.mPerfRegs_.activeEvents())
+    updatePerformanceCounters(di);
+  prevCountersCsrOn_ = countersCsrOn_;
+
+  // Events of this instruction must not leak into the next one, even
+  // if it took an exception.
+  misalignedLdSt_ = false;
+  lastBranchTaken_ = false;
+  lastBranchMiss_ = false;
+
+  // We do not update the instruction stats if an instruction causes
+  // an exception unless it is an ebreak or an ecall.
+  InstId id = info.instId();
+  if (hasException_ and id != InstId::ecall and id != InstId::ebreak and
+      id != InstId::c_ebreak)
+    return;
+
+  if (not instFreq_)
+    return;
+
+  InstProfile& entry = instProfileVec_[size_t(id)];
+
+  if (entry.freq_++ == 0)
+    {
+      auto regCount = intRegCount();
+      entry.rd_.resize(regCount);
+      entry.rs1_.resize(regCount);
+      entry.rs2_.resize(regCount);
+    }
+
+  bool hasRd = false;
+
+  unsigned rs1 = 0, rs2 = 0;
+  bool hasRs1 = false, hasRs2 = false;
+
+  if (info.ithOperandType(0) == OperandType::IntReg)
+    {
+      hasRd = info.isIthOperandWrite(0);
+      if (hasRd)
+	entry.rd_[op0]++;
+      else
+	{
+	  rs1 = op0;
+	  entry.rs1_[rs1]++;
+	  hasRs1 = true;
+	}
+    }
+
+  bool hasImm = false;  // True if instruction has an immediate operand.
+  int32_t imm = 0;     // Value of immediate operand.
+
+  if (info.ithOperandType(1) == OperandType::IntReg)
+    {
+      if (hasRd)
+	{
+	  rs1 = op1;
+	  entry.rs1_[rs1]++;
+	  hasRs1 = true;
+	}
+      else
+	{
+	  rs2 = op1;
+	  entry.rs2_[rs2]++;
+	  hasRs2 = true;
+	}
     }
   else if (info.ithOperandType(1) == OperandType::Imm)
     {
@@ -2354,7 +2808,7 @@ Core<URV>::accumulateInstructionStats(uint32_t inst)
       if (hasRd)
 	{
 	  rs2 = op2;
-	  entry.rs2_.at(rs2)++;
+	  entry.rs2_[rs2]++;
 	  hasRs2 = true;
 	}
       else
@@ -2418,7 +2872,9 @@ Core<URV>::clearTraceData()
   intRegs_.clearLastWrittenReg();
   fpRegs_.clearLastWrittenReg();
   csRegs_.clearLastWrittenRegs();
-  memory_.clearLastWriteInfo();
+  vecRegs_.clearLastWrittenReg();
+  lastWrite_.clear();
+  vecWrites_.clear();
 }
 
 
@@ -2534,23 +2990,10 @@ Core<URV>::lastMemory(std::vector<size_t>& addresses,
   addresses.clear();
   words.clear();
 
-  size_t address = 0;
-  uint64_t value;
-  unsigned writeSize = memory_.getLastWriteNewValue(address, value);
-
-  if (not writeSize)
-    return;
-
-  addresses.clear();
-  words.clear();
-  addresses.push_back(address);
-  words.push_back(uint32_t(value));
-
-  if (writeSize == 8)
-    {
-      addresses.push_back(address + 4);
-      words.push_back(uint32_t(value >> 32));
-    }
+  forEachMemoryChange([&addresses, &words] (size_t address, uint32_t word) {
+      addresses.push_back(address);
+      words.push_back(word);
+    });
 }
 
 
@@ -2638,13 +3081,31 @@ Core<URV>::untilAddress(URV address, FILE* traceFile)
   bool trace = traceFile != nullptr or enableTriggers_;
   clearTraceData();
 
+  // The debugger may move the hart in time (see gotoInstruction):
+  // Read the instruction count after it.
+  if (enableGdb_ and not replaying_)
+    handleExceptionForGdb(*this);
+
   uint64_t counter = counter_;
   uint64_t limit = instCountLim_;
   bool success = true;
-  bool doStats = instFreq_ or enableCounters_;
+  bool doStats = (instFreq_ or enableCounters_ or branchPred_ or
+		  funcCov_);
 
-  if (enableGdb_)
-    handleExceptionForGdb(*this);
+  // With reverse execution on, counter_ is kept current for the
+  // snapshots and for the debugger. A debugger stop (breakpoint or
+  // ebreak) may step or move the hart in time changing counter_.
+  bool timeTravel = snapshotPeriod_ != 0;
+  uint64_t stoppedAt = ~uint64_t(0);  // Count of last breakpoint stop.
+
+  // Flags are accrued after each instruction: Traces and triggers see
+  // exact FCSR values.
+  beginFpSession(false);
+
+  // Intercepted library routines are interpreted when their
+  // instructions must be observed.
+  bool intercept = (not intercepts_.empty() and not trace and
+		    not enableGdb_ and not timeTravel);
 
   uint32_t inst = 0;
 
@@ -2654,8 +3115,37 @@ Core<URV>::untilAddress(URV address, FILE* traceFile)
 
       try
 	{
+	  if (timeTravel)
+	    {
+	      counter_ = counter;
+	      if (counter >= nextSnapshot_)
+		takeSnapshot();
+	      if (not breakpoints_.empty() and breakpoints_.count(pc_) and
+		  counter != stoppedAt)
+		{
+		  if (replaying_)
+		    {
+		      breakpointHit_ = true;
+		      lastBreakpoint_ = counter;
+		    }
+		  else if (enableGdb_)
+		    {
+		      handleExceptionForGdb(*this);
+		      stoppedAt = counter = counter_;
+		      continue;
+		    }
+		}
+	    }
+
 	  currPc_ = pc_;
 
+	  if (intercept and atIntercept() and
+	      limit - counter >= interceptInsts_ and interceptCall())
+	    {
+	      counter += interceptInsts_;
+	      continue;
+	    }
+
 	  loadAddrValid_ = false;
 	  triggerTripped_ = false;
 	  hasException_ = false;
@@ -2706,10 +3196,18 @@ Core<URV>::untilAddress(URV address, FILE* traceFile)
 	      execute16(uint16_t(inst));
 	    }
 
+	  if (timeTravel and counter_ + 1 != counter)
+	    {
+	      stoppedAt = counter = counter_;  // Moved by the debugger.
+	      continue;
+	    }
+
 	  ++cycleCount_;
 
 	  if (hasException_)
 	    {
+	      if (doStats)
+		accumulateInstructionStats(inst);
 	      if (traceFile)
 		{
 		  printInstTrace(inst, counter, instStr, traceFile);
@@ -2723,13 +3221,18 @@ Core<URV>::untilAddress(URV address, FILE* traceFile)
 	      undoForTrigger();
 	      if (takeTriggerAction(traceFile, currPc_, currPc_,
 				    counter, true))
-		return true;
+		{
+		  endFpSession();
+		  return true;
+		}
 	      continue;
 	    }
 
 	  ++retiredInsts_;
 	  if (doStats)
 	    accumulateInstructionStats(inst);
+	  if (coverage_)
+	    coverage_->record(currPc_, pc_ != currPc_ + instructionSize(inst));
 
 	  bool icountHit = (enableTriggers_ and isInterruptEnabled() and
 			    icountTriggerHit());
@@ -2743,12 +3246,17 @@ Core<URV>::untilAddress(URV address, FILE* traceFile)
 
 	  if (icountHit)
 	    if (takeTriggerAction(traceFile, pc_, pc_, counter, false))
-	      return true;
+	      {
+		endFpSession();
+		return true;
+	      }
 	}
       catch (const CoreException& ce)
 	{
 	  if (ce.type() == CoreException::Stop)
 	    {
+	      if (coverage_)
+		coverage_->record(currPc_, false);
 	      if (trace)
 		{
 		  uint32_t inst = 0;
@@ -2760,25 +3268,29 @@ Core<URV>::untilAddress(URV address, FILE* traceFile)
 	      success = ce.value() == 1; // Anything besides 1 is a fail.
 	      {
 		std::lock_guard<std::mutex> guard(printInstTraceMutex);
-		std::cerr << (success? "Successful " : "Error: Failed ")
-			  << "stop: " << ce.what() << ": " << ce.value()
-			  << "\n";
-		setTargetProgramFinished(true);
+		if (not replaying_)
+		  std::cerr << (success? "Successful " : "Error: Failed ")
+			    << "stop: " << ce.what() << ": " << ce.value()
+			    << "\n";
+		recordStop(ce);
 	      }
 	      break;
 	    }
 	  if (ce.type() == CoreException::Exit)
 	    {
 	      std::lock_guard<std::mutex> guard(printInstTraceMutex);
-	      std::cerr << "Target program exited with code " << ce.value()
-			<< '\n';
-	      setTargetProgramFinished(true);
+	      if (not replaying_)
+		std::cerr << "Target program exited with code " << ce.value()
+			  << '\n';
+	      recordStop(ce);
 	      break;
 	    }
 	  std::cerr << "Stopped -- unexpected exception\n";
 	}
     }
 
+  endFpSession();
+
   // Update retired-instruction and cycle count registers.
   counter_ = counter;
 
@@ -2834,16 +3346,120 @@ Core<URV>::runUntilAddress(URV address, FILE* traceFile)
   uint64_t numInsts = counter_ - counter0;
 
   reportInstsPerSec(numInsts, elapsed, not userOk);
+  printTlbStats(std::cerr);
+  return success;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::runQuantum(uint64_t count, FILE* traceFile, bool& done)
+{
+  URV address = ~URV(0);  // Invalid stop PC.
+  if (stopAddrValid_ and not toHostValid_)
+    address = stopAddr_;
+
+  // Temporarily lower the instruction count limit to the end of the
+  // quantum.
+  uint64_t limit = instCountLim_;
+  bool success = true;
+  if (counter_ < limit)
+    {
+      if (count < limit - counter_)
+	instCountLim_ = counter_ + count;
+      success = untilAddress(address, traceFile);
+      instCountLim_ = limit;
+    }
+
+  done = hasTargetProgramFinished() or not userOk;
+  if (not done and counter_ >= limit)
+    {
+      std::cerr << "Stopped -- Reached instruction limit\n";
+      done = true;
+    }
+  else if (not done and pc_ == address)
+    {
+      std::cerr << "Stopped -- Reached end address\n";
+      done = true;
+    }
+
   return success;
 }
 
 
+template <typename URV>
+bool
+Core<URV>::probeSpinLoop(unsigned count, FILE* traceFile, bool& done,
+			 bool& spinning)
+{
+  spinning = false;
+  done = false;
+
+  if (spinProbeWait_)
+    {
+      --spinProbeWait_;
+      return true;
+    }
+
+  // Back off until a probe succeeds.
+  spinProbeBackoff_ = std::min(2*spinProbeBackoff_ + 1, 63u);
+  spinProbeWait_ = spinProbeBackoff_;
+
+  URV pc0 = pc_;
+  spinIntRegs_.resize(intRegCount());
+  for (unsigned i = 0; i < spinIntRegs_.size(); ++i)
+    spinIntRegs_[i] = peekIntReg(i);
+
+  spinFpRegs_.resize(fpRegCount());
+  for (unsigned i = 0; i < spinFpRegs_.size(); ++i)
+    peekFpReg(i, spinFpRegs_[i]);
+
+  uint64_t writes0 = memWriteCount_;
+
+  for (unsigned n = 0; n < count; ++n)
+    {
+      if (not runQuantum(1, traceFile, done))
+	return false;
+      if (done or memWriteCount_ != writes0)
+	return true;
+      if (pc_ != pc0)
+	continue;
+
+      bool same = true;
+      for (unsigned i = 0; i < spinIntRegs_.size() and same; ++i)
+	same = peekIntReg(i) == spinIntRegs_[i];
+      for (unsigned i = 0; i < spinFpRegs_.size() and same; ++i)
+	{
+	  uint64_t val = 0;
+	  peekFpReg(i, val);
+	  same = val == spinFpRegs_[i];
+	}
+      if (same)
+	{
+	  spinning = true;
+	  spinProbeBackoff_ = spinProbeWait_ = 0;
+	  return true;
+	}
+    }
+
+  return true;
+}
+
+
 template <typename URV>
 bool
 Core<URV>::simpleRun()
 {
   bool success = true;
 
+  // Performance counters and functional coverage are the only
+  // statistics that do not force the use of untilAddress.
+  bool doStats = enableCounters_ or funcCov_;
+
+  // FP flags accrue in the host and reach FCSR when it is accessed or
+  // when the session ends.
+  beginFpSession(true);
+
   try
     {
       while (userOk) 
@@ -2870,7 +3486,15 @@ Core<URV>::simpleRun()
 	    }
 
 	  if (not hasException_)
-	    ++retiredInsts_;
+	    {
+	      ++retiredInsts_;
+	      if (doStats)
+		accumulateInstructionStats(inst);
+	      if (coverage_)
+		coverage_->record(currPc_, pc_ != currPc_ + instructionSize(inst));
+	    }
+	  else if (doStats)
+	    accumulateInstructionStats(inst);  // Counts ecall/ebreak.
 	}
     }
   catch (const CoreException& ce)
@@ -2880,16 +3504,18 @@ Core<URV>::simpleRun()
       if (ce.type() == CoreException::Stop)
 	{
 	  ++retiredInsts_;
+	  if (coverage_)
+	    coverage_->record(currPc_, false);
 	  success = ce.value() == 1; // Anything besides 1 is a fail.
 	  std::cerr << (success? "Successful " : "Error: Failed ")
 		    << "stop: " << ce.what() << ": " << ce.value() << '\n';
-	  setTargetProgramFinished(true);
+	  recordStop(ce);
 	}
       else if (ce.type() == CoreException::Exit)
 	{
 	  std::cerr << "Target program exited with code " << ce.value() << '\n';
 	  success = ce.value() == 0;
-	  setTargetProgramFinished(true);
+	  recordStop(ce);
 	}
       else
 	{
@@ -2898,10 +3524,22 @@ Core<URV>::simpleRun()
 	}
     }
 
+  endFpSession();
   return success;
 }
 
 
+template <typename URV>
+void
+Core<URV>::recordStop(const CoreException& ce)
+{
+  setTargetProgramFinished(true);
+  stopped_ = true;
+  stopByExit_ = ce.type() == CoreException::Exit;
+  stopValue_ = ce.value();
+}
+
+
 /// Run indefinitely.  If the tohost address is defined, then run till
 /// a write is attempted to that address.
 template <typename URV>
@@ -2918,7 +3556,8 @@ Core<URV>::run(FILE* file)
   // execution. If any option is turned on, we switch to
   // runUntilAdress which runs slower but is full-featured.
   if (file or instCountLim_ < ~uint64_t(0) or instFreq_ or enableTriggers_ or
-      enableCounters_ or enableGdb_)
+      enableGdb_ or branchPred_ or not intercepts_.empty() or
+      snapshotPeriod_)
     {
       URV address = ~URV(0);  // Invalid stop PC.
       return runUntilAddress(address, file);
@@ -2927,6 +3566,8 @@ Core<URV>::run(FILE* file)
   struct timeval t0;
   gettimeofday(&t0, nullptr);
 
+  uint64_t retired0 = retiredInsts_;
+
 #ifdef __MINGW64__
   __p_sig_fn_t oldAction = nullptr;
   __p_sig_fn_t newAction = keyboardInterruptHandler;
@@ -2958,11 +3599,28 @@ Core<URV>::run(FILE* file)
 		    double(t1.tv_usec - t0.tv_usec)*1e-6);
 
   reportInstsPerSec(retiredInsts_, elapsed, not userOk);
+  printTlbStats(std::cerr);
+
+  // The fast path does not maintain the instruction counter.
+  counter_ += retiredInsts_ - retired0;
 
   return success;
 }
 
 
+template <typename URV>
+bool
+Core<URV>::isInterruptPending()
+{
+  URV mip = 0, mie = 0;
+  if (csRegs_.read(CsrNumber::MIP, PrivilegeMode::Machine, debugMode_, mip)
+      and
+      csRegs_.read(CsrNumber::MIE, PrivilegeMode::Machine, debugMode_, mie))
+    return (mip & mie) != 0;
+  return false;
+}
+
+
 template <typename URV>
 bool
 Core<URV>::isInterruptPossible(InterruptCause& cause)
@@ -2976,50 +3634,47 @@ Core<URV>::isInterruptPossible(InterruptCause& cause)
     return false;
 
   MstatusFields<URV> fields(mstatus);
-  if (not fields.bits_.MIE)
-    return false;
 
   URV mip, mie;
-  if (csRegs_.read(CsrNumber::MIP, PrivilegeMode::Machine, debugMode_, mip)
-      and
-      csRegs_.read(CsrNumber::MIE, PrivilegeMode::Machine, debugMode_, mie))
-    {
-      if ((mie & mip) == 0)
-	return false;  // Nothing enabled is pending.
+  if (not csRegs_.read(CsrNumber::MIP, PrivilegeMode::Machine, debugMode_, mip)
+      or
+      not csRegs_.read(CsrNumber::MIE, PrivilegeMode::Machine, debugMode_, mie))
+    return false;
 
-      // Order of priority: machine, supervisor, user and then
-      // external, software, timer and internal timers.
-      if (mie & (1 << unsigned(InterruptCause::M_EXTERNAL)) & mip)
-	{
-	  cause = InterruptCause::M_EXTERNAL;
-	  return true;
-	}
-      if (mie & (1 << unsigned(InterruptCause::M_LOCAL)) & mip)
-	{
-	  cause = InterruptCause::M_LOCAL;
-	  return true;
-	}
-      if (mie & (1 << unsigned(InterruptCause::M_SOFTWARE)) & mip)
-	{
-	  cause = InterruptCause::M_SOFTWARE;
-	  return true;
-	}
-      if (mie & (1 << unsigned(InterruptCause::M_TIMER)) & mip)
-	{
-	  cause = InterruptCause::M_TIMER;
-	  return true;
-	}
-      if (mie & (1 << unsigned(InterruptCause::M_INT_TIMER0)) & mip)
-	{
-	  cause = InterruptCause::M_INT_TIMER0;
-	  return true;
-	}
-      if (mie & (1 << unsigned(InterruptCause::M_INT_TIMER1)) & mip)
-	{
-	  cause = InterruptCause::M_INT_TIMER1;
-	  return true;
-	}
-    }
+  URV pending = mie & mip;
+  if (pending == 0)
+    return false;  // Nothing enabled is pending.
+
+  // Interrupts delegated in mideleg are taken in supervisor mode: They
+  // are enabled below supervisor mode and by SIE in supervisor
+  // mode. The others are taken in machine mode: They are enabled below
+  // machine mode and by MIE in machine mode.
+  URV mideleg = 0;
+  if (rvs_)
+    peekCsr(CsrNumber::MIDELEG, mideleg);
+
+  URV enabled = 0;
+  if (privMode_ < PrivilegeMode::Machine or fields.bits_.MIE)
+    enabled |= ~mideleg;
+  if (privMode_ < PrivilegeMode::Supervisor or
+      (privMode_ == PrivilegeMode::Supervisor and fields.bits_.SIE))
+    enabled |= mideleg;
+
+  pending &= enabled;
+  if (pending == 0)
+    return false;
+
+  // Order of priority: machine, supervisor, user and then
+  // external, software, timer and internal timers.
+  typedef InterruptCause IC;
+  for (IC ic : { IC::M_EXTERNAL, IC::M_LOCAL, IC::M_SOFTWARE, IC::M_TIMER,
+		 IC::M_INT_TIMER0, IC::M_INT_TIMER1, IC::S_EXTERNAL,
+		 IC::S_SOFTWARE, IC::S_TIMER } )
+    if (pending & (URV(1) << unsigned(ic)))
+      {
+	cause = ic;
+	return true;
+      }
 
   return false;
 }
@@ -3091,6 +3746,14 @@ Core<URV>::singleStep(FILE* traceFile)
   // know the changes after the execution of each instruction.
   bool doStats = instFreq_ or enableCounters_;
 
+  // Host flags raised outside this step must not reach FCSR. Flags are
+  // accrued eagerly so there is no session end: The host rounding
+  // mode of the step lingers until the next session begins.
+  beginFpSession(false);
+
+  if (counter_ >= nextSnapshot_)
+    takeSnapshot();
+
   try
     {
       uint32_t inst = 0;
@@ -3225,13 +3888,13 @@ Core<URV>::singleStep(FILE* traceFile)
 	  if (traceFile)
 	    printInstTrace(inst, counter_, instStr, traceFile);
 	  std::cerr << "Stopped...\n";
-	  setTargetProgramFinished(true);
+	  recordStop(ce);
 	}
       else if (ce.type() == CoreException::Exit)
 	{
 	  std::lock_guard<std::mutex> guard(printInstTraceMutex);
 	  std::cerr << "Target program exited with code " << ce.value() << '\n';
-	  setTargetProgramFinished(true);
+	  recordStop(ce);
 	}
       else
 	std::cerr << "Unexpected exception\n";
@@ -3243,13 +3906,92 @@ template <typename URV>
 bool
 Core<URV>::whatIfSingleStep(uint32_t inst, ChangeRecord& record)
 {
-  uint64_t prevExceptionCount = exceptionCount_;
-  URV prevPc = pc_;
+  if (not whatIfBegin())
+    return false;
 
-  clearTraceData();
+  bool result = whatIfStep(inst, record);
+  whatIfEnd();
+  return result;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::whatIfSingleStep(URV whatIfPc, uint32_t inst, ChangeRecord& record)
+{
+  if (not whatIfBegin())
+    return false;
+
+  pc_ = whatIfPc;
   triggerTripped_ = false;
 
-  // Note: triggers not yet supported.
+  // Fetch instruction. We don't care about what we fetch. Just checking
+  // if there is a fetch exception.
+  bool result = false;
+  uint32_t dummyInst = 0;
+  if (fetchInst(pc_, dummyInst))
+    result = whatIfStep(inst, record);
+  else
+    {
+      logWhatIfChanges(record);
+      record.hasException = true;
+    }
+
+  whatIfEnd();
+  return result;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::whatIfBegin()
+{
+  if (inWhatIf_)
+    {
+      std::cerr << "Error: Hart " << hartId_ << ": What-if sequences "
+		<< "cannot be nested\n";
+      return false;
+    }
+
+  inWhatIf_ = true;
+  undoLog_.clear();
+  whatIfCsrs_.clear();
+  transferHartState(whatIfState_, true);
+  virtMem_.setUndoLog(&undoLog_);
+  memory_.setUndoLog(&undoLog_);
+  return true;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::whatIfStep(uint32_t inst, ChangeRecord& record)
+{
+  record.clear();
+  if (not inWhatIf_)
+    {
+      std::cerr << "Error: Hart " << hartId_ << ": What-if step outside "
+		<< "of a what-if sequence\n";
+      return false;
+    }
+
+  uint64_t prevExceptionCount = exceptionCount_;
+
+  clearTraceData();
+  triggerTripped_ = false;
+
+  // Vector registers are modified in place: Save all of them before
+  // the first instruction that may write one (vector arithmetic or
+  // vector load).
+  if (rvv_ and not whatIfState_.vecSaved_ and isFullSizeInst(inst))
+    {
+      unsigned opcode = inst & 0x7f;
+      if (opcode == 0x57 or opcode == 0x07)
+	{
+	  whatIfState_.vecData_ = vecRegs_.data_;
+	  whatIfState_.vecSaved_ = true;
+	}
+    }
 
   // Execute instruction
   currPc_ = pc_;
@@ -3272,51 +4014,18 @@ Core<URV>::whatIfSingleStep(uint32_t inst, ChangeRecord& record)
   if (dcsrStep_ and not ebreakInstDebug_)
     enterDebugMode(DebugModeCause::STEP, pc_);
 
-  // Collect changes. Undo each collected change.
-  exceptionCount_ = prevExceptionCount;
-
-  collectAndUndoWhatIfChanges(prevPc, record);
-  
+  logWhatIfChanges(record);
+  record.hasException = not result;
   return result;
 }
 
 
-template <typename URV>
-bool
-Core<URV>::whatIfSingleStep(URV whatIfPc, uint32_t inst, ChangeRecord& record)
-{
-  URV prevPc = pc_;
-  pc_ = whatIfPc;
-
-  // Note: triggers not yet supported.
-  triggerTripped_ = false;
-
-  // Fetch instruction. We don't care about what we fetch. Just checking
-  // if there is a fetch exception.
-  uint32_t dummyInst = 0;
-  bool fetchOk = fetchInst(pc_, dummyInst);
-
-  if (not fetchOk)
-    {
-      collectAndUndoWhatIfChanges(prevPc, record);
-      return false;
-    }
-
-  bool res = whatIfSingleStep(inst, record);
-
-  pc_ = prevPc;
-  return res;
-}
-
-
 template <typename URV>
 void
-Core<URV>::collectAndUndoWhatIfChanges(URV prevPc, ChangeRecord& record)
+Core<URV>::logWhatIfChanges(ChangeRecord& record)
 {
   record.clear();
-
   record.newPc = pc_;
-  pc_ = prevPc;
 
   unsigned regIx = 0;
   URV oldValue = 0;
@@ -3324,7 +4033,7 @@ Core<URV>::collectAndUndoWhatIfChanges(URV prevPc, ChangeRecord& record)
     {
       URV newValue = 0;
       peekIntReg(regIx, newValue);
-      pokeIntReg(regIx, oldValue);
+      undoLog_.add(UndoLog::Kind::IntReg, regIx, oldValue);
 
       record.hasIntReg = true;
       record.intRegIx = regIx;
@@ -3336,45 +4045,364 @@ Core<URV>::collectAndUndoWhatIfChanges(URV prevPc, ChangeRecord& record)
     {
       uint64_t newFpValue = 0;
       peekFpReg(regIx, newFpValue);
-      pokeFpReg(regIx, oldFpValue);
+      undoLog_.add(UndoLog::Kind::FpReg, regIx, oldFpValue);
 
       record.hasFpReg = true;
       record.fpRegIx = regIx;
       record.fpRegValue = newFpValue;
     }
 
-  record.memSize = memory_.getLastWriteNewValue(record.memAddr, record.memValue);
+  // Memory was logged as written (see Memory::noteWrite).
+  record.memSize = getLastWriteNewValue(record.memAddr, record.memValue);
+
+  // Only the first previous value of a CSR within the sequence is
+  // needed to undo it.
+  for (CsrNumber csrn : csRegs_.lastWrittenRegs())
+    {
+      Csr<URV>* csr = csRegs_.getImplementedCsr(csrn);
+      if (not csr)
+	continue;
+
+      if (not whatIfCsrs_.contains(csrn))
+	{
+	  whatIfCsrs_.insert(csrn);
+	  undoLog_.add(UndoLog::Kind::Csr, unsigned(csrn), csr->prevValue());
+	}
+
+      record.csrIx.push_back(csrn);
+      record.csrValue.push_back(csr->read());
+    }
+}
+
+
+template <typename URV>
+void
+Core<URV>::whatIfEnd()
+{
+  if (not inWhatIf_)
+    return;
+
+  virtMem_.setUndoLog(nullptr);
+  memory_.setUndoLog(nullptr);
 
-  size_t addr = 0;
-  uint64_t value = 0;
-  size_t byteCount = memory_.getLastWriteOldValue(addr, value);
-  for (size_t i = 0; i < byteCount; ++i)
+  bool pteChanged = false;
+  const auto& entries = undoLog_.entries();
+  for (auto iter = entries.rbegin(); iter != entries.rend(); ++iter)
     {
-      uint8_t byte = value & 0xff;
-      memory_.poke(addr, byte);
-      addr++;
-      value = value >> 8;
+      const UndoLog::Entry& entry = *iter;
+      switch (entry.kind_)
+	{
+	case UndoLog::Kind::IntReg:
+	  pokeIntReg(entry.index_, entry.value_);
+	  break;
+
+	case UndoLog::Kind::FpReg:
+	  pokeFpReg(entry.index_, entry.value_);
+	  break;
+
+	case UndoLog::Kind::Csr:
+	  {
+	    Csr<URV>* csr = csRegs_.getImplementedCsr(CsrNumber(entry.index_));
+	    if (csr)
+	      csr->pokeNoMask(entry.value_);
+	  }
+	  break;
+
+	case UndoLog::Kind::Pte:
+	  pteChanged = true;
+	  [[fallthrough]];
+
+	case UndoLog::Kind::Memory:
+	  {
+	    uint64_t value = entry.value_;
+	    for (unsigned i = 0; i < entry.size_; ++i, value >>= 8)
+	      memory_.poke(entry.index_ + i, uint8_t(value));
+	  }
+	  break;
+	}
     }
 
-  std::vector<CsrNumber> csrNums;
-  std::vector<unsigned> triggerNums;
-  csRegs_.getLastWrittenRegs(csrNums, triggerNums);
+  transferHartState(whatIfState_, false);
 
-  for (auto csrn : csrNums)
+  // Refresh the state derived from the restored CSRs (PMP regions,
+  // translation, vector configuration, cached fields). Trigger CSRs
+  // were restored with the triggers.
+  for (const auto& entry : entries)
     {
-      Csr<URV>* csr = csRegs_.getImplementedCsr(csrn);
+      CsrNumber csrn = CsrNumber(entry.index_);
+      if (entry.kind_ == UndoLog::Kind::Csr and
+	  (csrn < CsrNumber::TDATA1 or csrn > CsrNumber::TDATA3))
+	pokeCsr(csrn, entry.value_);
+    }
+
+  if (pteChanged)
+    virtMem_.flush(true, 0, true, 0);
+  updateTranslation();
+
+  clearTraceData();
+  undoLog_.clear();
+  whatIfCsrs_.clear();
+  inWhatIf_ = false;
+}
+
+
+template <typename URV>
+void
+Core<URV>::transferHartState(HartState& st, bool save)
+{
+  auto xfer = [save] (auto& live, auto& saved) {
+    if (save)
+      saved = live;
+    else
+      live = saved;
+  };
+
+  xfer(pc_, st.pc_); xfer(currPc_, st.currPc_); xfer(progBreak_, st.progBreak_);
+  xfer(hasException_, st.hasException_);
+  xfer(csrException_, st.csrException_);
+  xfer(triggerTripped_, st.triggerTripped_);
+  xfer(hasLr_, st.hasLr_); xfer(lrAddr_, st.lrAddr_);
+  xfer(lrSize_, st.lrSize_); xfer(lrValue_, st.lrValue_);
+  xfer(lastBranchTaken_, st.lastBranchTaken_);
+  xfer(lastBranchMiss_, st.lastBranchMiss_);
+  xfer(misalignedLdSt_, st.misalignedLdSt_);
+  xfer(retiredInsts_, st.retiredInsts_); xfer(cycleCount_, st.cycleCount_);
+  xfer(counter_, st.counter_);
+  xfer(exceptionCount_, st.exceptionCount_);
+  xfer(interruptCount_, st.interruptCount_);
+  xfer(consecutiveIllegalCount_, st.consecutiveIllegalCount_);
+  xfer(counterAtLastIllegal_, st.counterAtLastIllegal_);
+  xfer(prevCountersCsrOn_, st.prevCountersCsrOn_);
+  xfer(countersCsrOn_, st.countersCsrOn_);
+  xfer(nmiPending_, st.nmiPending_); xfer(nmiCause_, st.nmiCause_);
+  xfer(loadAddr_, st.loadAddr_); xfer(loadAddrValid_, st.loadAddrValid_);
+  xfer(storeQueue_, st.storeQueue_); xfer(loadQueue_, st.loadQueue_);
+  xfer(privMode_, st.privMode_);
+  xfer(debugMode_, st.debugMode_); xfer(debugStepMode_, st.debugStepMode_);
+  xfer(dcsrStepIe_, st.dcsrStepIe_); xfer(dcsrStep_, st.dcsrStep_);
+  xfer(ebreakInstDebug_, st.ebreakInstDebug_);
+  xfer(storeErrorRollback_, st.storeErrorRollback_);
+  xfer(loadErrorRollback_, st.loadErrorRollback_);
+  xfer(targetProgFinished_, st.targetProgFinished_);
+  xfer(waitForInterrupt_, st.waitForInterrupt_);
+  xfer(csRegs_.mdseacLocked_, st.mdseacLocked_);
+  xfer(memWriteCount_, st.memWriteCount_);
+  xfer(csRegs_.mPerfRegs_.counters_, st.perfCounters_);
+
+  // These CSRs are changed by pokes that are not recorded as writes
+  // (entering debug mode, store exceptions, writing MEIVT).
+  const CsrNumber pokedCsrs[] = { CsrNumber::DCSR, CsrNumber::DPC,
+				  CsrNumber::MDSEAC, CsrNumber::MEIHAP };
+  for (unsigned i = 0; i < 4; ++i)
+    {
+      Csr<URV>* csr = csRegs_.getImplementedCsr(pokedCsrs[i]);
       if (not csr)
 	continue;
+      if (save)
+	st.pokedCsrs_[i] = csr->read();
+      else
+	csr->pokeNoMask(st.pokedCsrs_[i]);
+    }
+
+  if (save)
+    {
+      memory_.saveReservations(st.reservations_);
+      csRegs_.saveTriggers(st.triggers_);
+      st.vecSaved_ = false;
+    }
+  else
+    {
+      memory_.restoreReservations(st.reservations_);
+      csRegs_.restoreTriggers(st.triggers_);
+      if (st.vecSaved_)
+	vecRegs_.data_ = st.vecData_;
+    }
+}
 
-      URV newVal = csr->read();
-      URV oldVal = csr->prevValue();
-      csr->write(oldVal);
 
-      record.csrIx.push_back(csrn);
-      record.csrValue.push_back(newVal);
+template <typename URV>
+void
+Core<URV>::enableSnapshots(uint64_t period, uint64_t budget)
+{
+  snapshotPeriod_ = period;
+  snapshotBudget_ = budget;
+  nextSnapshot_ = period ? counter_ : ~uint64_t(0);
+}
+
+
+template <typename URV>
+void
+Core<URV>::takeSnapshot()
+{
+  snapshots_.emplace_back();
+  Snapshot& snap = snapshots_.back();
+
+  transferHartState(snap.state_, true);
+  if (rvv_)
+    {
+      snap.state_.vecData_ = vecRegs_.data_;
+      snap.state_.vecSaved_ = true;
+    }
+
+  snap.intRegs_.resize(intRegs_.size());
+  for (unsigned i = 0; i < intRegs_.size(); ++i)
+    snap.intRegs_.at(i) = intRegs_.read(i);
+
+  if (isRvf() or isRvd())
+    {
+      snap.fpRegs_.resize(fpRegs_.size());
+      for (unsigned i = 0; i < fpRegs_.size(); ++i)
+	peekFpReg(i, snap.fpRegs_.at(i));
+    }
+
+  for (const auto& csr : csRegs_.regs_)
+    if (csr.isImplemented())
+      snap.csrs_.emplace_back(csr.getNumber(), csr.read());
+
+  memory_.beginHistoryPeriod();
+  nextSnapshot_ = counter_ + snapshotPeriod_;
+
+  // Snapshots have about the same size: Drop the oldest ones (and
+  // their memory periods) while over budget.
+  size_t snapBytes = (sizeof(snap) + snap.intRegs_.size()*sizeof(URV) +
+		      snap.fpRegs_.size()*sizeof(uint64_t) +
+		      snap.csrs_.size()*sizeof(snap.csrs_.front()) +
+		      snap.state_.vecData_.size());
+  while (snapshots_.size() > 1 and
+	 memory_.historyBytes() + snapshots_.size()*snapBytes > snapshotBudget_)
+    {
+      snapshots_.pop_front();
+      memory_.dropOldestHistoryPeriod();
+    }
+}
+
+
+template <typename URV>
+void
+Core<URV>::restoreSnapshot(size_t ix)
+{
+  furthest_ = std::max(furthest_, counter_);
+
+  memory_.rollbackHistory(ix);
+  snapshots_.resize(ix + 1);
+  Snapshot& snap = snapshots_.back();
+
+  for (unsigned i = 0; i < snap.intRegs_.size(); ++i)
+    pokeIntReg(i, snap.intRegs_.at(i));
+  for (unsigned i = 0; i < snap.fpRegs_.size(); ++i)
+    pokeFpReg(i, snap.fpRegs_.at(i));
+
+  for (const auto& [csrn, value] : snap.csrs_)
+    {
+      Csr<URV>* csr = csRegs_.getImplementedCsr(csrn);
+      if (csr)
+	csr->pokeNoMask(value);
     }
 
+  transferHartState(snap.state_, false);
+
+  // Refresh the state derived from the CSRs as in whatIfEnd.
+  for (const auto& [csrn, value] : snap.csrs_)
+    if (csrn < CsrNumber::TDATA1 or csrn > CsrNumber::TDATA3)
+      pokeCsr(csrn, value);
+
+  virtMem_.flush(true, 0, true, 0);
+  updateTranslation();
+  fetchSpan_ = 0;
   clearTraceData();
+
+  nextSnapshot_ = counter_ + snapshotPeriod_;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::runTo(uint64_t target, bool quiet)
+{
+  uint64_t limit = instCountLim_;
+  instCountLim_ = std::min(limit, target);
+  bool prevReplaying = replaying_;
+  replaying_ = quiet;
+
+  untilAddress(~URV(0), nullptr);
+
+  replaying_ = prevReplaying;
+  instCountLim_ = limit;
+  return counter_ == target;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::replayTo(uint64_t target)
+{
+  uint64_t quietEnd = std::min(target, furthest_);
+  if (counter_ < quietEnd and not runTo(quietEnd, true))
+    return false;
+  return counter_ >= target or runTo(target, false);
+}
+
+
+template <typename URV>
+bool
+Core<URV>::gotoInstruction(uint64_t count)
+{
+  if (count < historyStart())
+    return false;
+
+  if (count < counter_)
+    {
+      size_t ix = snapshots_.size() - 1;
+      while (snapshots_.at(ix).state_.counter_ > count)
+	--ix;
+      restoreSnapshot(ix);
+    }
+
+  return replayTo(count);
+}
+
+
+template <typename URV>
+bool
+Core<URV>::reverseStep(uint64_t count)
+{
+  uint64_t start = historyStart();
+  if (counter_ - start < count)
+    {
+      gotoInstruction(start);
+      return false;
+    }
+  return gotoInstruction(counter_ - count);
+}
+
+
+template <typename URV>
+bool
+Core<URV>::reverseContinue()
+{
+  // Replay the intervals between snapshots from the latest one back
+  // recording the last breakpoint reached in each.
+  uint64_t end = counter_;
+  while (true)
+    {
+      size_t ix = snapshots_.size();
+      while (ix > 0 and snapshots_.at(ix - 1).state_.counter_ >= end)
+	--ix;
+      if (ix == 0)
+	break;
+      --ix;
+
+      uint64_t start = snapshots_.at(ix).state_.counter_;
+      restoreSnapshot(ix);
+      breakpointHit_ = false;
+      runTo(end, true);
+      if (breakpointHit_)
+	return gotoInstruction(lastBreakpoint_);
+      end = start;
+    }
+
+  gotoInstruction(historyStart());
+  return false;
 }
 
 
@@ -3538,6 +4566,7 @@ Core<URV>::execute32(uint32_t inst)
     uint32_t f3 = iform.fields.funct3;
     if      (f3 == 2)   { execFlw(rd, rs1, imm); }
     else if (f3 == 3)   { execFld(rd, rs1, imm); }
+    else if (f3 == 0 or f3 >= 5) { execVecLoad(inst); }
     else                { illegalInst(); }
   }
   return;
@@ -3555,6 +4584,7 @@ Core<URV>::execute32(uint32_t inst)
     int32_t imm = sform.immed();
     if      (funct3 == 2)  execFsw(rs1, rs2, imm);
     else if (funct3 == 3)  execFsd(rs1, rs2, imm);
+    else if (funct3 == 0 or funct3 >= 5)  execVecStore(inst);
     else                   illegalInst();
   }
   return;
@@ -3653,6 +4683,9 @@ Core<URV>::execute32(uint32_t inst)
   return;
 
  l21:
+  executeVec(inst);
+  return;
+
  l22:
  l23:
  l26:
@@ -3702,14 +4735,21 @@ Core<URV>::execute32(uint32_t inst)
 	iform.getShiftFields(isRv64(), topBits, shamt);
 	if (topBits == 0)
 	  execSlli(rd, rs1, shamt);
-	else if ((topBits >> 1) == 4)
-	  execSloi(rd, rs1, shamt);
-	else if (imm == 0x600)
-	  execClz(rd, rs1, 0);
-	else if (imm == 0x601)
-	  execCtz(rd, rs1, 0);
-	else if (imm == 0x602)
-	  execPcnt(rd, rs1, 0);
+	else if (isRv64() or (topBits & 1) == 0)
+	  {
+	    // Bit manipulation: Bit 25 is part of the shift amount in
+	    // RV64 and must be zero in RV32.
+	    unsigned top6 = isRv64() ? topBits : topBits >> 1;
+	    if      (top6 == 0x0a)  execBseti(rd, rs1, shamt);
+	    else if (top6 == 0x12)  execBclri(rd, rs1, shamt);
+	    else if (top6 == 0x1a)  execBinvi(rd, rs1, shamt);
+	    else if (imm == 0x600)  execClz(rd, rs1, 0);
+	    else if (imm == 0x601)  execCtz(rd, rs1, 0);
+	    else if (imm == 0x602)  execCpop(rd, rs1, 0);
+	    else if (imm == 0x604)  execSext_b(rd, rs1, 0);
+	    else if (imm == 0x605)  execSext_h(rd, rs1, 0);
+	    else                    illegalInst();
+	  }
 	else
 	  illegalInst();
       }
@@ -3722,19 +4762,18 @@ Core<URV>::execute32(uint32_t inst)
 	iform.getShiftFields(isRv64(), topBits, shamt);
 	if (topBits == 0)
 	  execSrli(rd, rs1, shamt);
-	else if ((topBits >> 1) == 4)
-	  execSroi(rd, rs1, shamt);
-	else if ((topBits >> 1) == 0xc)
-	  execRori(rd, rs1, shamt);
-	else
+	else if (isRv64() or (topBits & 1) == 0)
 	  {
-	    if (isRv64())
-	      topBits <<= 1;
-	    if (topBits == 0x20)
-	      execSrai(rd, rs1, shamt);
-	    else
-	      illegalInst();
+	    unsigned top6 = isRv64() ? topBits : topBits >> 1;
+	    if      (top6 == 0x10)  execSrai(rd, rs1, shamt);
+	    else if (top6 == 0x18)  execRori(rd, rs1, shamt);
+	    else if (top6 == 0x12)  execBexti(rd, rs1, shamt);
+	    else if (imm == 0x287)  execOrc_b(rd, rs1, 0);
+	    else if (imm == (isRv64() ? 0x6b8 : 0x698))  execRev8(rd, rs1, 0);
+	    else                    illegalInst();
 	  }
+	else
+	  illegalInst();
       }
     else if (funct3 == 6)  execOri(rd, rs1, imm);
     else if (funct3 == 7)  execAndi(rd, rs1, imm);
@@ -3759,10 +4798,18 @@ Core<URV>::execute32(uint32_t inst)
       execAddiw(rd, rs1, imm);
     else if (funct3 == 1)
       {
-	if (iform.top7() != 0)
-	  illegalInst();
-	else
+	if (iform.top7() == 0)
 	  execSlliw(rd, rs1, iform.fields2.shamt);
+	else if ((iform.top7() >> 1) == 2)
+	  execSlli_uw(rd, rs1, iform.fields3.shamt);
+	else if (imm == 0x600)
+	  execClzw(rd, rs1, 0);
+	else if (imm == 0x601)
+	  execCtzw(rd, rs1, 0);
+	else if (imm == 0x602)
+	  execCpopw(rd, rs1, 0);
+	else
+	  illegalInst();
       }
     else if (funct3 == 5)
       {
@@ -3770,6 +4817,8 @@ Core<URV>::execute32(uint32_t inst)
 	  execSrliw(rd, rs1, iform.fields2.shamt);
 	else if (iform.top7() == 0x20)
 	  execSraiw(rd, rs1, iform.fields2.shamt);
+	else if (iform.top7() == 0x30)
+	  execRoriw(rd, rs1, iform.fields2.shamt);
 	else
 	  illegalInst();
       }
@@ -3869,34 +4918,58 @@ Core<URV>::execute32(uint32_t inst)
       }
     else if (funct7 == 4)
       {
-	if      (funct3 == 0) execPack(rd, rs1, rs2);
-	else                  illegalInst();
+	if (funct3 == 4 and rs2 == 0 and not isRv64())
+	  execZext_h(rd, rs1, 0);
+	else
+	  illegalInst();
       }
     else if (funct7 == 5)
       {
-	if      (funct3 == 2) execMin(rd, rs1, rs2);
-	else if (funct3 == 3) execMinu(rd, rs1, rs2);
+	if      (funct3 == 1) execClmul(rd, rs1, rs2);
+	else if (funct3 == 2) execClmulr(rd, rs1, rs2);
+	else if (funct3 == 3) execClmulh(rd, rs1, rs2);
+	else if (funct3 == 4) execMin(rd, rs1, rs2);
+	else if (funct3 == 5) execMinu(rd, rs1, rs2);
 	else if (funct3 == 6) execMax(rd, rs1, rs2);
 	else if (funct3 == 7) execMaxu(rd, rs1, rs2);
 	else                  illegalInst();
       }
     else if (funct7 == 0x10)
       {
-	if      (funct3 == 1) execSlo(rd, rs1, rs2);
-	else if (funct3 == 5) execSro(rd, rs1, rs2);
+	if      (funct3 == 2) execSh1add(rd, rs1, rs2);
+	else if (funct3 == 4) execSh2add(rd, rs1, rs2);
+	else if (funct3 == 6) execSh3add(rd, rs1, rs2);
+	else                  illegalInst();
+      }
+    else if (funct7 == 0x14)
+      {
+	if      (funct3 == 1) execBset(rd, rs1, rs2);
 	else                  illegalInst();
       }
     else if (funct7 == 0x20)
       {
 	if      (funct3 == 0) execSub(rd, rs1, rs2);
+	else if (funct3 == 4) execXnor(rd, rs1, rs2);
 	else if (funct3 == 5) execSra(rd, rs1, rs2);
-	else if (funct3 == 7) execAndc(rd, rs1, rs2);
+	else if (funct3 == 6) execOrn(rd, rs1, rs2);
+	else if (funct3 == 7) execAndn(rd, rs1, rs2);
+	else                  illegalInst();
+      }
+    else if (funct7 == 0x24)
+      {
+	if      (funct3 == 1) execBclr(rd, rs1, rs2);
+	else if (funct3 == 5) execBext(rd, rs1, rs2);
 	else                  illegalInst();
       }
     else if (funct7 == 0x30)
       {
 	if      (funct3 == 1) execRol(rd, rs1, rs2);
-	if      (funct3 == 5) execRor(rd, rs1, rs2);
+	else if (funct3 == 5) execRor(rd, rs1, rs2);
+	else                  illegalInst();
+      }
+    else if (funct7 == 0x34)
+      {
+	if      (funct3 == 1) execBinv(rd, rs1, rs2);
 	else                  illegalInst();
       }
     else
@@ -3932,12 +5005,31 @@ Core<URV>::execute32(uint32_t inst)
 	else if (funct3 == 7)  execRemuw(rd, rs1, rs2);
 	else                   illegalInst();
       }
+    else if (funct7 == 4)
+      {
+	if      (funct3 == 0)  execAdd_uw(rd, rs1, rs2);
+	else if (funct3 == 4 and rs2 == 0)  execZext_h(rd, rs1, 0);
+	else                   illegalInst();
+      }
+    else if (funct7 == 0x10)
+      {
+	if      (funct3 == 2)  execSh1add_uw(rd, rs1, rs2);
+	else if (funct3 == 4)  execSh2add_uw(rd, rs1, rs2);
+	else if (funct3 == 6)  execSh3add_uw(rd, rs1, rs2);
+	else                   illegalInst();
+      }
     else if (funct7 == 0x20)
       {
 	if      (funct3 == 0)  execSubw(rd, rs1, rs2);
 	else if (funct3 == 5)  execSraw(rd, rs1, rs2);
 	else                   illegalInst();
       }
+    else if (funct7 == 0x30)
+      {
+	if      (funct3 == 1)  execRolw(rd, rs1, rs2);
+	else if (funct3 == 5)  execRorw(rd, rs1, rs2);
+	else                   illegalInst();
+      }
     else
       illegalInst();
   }
@@ -3997,7 +5089,7 @@ Core<URV>::execute32(uint32_t inst)
 	  else if (funct7 == 9)
 	    {
 	      if (rd != 0) illegalInst();
-	      else         unimplemented();  // sfence.vma
+	      else         execSfence_vma(rs1, iform.rs2());
 	    }
 	  else if (csr == 0x102) execSret();
 	  else if (csr == 0x302) execMret();
@@ -4028,332 +5120,16 @@ Core<URV>::execute16(uint16_t inst)
       return;
     }
 
-  uint16_t quadrant = inst & 0x3;
-  uint16_t funct3 =  uint16_t(inst >> 13);    // Bits 15 14 and 13
-
-  if (quadrant == 0)
+  // Execute the equivalent 32-bit instruction. Zero marks the illegal
+  // and reserved 16-bit codes.
+  uint32_t code32 = rvcExpansion_[inst];
+  if (code32 == 0)
     {
-      if (funct3 == 0)   // illegal, c.addi4spn
-	{
-	  if (inst == 0)
-	    illegalInst();
-	  else
-	    {
-	      CiwFormInst ciwf(inst);
-	      unsigned immed = ciwf.immed();
-	      if (immed == 0)
-		illegalInst();  // As of v2.3 of User-Level ISA (Dec 2107).
-	      else
-		execAddi(8+ciwf.bits.rdp, RegSp, immed);  // c.addi4spn
-	    }
-	  return;
-	}
+      illegalInst();
+      return;
+    }
 
-      if (funct3 == 1) // c.fld c.lq
-	{
-	  if (not isRvd())
-	    illegalInst();
-	  else
-	    {
-	      ClFormInst clf(inst);
-	      execFld(8+clf.bits.rdp, 8+clf.bits.rs1p, clf.ldImmed());
-	    }
-	  return;
-	}
-
-      if (funct3 == 2) // c.lw
-	{
-	  ClFormInst clf(inst);
-	  execLw(8+clf.bits.rdp, 8+clf.bits.rs1p, clf.lwImmed());
-	  return;
-	}
-
-      if (funct3 == 3)  // c.flw, c.ld
-	{
-	  ClFormInst clf(inst);
-	  if (isRv64())
-	    execLd(8+clf.bits.rdp, 8+clf.bits.rs1p, clf.ldImmed());
-	  else
-	    {  // c.flw
-	      if (isRvf())
-		execFlw(8+clf.bits.rdp, 8+clf.bits.rs1p, clf.lwImmed());
-	      else
-		illegalInst();
-	    }
-	  return;
-	}
-
-      if (funct3 == 5)  // c.fsd
-	{
-	  if (isRvd())
-	    {
-	      ClFormInst clf(inst);
-	      execFsd(8+clf.bits.rdp, 8+clf.bits.rs1p, clf.ldImmed());
-	    }
-	  else
-	    illegalInst();
-	  return;
-	}
-
-      if (funct3 == 6)  // c.sw
-	{
-	  CsFormInst cs(inst);
-	  execSw(8+cs.bits.rs1p, 8+cs.bits.rs2p, cs.swImmed());
-	  return;
-	}
-
-      if (funct3 == 7) // c.fsw, c.sd
-	{
-	  CsFormInst cs(inst);
-	  if (isRv64())
-	    execSd(8+cs.bits.rs1p, 8+cs.bits.rs2p, cs.sdImmed());
-	  else
-	    {
-	      if (isRvf())
-		execFsw(8+cs.bits.rs1p, 8+cs.bits.rs2p, cs.swImmed());
-	      else
-		illegalInst(); // c.fsw
-	    }
-	  return;
-	}
-
-      // funct3 is 4 (reserved).
-      illegalInst();
-      return;
-    }
-
-  if (quadrant == 1)
-    {
-      if (funct3 == 0)  // c.nop, c.addi
-	{
-	  CiFormInst cif(inst);
-	  execAddi(cif.bits.rd, cif.bits.rd, cif.addiImmed());
-	  return;
-	}
-	  
-      if (funct3 == 1)  // c.jal, in rv64 and rv128 this is c.addiw
-	{
-	  if (isRv64())
-	    {
-	      CiFormInst cif(inst);
-	      if (cif.bits.rd == 0)
-		illegalInst();
-	      else
-		execAddiw(cif.bits.rd, cif.bits.rd, cif.addiImmed());
-	    }
-	  else
-	    {
-	      CjFormInst cjf(inst);
-	      execJal(RegRa, cjf.immed());
-	    }
-	  return;
-	}
-
-      if (funct3 == 2)  // c.li
-	{
-	  CiFormInst cif(inst);
-	  execAddi(cif.bits.rd, RegX0, cif.addiImmed());
-	  return;
-	}
-
-      if (funct3 == 3)  // c.addi16sp, c.lui
-	{
-	  CiFormInst cif(inst);
-	  int immed16 = cif.addi16spImmed();
-	  if (immed16 == 0)
-	    illegalInst();
-	  else if (cif.bits.rd == RegSp)  // c.addi16sp
-	    execAddi(cif.bits.rd, cif.bits.rd, immed16);
-	  else
-	    execLui(cif.bits.rd, cif.luiImmed());
-	  return;
-	}
-
-      // c.srli c.srli64 c.srai c.srai64 c.andi c.sub c.xor c.and
-      // c.subw c.addw
-      if (funct3 == 4)
-	{
-	  CaiFormInst caf(inst);  // compressed and immediate form
-	  int immed = caf.andiImmed();
-	  unsigned rd = 8 + caf.bits.rdp;
-	  unsigned f2 = caf.bits.funct2;
-	  if (f2 == 0) // srli64, srli
-	    {
-	      if (caf.bits.ic5 != 0 and not isRv64())
-		illegalInst(); // As of v2.3 of User-Level ISA (Dec 2107).
-	      else
-		execSrli(rd, rd, caf.shiftImmed());
-	    }
-	  else if (f2 == 1) // srai64, srai
-	    {
-	      if (caf.bits.ic5 != 0 and not isRv64())
-		illegalInst(); // As of v2.3 of User-Level ISA (Dec 2107).
-	      else
-		execSrai(rd, rd, caf.shiftImmed());
-	    }
-	  else if (f2 == 2)  // c.andi
-	    execAndi(rd, rd, immed);
-	  else  // f2 == 3: c.sub c.xor c.or c.subw c.addw
-	    {
-	      unsigned rs2p = (immed & 0x7); // Lowest 3 bits of immed
-	      unsigned rs2 = 8 + rs2p;
-	      unsigned imm34 = (immed >> 3) & 3; // Bits 3 and 4 of immed
-	      if ((immed & 0x20) == 0)  // Bit 5 of immed
-		{
-		  if      (imm34 == 0) execSub(rd, rd, rs2);
-		  else if (imm34 == 1) execXor(rd, rd, rs2);
-		  else if (imm34 == 2) execOr(rd, rd, rs2);
-		  else                 execAnd(rd, rd, rs2);
-		}
-	      else
-		{
-		  if      (imm34 == 0) execSubw(rd, rd, rs2);
-		  else if (imm34 == 1) execAddw(rd, rd, rs2);
-		  else if (imm34 == 2) illegalInst(); // reserved
-		  else                 illegalInst(); // reserved
-		}
-	    }
-	  return;
-	}
-
-      if (funct3 == 5)  // c.j
-	{
-	  CjFormInst cjf(inst);
-	  execJal(RegX0, cjf.immed());
-	  return;
-	}
-	  
-      if (funct3 == 6)  // c.beqz
-	{
-	  CbFormInst cbf(inst);
-	  execBeq(8+cbf.bits.rs1p, RegX0, cbf.immed());
-	  return;
-	}
-
-      // (funct3 == 7)  // c.bnez
-      CbFormInst cbf(inst);
-      execBne(8+cbf.bits.rs1p, RegX0, cbf.immed());
-      return;
-    }
-
-  if (quadrant == 2)
-    {
-      if (funct3 == 0)  // c.slli, c.slli64
-	{
-	  CiFormInst cif(inst);
-	  unsigned immed = unsigned(cif.slliImmed());
-	  if (cif.bits.ic5 != 0 and not isRv64())
-	    illegalInst();
-	  else
-	    execSlli(cif.bits.rd, cif.bits.rd, immed);
-	  return;
-	}
-
-      if (funct3 == 1)  // c.fldsp c.lqsp
-	{
-	  if (isRvd())
-	    {
-	      CiFormInst cif(inst);
-	      execFld(cif.bits.rd, RegSp, cif.ldspImmed());
-	    }
-	  else
-	    illegalInst();
-	  return;
-	}
-
-      if (funct3 == 2)  // c.lwsp
-	{
-	  CiFormInst cif(inst);
-	  unsigned rd = cif.bits.rd;
-	  execLw(rd, RegSp, cif.lwspImmed());
-	  return;
-	}
-
-      if (funct3 == 3)  // c.ldsp  c.flwsp
-	{
-	  CiFormInst cif(inst);
-	  unsigned rd = cif.bits.rd;
-	  if (isRv64())  // c.ldsp
-	    execLd(rd, RegSp, cif.ldspImmed());
-	  else if (isRvf())  // c.flwsp
-	    execFlw(rd, RegSp, cif.lwspImmed());
-	  else
-	    illegalInst();
-	  return;
-	}
-
-      if (funct3 == 4)   // c.jr c.mv c.ebreak c.jalr c.add
-	{
-	  CiFormInst cif(inst);
-	  unsigned immed = cif.addiImmed();
-	  unsigned rd = cif.bits.rd;
-	  unsigned rs2 = immed & 0x1f;
-	  if ((immed & 0x20) == 0)  // c.jr or c.mv
-	    {
-	      if (rs2 == RegX0)
-		{
-		  if (rd == RegX0)
-		    illegalInst();
-		  else
-		    execJalr(RegX0, rd, 0);
-		}
-	      else
-		execAdd(rd, RegX0, rs2);
-	    }
-	  else  // c.ebreak, c.jalr or c.add 
-	    {
-	      if (rs2 == RegX0)
-		{
-		  if (rd == RegX0)
-		    execEbreak();
-		  else
-		    execJalr(RegRa, rd, 0);
-		}
-	      else
-		execAdd(rd, rd, rs2);
-	    }
-	  return;
-	}
-
-      if (funct3 == 5)  // c.fsdsp c.sqsp
-	{
-	  if (isRvd())
-	    {
-	      CswspFormInst csw(inst);
-	      execFsd(RegSp, csw.bits.rs2, csw.sdImmed());
-	    }
-	  else
-	    illegalInst();
-	  return;
-	}
-
-      if (funct3 == 6)  // c.swsp
-	{
-	  CswspFormInst csw(inst);
-	  execSw(RegSp, csw.bits.rs2, csw.swImmed());  // imm(sp) <- rs2
-	  return;
-	}
-
-      if (funct3 == 7)  // c.sdsp  c.fswsp
-	{
-	  if (isRv64())  // c.sdsp
-	    {
-	      CswspFormInst csw(inst);
-	      execSd(RegSp, csw.bits.rs2, csw.sdImmed());
-	    }
-	  else if (isRvf())   // c.fswsp
-	    {
-	      CswspFormInst csw(inst);
-	      execFsw(RegSp, csw.bits.rs2, csw.swImmed());  // imm(sp) <- rs2
-	    }
-	  else
-	    illegalInst();
-	  return;
-	}
-    }
-
-  // quadrant 3
-  illegalInst();
+  execute32(code32);
 }
 
 
@@ -4602,7 +5378,7 @@ Core<URV>::expandInst(uint16_t inst, uint32_t& code32) const
 	  if (isRv64())  // c.ldsp
 	    return encodeLd(rd, RegSp, cif.ldspImmed(), code32);
 	  if (isRvf())  // c.flwsp
-	    return encodeLw(rd, RegSp, cif.lwspImmed(), code32);
+	    return encodeFlw(rd, RegSp, cif.lwspImmed(), code32);
 	  return false;
 	}
 
@@ -4660,7 +5436,7 @@ Core<URV>::expandInst(uint16_t inst, uint32_t& code32) const
 	  if (isRvf())   // c.fswsp
 	    {
 	      CswspFormInst csw(inst);
-	      return encodeSw(RegSp, csw.bits.rs2, csw.swImmed(), code32);
+	      return encodeFsw(RegSp, csw.bits.rs2, csw.swImmed(), code32);
 	    }
 	  return false;
 	}
@@ -4679,28 +5455,29 @@ Core<URV>::enableInstructionFrequency(bool b)
   instFreq_ = b;
   if (b)
     {
+      // Register vectors and histograms of an entry are allocated
+      // when the corresponding instruction is first executed.
       instProfileVec_.resize(size_t(InstId::maxId) + 1);
-
-      auto regCount = intRegCount();
-      for (auto& inst : instProfileVec_)
-	{
-	  inst.rd_.resize(regCount);
-	  inst.rs1_.resize(regCount);
-	  inst.rs2_.resize(regCount);
-	  inst.rs1Histo_.resize(13);  // FIX: avoid magic 13
-	  inst.rs2Histo_.resize(13);  // FIX: avoid magic 13
-	  inst.immHisto_.resize(13);  // FIX: avoid magic 13
-	}
+      for (size_t i = 0; i < instProfileVec_.size(); ++i)
+	instProfileVec_[i].id_ = InstId(i);
     }
 }
 
 
+template <typename URV>
+void
+Core<URV>::enableBranchPrediction(BranchPredictor::Type type)
+{
+  branchPred_ = std::make_unique<BranchPredictor>(type);
+}
+
+
 template <typename URV>
 void
 Core<URV>::enterDebugMode(DebugModeCause cause, URV pc)
 {
   // Entering debug modes loses LR reservation.
-  hasLr_ = false;
+  cancelLr();
 
   if (debugMode_)
     {
@@ -5118,15 +5895,21 @@ Core<URV>::amoLoad32(uint32_t rs1, URV& value)
       return false;
     }
 
+  auto amoAccess = PmpManager::Access(PmpManager::Read | PmpManager::Write);
+
   uint32_t uval = 0;
-  if (not forceAccessFail_ and memory_.read(addr, uval))
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::STORE_ACC_FAULT;
+  if (not forceAccessFail_ and
+      translateData(addr, ldSize, amoAccess, pa, cause) and
+      pmpAllows(pa, ldSize, amoAccess) and memory_.read(pa, uval))
     {
       value = SRV(int32_t(uval)); // Sign extend.
       return true;  // Success.
     }
 
   // Either force-fail or load failed. Take exception.
-  initiateLoadException(ExceptionCause::STORE_ACC_FAULT, addr, ldSize);
+  initiateLoadException(cause, addr, ldSize);
   return false;
 }
 
@@ -5151,19 +5934,85 @@ Core<URV>::amoLoad64(uint32_t rs1, URV& value)
       return false;
     }
 
+  auto amoAccess = PmpManager::Access(PmpManager::Read | PmpManager::Write);
+
   uint64_t uval = 0;
-  if (not forceAccessFail_ and memory_.read(addr, uval))
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::STORE_ACC_FAULT;
+  if (not forceAccessFail_ and
+      translateData(addr, ldSize, amoAccess, pa, cause) and
+      pmpAllows(pa, ldSize, amoAccess) and memory_.read(pa, uval))
     {
       value = SRV(int64_t(uval)); // Sign extend.
       return true;  // Success.
     }
 
   // Either force-fail or load failed. Take exception.
-  initiateLoadException(ExceptionCause::STORE_ACC_FAULT, addr, ldSize);
+  initiateLoadException(cause, addr, ldSize);
   return false;
 }
 
 
+template <typename URV>
+template <typename LOAD_TYPE, typename OP>
+bool
+Core<URV>::amoAtomic(uint32_t rd, uint32_t rs1, uint32_t rs2, OP op)
+{
+  URV addr = intRegs_.read(rs1);
+
+  if (hasActiveTrigger() or forceAccessFail_ or virtMem_.isDataActive() or
+      (toHostValid_ and addr == toHost_))
+    return false;
+
+  if (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(addr))
+    return false;
+
+  auto amoAccess = PmpManager::Access(PmpManager::Read | PmpManager::Write);
+  if (not pmpAllows(addr, sizeof(LOAD_TYPE), amoAccess))
+    return false;
+
+  // Null if misaligned or not accessible: Slow path takes exception.
+  LOAD_TYPE* ptr = memory_.atomicPtr<LOAD_TYPE>(addr);
+  if (not ptr)
+    return false;
+
+  loadAddr_ = addr;    // For reporting load addr in trace-mode.
+  loadAddrValid_ = true;  // For reporting load addr in trace-mode.
+
+  if (loadQueueEnabled_)
+    removeFromLoadQueue(rs1);
+
+  // Hold the lock of the slow path of other harts: Their load and
+  // store must not straddle this update. The compare-and-swap keeps
+  // the update atomic with respect to plain stores.
+  std::unique_lock<std::recursive_mutex> lock(memory_.amoMutex(addr),
+						 std::defer_lock);
+  if (memory_.isShared())
+    lock.lock();
+
+  LOAD_TYPE rs2Val = LOAD_TYPE(intRegs_.read(rs2));
+  LOAD_TYPE prev = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+  LOAD_TYPE next = 0;
+  do
+    next = op(prev, rs2Val);
+  while (not __atomic_compare_exchange_n(ptr, &prev, next, true,
+					 __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+  ++memWriteCount_;
+  lastWrite_.set(sizeof(LOAD_TYPE), addr, next, prev,
+		 memory_.isAddrInDccm(addr));
+  memory_.invalidateReservations(addr, sizeof(LOAD_TYPE));
+
+  if (maxStoreQueueSize_)
+    putInStoreQueue(sizeof(LOAD_TYPE), addr, next, prev);
+
+  // Sign extend loaded value.
+  typedef typename std::make_signed<LOAD_TYPE>::type SLT;
+  intRegs_.write(rd, SRV(SLT(prev)));
+  return true;
+}
+
+
 template <typename URV>
 void
 Core<URV>::execEcall(uint32_t, uint32_t, int32_t)
@@ -5233,7 +6082,8 @@ Core<URV>::execEbreak(uint32_t, uint32_t, int32_t)
   if (enableGdb_)
     {
       pc_ = currPc_;
-      handleExceptionForGdb(*this);
+      if (not replaying_)
+	handleExceptionForGdb(*this);
       return;
     }
 }
@@ -5261,7 +6111,7 @@ Core<URV>::execMret(uint32_t, uint32_t, int32_t)
       return;
     }
 
-  hasLr_ = false;  // Clear LR reservation (if any).
+  cancelLr();  // Clear LR reservation (if any).
 
   // ... updating/unpacking its fields,
   MstatusFields<URV> fields(value);
@@ -5285,6 +6135,7 @@ Core<URV>::execMret(uint32_t, uint32_t, int32_t)
       
   // Update privilege mode.
   privMode_ = savedMode;
+  updateTranslation();
 }
 
 
@@ -5344,6 +6195,28 @@ Core<URV>::execSret(uint32_t, uint32_t, int32_t)
 
   // Update privilege mode.
   privMode_ = savedMode;
+  updateTranslation();
+}
+
+
+template <typename URV>
+void
+Core<URV>::execSfence_vma(uint32_t rs1, uint32_t rs2, int32_t)
+{
+  if (not isRvs() or privMode_ < PrivilegeMode::Supervisor)
+    {
+      illegalInst();
+      return;
+    }
+
+  if (triggerTripped_)
+    return;
+
+  // Register x0 selects all addresses (rs1) or all address spaces (rs2).
+  URV va = intRegs_.read(rs1);
+  URV asid = intRegs_.read(rs2);
+  virtMem_.flush(rs1 == 0, va, rs2 == 0, uint32_t(asid));
+  fetchSpan_ = 0;
 }
 
 
@@ -5403,7 +6276,9 @@ template <typename URV>
 void
 Core<URV>::execWfi(uint32_t, uint32_t, int32_t)
 {
-  return;   // Currently implemented as a no-op.
+  // Currently implemented as a no-op. Flag is used by the hart
+  // scheduler to deschedule a waiting hart.
+  waitForInterrupt_ = true;
 }
 
 
@@ -5411,6 +6286,9 @@ template <typename URV>
 bool
 Core<URV>::doCsrRead(CsrNumber csr, URV& value)
 {
+  if (lazyFpFlags_)
+    syncFpFlags();
+
   if (csRegs_.read(csr, privMode_, debugMode_, value))
     return true;
 
@@ -5430,12 +6308,20 @@ Core<URV>::doCsrWrite(CsrNumber csr, URV csrVal, unsigned intReg,
       return;
     }
 
+  if (lazyFpFlags_)
+    syncFpFlags();
+
   // Make auto-increment happen before write for minstret and cycle.
   if (csr == CsrNumber::MINSTRET or csr == CsrNumber::MINSTRETH)
     retiredInsts_++;
   if (csr == CsrNumber::MCYCLE or csr == CsrNumber::MCYCLEH)
     cycleCount_++;
 
+  if (isPmpCsr(csr))
+    csrVal = legalizePmpWrite(csr, csrVal);
+  else if (csr == CsrNumber::SATP)
+    csrVal = legalizeSatpWrite(csrVal);
+
   // Update CSR and integer register.
   csRegs_.write(csr, privMode_, debugMode_, csrVal);
   intRegs_.write(intReg, intRegVal);
@@ -5452,6 +6338,11 @@ Core<URV>::doCsrWrite(CsrNumber csr, URV csrVal, unsigned intReg,
       prevCountersCsrOn_ = countersCsrOn_;
       countersCsrOn_ = (csrVal & 1) == 1;
     }
+  else if (isPmpCsr(csr))
+    updatePmp();
+  else if (csr == CsrNumber::SATP or csr == CsrNumber::MSTATUS or
+	   csr == CsrNumber::SSTATUS)
+    updateTranslation();
 
   // Csr was written. If it was minstret, compensate for
   // auto-increment that will be done by run, runUntilAddress or
@@ -5465,6 +6356,281 @@ Core<URV>::doCsrWrite(CsrNumber csr, URV csrVal, unsigned intReg,
 }
 
 
+template <typename URV>
+URV
+Core<URV>::legalizePmpWrite(CsrNumber csr, URV csrVal)
+{
+  URV prev = 0;
+  peekCsr(csr, prev);
+
+  if (csr >= CsrNumber::PMPADDR0)
+    {
+      unsigned ix = unsigned(csr) - unsigned(CsrNumber::PMPADDR0);
+      return pmpManager_.isAddrLocked(ix) ? prev : csrVal;
+    }
+
+  // Each pmpcfg register holds one byte per entry: 4 entries in
+  // RV32, 8 in RV64 where only pmpcfg0 and pmpcfg2 exist.
+  unsigned first = (unsigned(csr) - unsigned(CsrNumber::PMPCFG0)) * 4;
+  URV result = 0;
+  for (unsigned i = 0; i < sizeof(URV); ++i)
+    {
+      unsigned shift = 8*i;
+      uint8_t byte = csrVal >> shift;
+      if (pmpManager_.isEntryLocked(first + i))
+	byte = prev >> shift;
+      else if ((byte & 3) == PmpManager::Write)
+	byte &= ~PmpManager::Write;  // W without R is reserved.
+      result |= URV(byte) << shift;
+    }
+  return result;
+}
+
+
+template <typename URV>
+void
+Core<URV>::updatePmp()
+{
+  uint8_t cfg[PmpManager::maxEntries] = {};
+  uint64_t addr[PmpManager::maxEntries] = {};
+  unsigned count = 0;
+
+  constexpr unsigned perReg = sizeof(URV);  // Entries per pmpcfg register.
+  for (unsigned ix = 0; ix < pmpEntries_; ++ix)
+    {
+      CsrNumber addrCsr = CsrNumber(unsigned(CsrNumber::PMPADDR0) + ix);
+      URV value = 0;
+      if (not csRegs_.getImplementedCsr(addrCsr) or
+	  not peekCsr(addrCsr, value))
+	break;
+      addr[ix] = value;
+
+      unsigned cfgIx = (ix / perReg) * (perReg / 4);
+      CsrNumber cfgCsr = CsrNumber(unsigned(CsrNumber::PMPCFG0) + cfgIx);
+      URV cfgVal = 0;
+      if (peekCsr(cfgCsr, cfgVal))
+	cfg[ix] = cfgVal >> (8*(ix % perReg));
+      count = ix + 1;
+    }
+
+  pmpManager_.update(cfg, addr, count);
+  fetchSpan_ = 0;
+}
+
+
+template <typename URV>
+URV
+Core<URV>::legalizeSatpWrite(URV csrVal)
+{
+  // Sv32 is the only translation mode of RV32 (field MODE is 1 bit).
+  if constexpr (sizeof(URV) == 4)
+    return csrVal;
+
+  unsigned mode = unsigned(uint64_t(csrVal) >> 60);
+  if (mode == VirtMem::Bare or mode == VirtMem::Sv39)
+    return csrVal;
+
+  URV prev = 0;
+  peekCsr(CsrNumber::SATP, prev);
+  return prev;
+}
+
+
+template <typename URV>
+void
+Core<URV>::updateTranslation()
+{
+  // Satp layout. RV32: mode (1 bit), asid (9), ppn (22). RV64: mode
+  // (4 bits), asid (16), ppn (44).
+  uint64_t satp = 0;
+  URV value = 0;
+  if (csRegs_.getImplementedCsr(CsrNumber::SATP) and
+      peekCsr(CsrNumber::SATP, value))
+    satp = value;
+
+  VirtMem::Mode mode = VirtMem::Bare;
+  uint32_t asid = 0;
+  uint64_t ppn = 0;
+  if constexpr (sizeof(URV) == 4)
+    {
+      if (satp >> 31)
+	mode = VirtMem::Sv32;
+      asid = (satp >> 22) & 0x1ff;
+      ppn = satp & 0x3fffff;
+    }
+  else
+    {
+      if ((satp >> 60) == VirtMem::Sv39)
+	mode = VirtMem::Sv39;
+      asid = (satp >> 44) & 0xffff;
+      ppn = satp & ((uint64_t(1) << 44) - 1);
+    }
+  virtMem_.setSatp(mode, asid, ppn);
+
+  // Loads and stores of machine mode use the privilege in MPP when
+  // MPRV is set: For translation and for PMP.
+  URV status = 0;
+  peekCsr(CsrNumber::MSTATUS, status);
+  MstatusFields<URV> msf(status);
+  dataMode_ = privMode_;
+  if (privMode_ == PrivilegeMode::Machine and msf.bits_.MPRV)
+    dataMode_ = PrivilegeMode(msf.bits_.MPP);
+  virtMem_.setPrivilege(privMode_, dataMode_, msf.bits_.SUM, msf.bits_.MXR);
+  fetchSpan_ = 0;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::translateDataSlow(URV va, unsigned size, PmpManager::Access access,
+			     URV& pa, ExceptionCause& cause)
+{
+  bool isLoad = access == PmpManager::Read;
+
+  // An access straddling two pages would need two translations: Report
+  // it as misaligned instead.
+  if (((va ^ (va + size - 1)) >> VirtMem::pageShift) != 0)
+    {
+      cause = (isLoad ? ExceptionCause::LOAD_ADDR_MISAL :
+	       ExceptionCause::STORE_ADDR_MISAL);
+      return false;
+    }
+
+  uint64_t phys = 0;
+  auto result = virtMem_.translateData(va, access, phys);
+  if (result == VirtMem::Result::Ok)
+    {
+      pa = URV(phys);
+      return true;
+    }
+
+  if (result == VirtMem::Result::PageFault)
+    cause = (isLoad ? ExceptionCause::LOAD_PAGE_FAULT :
+	     ExceptionCause::STORE_PAGE_FAULT);
+  else
+    cause = (isLoad ? ExceptionCause::LOAD_ACC_FAULT :
+	     ExceptionCause::STORE_ACC_FAULT);
+  return false;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::translateInstAddr(URV va, URV& pa, ExceptionCause& cause)
+{
+  uint64_t phys = 0;
+  auto result = virtMem_.translateInst(va, phys);
+  if (result == VirtMem::Result::Ok)
+    {
+      pa = URV(phys);
+      return true;
+    }
+
+  if (result == VirtMem::Result::PageFault)
+    cause = ExceptionCause::INST_PAGE_FAULT;
+  else
+    cause = ExceptionCause::INST_ACC_FAULT;
+  return false;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::fetchInstSlow(URV addr, uint32_t& inst)
+{
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::INST_ACC_FAULT;
+  bool virt = virtMem_.isInstActive();
+  if (virt and not translateInstAddr(addr, pa, cause))
+    {
+      initiateException(cause, addr, addr);
+      return false;
+    }
+
+  // With translation on, the 2nd half of a 4-byte instruction at the
+  // end of a page is in the next page.
+  bool straddle = virt and ((addr + 2) & (VirtMem::pageSize - 1)) == 0;
+
+  if (not straddle and memory_.readInstWord(pa, inst))
+    {
+      unsigned size = isCompressedInst(inst) ? 2 : 4;
+      if (pmpAllowsFetch(pa, size))
+	{
+	  setFetchWindow(addr, pa);
+	  return true;
+	}
+      initiateException(ExceptionCause::INST_ACC_FAULT, addr, addr);
+      return false;
+    }
+
+  uint16_t half;
+  if (not memory_.readInstHalfWord(pa, half) or not pmpAllowsFetch(pa, 2))
+    {
+      initiateException(ExceptionCause::INST_ACC_FAULT, addr, addr);
+      return false;
+    }
+
+  inst = half;
+  if (isCompressedInst(inst))
+    return true;
+
+  URV pa2 = pa + 2;
+  cause = ExceptionCause::INST_ACC_FAULT;
+  if (not straddle)
+    {
+      // 4-byte instruction: 4-byte fetch failed but 1st 2-byte fetch
+      // succeeded. Problem must be in 2nd half of instruction.
+      initiateException(cause, addr, addr + 2);
+      return false;
+    }
+
+  if (not translateInstAddr(addr + 2, pa2, cause))
+    {
+      initiateException(cause, addr, addr + 2);
+      return false;
+    }
+
+  if (not memory_.readInstHalfWord(pa2, half) or not pmpAllowsFetch(pa2, 2))
+    {
+      initiateException(ExceptionCause::INST_ACC_FAULT, addr, addr + 2);
+      return false;
+    }
+
+  inst |= uint32_t(half) << 16;
+  return true;
+}
+
+
+template <typename URV>
+void
+Core<URV>::setFetchWindow(URV va, URV pa)
+{
+  uint64_t first = 0, span = 0;
+  pmpManager_.getFetchWindow(privMode_, first, span);
+
+  if (not virtMem_.isInstActive())
+    {
+      // Without translation the window is that of PMP.
+      fetchVa_ = fetchPa_ = URV(first);
+      fetchSpan_ = span > ~URV(0) ? ~URV(0) : URV(span);
+      return;
+    }
+
+  // With translation the window is the page of va provided that PMP
+  // allows fetching from the whole corresponding physical page.
+  uint64_t page = VirtMem::pageSize;
+  uint64_t paFirst = uint64_t(pa) & ~(page - 1);
+  if (paFirst - first < span and paFirst + page - 4 - first < span)
+    {
+      fetchVa_ = va & ~URV(page - 1);
+      fetchPa_ = URV(paFirst);
+      fetchSpan_ = URV(page - 3);
+    }
+  else
+    fetchSpan_ = 0;
+}
+
+
 // Set control and status register csr to value of register rs1 and
 // save its original value in register rd.
 template <typename URV>
@@ -5655,8 +6821,13 @@ Core<URV>::store(URV base, URV addr, STORE_TYPE storeVal)
       return false;
     }
 
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::STORE_ACC_FAULT;
+  bool translated = translateData(addr, stSize, PmpManager::Write, pa, cause);
+
   STORE_TYPE maskedVal = storeVal;
-  if (hasTrig and not forceAccessFail_ and memory_.checkWrite(addr, maskedVal))
+  if (hasTrig and translated and not forceAccessFail_ and
+      memory_.checkWrite(pa, maskedVal))
     {
       // No exception: consider store-data  trigger
       if (ldStDataTriggerHit(maskedVal, timing, isLoad, isInterruptEnabled()))
@@ -5665,17 +6836,16 @@ Core<URV>::store(URV base, URV addr, STORE_TYPE storeVal)
   if (triggerTripped_)
     return false;
 
-  if (not forceAccessFail_ and memory_.write(addr, storeVal))
+  if (translated and not forceAccessFail_ and
+      pmpAllows(pa, stSize, PmpManager::Write) and
+      memory_.write(pa, storeVal, lastWrite_))
     {
-      // if (hasLr_)
-      //   {
-      //     size_t ss = sizeof(STORE_TYPE);
-      //     if (addr >= lrAddr_ and addr <= lrAddr_ + ss - 1)
-      //       hasLr_ = false;
-      //   }
+      ++memWriteCount_;
+
+      memory_.invalidateReservations(pa, sizeof(STORE_TYPE));
 
       // If we write to special location, end the simulation.
-      if (toHostValid_ and addr == toHost_ and storeVal != 0)
+      if (toHostValid_ and pa == toHost_ and storeVal != 0)
 	{
 	  throw CoreException(CoreException::Stop, "write to to-host",
 			      toHost_, storeVal);
@@ -5684,9 +6854,9 @@ Core<URV>::store(URV base, URV addr, STORE_TYPE storeVal)
       // If addr is special location, then write to console.
       if constexpr (sizeof(STORE_TYPE) == 1)
         {
-	  if (conIoValid_ and addr == conIo_)
+	  if (conIoValid_ and pa == conIo_)
 	    {
-	      if (consoleOut_)
+	      if (consoleOut_ and not replaying_)
 		fputc(storeVal, consoleOut_);
 	      return true;
 	    }
@@ -5694,19 +6864,85 @@ Core<URV>::store(URV base, URV addr, STORE_TYPE storeVal)
 
       if (maxStoreQueueSize_)
 	{
-	  uint64_t prevVal = 0;
-	  memory_.getLastWriteOldValue(prevVal);
-	  putInStoreQueue(sizeof(STORE_TYPE), addr, storeVal, prevVal);
+	  putInStoreQueue(sizeof(STORE_TYPE), pa, storeVal,
+			  lastWrite_.prevValue_);
 	}
       return true;
     }
 
   // Either force-fail or store failed.  Take exception.
-  initiateStoreException(ExceptionCause::STORE_ACC_FAULT, addr);
+  initiateStoreException(cause, addr);
   return false;
 }
 
 
+template <typename URV>
+bool
+Core<URV>::vecLoadElem(URV base, URV addr, unsigned size, uint64_t& value,
+		       bool trap)
+{
+  if (hasActiveTrigger())
+    {
+      typedef TriggerTiming Timing;
+
+      bool isLoad = true;
+      if (ldStAddrTriggerHit(addr, Timing::Before, isLoad, isInterruptEnabled()))
+	triggerTripped_ = true;
+      if (triggerTripped_)
+	return false;
+    }
+
+  if (eaCompatWithBase_)
+    forceAccessFail_ = forceAccessFail_ or effectiveAndBaseAddrMismatch(addr, base);
+
+  // Misaligned load from io section triggers an exception. Crossing
+  // dccm to non-dccm causes an exception.
+  bool misal = addr & (size - 1);
+  misalignedLdSt_ = misal;
+  if (misal and misalignedAccessCausesException(addr, size))
+    {
+      if (trap)
+	initiateLoadException(ExceptionCause::LOAD_ADDR_MISAL, addr, size);
+      return false;
+    }
+
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::LOAD_ACC_FAULT;
+  bool ok = (not forceAccessFail_ and
+	     translateData(addr, size, PmpManager::Read, pa, cause) and
+	     pmpAllows(pa, size, PmpManager::Read));
+  if (ok)
+    {
+      uint8_t v8 = 0; uint16_t v16 = 0; uint32_t v32 = 0; uint64_t v64 = 0;
+      switch (size)
+	{
+	case 1: ok = memory_.read(pa, v8);  value = v8;  break;
+	case 2: ok = memory_.read(pa, v16); value = v16; break;
+	case 4: ok = memory_.read(pa, v32); value = v32; break;
+	default: ok = memory_.read(pa, v64); value = v64; break;
+	}
+    }
+
+  if (not ok and trap)
+    initiateLoadException(cause, addr, size);
+  return ok;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::vecStoreElem(URV base, URV addr, unsigned size, uint64_t value)
+{
+  switch (size)
+    {
+    case 1:  return store<uint8_t>(base, addr, uint8_t(value));
+    case 2:  return store<uint16_t>(base, addr, uint16_t(value));
+    case 4:  return store<uint32_t>(base, addr, uint32_t(value));
+    default: return store<uint64_t>(base, addr, value);
+    }
+}
+
+
 template <typename URV>
 void
 Core<URV>::execSb(uint32_t rs1, uint32_t rs2, int32_t imm)
@@ -6261,48 +7497,91 @@ template <typename URV>
 void
 Core<URV>::updateAccruedFpBits()
 {
-  URV val = 0;
-  if (csRegs_.read(CsrNumber::FCSR, PrivilegeMode::Machine, debugMode_, val))
-    {
-      URV prev = val;
+  if (not lazyFpFlags_)
+    syncFpFlags();
+}
 
-      int flags = fetestexcept(FE_ALL_EXCEPT);
-      
-      if (flags & FE_INEXACT)
-	val |= URV(FpFlags::Inexact);
 
-      if (flags & FE_UNDERFLOW)
-	val |= URV(FpFlags::Underflow);
+template <typename URV>
+void
+Core<URV>::syncFpFlags()
+{
+  int flags = std::fetestexcept(FE_ALL_EXCEPT);
+  if (flags == 0)
+    return;
+
+  std::feclearexcept(FE_ALL_EXCEPT);
 
-      if (flags & FE_OVERFLOW)
-	val |= URV(FpFlags::Overflow);
-      
-      if (flags & FE_DIVBYZERO)
-	val |= URV(FpFlags::DivByZero);
+  unsigned riscvFlags = 0;
+  if (flags & FE_INEXACT)
+    riscvFlags |= unsigned(FpFlags::Inexact);
+
+  if (flags & FE_UNDERFLOW)
+    riscvFlags |= unsigned(FpFlags::Underflow);
+
+  if (flags & FE_OVERFLOW)
+    riscvFlags |= unsigned(FpFlags::Overflow);
 
-      if (flags & FE_INVALID)
-	val |= URV(FpFlags::Invalid);
+  if (flags & FE_DIVBYZERO)
+    riscvFlags |= unsigned(FpFlags::DivByZero);
+
+  if (flags & FE_INVALID)
+    riscvFlags |= unsigned(FpFlags::Invalid);
+
+  orFpFlags(riscvFlags);
+}
+
+
+template <typename URV>
+void
+Core<URV>::orFpFlags(unsigned flags)
+{
+  if (flags == 0)
+    return;
 
+  URV val = 0;
+  if (csRegs_.read(CsrNumber::FCSR, PrivilegeMode::Machine, debugMode_, val))
+    {
+      URV prev = val;
+      val |= flags;
       if (val != prev)
 	csRegs_.write(CsrNumber::FCSR, PrivilegeMode::Machine, debugMode_, val);
     }
 }
 
 
-int
-setSimulatorRoundingMode(RoundingMode mode)
+template <typename URV>
+void
+Core<URV>::changeHostRoundingMode(RoundingMode mode)
 {
-  int previous = std::fegetround();
-  switch(mode)
+  switch (mode)
     {
-    case RoundingMode::NearestEven: std::fesetround(FE_TONEAREST);  break;
-    case RoundingMode::Zero:        std::fesetround(FE_TOWARDZERO); break;
-    case RoundingMode::Down:        std::fesetround(FE_DOWNWARD);   break;
-    case RoundingMode::Up:          std::fesetround(FE_UPWARD);     break;
-    case RoundingMode::NearestMax:  std::fesetround(FE_TONEAREST);  break; //FIX
-    default: break;
+    case RoundingMode::Zero: std::fesetround(FE_TOWARDZERO); break;
+    case RoundingMode::Down: std::fesetround(FE_DOWNWARD);   break;
+    case RoundingMode::Up:   std::fesetround(FE_UPWARD);     break;
+    default:                 std::fesetround(FE_TONEAREST);  break;
     }
-  return previous;
+  hostRoundingMode_ = mode;
+}
+
+
+template <typename URV>
+void
+Core<URV>::beginFpSession(bool lazy)
+{
+  std::feclearexcept(FE_ALL_EXCEPT);
+  setHostRoundingMode(RoundingMode::NearestEven);
+  lazyFpFlags_ = lazy;
+}
+
+
+template <typename URV>
+void
+Core<URV>::endFpSession()
+{
+  syncFpFlags();
+  lazyFpFlags_ = false;
+  setHostRoundingMode(RoundingMode::NearestEven);
 }
 
 
@@ -6395,14 +7674,6 @@ Core<URV>::execFsw(uint32_t rs1, uint32_t rs2, int32_t imm)
 }
 
 
-inline
-void
-feClearAllExceptions()
-{
-  asm("fnclex");  // std::feclearexcept(FE_ALL_EXCEPT);
-}
-
-
 template <typename URV>
 void
 Core<URV>::execFmadd_s(uint32_t rd, uint32_t rs1, int32_t rs2)
@@ -6420,17 +7691,21 @@ Core<URV>::execFmadd_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
   float f3 = fpRegs_.readSingle(instRs3_);
-  float res = std::fma(f1, f2, f3);
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return std::fma(double(f1), double(f2), double(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(f1, f2, f3);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6451,17 +7726,21 @@ Core<URV>::execFmsub_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
   float f3 = fpRegs_.readSingle(instRs3_);
-  float res = std::fma(f1, f2, -f3);
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return std::fma(double(f1), double(f2), -double(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(f1, f2, -f3);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6482,17 +7761,21 @@ Core<URV>::execFnmsub_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
   float f3 = fpRegs_.readSingle(instRs3_);
-  float res = std::fma(f1, f2, -f3);
-  fpRegs_.writeSingle(rd, -res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return std::fma(-double(f1), double(f2), double(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(-f1, f2, f3);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6513,17 +7796,21 @@ Core<URV>::execFnmadd_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
   float f3 = fpRegs_.readSingle(instRs3_);
-  float res = std::fma(f1, f2, f3);
-  fpRegs_.writeSingle(rd, -res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return std::fma(-double(f1), double(f2), -double(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(-f1, f2, -f3);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6544,16 +7831,20 @@ Core<URV>::execFadd_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
-  float res = f1 + f2;
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return double(f1) + double(f2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = f1 + f2;
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6574,16 +7865,20 @@ Core<URV>::execFsub_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
-  float res = f1 - f2;
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return double(f1) - double(f2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = f1 - f2;
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6604,16 +7899,20 @@ Core<URV>::execFmul_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  std::feclearexcept(FE_ALL_EXCEPT);
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
-  float res = f1 * f2;
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return double(f1) * double(f2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = f1 * f2;
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6634,16 +7933,20 @@ Core<URV>::execFdiv_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
-  float res = f1 / f2;
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return double(f1) / double(f2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = f1 / f2;
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6664,15 +7967,19 @@ Core<URV>::execFsqrt_s(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  std::feclearexcept(FE_ALL_EXCEPT);
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
-  float res = std::sqrt(f1);
-  fpRegs_.writeSingle(rd, res);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return std::sqrt(double(f1)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::sqrt(f1);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6785,15 +8092,11 @@ Core<URV>::execFcvt_w_s(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
-  SRV result = int32_t(f1);
+  SRV result = fpToInt<int32_t>(f1, riscvMode);
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6814,15 +8117,11 @@ Core<URV>::execFcvt_wu_s(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
-  URV result = uint32_t(f1);
+  SRV result = int32_t(fpToInt<uint32_t>(f1, riscvMode));  // Sign extend.
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -6863,8 +8162,6 @@ Core<URV>::execFeq_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
 
@@ -6885,8 +8182,6 @@ Core<URV>::execFlt_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
 
@@ -6907,8 +8202,6 @@ Core<URV>::execFle_s(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-
   float f1 = fpRegs_.readSingle(rs1);
   float f2 = fpRegs_.readSingle(rs2);
 
@@ -7026,15 +8319,19 @@ Core<URV>::execFcvt_s_w(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
-  SRV i1 = intRegs_.read(rs1);
-  float result = float(i1);
-  fpRegs_.writeSingle(rd, result);
+  int32_t i1 = intRegs_.read(rs1);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return double(i1); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = float(i1);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7055,15 +8352,19 @@ Core<URV>::execFcvt_s_wu(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   uint32_t u1 = intRegs_.read(rs1);
-  float result = float(u1);
-  fpRegs_.writeSingle(rd, result);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return double(u1); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = float(u1);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7109,15 +8410,11 @@ Core<URV>::execFcvt_l_s(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
-  SRV result = SRV(f1);
+  SRV result = fpToInt<int64_t>(f1, riscvMode);
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7138,15 +8435,11 @@ Core<URV>::execFcvt_lu_s(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   float f1 = fpRegs_.readSingle(rs1);
-  URV result = URV(f1);
+  URV result = fpToInt<uint64_t>(f1, riscvMode);
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7167,15 +8460,19 @@ Core<URV>::execFcvt_s_l(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   SRV i1 = intRegs_.read(rs1);
-  float result = float(i1);
-  fpRegs_.writeSingle(rd, result);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, WideDouble>
+      ([=] { return WideDouble(i1); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = float(i1);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7196,15 +8493,19 @@ Core<URV>::execFcvt_s_lu(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   URV i1 = intRegs_.read(rs1);
-  float result = float(i1);
-  fpRegs_.writeSingle(rd, result);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, WideDouble>
+      ([=] { return WideDouble(i1); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = float(i1);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7314,17 +8615,21 @@ Core<URV>::execFmadd_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double f1 = fpRegs_.read(rs1);
   double f2 = fpRegs_.read(rs2);
   double f3 = fpRegs_.read(instRs3_);
-  double res = std::fma(f1, f2, f3);
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return std::fma(WideDouble(f1), WideDouble(f2), WideDouble(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(f1, f2, f3);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7345,17 +8650,21 @@ Core<URV>::execFmsub_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double f1 = fpRegs_.read(rs1);
   double f2 = fpRegs_.read(rs2);
   double f3 = fpRegs_.read(instRs3_);
-  double res = std::fma(f1, f2, -f3);
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return std::fma(WideDouble(f1), WideDouble(f2), -WideDouble(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(f1, f2, -f3);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7376,17 +8685,21 @@ Core<URV>::execFnmsub_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double f1 = fpRegs_.read(rs1);
   double f2 = fpRegs_.read(rs2);
   double f3 = fpRegs_.read(instRs3_);
-  double res = std::fma(f1, f2, -f3);
-  fpRegs_.write(rd, -res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return std::fma(-WideDouble(f1), WideDouble(f2), WideDouble(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(-f1, f2, f3);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7407,17 +8720,21 @@ Core<URV>::execFnmadd_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double f1 = fpRegs_.read(rs1);
   double f2 = fpRegs_.read(rs2);
   double f3 = fpRegs_.read(instRs3_);
-  double res = std::fma(f1, f2, f3);
-  fpRegs_.write(rd, -res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return std::fma(-WideDouble(f1), WideDouble(f2), -WideDouble(f3)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::fma(-f1, f2, -f3);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7438,16 +8755,20 @@ Core<URV>::execFadd_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
   double d2 = fpRegs_.read(rs2);
-  double res = d1 + d2;
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return WideDouble(d1) + WideDouble(d2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = d1 + d2;
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7468,16 +8789,20 @@ Core<URV>::execFsub_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
   double d2 = fpRegs_.read(rs2);
-  double res = d1 - d2;
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return WideDouble(d1) - WideDouble(d2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = d1 - d2;
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7498,16 +8823,20 @@ Core<URV>::execFmul_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
   double d2 = fpRegs_.read(rs2);
-  double res = d1 * d2;
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return WideDouble(d1) * WideDouble(d2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = d1 * d2;
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7529,16 +8858,20 @@ Core<URV>::execFdiv_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
   double d2 = fpRegs_.read(rs2);
-  double res = d1 / d2;
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return WideDouble(d1) / WideDouble(d2); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = d1 / d2;
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7652,15 +8985,12 @@ Core<URV>::execFcvt_d_s(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
+  // Exact: Rounding mode is irrelevant.
   float f1 = fpRegs_.readSingle(rs1);
   double result = f1;
   fpRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7681,15 +9011,19 @@ Core<URV>::execFcvt_s_d(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
-  float result = float(d1);
-  fpRegs_.writeSingle(rd, result);
+  float res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<float, double>
+      ([=] { return d1; });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = float(d1);
+    }
 
+  fpRegs_.writeSingle(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7710,15 +9044,19 @@ Core<URV>::execFsqrt_d(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
-  double res = std::sqrt(d1);
-  fpRegs_.write(rd, res);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return std::sqrt(WideDouble(d1)); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = std::sqrt(d1);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7799,15 +9137,11 @@ Core<URV>::execFcvt_w_d(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
-  SRV result = int32_t(d1);
+  SRV result = fpToInt<int32_t>(d1, riscvMode);
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7828,15 +9162,11 @@ Core<URV>::execFcvt_wu_d(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double d1 = fpRegs_.read(rs1);
-  URV result = uint32_t(d1);
+  SRV result = int32_t(fpToInt<uint32_t>(d1, riscvMode));  // Sign extend.
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7857,15 +9187,12 @@ Core<URV>::execFcvt_d_w(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
+  // Exact: Rounding mode is irrelevant.
   int32_t i1 = intRegs_.read(rs1);
   double result = i1;
   fpRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7886,15 +9213,12 @@ Core<URV>::execFcvt_d_wu(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
+  // Exact: Rounding mode is irrelevant.
   uint32_t i1 = intRegs_.read(rs1);
   double result = i1;
   fpRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -7972,15 +9296,11 @@ Core<URV>::execFcvt_l_d(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double f1 = fpRegs_.read(rs1);
-  SRV result = SRV(f1);
+  SRV result = fpToInt<int64_t>(f1, riscvMode);
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -8001,15 +9321,11 @@ Core<URV>::execFcvt_lu_d(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   double f1 = fpRegs_.read(rs1);
-  URV result = URV(f1);
+  URV result = fpToInt<uint64_t>(f1, riscvMode);
   intRegs_.write(rd, result);
 
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -8030,15 +9346,19 @@ Core<URV>::execFcvt_d_l(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   SRV i1 = intRegs_.read(rs1);
-  double result = double(i1);
-  fpRegs_.write(rd, result);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return WideDouble(i1); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = double(i1);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -8059,15 +9379,19 @@ Core<URV>::execFcvt_d_lu(uint32_t rd, uint32_t rs1, int32_t)
       return;
     }
 
-  feClearAllExceptions();
-  int prevMode = setSimulatorRoundingMode(riscvMode);
-
   URV i1 = intRegs_.read(rs1);
-  double result = double(i1);
-  fpRegs_.write(rd, result);
+  double res = 0;
+  if (riscvMode == RoundingMode::NearestMax)
+    res = nearestMaxOp<double, WideDouble>
+      ([=] { return WideDouble(i1); });
+  else
+    {
+      setHostRoundingMode(riscvMode);
+      res = double(i1);
+    }
 
+  fpRegs_.write(rd, res);
   updateAccruedFpBits();
-  std::fesetround(prevMode);
 }
 
 
@@ -8167,12 +9491,18 @@ Core<URV>::loadReserve(uint32_t rd, uint32_t rs1)
       return;
     }
 
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::LOAD_ACC_FAULT;
   bool forceFail = forceAccessFail_;
-  if (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(addr))
+  if (not translateData(addr, ldSize, PmpManager::Read, pa, cause))
+    forceFail = true;
+  else if (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(pa))
+    forceFail = true;
+  else if (not pmpAllows(pa, ldSize, PmpManager::Read))
     forceFail = true;
 
   ULT uval = 0;
-  if (not forceFail and memory_.read(addr, uval))
+  if (not forceFail and memory_.read(pa, uval))
     {
       URV value;
       if constexpr (std::is_same<ULT, LOAD_TYPE>::value)
@@ -8185,10 +9515,12 @@ Core<URV>::loadReserve(uint32_t rd, uint32_t rs1)
 	putInLoadQueue(ldSize, addr, rd, peekIntReg(rd));
 
       intRegs_.write(rd, value);
+      lrValue_ = uval;
+      lrAddr_ = pa;
     }
   else
     {
-      initiateLoadException(ExceptionCause::LOAD_ACC_FAULT, addr, ldSize);
+      initiateLoadException(cause, addr, ldSize);
     }
 }
 
@@ -8202,8 +9534,8 @@ Core<URV>::execLr_w(uint32_t rd, uint32_t rs1, int32_t)
     return;
 
   hasLr_ = true;
-  lrAddr_ = loadAddr_;
   lrSize_ = 4;
+  memory_.makeReservation(hartId_, lrAddr_);
 }
 
 
@@ -8234,15 +9566,20 @@ Core<URV>::storeConditional(URV addr, STORE_TYPE storeVal)
       return false;
     }
 
-  if (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(addr))
+  URV pa = addr;
+  ExceptionCause cause = ExceptionCause::STORE_ACC_FAULT;
+  if (not translateData(addr, sizeof(STORE_TYPE), PmpManager::Write, pa,
+			cause) or
+      (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(pa)) or
+      not pmpAllows(pa, sizeof(STORE_TYPE), PmpManager::Write))
     {
       if (triggerTripped_)
 	return false;  // No exception if earlier trigger.
-      initiateStoreException(ExceptionCause::STORE_ACC_FAULT, addr);
+      initiateStoreException(cause, addr);
       return false;
     }
 
-  if (hasTrig and not forceAccessFail_ and memory_.checkWrite(addr, storeVal))
+  if (hasTrig and not forceAccessFail_ and memory_.checkWrite(pa, storeVal))
     {
       // No exception: consider store-data  trigger
       if (ldStDataTriggerHit(storeVal, timing, isLoad, isInterruptEnabled()))
@@ -8251,17 +9588,45 @@ Core<URV>::storeConditional(URV addr, STORE_TYPE storeVal)
   if (triggerTripped_)
     return false;
 
-  if (not hasLr_ or addr != lrAddr_)
+  // Reservation may have been lost to a write by another hart. The
+  // reservations of the granule are invalidated under the same lock:
+  // Hold it from the check to the store so that no other hart
+  // invalidates the reservation in between.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(pa));
+  if (not hasLr_ or pa != lrAddr_ or
+      not memory_.hasReservation(hartId_, pa))
     return false;
 
   bool forceFail = forceAccessFail_;
-  if (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(addr))
+  if (amoIllegalOutsideDccm_ and not memory_.isAddrInDccm(pa))
     forceFail = true;
 
-  if (not forceFail and memory_.write(addr, storeVal))
+  // A plain store of another hart writes before it invalidates the
+  // reservations. In regular memory, the store takes place only if
+  // the location still holds the value loaded by the load-reserve:
+  // This catches such a store done before the check above.
+  STORE_TYPE* ptr = forceFail? nullptr : memory_.atomicPtr<STORE_TYPE>(pa);
+  bool stored = false;
+  if (ptr)
+    {
+      STORE_TYPE expected = STORE_TYPE(lrValue_);
+      if (not __atomic_compare_exchange_n(ptr, &expected, storeVal, false,
+					  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+	return false;
+      lastWrite_.set(sizeof(STORE_TYPE), pa, storeVal, expected,
+		     memory_.isAddrInDccm(pa));
+      stored = true;
+    }
+  else if (not forceFail)
+    stored = memory_.write(pa, storeVal, lastWrite_);
+
+  if (stored)
     {
+      ++memWriteCount_;
+      memory_.invalidateReservations(pa, sizeof(STORE_TYPE));
+
       // If we write to special location, end the simulation.
-      if (toHostValid_ and addr == toHost_ and storeVal != 0)
+      if (toHostValid_ and pa == toHost_ and storeVal != 0)
 	{
 	  throw CoreException(CoreException::Stop, "write to to-host",
 			      toHost_, storeVal);
@@ -8269,9 +9634,8 @@ Core<URV>::storeConditional(URV addr, STORE_TYPE storeVal)
 
       if (maxStoreQueueSize_)
 	{
-	  uint64_t prevVal = 0;
-	  memory_.getLastWriteOldValue(prevVal);
-	  putInStoreQueue(sizeof(STORE_TYPE), addr, storeVal, prevVal);
+	  putInStoreQueue(sizeof(STORE_TYPE), pa, storeVal,
+			  lastWrite_.prevValue_);
 	}
       return true;
     }
@@ -8291,15 +9655,15 @@ Core<URV>::execSc_w(uint32_t rd, uint32_t rs1, int32_t rs2)
   URV value = intRegs_.read(rs2);
   URV addr = intRegs_.read(rs1);
 
-  if (storeConditional(addr, uint32_t(value)))
+  bool ok = storeConditional(addr, uint32_t(value));
+  cancelLr();
+
+  if (ok)
     {
-      hasLr_ = false;
       intRegs_.write(rd, 0); // success
       return;
     }
 
-  hasLr_ = false;
-
   if (hasException_ or triggerTripped_)
     return;
 
@@ -8311,9 +9675,13 @@ template <typename URV>
 void
 Core<URV>::execAmoadd_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t { return mem + reg; };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8339,9 +9707,13 @@ template <typename URV>
 void
 Core<URV>::execAmoswap_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t, uint32_t reg) -> uint32_t { return reg; };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8367,9 +9739,13 @@ template <typename URV>
 void
 Core<URV>::execAmoxor_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t { return mem ^ reg; };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8395,9 +9771,13 @@ template <typename URV>
 void
 Core<URV>::execAmoor_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t { return mem | reg; };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8423,9 +9803,13 @@ template <typename URV>
 void
 Core<URV>::execAmoand_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t { return mem & reg; };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8451,9 +9835,15 @@ template <typename URV>
 void
 Core<URV>::execAmomin_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t {
+	      return int32_t(mem) < int32_t(reg) ? mem : reg;
+	    };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8480,9 +9870,15 @@ template <typename URV>
 void
 Core<URV>::execAmominu_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t {
+	      return mem < reg ? mem : reg;
+	    };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8510,9 +9906,15 @@ template <typename URV>
 void
 Core<URV>::execAmomax_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t {
+	      return int32_t(mem) > int32_t(reg) ? mem : reg;
+	    };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8538,9 +9940,15 @@ template <typename URV>
 void
 Core<URV>::execAmomaxu_w(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint32_t mem, uint32_t reg) -> uint32_t {
+	      return mem > reg ? mem : reg;
+	    };
+  if (amoAtomic<uint32_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad32(rs1, loadedValue);
@@ -8574,8 +9982,8 @@ Core<URV>::execLr_d(uint32_t rd, uint32_t rs1, int32_t)
     return;
 
   hasLr_ = true;
-  lrAddr_ = loadAddr_;
   lrSize_ = 8;
+  memory_.makeReservation(hartId_, lrAddr_);
 }
 
 
@@ -8586,7 +9994,10 @@ Core<URV>::execSc_d(uint32_t rd, uint32_t rs1, int32_t rs2)
   URV value = intRegs_.read(rs2);
   URV addr = intRegs_.read(rs1);
 
-  if (storeConditional(addr, uint64_t(value)))
+  bool ok = storeConditional(addr, uint64_t(value));
+  cancelLr();
+
+  if (ok)
     {
       intRegs_.write(rd, 0); // success
       return;
@@ -8603,9 +10014,13 @@ template <typename URV>
 void
 Core<URV>::execAmoadd_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t { return mem + reg; };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8617,7 +10032,7 @@ Core<URV>::execAmoadd_d(uint32_t rd, uint32_t rs1, int32_t rs2)
       URV rs2Val = intRegs_.read(rs2);
       URV result = rs2Val + rdVal;
 
-      bool storeOk = store<uint32_t>(addr, addr, result);
+      bool storeOk = store<URV>(addr, addr, result);
 
       if (storeOk and not triggerTripped_)
 	intRegs_.write(rd, rdVal);
@@ -8629,9 +10044,13 @@ template <typename URV>
 void
 Core<URV>::execAmoswap_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t, uint64_t reg) -> uint64_t { return reg; };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8655,9 +10074,13 @@ template <typename URV>
 void
 Core<URV>::execAmoxor_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t { return mem ^ reg; };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8681,9 +10104,13 @@ template <typename URV>
 void
 Core<URV>::execAmoor_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t { return mem | reg; };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8707,9 +10134,13 @@ template <typename URV>
 void
 Core<URV>::execAmoand_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t { return mem & reg; };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8733,9 +10164,15 @@ template <typename URV>
 void
 Core<URV>::execAmomin_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t {
+	      return int64_t(mem) < int64_t(reg) ? mem : reg;
+	    };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8759,9 +10196,15 @@ template <typename URV>
 void
 Core<URV>::execAmominu_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t {
+	      return mem < reg ? mem : reg;
+	    };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8785,9 +10228,15 @@ template <typename URV>
 void
 Core<URV>::execAmomax_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t {
+	      return int64_t(mem) > int64_t(reg) ? mem : reg;
+	    };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8811,9 +10260,15 @@ template <typename URV>
 void
 Core<URV>::execAmomaxu_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  // Lock mutex to serialize AMO instructions. Unlock automatically on
-  // exit from this scope.
-  std::lock_guard<std::mutex> lock(memory_.amoMutex_);
+  auto op = [] (uint64_t mem, uint64_t reg) -> uint64_t {
+	      return mem > reg ? mem : reg;
+	    };
+  if (amoAtomic<uint64_t>(rd, rs1, rs2, op))
+    return;
+
+  // Serialize with other AMO instructions to the same location.
+  // Unlock automatically on exit from this scope.
+  std::lock_guard<std::recursive_mutex> lock(memory_.amoMutex(intRegs_.read(rs1)));
 
   URV loadedValue = 0;
   bool loadOk = amoLoad64(rs1, loadedValue);
@@ -8833,266 +10288,443 @@ Core<URV>::execAmomaxu_d(uint32_t rd, uint32_t rs1, int32_t rs2)
 }
 
 
-template <typename URV>
+/// Carry-less multiply a by b setting low and high to the least and
+/// most significant 64 bits of the 128-bit product.
+inline
 void
-Core<URV>::execClz(uint32_t rd, uint32_t rs1, int32_t)
+clmul64(uint64_t a, uint64_t b, uint64_t& low, uint64_t& high)
 {
-  if (not isRvzbmini())
+#ifdef __PCLMUL__
+  __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi64_si128(a),
+				      _mm_cvtsi64_si128(b), 0);
+  low = _mm_cvtsi128_si64(prod);
+  high = _mm_cvtsi128_si64(_mm_unpackhi_epi64(prod, prod));
+#else
+  // One shift/xor per set bit of b.
+  low = high = 0;
+  for ( ; b; b &= b - 1)
     {
-      illegalInst();
-      return;
+      unsigned i = __builtin_ctzll(b);
+      low ^= a << i;
+      if (i)
+	high ^= a >> (64 - i);
     }
-
-  URV v1 = intRegs_.read(rs1);
-
-  if constexpr (sizeof(URV) == 4)
-    v1 = __builtin_clz(v1);
-  else
-    v1 = __builtin_clzl(v1);
-
-  intRegs_.write(rd, v1);
+#endif
 }
 
 
 template <typename URV>
 void
-Core<URV>::execCtz(uint32_t rd, uint32_t rs1, int32_t)
+Core<URV>::execAdd_uw(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba() or not isRv64())
     {
       illegalInst();
       return;
     }
 
-  URV v1 = intRegs_.read(rs1);
-
-  if constexpr (sizeof(URV) == 4)
-    v1 = __builtin_ctz(v1);
-  else
-    v1 = __builtin_ctzl(v1);
-
-  intRegs_.write(rd, v1);
+  URV res = intRegs_.read(rs2) + uint32_t(intRegs_.read(rs1));
+  intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execPcnt(uint32_t rd, uint32_t rs1, int32_t)
+Core<URV>::execSh1add(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba())
     {
       illegalInst();
       return;
     }
 
-  URV v1 = intRegs_.read(rs1);
-  URV res = __builtin_popcount(v1);
+  URV res = intRegs_.read(rs2) + (intRegs_.read(rs1) << 1);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execAndc(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execSh1add_uw(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba() or not isRv64())
     {
       illegalInst();
       return;
     }
 
-  URV v1 = intRegs_.read(rs1);
-  URV v2 = intRegs_.read(rs2);
-  URV res = v1 & ~v2;
+  URV res = intRegs_.read(rs2) + (URV(uint32_t(intRegs_.read(rs1))) << 1);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execSlo(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execSh2add(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba())
     {
       illegalInst();
       return;
     }
 
-  URV mask = intRegs_.shiftMask();
-  URV shift = intRegs_.read(rs2) & mask;
-
-  URV v1 = intRegs_.read(rs1);
-  URV res = ~((~v1) << shift);
+  URV res = intRegs_.read(rs2) + (intRegs_.read(rs1) << 2);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execSro(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execSh2add_uw(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba() or not isRv64())
     {
       illegalInst();
       return;
     }
 
-  URV mask = intRegs_.shiftMask();
-  URV shift = intRegs_.read(rs2) & mask;
-
-  URV v1 = intRegs_.read(rs1);
-  URV res = ~((~v1) >> shift);
+  URV res = intRegs_.read(rs2) + (URV(uint32_t(intRegs_.read(rs1))) << 2);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execSloi(uint32_t rd, uint32_t rs1, int32_t imm)
+Core<URV>::execSh3add(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba())
     {
       illegalInst();
       return;
     }
 
-  if ((imm & 0x20) and not rv64_)
-    {
-      illegalInst();  // Bit 5 of shift amount cannot be one in 32-bit.
-      return;
-    }
-
-  URV v1 = intRegs_.read(rs1);
-  URV res = ~((~v1) << imm);
+  URV res = intRegs_.read(rs2) + (intRegs_.read(rs1) << 3);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execSroi(uint32_t rd, uint32_t rs1, int32_t imm)
+Core<URV>::execSh3add_uw(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzba() or not isRv64())
     {
       illegalInst();
       return;
     }
 
-  if ((imm & 0x20) and not rv64_)
-    {
-      illegalInst();  // Bit 5 of shift amount cannot be one in 32-bit.
-      return;
-    }
-
-  URV v1 = intRegs_.read(rs1);
-  URV res = ~((~v1) >> imm);
+  URV res = intRegs_.read(rs2) + (URV(uint32_t(intRegs_.read(rs1))) << 3);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execMin(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execSlli_uw(uint32_t rd, uint32_t rs1, int32_t amount)
 {
-  if (not isRvzbmini())
+  if (not isRvzba() or not isRv64())
     {
       illegalInst();
       return;
     }
 
-  SRV v1 = intRegs_.read(rs1);
-  SRV v2 = intRegs_.read(rs2);
-  SRV res = v1 < v2? v1 : v2;
+  URV res = URV(uint32_t(intRegs_.read(rs1))) << amount;
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execMax(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execAndn(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb())
     {
       illegalInst();
       return;
     }
 
-  SRV v1 = intRegs_.read(rs1);
-  SRV v2 = intRegs_.read(rs2);
-  SRV res = v1 > v2? v1 : v2;
+  URV res = intRegs_.read(rs1) & ~intRegs_.read(rs2);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execMinu(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execOrn(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb())
     {
       illegalInst();
       return;
     }
 
-  URV v1 = intRegs_.read(rs1);
-  URV v2 = intRegs_.read(rs2);
-  URV res = v1 < v2? v1 : v2;
+  URV res = intRegs_.read(rs1) | ~intRegs_.read(rs2);
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execMaxu(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execXnor(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb())
     {
       illegalInst();
       return;
     }
 
-  URV v1 = intRegs_.read(rs1);
-  URV v2 = intRegs_.read(rs2);
-  URV res = v1 > v2? v1 : v2;
+  URV res = ~(intRegs_.read(rs1) ^ intRegs_.read(rs2));
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execRol(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execClz(uint32_t rd, uint32_t rs1, int32_t)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb())
     {
       illegalInst();
       return;
     }
 
-  URV mask = intRegs_.shiftMask();
-  URV rot = intRegs_.read(rs2) & mask;  // Rotate amount
-
   URV v1 = intRegs_.read(rs1);
-  URV res = (v1 << rot) | (v1 >> (intRegs_.regWidth() - rot));
+  URV res = 8*sizeof(URV);
 
-  intRegs_.write(rd, res);
+  if (v1 == 0)
+    ;  // The host builtins are undefined for zero.
+  else if constexpr (sizeof(URV) == 4)
+    res = __builtin_clz(v1);
+  else
+    res = __builtin_clzll(v1);
+
+  intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execRor(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execClzw(uint32_t rd, uint32_t rs1, int32_t)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb() or not isRv64())
     {
       illegalInst();
       return;
     }
 
-  URV mask = intRegs_.shiftMask();
-  URV rot = intRegs_.read(rs2) & mask;  // Rotate amount
+  uint32_t v1 = intRegs_.read(rs1);
+  URV res = v1 == 0 ? 32 : __builtin_clz(v1);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execCtz(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV v1 = intRegs_.read(rs1);
+  URV res = 8*sizeof(URV);
+
+  if (v1 == 0)
+    ;  // The host builtins are undefined for zero.
+  else if constexpr (sizeof(URV) == 4)
+    res = __builtin_ctz(v1);
+  else
+    res = __builtin_ctzll(v1);
+
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execCtzw(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb() or not isRv64())
+    {
+      illegalInst();
+      return;
+    }
+
+  uint32_t v1 = intRegs_.read(rs1);
+  URV res = v1 == 0 ? 32 : __builtin_ctz(v1);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execCpop(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV v1 = intRegs_.read(rs1);
+  URV res = 0;
+
+  if constexpr (sizeof(URV) == 4)
+    res = __builtin_popcount(v1);
+  else
+    res = __builtin_popcountll(v1);
+
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execCpopw(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb() or not isRv64())
+    {
+      illegalInst();
+      return;
+    }
+
+  uint32_t v1 = intRegs_.read(rs1);
+  URV res = __builtin_popcount(v1);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execMax(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  SRV v1 = intRegs_.read(rs1);
+  SRV v2 = intRegs_.read(rs2);
+  SRV res = v1 > v2? v1 : v2;
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execMaxu(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV v1 = intRegs_.read(rs1);
+  URV v2 = intRegs_.read(rs2);
+  URV res = v1 > v2? v1 : v2;
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execMin(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  SRV v1 = intRegs_.read(rs1);
+  SRV v2 = intRegs_.read(rs2);
+  SRV res = v1 < v2? v1 : v2;
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execMinu(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV v1 = intRegs_.read(rs1);
+  URV v2 = intRegs_.read(rs2);
+  URV res = v1 < v2? v1 : v2;
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execSext_b(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  SRV res = int8_t(intRegs_.read(rs1));
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execSext_h(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  SRV res = int16_t(intRegs_.read(rs1));
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execZext_h(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV res = uint16_t(intRegs_.read(rs1));
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execRol(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned width = intRegs_.regWidth();
+  URV rot = intRegs_.read(rs2) & (width - 1);  // Rotate amount
 
+  // Masked shift amounts: Recognized by the compiler as a host rotate.
   URV v1 = intRegs_.read(rs1);
-  URV res = (v1 >> rot) | (v1 << (intRegs_.regWidth() - rot));
+  URV res = (v1 << rot) | (v1 >> ((width - rot) & (width - 1)));
 
   intRegs_.write(rd, res);
 }
@@ -9100,34 +10732,120 @@ Core<URV>::execRor(uint32_t rd, uint32_t rs1, int32_t rs2)
 
 template <typename URV>
 void
-Core<URV>::execRori(uint32_t rd, uint32_t rs1, int32_t imm)
+Core<URV>::execRolw(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb() or not isRv64())
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned rot = intRegs_.read(rs2) & 31;
+  uint32_t v1 = intRegs_.read(rs1);
+  int32_t res = (v1 << rot) | (v1 >> ((32 - rot) & 31));
+  intRegs_.write(rd, SRV(res));  // Sign extend to 64-bits.
+}
+
+
+template <typename URV>
+void
+Core<URV>::execRor(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb())
     {
       illegalInst();
       return;
     }
 
-  if ((imm & 0x20) and not rv64_)
+  unsigned width = intRegs_.regWidth();
+  URV rot = intRegs_.read(rs2) & (width - 1);  // Rotate amount
+
+  URV v1 = intRegs_.read(rs1);
+  URV res = (v1 >> rot) | (v1 << ((width - rot) & (width - 1)));
+
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execRori(uint32_t rd, uint32_t rs1, int32_t amount)
+{
+  if (not isRvzbb())
     {
-      illegalInst();  // Bit 5 of rotate amount cannot be one in 32-bit.
+      illegalInst();
       return;
     }
 
-  URV rot = imm;
+  unsigned width = intRegs_.regWidth();
+  URV rot = amount;
 
   URV v1 = intRegs_.read(rs1);
-  URV res = (v1 >> rot) | (v1 << (intRegs_.regWidth() - rot));
+  URV res = (v1 >> rot) | (v1 << ((width - rot) & (width - 1)));
+
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execRoriw(uint32_t rd, uint32_t rs1, int32_t amount)
+{
+  if (not isRvzbb() or not isRv64())
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned rot = amount & 31;
+  uint32_t v1 = intRegs_.read(rs1);
+  int32_t res = (v1 >> rot) | (v1 << ((32 - rot) & 31));
+  intRegs_.write(rd, SRV(res));  // Sign extend to 64-bits.
+}
+
+
+template <typename URV>
+void
+Core<URV>::execRorw(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbb() or not isRv64())
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned rot = intRegs_.read(rs2) & 31;
+  uint32_t v1 = intRegs_.read(rs1);
+  int32_t res = (v1 >> rot) | (v1 << ((32 - rot) & 31));
+  intRegs_.write(rd, SRV(res));  // Sign extend to 64-bits.
+}
+
+
+template <typename URV>
+void
+Core<URV>::execOrc_b(uint32_t rd, uint32_t rs1, int32_t)
+{
+  if (not isRvzbb())
+    {
+      illegalInst();
+      return;
+    }
 
+  // Set the most significant bit of each non-zero byte without
+  // carries across bytes, then spread it over the byte.
+  URV low7 = ~URV(0) / 0xff * 0x7f;
+  URV v1 = intRegs_.read(rs1);
+  URV high = (((v1 & low7) + low7) | v1) & ~low7;
+  URV res = (high >> 7) * 0xff;
   intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execBswap(uint32_t rd, uint32_t rs1, int32_t)
+Core<URV>::execRev8(uint32_t rd, uint32_t rs1, int32_t)
 {
-  if (not isRvzbmini())
+  if (not isRvzbb())
     {
       illegalInst();
       return;
@@ -9146,49 +10864,194 @@ Core<URV>::execBswap(uint32_t rd, uint32_t rs1, int32_t)
 
 template <typename URV>
 void
-Core<URV>::execBrev(uint32_t rd, uint32_t rs1, int32_t)
+Core<URV>::execClmul(uint32_t rd, uint32_t rs1, int32_t rs2)
 {
-  if (not isRvzbmini())
+  if (not isRvzbc())
     {
       illegalInst();
       return;
     }
 
-  URV v1 = intRegs_.read(rs1);
+  uint64_t low = 0, high = 0;
+  clmul64(intRegs_.read(rs1), intRegs_.read(rs2), low, high);
+  intRegs_.write(rd, URV(low));
+}
+
+
+template <typename URV>
+void
+Core<URV>::execClmulh(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbc())
+    {
+      illegalInst();
+      return;
+    }
+
+  uint64_t low = 0, high = 0;
+  clmul64(intRegs_.read(rs1), intRegs_.read(rs2), low, high);
 
+  // Product of two 32-bit values fits in the low 64 bits.
   if constexpr (sizeof(URV) == 4)
+    intRegs_.write(rd, URV(low >> 32));
+  else
+    intRegs_.write(rd, high);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execClmulr(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbc())
     {
-      v1 = ((v1 & 0xaaaaaaaa) >> 1) | ((v1 & 0x55555555) << 1);
-      v1 = ((v1 & 0xcccccccc) >> 2) | ((v1 & 0x33333333) << 2);
-      v1 = ((v1 & 0xf0f0f0f0) >> 4) | ((v1 & 0x0f0f0f0f) << 4);
-      v1 = __builtin_bswap32(v1);
+      illegalInst();
+      return;
     }
+
+  uint64_t low = 0, high = 0;
+  clmul64(intRegs_.read(rs1), intRegs_.read(rs2), low, high);
+
+  // Bits 2*xlen-2 to xlen-1 of the product.
+  if constexpr (sizeof(URV) == 4)
+    intRegs_.write(rd, URV(low >> 31));
   else
+    intRegs_.write(rd, (high << 1) | (low >> 63));
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBclr(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbs())
     {
-      v1 = ((v1 & 0xaaaaaaaaaaaaaaaa) >> 1) | ((v1 & 0x5555555555555555) << 1);
-      v1 = ((v1 & 0xcccccccccccccccc) >> 2) | ((v1 & 0x3333333333333333) << 2);
-      v1 = ((v1 & 0xf0f0f0f0f0f0f0f0) >> 4) | ((v1 & 0x0f0f0f0f0f0f0f0f) << 4);
-      v1 = __builtin_bswap64(v1);
+      illegalInst();
+      return;
     }
 
-  intRegs_.write(rd, v1);
+  URV bit = intRegs_.read(rs2) & (intRegs_.regWidth() - 1);
+  URV v1 = intRegs_.read(rs1);
+  URV res = v1 & ~(URV(1) << bit);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBclri(uint32_t rd, uint32_t rs1, int32_t amount)
+{
+  if (not isRvzbs())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV bit = amount;
+  URV v1 = intRegs_.read(rs1);
+  URV res = v1 & ~(URV(1) << bit);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBext(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbs())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV bit = intRegs_.read(rs2) & (intRegs_.regWidth() - 1);
+  URV v1 = intRegs_.read(rs1);
+  URV res = (v1 >> bit) & 1;
+  intRegs_.write(rd, res);
 }
 
 
 template <typename URV>
 void
-Core<URV>::execPack(uint32_t rd, uint32_t rs1, int32_t rs2)
+Core<URV>::execBexti(uint32_t rd, uint32_t rs1, int32_t amount)
 {
-  if (not isRvzbmini())
+  if (not isRvzbs())
     {
       illegalInst();
       return;
     }
 
-  unsigned halfXlen = sizeof(URV)*4;
-  URV upper = intRegs_.read(rs1) << halfXlen;
-  URV lower = (intRegs_.read(rs2) << halfXlen) >> halfXlen;
-  URV res = upper | lower;
+  URV bit = amount;
+  URV v1 = intRegs_.read(rs1);
+  URV res = (v1 >> bit) & 1;
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBinv(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbs())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV bit = intRegs_.read(rs2) & (intRegs_.regWidth() - 1);
+  URV v1 = intRegs_.read(rs1);
+  URV res = v1 ^ (URV(1) << bit);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBinvi(uint32_t rd, uint32_t rs1, int32_t amount)
+{
+  if (not isRvzbs())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV bit = amount;
+  URV v1 = intRegs_.read(rs1);
+  URV res = v1 ^ (URV(1) << bit);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBset(uint32_t rd, uint32_t rs1, int32_t rs2)
+{
+  if (not isRvzbs())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV bit = intRegs_.read(rs2) & (intRegs_.regWidth() - 1);
+  URV v1 = intRegs_.read(rs1);
+  URV res = v1 | (URV(1) << bit);
+  intRegs_.write(rd, res);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execBseti(uint32_t rd, uint32_t rs1, int32_t amount)
+{
+  if (not isRvzbs())
+    {
+      illegalInst();
+      return;
+    }
+
+  URV bit = amount;
+  URV v1 = intRegs_.read(rs1);
+  URV res = v1 | (URV(1) << bit);
   intRegs_.write(rd, res);
 }
 
@@ -20,15 +20,26 @@
 
 #include <cstdint>
 #include <vector>
+#include <deque>
+#include <memory>
 #include <iosfwd>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include "InstId.hpp"
 #include "InstInfo.hpp"
 #include "IntRegs.hpp"
 #include "CsRegs.hpp"
 #include "FpRegs.hpp"
+#include "VecRegs.hpp"
+#include "PmpManager.hpp"
+#include "VirtMem.hpp"
+#include "UndoLog.hpp"
 #include "Memory.hpp"
 #include "InstProfile.hpp"
+#include "BranchPredictor.hpp"
+#include "CodeCoverage.hpp"
+#include "FuncCoverage.hpp"
 
 namespace WdRiscv
 {
@@ -70,8 +81,17 @@ namespace WdRiscv
   /// test pattern generation.
   struct ChangeRecord
   {
+    /// Reset to no change keeping the capacity of the CSR vectors: A
+    /// record reused across instructions does not allocate.
     void clear()
-    { *this = ChangeRecord(); }
+    {
+      csrIx.clear();
+      csrValue.clear();
+      newPc = 0; hasException = false;
+      hasIntReg = false; intRegIx = 0; intRegValue = 0;
+      hasFpReg = false; fpRegIx = 0; fpRegValue = 0;
+      memSize = 0; memAddr = 0; memValue = 0;
+    }
 
     uint64_t newPc = 0;        // Value of pc after instruction execution.
     bool hasException = false; // True if instruction causes an exception.
@@ -131,6 +151,20 @@ namespace WdRiscv
     size_t fpRegCount() const
     { return isRvf()? fpRegs_.size() : 0; }
 
+    /// Return count of vector registers. Return zero if extension v
+    /// is not enabled.
+    size_t vecRegCount() const
+    { return isRvv()? vecRegs_.size() : 0; }
+
+    /// Return the width in bits of the vector registers (VLEN).
+    unsigned vecRegWidth() const
+    { return vecRegs_.bitsPerReg(); }
+
+    /// Set the width in bits of the vector registers (VLEN) clearing
+    /// them. Return false leaving registers unmodified if width is not
+    /// a power of 2 between 64 and 65536.
+    bool configVectorLength(unsigned width);
+
     /// Return size of memory in bytes.
     size_t memorySize() const
     { return memory_.size(); }
@@ -170,6 +204,18 @@ namespace WdRiscv
     /// true on success. Return false if reg is out of bound.
     bool pokeFpReg(unsigned reg, uint64_t val);
 
+    /// Set bytes to the contents of the vector register reg (least
+    /// significant byte first) returning true on success. Return false
+    /// leaving bytes unmodified if reg is out of bounds or if the vector
+    /// extension is not enabled.
+    bool peekVecReg(unsigned reg, std::vector<uint8_t>& bytes) const;
+
+    /// Set the contents of the vector register reg from the given bytes
+    /// (least significant byte first, missing bytes are zero) returning
+    /// true on success. Return false if reg is out of bounds or if the
+    /// vector extension is not enabled.
+    bool pokeVecReg(unsigned reg, const std::vector<uint8_t>& bytes);
+
     /// Set val to the value of the control and status register csr
     /// returning true on success. Return false leaving val unmodified
     /// if csr is out of bounds.
@@ -244,6 +290,12 @@ namespace WdRiscv
     /// read-write.
     bool configMachineModePerfCounters(unsigned n);
 
+    /// Define the number of implemented PMP entries (0 to 16) returning
+    /// true on success and false on failure. With no entry (the
+    /// default), PMP does not restrict any access and the PMP CSRs are
+    /// read-only zero.
+    bool configPmpEntries(unsigned count);
+
     /// Set the maximum event id that can be written to the mhpmevent
     /// registers. Larger values are replaced by this max-value before
     /// being written to the mhpmevent registers. Return true on
@@ -311,6 +363,80 @@ namespace WdRiscv
     /// exception).
     bool whatIfSingleStep(uint32_t inst, ChangeRecord& record);
 
+    /// Start a what-if sequence: The instructions executed by whatIfStep
+    /// until the matching whatIfEnd change the hart and the memory as
+    /// usual (each one sees the effects of the previous ones) while the
+    /// previous values of the modified resources are recorded in an
+    /// undo log. Sequences do not nest: Return false if one is already
+    /// active.
+    bool whatIfBegin();
+
+    /// Execute the given instruction at the current program counter
+    /// within a what-if sequence (see whatIfBegin). Nothing is fetched.
+    /// Set the fields of the record to the resources changed by the
+    /// instruction. Return true if the instruction executes without an
+    /// exception and false otherwise.
+    bool whatIfStep(uint32_t inst, ChangeRecord& record);
+
+    /// End the current what-if sequence (if any) restoring the hart
+    /// and the memory to their state at the matching whatIfBegin. Cost
+    /// is proportional to the number of changes.
+    void whatIfEnd();
+
+    /// Return true if a what-if sequence is active.
+    bool inWhatIf() const
+    { return inWhatIf_; }
+
+    /// Enable reverse execution: Take a snapshot of the hart every
+    /// period instructions keeping the memory pages written since the
+    /// previous snapshot. Going back in time restores the nearest
+    /// snapshot and re-executes deterministically from there. The
+    /// oldest snapshots are dropped to keep the saved data within
+    /// budget bytes. A zero period disables reverse execution.
+    /// Supported with a single hart only. Intercepted system calls are
+    /// disabled while this is on.
+    void enableSnapshots(uint64_t period, uint64_t budget);
+
+    /// Return true if reverse execution is enabled.
+    bool hasSnapshots() const
+    { return snapshotPeriod_ != 0; }
+
+    /// Return the instruction count of the oldest state that can be
+    /// reached by going back in time.
+    uint64_t historyStart() const
+    { return snapshots_.empty() ? counter_ : snapshots_.front().state_.counter_; }
+
+    /// Bring the hart and the memory to their state after the given
+    /// number of executed instructions (see getInstructionCount)
+    /// going back in time if needed. Return true on success. Return
+    /// false without changing anything if the count precedes
+    /// historyStart. Return false if the program stops before reaching
+    /// a later count.
+    bool gotoInstruction(uint64_t count);
+
+    /// Go back the given number of instructions. If that precedes
+    /// historyStart, go to historyStart and return false.
+    bool reverseStep(uint64_t count = 1);
+
+    /// Go back to the latest state preceding the current one where
+    /// the program counter is at a breakpoint (see addBreakpoint). If
+    /// there is no such state, go to historyStart and return false.
+    bool reverseContinue();
+
+    /// Define a breakpoint at the given address: Execution under the
+    /// debugger (gdb) stops before executing the instruction at that
+    /// address. Breakpoints are also the targets of reverseContinue.
+    void addBreakpoint(URV address)
+    { breakpoints_.insert(address); }
+
+    /// Remove the breakpoint at the given address (if any).
+    void removeBreakpoint(URV address)
+    { breakpoints_.erase(address); }
+
+    /// Return true if there is a breakpoint at the given address.
+    bool hasBreakpoint(URV address) const
+    { return breakpoints_.count(address) != 0; }
+
     /// Run until the program counter reaches the given address. Do
     /// execute the instruction at that address. If file is non-null
     /// then print thereon tracing information after each executed
@@ -321,6 +447,46 @@ namespace WdRiscv
     /// print run-time and instructions per second.
     bool untilAddress(URV address, FILE* file = nullptr);
 
+    /// Run at most count instructions using the same stopping criteria
+    /// as method run. Set done to true if this hart cannot progress any
+    /// further (target program finished, instruction count limit or
+    /// stop address reached, keyboard interrupt). Return false if the
+    /// target program stopped with a failure and true otherwise. This
+    /// is used to interleave the execution of harts in fixed-size
+    /// quanta.
+    bool runQuantum(uint64_t count, FILE* file, bool& done);
+
+    /// Run up to count instructions, one at a time, looking for a
+    /// spin-wait loop: Set spinning to true if this hart comes back to
+    /// the program counter and register values it had on entry without
+    /// writing memory in between. Such a loop cannot exit until some
+    /// other agent changes memory. Set done as in runQuantum. Return
+    /// false if the target program stopped with a failure and true
+    /// otherwise. Probing is adaptive: After a probe that finds no
+    /// loop, the next 2^n-1 calls return without probing (n grows up
+    /// to 6 with each failed probe).
+    bool probeSpinLoop(unsigned count, FILE* file, bool& done,
+		       bool& spinning);
+
+    /// Return the number of successful memory writes (stores, atomics
+    /// and store-conditionals) performed by this hart.
+    uint64_t memoryWriteCount() const
+    { return memWriteCount_; }
+
+    /// Return true if a wfi instruction was executed since the last
+    /// call to clearWaitForInterrupt.
+    bool isWaitingForInterrupt() const
+    { return waitForInterrupt_; }
+
+    /// Clear the wait-for-interrupt flag set by the wfi instruction.
+    void clearWaitForInterrupt()
+    { waitForInterrupt_ = false; }
+
+    /// Return true if an interrupt is pending and locally enabled (mip
+    /// and mie have a common bit). This is the wfi resume condition
+    /// which disregards the global interrupt enable.
+    bool isInterruptPending();
+
     /// Define the program counter value at which the run method will
     /// stop.
     void setStopAddress(URV address)
@@ -418,6 +584,16 @@ namespace WdRiscv
     bool findElfFunction(URV addr, std::string& name, ElfSymbol& value) const
     { return memory_.findElfFunction(addr, name, value); }
 
+    /// Locate the source file and line of the given address using the
+    /// DWARF line information of the loaded ELF files. Return true on
+    /// success and false if address has no line information.
+    bool findSourceLine(URV addr, std::string& file, unsigned& line) const
+    { return memory_.findSourceLine(addr, file, line); }
+
+    /// Return the source line table of the loaded ELF files.
+    const DwarfLineTable& sourceLineTable() const
+    { return memory_.sourceLineTable(); }
+
     /// Print the ELF symbols on the given stream. Output format:
     /// <name> <value>
     void printElfSymbols(std::ostream& out) const
@@ -499,6 +675,12 @@ namespace WdRiscv
     /// it no FP register was written.
     int lastFpReg() const;
 
+    /// Support for tracing: Return the index of the first register of
+    /// the vector register group written by the last executed
+    /// instruction and set groupSize to the number of registers in
+    /// that group. Return -1 if no vector register was written.
+    int lastVecReg(unsigned& groupSize) const;
+
     /// Support for tracing: Fill the csrs vector with the
     /// register-numbers of the CSRs written by the execution of the
     /// last instruction. CSRs modified as a side effect (e.g. mcycle
@@ -514,6 +696,81 @@ namespace WdRiscv
     void lastMemory(std::vector<size_t>& addresses,
 		    std::vector<uint32_t>& words) const;
 
+    /// Support for tracing without heap allocation: Call visit(key,
+    /// value) for each CSR and debug-trigger component written by the
+    /// last instruction in increasing key order. The key of a CSR is
+    /// its number and that of a trigger component is (trigger << 16)
+    /// | n where n is the number of the tdata CSR. CSR values are
+    /// obtained with readCsr(csr, value) which may fail to skip a CSR.
+    template <typename READ, typename VISIT>
+    void forEachCsrChange(READ readCsr, VISIT visit) const
+    {
+      const CsrWriteSet& written = csRegs_.lastWrittenRegs();
+      if (written.empty())
+	return;
+
+      // Components of trigger 0 have the keys of the tdata CSRs.
+      bool tdataChanged[3] = {};
+      bool first = csRegs_.isTriggerLastWritten(0);
+      URV data[3] = {};
+      if (first)
+	peekTrigger(0, data[0], data[1], data[2]);
+
+      for (CsrNumber csr : written)
+	{
+	  URV value = 0;
+	  if (not readCsr(csr, value))
+	    continue;
+	  if (csr < CsrNumber::TDATA1 or csr > CsrNumber::TDATA3)
+	    {
+	      visit(URV(csr), value);
+	      continue;
+	    }
+	  unsigned ix = unsigned(csr) - unsigned(CsrNumber::TDATA1);
+	  tdataChanged[ix] = true;
+	  if (first)
+	    visit(URV(csr), data[ix]);
+	}
+
+      if (not tdataChanged[0] and not tdataChanged[1] and not tdataChanged[2])
+	return;
+
+      for (unsigned trigger = 1; trigger < csRegs_.triggerCount(); ++trigger)
+	{
+	  if (not csRegs_.isTriggerLastWritten(trigger) or
+	      not peekTrigger(trigger, data[0], data[1], data[2]))
+	    continue;
+	  for (unsigned ix = 0; ix < 3; ++ix)
+	    if (tdataChanged[ix])
+	      visit((URV(trigger) << 16) | (URV(CsrNumber::TDATA1) + ix),
+		    data[ix]);
+	}
+    }
+
+    /// Support for tracing without heap allocation: Call
+    /// visit(address, word) for each of the memory words modified by
+    /// the last executed instruction (see lastMemory).
+    template <typename VISIT>
+    void forEachMemoryChange(VISIT visit) const
+    {
+      for (const auto& info : vecWrites_)
+	{
+	  visit(size_t(info.addr_), uint32_t(info.value_));
+	  if (info.size_ == 8)
+	    visit(size_t(info.addr_ + 4), uint32_t(info.value_ >> 32));
+	}
+      if (not vecWrites_.empty())
+	return;
+
+      size_t address = 0;
+      uint64_t value = 0;
+      unsigned writeSize = getLastWriteNewValue(address, value);
+      if (writeSize)
+	visit(address, uint32_t(value));
+      if (writeSize == 8)
+	visit(address + 4, uint32_t(value >> 32));
+    }
+
     /// Return data address of last executed load instruction.
     URV lastLoadAddress() const
     { return loadAddr_; }
@@ -537,6 +794,11 @@ namespace WdRiscv
     uint64_t getInstructionCount() const 
     { return counter_; }
 
+    /// Print the TLB hit statistics of this hart on the given
+    /// stream. Print nothing if address translation was never used.
+    void printTlbStats(std::ostream& out) const
+    { virtMem_.printStats(out, hartId_); }
+
     /// Define instruction closed coupled memory (in core instruction memory).
     bool defineIccm(size_t region, size_t offset, size_t size);
 
@@ -578,6 +840,12 @@ namespace WdRiscv
     void setTraceLoad(bool flag)
     { traceLoad_ = flag; }
 
+    /// Enable printing of the source file and line of each instruction
+    /// in instruction trace mode (requires DWARF line information in
+    /// the loaded ELF files).
+    void setTraceSource(bool flag)
+    { traceSource_ = flag; }
+
     /// Return count of traps (exceptions or interrupts) seen by this
     /// core.
     uint64_t getTrapCount() const
@@ -667,6 +935,54 @@ namespace WdRiscv
     /// Print collected instruction frequency to the given file.
     void reportInstructionFrequency(FILE* file) const;
 
+    /// Print the given instruction profile (one entry per instruction
+    /// id as produced by mergeInstructionFrequency) to the given file.
+    void reportInstructionFrequency(FILE* file,
+				    const std::vector<InstProfile>& profileVec) const;
+
+    /// Same as above but in JSON format. Return true on success and
+    /// false on failure.
+    bool reportInstructionFrequencyJson(std::ostream& out,
+					const std::vector<InstProfile>& prof) const;
+
+    /// Add the instruction frequencies collected by this hart to the
+    /// given profile (one entry per instruction id). This is used to
+    /// merge the profiles of multiple harts.
+    void mergeInstructionFrequency(std::vector<InstProfile>& prof) const;
+
+    /// Enable branch prediction modeling using a predictor of the
+    /// given type. Mispredicted branches count towards the BranchMiss
+    /// performance event.
+    void enableBranchPrediction(BranchPredictor::Type type);
+
+    /// Print branch prediction statistics (overall, per function and
+    /// per branch) to the given file.
+    void reportBranchPrediction(FILE* file) const;
+
+    /// Enable code coverage collection over the executable sections
+    /// of the given ELF file. Return true on success and false if the
+    /// file cannot be read.
+    bool enableCodeCoverage(const std::string& elfFile);
+
+    /// Return the code coverage collected by this hart or null if
+    /// coverage collection is not enabled.
+    const CodeCoverage* codeCoverage() const
+    { return coverage_.get(); }
+
+    /// Return the size of the instruction at the given address (0 if
+    /// it cannot be read) setting isCondBranch to true if it is a
+    /// conditional branch and false otherwise.
+    unsigned classifyInstruction(size_t addr, bool& isCondBranch);
+
+    /// Enable/disable functional coverage collection (instruction and
+    /// operand classes, CSR accesses).
+    void enableFunctionalCoverage(bool flag);
+
+    /// Return the functional coverage collected by this hart or null
+    /// if functional coverage collection is not enabled.
+    const FuncCoverage* functionalCoverage() const
+    { return funcCov_.get(); }
+
     /// Reset trace data (items changed by the execution of an
     /// instruction.)
     void clearTraceData();
@@ -698,6 +1014,16 @@ namespace WdRiscv
     void enableNewlib(bool flag)
     { newlib_ = flag; }
 
+    /// Perform calls to the given C library routines (memcpy, memmove,
+    /// memset, strlen and strcmp, or "all" for those of them present
+    /// in the loaded ELF files) natively instead of interpreting
+    /// them. Routines are located through the ELF symbol table. Each
+    /// intercepted call counts as the given numbers of retired
+    /// instructions and cycles. Return true on success and false if a
+    /// name is not supported or its symbol is not found.
+    bool defineIntercepts(const std::vector<std::string>& names,
+			  uint64_t instCost, uint64_t cycleCost);
+
     /// For Linux emulation: Set initial target program break to the
     /// RISCV page address larger than or equal to the given address.
     void setTargetProgramBreak(URV addr);
@@ -723,6 +1049,10 @@ namespace WdRiscv
     bool isRvd() const
     { return rvd_; }
 
+    /// Return true if rvv (vector) extension is enabled in this core.
+    bool isRvv() const
+    { return rvv_; }
+
     /// Return true if rv64 (64-bit option) extension is enabled in
     /// this core.
     bool isRv64() const
@@ -752,9 +1082,40 @@ namespace WdRiscv
     bool isRvu() const
     { return rvu_; }
 
-    /// Return true if zbmini extension is enabled in this core.
-    bool isRvzbmini() const
-    { return rvzbmini_; }
+    /// Return true if the zba (address generation) bit manipulation
+    /// extension is enabled in this core.
+    bool isRvzba() const
+    { return rvzba_; }
+
+    /// Return true if the zbb (basic) bit manipulation extension is
+    /// enabled in this core.
+    bool isRvzbb() const
+    { return rvzbb_; }
+
+    /// Return true if the zbc (carry-less multiply) bit manipulation
+    /// extension is enabled in this core.
+    bool isRvzbc() const
+    { return rvzbc_; }
+
+    /// Return true if the zbs (single bit) bit manipulation extension
+    /// is enabled in this core.
+    bool isRvzbs() const
+    { return rvzbs_; }
+
+    /// Enable/disable the zba, zbb, zbc and zbs bit manipulation
+    /// extensions. Bit b of the MISA register also enables zba, zbb
+    /// and zbs. Takes effect at the next reset.
+    void enableRvzba(bool flag)
+    { enableZba_ = flag; }
+
+    void enableRvzbb(bool flag)
+    { enableZbb_ = flag; }
+
+    void enableRvzbc(bool flag)
+    { enableZbc_ = flag; }
+
+    void enableRvzbs(bool flag)
+    { enableZbs_ = flag; }
 
     /// Return true if current program is considered finihsed (either
     /// reached stop address or executed exit limit).
@@ -765,6 +1126,17 @@ namespace WdRiscv
     void setTargetProgramFinished(bool flag)
     { targetProgFinished_ = flag; }
 
+    /// Return true if the target program has finished by writing to
+    /// tohost or by calling exit. Set value to the value written to
+    /// tohost or to the exit code and set exited to true in the latter
+    /// case.
+    bool getTargetProgramStop(uint64_t& value, bool& exited) const
+    {
+      value = stopValue_;
+      exited = stopByExit_;
+      return stopped_;
+    }
+
     /// Make atomic memory operations illegal/legal outside of the DCCM
     /// region based on the value of flag (true/false).
     void setAmoIllegalOutsideDccm(bool flag)
@@ -782,21 +1154,84 @@ namespace WdRiscv
     /// exit is called.
     bool simpleRun();
 
+    /// Mark the target program as finished by the given stop or exit
+    /// exception recording its value (see getTargetProgramStop).
+    void recordStop(const CoreException& ce);
+
     /// Helper to decode. Used for compressed instructions.
     const InstInfo& decode16(uint16_t inst, uint32_t& op0, uint32_t& op1,
 			     int32_t& op2);
 
-    /// Helper to whatIfSingleStep.
-    void collectAndUndoWhatIfChanges(URV prevPc, ChangeRecord& record);
+    /// Helper to decode. Used for the 32-bit instructions that are
+    /// not base integer ones: Decode from the instruction table. Not
+    /// inlined so that the fast path of decode stays a leaf.
+    __attribute__((noinline))
+    const InstInfo& decode32(uint32_t inst, uint32_t& op0, uint32_t& op1,
+			     int32_t& op2, int32_t& op3);
+
+    /// Helper to whatIfStep: Fill the record with the changes of the
+    /// last executed instruction and append the previous values of its
+    /// registers and CSRs to the undo log (memory is logged as it is
+    /// written, see Memory::noteWrite).
+    void logWhatIfChanges(ChangeRecord& record);
 
     /// Return the effective rounding mode for the currently executing
     /// floating point instruction. This assumes that execute32 or
     /// execute16 has already set the instruction rounding mode.
     RoundingMode effectiveRoundingMode();
 
-    /// Update the accrued floating point bits in the FCSR register.
+    /// Update the accrued floating point bits in the FCSR register
+    /// with the host exception flags raised by the current
+    /// instruction. No-op in lazy mode (see beginFpSession) where the
+    /// host flags accumulate until the next syncFpFlags.
     void updateAccruedFpBits();
 
+    /// Fold the host floating point exception flags into the accrued
+    /// bits of FCSR and clear them.
+    void syncFpFlags();
+
+    /// Or the given RISCV exception flags (see FpFlags) into FCSR.
+    void orFpFlags(unsigned flags);
+
+    /// Make the host rounding mode match the given RISCV mode. The
+    /// host mode is cached across instructions and is switched only
+    /// when the mode changes. NearestMax (which the host lacks) maps
+    /// to the host nearest-even: Instructions using it go through
+    /// nearestMaxOp.
+    void setHostRoundingMode(RoundingMode mode)
+    {
+      if (mode != hostRoundingMode_)
+	changeHostRoundingMode(mode);
+    }
+
+    /// Helper to setHostRoundingMode.
+    void changeHostRoundingMode(RoundingMode mode);
+
+    /// Start a stretch of instruction execution: Clear the host
+    /// floating point exception flags and select the host default
+    /// rounding mode. If lazy is true, flags are folded into FCSR only
+    /// when a CSR is accessed (see syncFpFlags) instead of after each
+    /// floating point instruction.
+    void beginFpSession(bool lazy);
+
+    /// End a stretch of instruction execution: Fold pending flags and
+    /// restore the host default rounding mode.
+    void endFpSession();
+
+    /// Evaluate op (returning a value of the wider type W) and round
+    /// the result to F using round to nearest, ties to max magnitude.
+    /// The host cannot do this: The operation is evaluated in round
+    /// to odd and rounded in software. Accrue the exception flags.
+    template <typename F, typename W, typename OP>
+    F nearestMaxOp(OP op);
+
+    /// Convert the given floating point value to the integer type INT
+    /// using the given rounding mode. NaN and too large values
+    /// saturate to the maximum INT and too small values to the
+    /// minimum, raising the invalid flag. Accrue the exception flags.
+    template <typename INT, typename F>
+    INT fpToInt(F value, RoundingMode mode);
+
     /// Undo the effect of the last executed instruction given that
     /// that a trigger has tripped.
     void undoForTrigger();
@@ -869,6 +1304,70 @@ namespace WdRiscv
     /// accessible).  is writeable.
     bool doCsrRead(CsrNumber csr, URV& csrVal);
 
+    /// Return true if csr is one of pmpcfg0-3 or pmpaddr0-15.
+    static bool isPmpCsr(CsrNumber csr)
+    { return csr >= CsrNumber::PMPCFG0 and csr <= CsrNumber::PMPADDR15; }
+
+    /// Return the value that a CSR instruction writing csrVal to the
+    /// given PMP CSR actually stores: Locked entries keep their
+    /// value and the reserved R=0/W=1 combination is cleared.
+    URV legalizePmpWrite(CsrNumber csr, URV csrVal);
+
+    /// Redecode the PMP regions from the PMP CSRs. Called when any
+    /// of those CSRs is written.
+    void updatePmp();
+
+    /// Return true if PMP allows a data access of the given type to the
+    /// size bytes at addr in the effective privilege mode of loads and
+    /// stores (see updateTranslation).
+    bool pmpAllows(URV addr, unsigned size, PmpManager::Access access)
+    { return pmpManager_.isAllowed(addr, size, dataMode_, access); }
+
+    /// Return true if PMP allows fetching an instruction of the given
+    /// size at addr in the current privilege mode.
+    bool pmpAllowsFetch(URV addr, unsigned size)
+    { return pmpManager_.isFetchAllowed(addr, size, privMode_); }
+
+    /// Return the value that a CSR instruction writing csrVal to satp
+    /// actually stores: A write selecting an unsupported translation
+    /// mode is ignored.
+    URV legalizeSatpWrite(URV csrVal);
+
+    /// Refresh the address translation state from satp, mstatus and
+    /// the privilege mode. Called when any of those changes.
+    void updateTranslation();
+
+    /// Translate the virtual address of a data access of the given
+    /// type and size setting pa to the physical address. Return true
+    /// on success. On failure, set cause to the exception to take
+    /// and return false.
+    bool translateData(URV va, unsigned size, PmpManager::Access access,
+		       URV& pa, ExceptionCause& cause)
+    {
+      pa = va;
+      if (not virtMem_.isDataActive())
+	return true;
+      return translateDataSlow(va, size, access, pa, cause);
+    }
+
+    /// Helper to translateData.
+    bool translateDataSlow(URV va, unsigned size, PmpManager::Access access,
+			   URV& pa, ExceptionCause& cause);
+
+    /// Translate the virtual address of an instruction fetch. Same
+    /// conventions as translateData.
+    bool translateInstAddr(URV va, URV& pa, ExceptionCause& cause);
+
+    /// Helper to fetchInst: Fetch an instruction outside the fetch
+    /// window translating its address (an instruction may straddle
+    /// two pages) and checking PMP. On success, refresh the window.
+    bool fetchInstSlow(URV addr, uint32_t& inst);
+
+    /// Make the page of the instruction at virtual address va and
+    /// physical address pa the fetch window if it is executable as a
+    /// whole.
+    void setFetchWindow(URV va, URV pa);
+
     /// Return true if one or more load-address/store-address trigger
     /// has a hit on the given address and given timing
     /// (before/after). Set the hit bit of all the triggers that trip.
@@ -911,11 +1410,64 @@ namespace WdRiscv
     /// performance monitors).
     void accumulateInstructionStats(uint32_t inst);
 
+    /// Decoded instruction: Result of decode for a given instruction
+    /// code plus the mask of the performance events implied by the
+    /// instruction encoding (see PerfRegs::updateCounters(uint64_t)).
+    struct DecodedInst
+    {
+      uint32_t inst_ = 0;
+      const InstInfo* info_ = nullptr;  // Null if entry is not valid.
+      uint32_t op0_ = 0;
+      uint32_t op1_ = 0;
+      int32_t op2_ = 0;
+      int32_t op3_ = 0;
+      uint64_t events_ = 0;
+    };
+
+    /// Same as decode but results are cached (in a direct mapped
+    /// table indexed by instruction code) to avoid decoding again
+    /// recently executed instructions. Returned reference is valid
+    /// until the next call.
+    const DecodedInst& decodeCached(uint32_t inst)
+    {
+      DecodedInst& di = decodeCache_[(inst ^ (inst >> 12)) & decodeCacheMask_];
+      if (di.info_ == nullptr or di.inst_ != inst)
+	fillDecodedInst(inst, di);
+      return di;
+    }
+
+    /// Decode given instruction into given cache entry, computing
+    /// the entry's static event mask.
+    void fillDecodedInst(uint32_t inst, DecodedInst& di);
+
+    /// Invalidate all decode cache entries. This must be done
+    /// whenever the decoding depends on state that has changed (for
+    /// example, the extensions enabled in MISA).
+    void invalidateDecodeCache()
+    {
+      for (auto& di : decodeCache_)
+	di.info_ = nullptr;
+    }
+
+    /// Point rvcExpansion_ to the table of the 32-bit equivalents (see
+    /// expandInst) of every 16-bit code under the currently enabled
+    /// extensions. Tables are shared by the cores with the same XLEN
+    /// and F/D extensions.
+    void setupRvcExpansion();
+
     /// Update performance counters: Enabled counters tick up
     /// according to the events associated with the most recent
     /// retired instruction.
-    void updatePerformanceCounters(uint32_t inst, const InstInfo& info,
-				   uint32_t op0, uint32_t op1);
+    void updatePerformanceCounters(const DecodedInst& di);
+
+    /// Present the outcome of the most recent retired branch/jump
+    /// instruction to the branch predictor setting lastBranchMiss_.
+    void updateBranchPredictor(uint32_t inst, const InstInfo& info,
+			       uint32_t op0, uint32_t op1, int32_t op2);
+
+    /// Record the functional coverage bins hit by the most recent
+    /// retired instruction.
+    void updateFunctionalCoverage(uint32_t inst, const DecodedInst& di);
 
     /// Fetch an instruction. Return true on success. Return false on
     /// fail (in which case an exception is initiated). May fetch a
@@ -966,11 +1518,6 @@ namespace WdRiscv
     /// exception will end up modifying pc_.
     void execute16(uint16_t inst);
 
-    /// Helper to decode: Decode instructions associated with opcode
-    /// 1010011.
-    const InstInfo& decodeFp(uint32_t inst, uint32_t& op0, uint32_t& op1,
-			     int32_t& op2);
-
     /// Helper to disassembleInst32: Disassemble instructions
     /// associated with opcode 1010011.
     void disassembleFp(uint32_t inst, std::ostream& stream);
@@ -979,6 +1526,62 @@ namespace WdRiscv
     /// opcode 1010011. This is a helper to execute32.
     void executeFp(uint32_t inst);
 
+    /// Helper to disassembleInst32: Disassemble vector instructions
+    /// (opcode 1010111 and the vector loads/stores).
+    void disassembleVec(uint32_t inst, std::ostream& stream);
+
+    /// Decode and execute vector instructions associated with opcode
+    /// 1010111. This is a helper to execute32.
+    void executeVec(uint32_t inst);
+
+    /// Execute a vector load: Opcode 0000111 with a vector width
+    /// (funct3 of 0, 5, 6 or 7). This is a helper to execute32.
+    void execVecLoad(uint32_t inst);
+
+    /// Execute a vector store: Opcode 0100111 with a vector width.
+    /// This is a helper to execute32.
+    void execVecStore(uint32_t inst);
+
+    /// Helper to executeVec: Set vl and vtype for the given application
+    /// vector length and vtype value, then write vl to register rd
+    /// (vsetvli, vsetivli and vsetvl). If keepVl is true (rd and rs1
+    /// are both x0), keep the current vl.
+    void execVsetvl(unsigned rd, URV avl, URV vtype, bool keepVl);
+
+    /// Helpers to executeVec: Integer (OPIVV, OPIVX and OPIVI), integer
+    /// multiply/reduce/mask (OPMVV and OPMVX) and floating point
+    /// (OPFVV and OPFVF) instructions for an element type T (signed
+    /// integer of the selected element width, float or double). Return
+    /// false if the instruction is illegal.
+    template <typename T>
+    bool execVecInt(uint32_t inst);
+    template <typename T>
+    bool execVecMul(uint32_t inst);
+    template <typename F>
+    bool execVecFp(uint32_t inst);
+
+    /// Helpers to execVecLoad: Load the element of the given size at
+    /// addr into value. Return true on success. On an exception or a
+    /// trigger hit return false and, if trap is true, take the
+    /// exception. Otherwise (not the first element of a fault only
+    /// first load) just return false.
+    bool vecLoadElem(URV base, URV addr, unsigned size, uint64_t& value,
+		     bool trap);
+
+    /// Helper to execVecStore: Store the given size least significant
+    /// bytes of value at addr. Return true on success and false on an
+    /// exception or a trigger hit.
+    bool vecStoreElem(URV base, URV addr, unsigned size, uint64_t value);
+
+    /// Return the value of vstart.
+    URV vecStart() const;
+
+    /// Set vstart to the given value recording the change for tracing.
+    void setVecStart(URV value);
+
+    /// Set vl to the given value recording the change for tracing.
+    void setVecLength(URV value);
+
     /// Change machine state and program counter in reaction to an
     /// exception or an interrupt. Given pc is the program counter to
     /// save (address of instruction causing the asynchronous
@@ -1009,6 +1612,23 @@ namespace WdRiscv
     /// Implement some Newlib system calls in the simulator.
     URV emulateNewlib();
 
+    /// C library routines that may be performed natively.
+    enum class Intercept { Memcpy, Memmove, Memset, Strlen, Strcmp };
+
+    /// Return true if the pc is at the entry point of an intercepted
+    /// routine.
+    bool atIntercept() const
+    { return pc_ >= interceptLow_ and pc_ <= interceptHigh_ and
+	intercepts_.count(pc_); }
+
+    /// Perform the intercepted routine at the pc natively: Update
+    /// memory, place the result in a0 and return to the address in
+    /// ra. Return true on success. Return false without changing
+    /// anything if the routine must be interpreted instead (e.g. it
+    /// would touch memory-mapped registers, the to-host or console
+    /// locations, or memory that is not accessible).
+    bool interceptCall();
+
     /// Check address associated with an atomic memory operation (AMO)
     /// instruction. Return true if AMO accsess is allowed. Return false
     /// trigerring an exception if address is misaligned or if it is out
@@ -1027,6 +1647,23 @@ namespace WdRiscv
     /// place in which case val is not modified.
     bool amoLoad64(uint32_t rs1, URV& val);
 
+    /// Perform an AMO instruction accessing a LOAD_TYPE location with
+    /// a host atomic read-modify-write: op is given the memory value
+    /// and the value of rs2 and returns the value to store. Return
+    /// true if the instruction was performed (rd updated). Return
+    /// false if the slow path (load and store under amoMutex) must be
+    /// used: triggers are active, access is to the to-host location or
+    /// to a memory-mapped register, or access would fail.
+    template <typename LOAD_TYPE, typename OP>
+    bool amoAtomic(uint32_t rd, uint32_t rs1, uint32_t rs2, OP op);
+
+    /// Drop the load reservation of this hart (if any).
+    void cancelLr()
+    {
+      hasLr_ = false;
+      memory_.cancelReservation(hartId_);
+    }
+
     // rs1: index of source register (value range: 0 to 31)
     // rs2: index of source register (value range: 0 to 31)
     // rd: index of destination register (value range: 0 to 31)
@@ -1079,6 +1716,7 @@ namespace WdRiscv
     void execMret(uint32_t = 0, uint32_t = 0, int32_t = 0);
     void execUret(uint32_t = 0, uint32_t = 0, int32_t = 0);
     void execSret(uint32_t = 0, uint32_t = 0, int32_t = 0);
+    void execSfence_vma(uint32_t rs1, uint32_t rs2, int32_t = 0);
 
     void execWfi(uint32_t = 0, uint32_t = 0, int32_t = 0);
 
@@ -1225,25 +1863,56 @@ namespace WdRiscv
     void execAmominu_d(uint32_t rd, uint32_t rs1, int32_t rs2);
     void execAmomaxu_d(uint32_t rd, uint32_t rs1, int32_t rs2);
 
-    // Bit manipulation
-    void execClz(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execCtz(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execPcnt(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execAndc(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execSlo(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execSro(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execSloi(uint32_t rd, uint32_t rs1, int32_t imm);
-    void execSroi(uint32_t rd, uint32_t rs1, int32_t imm);
-    void execMin(uint32_t rd, uint32_t rs1, int32_t rs2);
+    // Bit manipulation: zba
+    void execAdd_uw(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSh1add(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSh1add_uw(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSh2add(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSh2add_uw(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSh3add(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSh3add_uw(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSlli_uw(uint32_t rd, uint32_t rs1, int32_t amount);
+
+    // Bit manipulation: zbb
+    void execAndn(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execOrn(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execXnor(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execClz(uint32_t rd, uint32_t rs1, int32_t);
+    void execClzw(uint32_t rd, uint32_t rs1, int32_t);
+    void execCtz(uint32_t rd, uint32_t rs1, int32_t);
+    void execCtzw(uint32_t rd, uint32_t rs1, int32_t);
+    void execCpop(uint32_t rd, uint32_t rs1, int32_t);
+    void execCpopw(uint32_t rd, uint32_t rs1, int32_t);
     void execMax(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execMinu(uint32_t rd, uint32_t rs1, int32_t rs2);
     void execMaxu(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execMin(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execMinu(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execSext_b(uint32_t rd, uint32_t rs1, int32_t);
+    void execSext_h(uint32_t rd, uint32_t rs1, int32_t);
+    void execZext_h(uint32_t rd, uint32_t rs1, int32_t);
     void execRol(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execRolw(uint32_t rd, uint32_t rs1, int32_t rs2);
     void execRor(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execRori(uint32_t rd, uint32_t rs1, int32_t imm);
-    void execBswap(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execBrev(uint32_t rd, uint32_t rs1, int32_t rs2);
-    void execPack(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execRori(uint32_t rd, uint32_t rs1, int32_t amount);
+    void execRoriw(uint32_t rd, uint32_t rs1, int32_t amount);
+    void execRorw(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execOrc_b(uint32_t rd, uint32_t rs1, int32_t);
+    void execRev8(uint32_t rd, uint32_t rs1, int32_t);
+
+    // Bit manipulation: zbc
+    void execClmul(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execClmulh(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execClmulr(uint32_t rd, uint32_t rs1, int32_t rs2);
+
+    // Bit manipulation: zbs
+    void execBclr(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execBclri(uint32_t rd, uint32_t rs1, int32_t amount);
+    void execBext(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execBexti(uint32_t rd, uint32_t rs1, int32_t amount);
+    void execBinv(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execBinvi(uint32_t rd, uint32_t rs1, int32_t amount);
+    void execBset(uint32_t rd, uint32_t rs1, int32_t rs2);
+    void execBseti(uint32_t rd, uint32_t rs1, int32_t amount);
 
   private:
 
@@ -1294,6 +1963,100 @@ namespace WdRiscv
     void putInStoreQueue(unsigned size, size_t addr, uint64_t newData,
 			 uint64_t prevData);
 
+    // Hart state that an instruction may change other than registers,
+    // CSRs and memory (counters, reservations, load/store queues,
+    // privilege and debug state, triggers). What-if sequences (see
+    // whatIfBegin) restore registers, CSRs and memory from the undo
+    // log and save this at the start of the sequence. Vector registers
+    // are saved on the first vector instruction of the sequence.
+    // Snapshots save this along with all the registers and CSRs.
+    struct HartState
+    {
+      URV pc_ = 0, currPc_ = 0, progBreak_ = 0;
+      URV pokedCsrs_[4] = {};  // See transferHartState.
+      bool hasException_ = false, csrException_ = false;
+      bool triggerTripped_ = false;
+      bool hasLr_ = false;
+      URV lrAddr_ = 0;
+      unsigned lrSize_ = 0;
+      uint64_t lrValue_ = 0;
+      bool lastBranchTaken_ = false, lastBranchMiss_ = false;
+      bool misalignedLdSt_ = false;
+      uint64_t retiredInsts_ = 0, cycleCount_ = 0, counter_ = 0;
+      uint64_t exceptionCount_ = 0, interruptCount_ = 0;
+      uint64_t consecutiveIllegalCount_ = 0, counterAtLastIllegal_ = 0;
+      bool prevCountersCsrOn_ = true, countersCsrOn_ = true;
+      bool nmiPending_ = false;
+      NmiCause nmiCause_ = NmiCause::UNKNOWN;
+      URV loadAddr_ = 0;
+      bool loadAddrValid_ = false;
+      std::vector<StoreInfo> storeQueue_;
+      std::vector<LoadInfo> loadQueue_;
+      PrivilegeMode privMode_ = PrivilegeMode::Machine;
+      bool debugMode_ = false, debugStepMode_ = false;
+      bool dcsrStepIe_ = false, dcsrStep_ = false, ebreakInstDebug_ = false;
+      bool storeErrorRollback_ = false, loadErrorRollback_ = false;
+      bool targetProgFinished_ = false, waitForInterrupt_ = false;
+      bool mdseacLocked_ = false;
+      uint64_t memWriteCount_ = 0;
+      std::vector<uint64_t> perfCounters_;
+      std::vector<uint64_t> reservations_;
+      Triggers<URV> triggers_;
+      bool vecSaved_ = false;
+      std::vector<uint8_t> vecData_;
+    };
+
+    /// Copy the hart state that is not covered by the undo log to st
+    /// if save is true, or back from it otherwise.
+    void transferHartState(HartState& st, bool save);
+
+    /// Save the registers, CSRs and remaining hart state in a new
+    /// snapshot and start a new memory history period (see
+    /// enableSnapshots). Drop the oldest snapshots exceeding the
+    /// budget.
+    void takeSnapshot();
+
+    /// Bring the hart and the memory back to the state of the ith
+    /// retained snapshot. Later snapshots are dropped.
+    void restoreSnapshot(size_t ix);
+
+    /// Execute from the current state until the instruction count
+    /// reaches target. Instructions already executed once (before a
+    /// snapshot restore) are re-executed quietly: no console output,
+    /// no debugger stops, breakpoints are only recorded (see
+    /// lastBreakpoint_). Return true if target is reached.
+    bool replayTo(uint64_t target);
+
+    /// Helper to replayTo: Run until the instruction count reaches
+    /// target with replaying_ set to quiet.
+    bool runTo(uint64_t target, bool quiet);
+
+    /// Set addr and value to the address and value of the most recent
+    /// memory write of this hart and return the size of that
+    /// write. Return 0 if no write since the last clearTraceData in
+    /// which case addr and value are not modified.
+    unsigned getLastWriteNewValue(size_t& addr, uint64_t& value) const
+    {
+      if (lastWrite_.size_)
+	{
+	  addr = lastWrite_.addr_;
+	  value = lastWrite_.value_;
+	}
+      return lastWrite_.size_;
+    }
+
+    /// Same as getLastWriteNewValue but set value to the memory value
+    /// before the write.
+    unsigned getLastWriteOldValue(size_t& addr, uint64_t& value) const
+    {
+      if (lastWrite_.size_)
+	{
+	  addr = lastWrite_.addr_;
+	  value = lastWrite_.prevValue_;
+	}
+      return lastWrite_.size_;
+    }
+
   private:
 
     unsigned hartId_ = 0;        // Hardware thread id.
@@ -1301,6 +2064,7 @@ namespace WdRiscv
     IntRegs<URV> intRegs_;       // Integer register file.
     CsRegs<URV> csRegs_;         // Control and status registers.
     FpRegs<double> fpRegs_;      // Floating point registers.
+    VecRegs vecRegs_;            // Vector registers.
     bool rv64_ = sizeof(URV)==8; // True if 64-bit base (RV64I).
     bool rva_ = false;           // True if extension A (atomic) enabled.
     bool rvc_ = true;            // True if extension C (compressed) enabled.
@@ -1309,8 +2073,26 @@ namespace WdRiscv
     bool rvm_ = true;            // True if extension M (mul/div) enabled.
     bool rvs_ = false;           // True if extension S (supervisor-mode) enabled.
     bool rvu_ = false;           // True if extension U (user-mode) enabled.
-    bool rvzbmini_ = false;      // True if extension zbmini enabled.
+    bool rvv_ = false;           // True if extension V (vector) enabled.
+    bool rvzba_ = false;         // True if extension zba enabled.
+    bool rvzbb_ = false;         // True if extension zbb enabled.
+    bool rvzbc_ = false;         // True if extension zbc enabled.
+    bool rvzbs_ = false;         // True if extension zbs enabled.
+    bool enableZba_ = false;     // Enable zba regardless of MISA.
+    bool enableZbb_ = false;     // Enable zbb regardless of MISA.
+    bool enableZbc_ = false;     // Enable zbc.
+    bool enableZbs_ = false;     // Enable zbs regardless of MISA.
+    uint32_t instTypesOn_ = ~0u; // Bit t set if InstType t is enabled.
     URV pc_ = 0;                 // Program counter. Incremented by instr fetch.
+
+    // Fetch window: An instruction at a virtual address va such that
+    // va - fetchVa_ < fetchSpan_ is at physical address fetchPa_ +
+    // (va - fetchVa_) and needs no translation or PMP check. Emptied
+    // (fetchSpan_ = 0) whenever translation, privilege or PMP changes.
+    URV fetchVa_ = 0;
+    URV fetchPa_ = 0;
+    URV fetchSpan_ = 0;
+
     URV currPc_ = 0;             // Addr instr being executed (pc_ before fetch).
     URV resetPc_ = 0;            // Pc to use on reset.
     URV stopAddr_ = 0;           // Pc at which to stop the simulator.
@@ -1331,10 +2113,12 @@ namespace WdRiscv
     bool triggerTripped_ = 0;    // True if a trigger trips.
 
     bool hasLr_ = false;         // True if there is a load reservation.
-    URV lrAddr_ = 0;             // Address of load reservation.
+    URV lrAddr_ = 0;             // Physical address of load reservation.
     unsigned lrSize_ = 0;        // Size of load reservation (4 or 8).
+    uint64_t lrValue_ = 0;       // Value loaded by load reservation.
 
     bool lastBranchTaken_ = false; // Useful for performance counters
+    bool lastBranchMiss_ = false;  // Useful for performance counters
     bool misalignedLdSt_ = false;  // Useful for performance counters
 
     // True if effective and base addresses must be in regions of the
@@ -1362,9 +2146,18 @@ namespace WdRiscv
     bool enableGdb_ = false;        // Enable gdb mode.
     bool abiNames_ = false;         // Use ABI register names when true.
     bool newlib_ = false;           // Enable newlib system calls.
+
+    // Entry points of intercepted C library routines and the range
+    // containing them (empty range if none).
+    std::unordered_map<URV, Intercept> intercepts_;
+    URV interceptLow_ = 1;
+    URV interceptHigh_ = 0;
+    uint64_t interceptInsts_ = 1;   // Retired count charged per call.
+    uint64_t interceptCycles_ = 1;  // Cycle count charged per call.
     bool amoIllegalOutsideDccm_ = false;
 
     bool traceLoad_ = false;        // Trace addr of load inst if true.
+    bool traceSource_ = false;      // Trace source line if true.
     URV loadAddr_ = 0;              // Address of data of most recent load inst.
     bool loadAddrValid_ = false;    // True if loadAddr_ valid.
 
@@ -1388,6 +2181,17 @@ namespace WdRiscv
     bool storeErrorRollback_ = false;
     bool loadErrorRollback_ = false;
     bool targetProgFinished_ = false;
+    bool stopped_ = false;           // Finished by tohost write or exit.
+    bool stopByExit_ = false;        // Finished by exit.
+    uint64_t stopValue_ = 0;         // Tohost value or exit code.
+    bool waitForInterrupt_ = false;  // True if wfi executed.
+    uint64_t memWriteCount_ = 0;     // Count of memory writes by this hart.
+    std::vector<URV> spinIntRegs_;       // Registers on entry to spin probe.
+    std::vector<uint64_t> spinFpRegs_;
+    unsigned spinProbeBackoff_ = 0;      // Probes skipped after a failure.
+    unsigned spinProbeWait_ = 0;         // Probes left to skip.
+    LastWriteInfo lastWrite_;        // Most recent memory write of this hart.
+    std::vector<LastWriteInfo> vecWrites_; // Element writes of last vector store.
     unsigned mxlen_ = 8*sizeof(URV);
     FILE* consoleOut_ = nullptr;
 
@@ -1396,18 +2200,71 @@ namespace WdRiscv
     RoundingMode instRoundingMode_ = RoundingMode::NearestEven;
     unsigned instRs3_ = 0;
 
+    // Host rounding mode currently in effect (see setHostRoundingMode).
+    // The host floating point environment belongs to the thread and is
+    // shared by all the harts the thread runs.
+    static inline thread_local RoundingMode hostRoundingMode_ =
+      RoundingMode::NearestEven;
+    bool lazyFpFlags_ = false;  // See beginFpSession.
+
     // AMO instructions have additional operands: rl and aq.
     bool amoAq_ = false;
     bool amoRl_ = false;
 
     InstInfoTable instTable_;
     std::vector<InstProfile> instProfileVec_; // Instruction frequency
+    std::unique_ptr<BranchPredictor> branchPred_; // Null if not modeled.
+    std::unique_ptr<CodeCoverage> coverage_;      // Null if not collected.
+    std::unique_ptr<FuncCoverage> funcCov_;       // Null if not collected.
+
+    // Cache of decoded instructions used for statistics and counters.
+    std::vector<DecodedInst> decodeCache_;
+    unsigned decodeCacheMask_ = 0;
+
+    // Ith entry is the 32-bit equivalent of the compressed code i (zero
+    // if illegal) for the extensions in rvcExpansionKey_ (F and D bits).
+    const uint32_t* rvcExpansion_ = nullptr;
+    int rvcExpansionKey_ = -1;
 
     // Ith entry is true if ith region has iccm/dccm/pic.
     std::vector<bool> regionHasLocalMem_;
 
     // Ith entry is true if ith region has dccm/pic.
     std::vector<bool> regionHasLocalDataMem_;
+
+    // What-if sequences (see whatIfBegin).
+    bool inWhatIf_ = false;
+    UndoLog undoLog_;
+    CsrWriteSet whatIfCsrs_;     // CSRs already in the undo log.
+    HartState whatIfState_;
+
+    // Reverse execution (see enableSnapshots). Snapshot i goes with
+    // memory history period i (see Memory::beginHistoryPeriod).
+    struct Snapshot
+    {
+      HartState state_;  // Includes the instruction count.
+      std::vector<URV> intRegs_;
+      std::vector<uint64_t> fpRegs_;
+      std::vector<std::pair<CsrNumber, URV>> csrs_;  // Implemented CSRs.
+    };
+
+    std::deque<Snapshot> snapshots_;    // Oldest first.
+    uint64_t snapshotPeriod_ = 0;       // Zero if reverse execution is off.
+    uint64_t snapshotBudget_ = 0;       // In bytes.
+    uint64_t nextSnapshot_ = ~uint64_t(0);  // Count of next snapshot.
+    uint64_t furthest_ = 0;             // Largest count before going back.
+    bool replaying_ = false;            // See replayTo.
+    bool breakpointHit_ = false;        // Breakpoint reached in replay.
+    uint64_t lastBreakpoint_ = 0;       // Count of last breakpoint in replay.
+    std::unordered_set<URV> breakpoints_;
+
+    // Decoded PMP regions and their page cache.
+    PmpManager pmpManager_;
+    unsigned pmpEntries_ = 0;     // Implemented PMP entries.
+    PrivilegeMode dataMode_ = PrivilegeMode::Machine; // Mode of ld/st (MPRV).
+
+    // Address translation and TLBs (uses pmpManager_).
+    VirtMem virtMem_;
   };
 }
 
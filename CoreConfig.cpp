@@ -524,6 +524,24 @@ CoreConfig::applyConfig(Core<URV>& core, bool verbose) const
       core.enableTriggers(et);
     }
 
+  // Enable bit manipulation extensions (zba, zbb and zbs are also
+  // enabled by bit b of misa).
+  tag = "enable_zba";
+  if (config_ -> count(tag))
+    core.enableRvzba(getJsonBoolean(tag, config_ -> at(tag)));
+
+  tag = "enable_zbb";
+  if (config_ -> count(tag))
+    core.enableRvzbb(getJsonBoolean(tag, config_ -> at(tag)));
+
+  tag = "enable_zbc";
+  if (config_ -> count(tag))
+    core.enableRvzbc(getJsonBoolean(tag, config_ -> at(tag)));
+
+  tag = "enable_zbs";
+  if (config_ -> count(tag))
+    core.enableRvzbs(getJsonBoolean(tag, config_ -> at(tag)));
+
   // Enable performance counters.
   tag ="enable_performance_counters";
   if (config_ -> count(tag))
@@ -634,6 +652,24 @@ CoreConfig::applyConfig(Core<URV>& core, bool verbose) const
       core.configMachineModeMaxPerfEvent(maxId);
     }
 
+  // Number of implemented PMP entries (default none).
+  tag = "num_pmp_entries";
+  if (config_ -> count(tag))
+    {
+      unsigned count = getJsonUnsigned<unsigned>(tag, config_ -> at(tag));
+      if (not core.configPmpEntries(count))
+	errors++;
+    }
+
+  // Vector register width in bits (VLEN).
+  tag = "vlen";
+  if (config_ -> count(tag))
+    {
+      unsigned vlen = getJsonUnsigned<unsigned>(tag, config_ -> at(tag));
+      if (not core.configVectorLength(vlen))
+	errors++;
+    }
+
   if (not applyCsrConfig(core, *config_, verbose))
     errors++;
 
@@ -132,6 +132,8 @@ CsRegs<URV>::read(CsrNumber number, PrivilegeMode mode,
     return readTdata(number, mode, debugMode, value);
 
   value = csr->read();
+  if (number == CsrNumber::SIE or number == CsrNumber::SIP)
+    value &= regs_.at(size_t(CsrNumber::MIDELEG)).read();
   return true;
 }
   
@@ -160,6 +162,15 @@ CsRegs<URV>::write(CsrNumber number, PrivilegeMode mode, bool debugMode,
       return true;
     }
 
+  // vxrm and vxsat are part of vcsr
+  if (number == CsrNumber::VXSAT or number == CsrNumber::VXRM or number == CsrNumber::VCSR)
+    {
+      csr->write(value);
+      recordWrite(number);
+      updateVcsrGroupForWrite(number, value);
+      return true;
+    }
+
   if (number >= CsrNumber::TDATA1 and number <= CsrNumber::TDATA3)
     {
       if (not writeTdata(number, mode, debugMode, value))
@@ -199,6 +210,9 @@ CsRegs<URV>::write(CsrNumber number, PrivilegeMode mode, bool debugMode,
       interruptEnable_ = fields.bits_.MIE;
     }
 
+  if (number == CsrNumber::MIDELEG)
+    updateSupervisorInterruptMasks();
+
   // Writing MDEAU unlocks mdseac.
   if (number == CsrNumber::MDEAU)
     lockMdseac(false);
@@ -259,6 +273,7 @@ CsRegs<URV>::reset()
       interruptEnable_ = fields.bits_.MIE;
     }
 
+  updateSupervisorInterruptMasks();
   mdseacLocked_ = false;
 }
 
@@ -319,6 +334,45 @@ CsRegs<URV>::configCsr(CsrNumber csrNum, bool implemented,
 }
 
 
+template <typename URV>
+bool
+CsRegs<URV>::configPmpEntries(unsigned count)
+{
+  if (count > 16)
+    {
+      std::cerr << "No more than 16 PMP entries can be defined\n";
+      return false;
+    }
+
+  unsigned errors = 0;
+  bool isDebug = false;
+
+  for (unsigned i = 0; i < 16; ++i)
+    {
+      URV mask = i < count ? ~URV(0) : 0;
+      CsrNumber csrNum = CsrNumber(i + unsigned(CsrNumber::PMPADDR0));
+      if (not configCsr(csrNum, true, 0, mask, mask, isDebug))
+	errors++;
+    }
+
+  // One byte per entry: 4 entries per pmpcfg register in RV32 and 8
+  // in RV64 where only the even numbered registers exist.
+  constexpr unsigned perReg = sizeof(URV);
+  for (unsigned reg = 0; reg < 4; reg += perReg / 4)
+    {
+      URV mask = 0;
+      for (unsigned byte = 0; byte < perReg; ++byte)
+	if (reg*4 + byte < count)
+	  mask |= URV(0xff) << (8*byte);
+      CsrNumber csrNum = CsrNumber(reg + unsigned(CsrNumber::PMPCFG0));
+      if (not configCsr(csrNum, true, 0, mask, mask, isDebug))
+	errors++;
+    }
+
+  return errors == 0;
+}
+
+
 template <typename URV>
 bool
 CsRegs<URV>::configMachineModePerfCounters(unsigned numCounters)
@@ -461,11 +515,76 @@ CsRegs<URV>::updateFcsrGroupForPoke(CsrNumber number, URV value)
 
 template <typename URV>
 void
-CsRegs<URV>::recordWrite(CsrNumber num)
+CsRegs<URV>::updateVcsrGroupForWrite(CsrNumber number, URV value)
+{
+  if (number == CsrNumber::VXSAT or number == CsrNumber::VXRM)
+    {
+      auto vcsr = getImplementedCsr(CsrNumber::VCSR);
+      if (vcsr)
+	{
+	  URV vcsrVal = vcsr->read();
+	  if (number == CsrNumber::VXSAT)
+	    vcsrVal = (vcsrVal & ~URV(1)) | (value & 1);
+	  else
+	    vcsrVal = (vcsrVal & ~URV(6)) | ((value << 1) & 6);
+	  vcsr->write(vcsrVal);
+	  recordWrite(CsrNumber::VCSR);
+	}
+      return;
+    }
+
+  if (number == CsrNumber::VCSR)
+    {
+      URV newVal = value & 1;  // New vxsat value
+      auto vxsat = getImplementedCsr(CsrNumber::VXSAT);
+      if (vxsat and vxsat->read() != newVal)
+	{
+	  vxsat->write(newVal);
+	  recordWrite(CsrNumber::VXSAT);
+	}
+
+      newVal = (value >> 1) & 3;
+      auto vxrm = getImplementedCsr(CsrNumber::VXRM);
+      if (vxrm and vxrm->read() != newVal)
+	{
+	  vxrm->write(newVal);
+	  recordWrite(CsrNumber::VXRM);
+	}
+    }
+}
+
+
+template <typename URV>
+void
+CsRegs<URV>::updateVcsrGroupForPoke(CsrNumber number, URV value)
 {
-  auto& lwr = lastWrittenRegs_;
-  if (std::find(lwr.begin(), lwr.end(), num) == lwr.end())
-    lwr.push_back(num);
+  if (number == CsrNumber::VXSAT or number == CsrNumber::VXRM)
+    {
+      auto vcsr = getImplementedCsr(CsrNumber::VCSR);
+      if (vcsr)
+	{
+	  URV vcsrVal = vcsr->read();
+	  if (number == CsrNumber::VXSAT)
+	    vcsrVal = (vcsrVal & ~URV(1)) | (value & 1);
+	  else
+	    vcsrVal = (vcsrVal & ~URV(6)) | ((value << 1) & 6);
+	  vcsr->poke(vcsrVal);
+	}
+      return;
+    }
+
+  if (number == CsrNumber::VCSR)
+    {
+      URV newVal = value & 1;  // New vxsat value
+      auto vxsat = getImplementedCsr(CsrNumber::VXSAT);
+      if (vxsat and vxsat->read() != newVal)
+	vxsat->poke(newVal);
+
+      newVal = (value >> 1) & 3;
+      auto vxrm = getImplementedCsr(CsrNumber::VXRM);
+      if (vxrm and vxrm->read() != newVal)
+	vxrm->poke(newVal);
+    }
 }
 
 
@@ -500,7 +619,11 @@ CsRegs<URV>::defineMachineRegs()
     mask |= (URV(0b1111) << 32);  // Mask for SXL and UXL.
   defineCsr("mstatus", Csrn::MSTATUS, mand, imp, val, mask, mask);
   defineCsr("misa", Csrn::MISA, mand,  imp, 0x40001104, rom, rom);
-  defineCsr("medeleg", Csrn::MEDELEG, !mand, !imp, 0, 0, 0);
+
+  // Exceptions other than environment call from machine mode can be
+  // delegated to supervisor mode.
+  mask = 0xb3ff;
+  defineCsr("medeleg", Csrn::MEDELEG, !mand, !imp, 0, mask, mask);
   defineCsr("mideleg", Csrn::MIDELEG, !mand, !imp, 0, 0, 0);
 
   // Interrupt enable: Least sig 12 bits corresponding to the 12
@@ -528,27 +651,31 @@ CsRegs<URV>::defineMachineRegs()
   // to defined interrupts are modifiable.
   defineCsr("mip", CsrNumber::MIP, mand, imp, 0, rom, mieMask);
 
-  // Machine protection and translation.
-  defineCsr("pmpcfg0",   Csrn::PMPCFG0,   !mand, imp, 0, wam, wam);
-  defineCsr("pmpcfg1",   Csrn::PMPCFG1,   !mand, imp, 0, wam, wam);
-  defineCsr("pmpcfg2",   Csrn::PMPCFG2,   !mand, imp, 0, wam, wam);
-  defineCsr("pmpcfg3",   Csrn::PMPCFG3,   !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr0",  Csrn::PMPADDR0,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr1",  Csrn::PMPADDR1,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr2",  Csrn::PMPADDR2,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr3",  Csrn::PMPADDR3,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr4",  Csrn::PMPADDR4,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr5",  Csrn::PMPADDR5,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr6",  Csrn::PMPADDR6,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr7",  Csrn::PMPADDR7,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr8",  Csrn::PMPADDR8,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr9",  Csrn::PMPADDR9,  !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr10", Csrn::PMPADDR10, !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr11", Csrn::PMPADDR11, !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr12", Csrn::PMPADDR12, !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr13", Csrn::PMPADDR13, !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr14", Csrn::PMPADDR14, !mand, imp, 0, wam, wam);
-  defineCsr("pmpaddr15", Csrn::PMPADDR15, !mand, imp, 0, wam, wam);
+  // Machine protection and translation. In RV64, pmpcfg0 and pmpcfg2
+  // hold 8 entries each and the odd numbered pmpcfg do not exist. No
+  // PMP entry is implemented by default: The registers read zero
+  // until configured (see configPmpEntries).
+  bool rv32 = sizeof(URV) == 4;
+  defineCsr("pmpcfg0",   Csrn::PMPCFG0,   !mand, imp, 0, rom, rom);
+  defineCsr("pmpcfg1",   Csrn::PMPCFG1,   !mand, rv32, 0, rom, rom);
+  defineCsr("pmpcfg2",   Csrn::PMPCFG2,   !mand, imp, 0, rom, rom);
+  defineCsr("pmpcfg3",   Csrn::PMPCFG3,   !mand, rv32, 0, rom, rom);
+  defineCsr("pmpaddr0",  Csrn::PMPADDR0,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr1",  Csrn::PMPADDR1,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr2",  Csrn::PMPADDR2,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr3",  Csrn::PMPADDR3,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr4",  Csrn::PMPADDR4,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr5",  Csrn::PMPADDR5,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr6",  Csrn::PMPADDR6,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr7",  Csrn::PMPADDR7,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr8",  Csrn::PMPADDR8,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr9",  Csrn::PMPADDR9,  !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr10", Csrn::PMPADDR10, !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr11", Csrn::PMPADDR11, !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr12", Csrn::PMPADDR12, !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr13", Csrn::PMPADDR13, !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr14", Csrn::PMPADDR14, !mand, imp, 0, rom, rom);
+  defineCsr("pmpaddr15", Csrn::PMPADDR15, !mand, imp, 0, rom, rom);
 
   // Machine Counter/Timers.
   defineCsr("mcycle",    Csrn::MCYCLE,    mand, imp, 0, wam, wam);
@@ -632,25 +759,81 @@ CsRegs<URV>::defineSupervisorRegs()
 
   using Csrn = CsrNumber;
 
-  // Only bits spp, spie, upie, sie and uie of sstatus are writeable.
-  URV mask = 0x233;
-  defineCsr("sstatus",    Csrn::SSTATUS,    !mand, !imp, 0, mask, mask);
+  URV wam = ~URV(0);  // Write-all mask: all bits writeable.
+
+  // Sstatus is a restricted view of mstatus: Only bits mxr, sum, xs,
+  // fs, spp, spie, upie, sie and uie are writeable.
+  URV mask = 0xc6133;
+  auto sstatus = defineCsr("sstatus", Csrn::SSTATUS, !mand, !imp, 0, mask,
+			   mask);
+  if (sstatus)
+    sstatus->tie(&regs_.at(size_t(Csrn::MSTATUS)).value_);
 
   defineCsr("sedeleg",    Csrn::SEDELEG,    !mand, !imp, 0, 0, 0);
   defineCsr("sideleg",    Csrn::SIDELEG,    !mand, !imp, 0, 0, 0);
   defineCsr("sie",        Csrn::SIE,        !mand, !imp, 0, 0, 0);
-  defineCsr("stvec",      Csrn::STVEC,      !mand, !imp, 0, 0, 0);
+  defineCsr("stvec",      Csrn::STVEC,      !mand, !imp, 0, ~URV(2), ~URV(2));
   defineCsr("scounteren", Csrn::SCOUNTEREN, !mand, !imp, 0, 0, 0);
 
   // Supervisor Trap Handling 
-  defineCsr("sscratch",   Csrn::SSCRATCH,   !mand, !imp, 0, 0, 0);
-  defineCsr("sepc",       Csrn::SEPC,       !mand, !imp, 0, 0, 0);
-  defineCsr("scause",     Csrn::SCAUSE,     !mand, !imp, 0, 0, 0);
-  defineCsr("stval",      Csrn::STVAL,      !mand, !imp, 0, 0, 0);
+  defineCsr("sscratch",   Csrn::SSCRATCH,   !mand, !imp, 0, wam, wam);
+  defineCsr("sepc",       Csrn::SEPC,       !mand, !imp, 0, ~URV(1), ~URV(1));
+  defineCsr("scause",     Csrn::SCAUSE,     !mand, !imp, 0, wam, wam);
+  defineCsr("stval",      Csrn::STVAL,      !mand, !imp, 0, wam, wam);
   defineCsr("sip",        Csrn::SIP,        !mand, !imp, 0, 0, 0);
 
-  // Supervisor Protection and Translation 
-  defineCsr("satp",       Csrn::SATP,       !mand, !imp, 0, 0, 0);
+  // Sie and sip are views of mie and mip restricted to the interrupts
+  // delegated in mideleg (see updateSupervisorInterruptMasks).
+  regs_.at(size_t(Csrn::SIE)).tie(&regs_.at(size_t(Csrn::MIE)).value_);
+  regs_.at(size_t(Csrn::SIP)).tie(&regs_.at(size_t(Csrn::MIP)).value_);
+
+  // Supervisor Protection and Translation. Unsupported modes are
+  // rejected by the hart (see Core::legalizeSatpWrite).
+  defineCsr("satp",       Csrn::SATP,       !mand, !imp, 0, wam, wam);
+}
+
+
+template <typename URV>
+void
+CsRegs<URV>::enableSupervisorMode()
+{
+  using Csrn = CsrNumber;
+
+  for (auto csrn : { Csrn::SSTATUS, Csrn::STVEC, Csrn::SSCRATCH, Csrn::SEPC,
+	             Csrn::SCAUSE, Csrn::STVAL, Csrn::SATP, Csrn::MEDELEG,
+		     Csrn::MIDELEG, Csrn::SIE, Csrn::SIP } )
+    regs_.at(size_t(csrn)).setImplemented(true);
+
+  // The supervisor software, timer and external interrupts can be
+  // delegated. Machine mode can set their pending bits in mip.
+  URV sMask = ((URV(1) << unsigned(InterruptCause::S_SOFTWARE)) |
+	       (URV(1) << unsigned(InterruptCause::S_TIMER)) |
+	       (URV(1) << unsigned(InterruptCause::S_EXTERNAL)));
+  Csr<URV>& mideleg = regs_.at(size_t(Csrn::MIDELEG));
+  mideleg.setWriteMask(sMask);
+  mideleg.setPokeMask(sMask);
+  Csr<URV>& mip = regs_.at(size_t(Csrn::MIP));
+  mip.setWriteMask(mip.getWriteMask() | sMask);
+  updateSupervisorInterruptMasks();
+}
+
+
+template <typename URV>
+void
+CsRegs<URV>::updateSupervisorInterruptMasks()
+{
+  // Supervisor mode can enable a delegated interrupt. Of the pending
+  // bits, it can only clear that of the software interrupt.
+  URV mideleg = regs_.at(size_t(CsrNumber::MIDELEG)).read();
+  URV ssip = URV(1) << unsigned(InterruptCause::S_SOFTWARE);
+
+  Csr<URV>& sie = regs_.at(size_t(CsrNumber::SIE));
+  sie.setWriteMask(mideleg);
+  sie.setPokeMask(mideleg);
+
+  Csr<URV>& sip = regs_.at(size_t(CsrNumber::SIP));
+  sip.setWriteMask(mideleg & ssip);
+  sip.setPokeMask(mideleg);
 }
 
 
@@ -682,6 +865,16 @@ CsRegs<URV>::defineUserRegs()
   defineCsr("frm",      Csrn::FRM,      !mand, !imp, 0, wam, wam);
   defineCsr("fcsr",     Csrn::FCSR,     !mand, !imp, 0, 0xff, 0xff);
 
+  // User Vector CSRs. Vl, vtype and vlenb are read-only: Vector
+  // instructions change vl and vtype by poking them.
+  defineCsr("vstart",   Csrn::VSTART,   !mand, !imp, 0, wam, wam);
+  defineCsr("vxsat",    Csrn::VXSAT,    !mand, !imp, 0, 1, 1);
+  defineCsr("vxrm",     Csrn::VXRM,     !mand, !imp, 0, 3, 3);
+  defineCsr("vcsr",     Csrn::VCSR,     !mand, !imp, 0, 7, 7);
+  defineCsr("vl",       Csrn::VL,       !mand, !imp, 0, 0, wam);
+  defineCsr("vtype",    Csrn::VTYPE,    !mand, !imp, 0, 0, wam);
+  defineCsr("vlenb",    Csrn::VLENB,    !mand, !imp, 0, 0, 0);
+
   // User Counter/Timers
   defineCsr("cycle",    Csrn::CYCLE,    !mand, imp,  0, wam, wam);
   defineCsr("time",     Csrn::TIME,     !mand, imp,  0, wam, wam);
@@ -837,6 +1030,8 @@ CsRegs<URV>::peek(CsrNumber number, URV& value) const
     return readTdata(number, PrivilegeMode::Machine, debugMode, value);
 
   value = csr->read();
+  if (number == CsrNumber::SIE or number == CsrNumber::SIP)
+    value &= regs_.at(size_t(CsrNumber::MIDELEG)).read();
   return true;
 }
   
@@ -857,6 +1052,14 @@ CsRegs<URV>::poke(CsrNumber number, URV value)
       return true;
     }
 
+  // vxrm and vxsat are parts of vcsr
+  if (number == CsrNumber::VXSAT or number == CsrNumber::VXRM or number == CsrNumber::VCSR)
+    {
+      csr->poke(value);
+      updateVcsrGroupForPoke(number, value);
+      return true;
+    }
+
   if (number >= CsrNumber::TDATA1 and number <= CsrNumber::TDATA3)
     return pokeTdata(number, value);
 
@@ -890,6 +1093,9 @@ CsRegs<URV>::poke(CsrNumber number, URV value)
       interruptEnable_ = fields.bits_.MIE;
     }
 
+  if (number == CsrNumber::MIDELEG)
+    updateSupervisorInterruptMasks();
+
   return true;
 }
 
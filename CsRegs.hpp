@@ -266,6 +266,15 @@ namespace WdRiscv
       FRM = 0x002,
       FCSR = 0x003,
 
+      // User Vector CSRs
+      VSTART = 0x008,
+      VXSAT = 0x009,
+      VXRM = 0x00a,
+      VCSR = 0x00f,
+      VL = 0xc20,
+      VTYPE = 0xc21,
+      VLENB = 0xc22,
+
       // User Counter/Timers
       CYCLE = 0xc00,
       TIME = 0xc01,
@@ -358,6 +367,88 @@ namespace WdRiscv
     };
 
 
+  /// Set of the CSRs written by one instruction. Insertion is a
+  /// bitmap test. Iteration visits the members in increasing CSR
+  /// number order (the order of trace records) without sorting and
+  /// clearing is free when nothing was inserted: There is no heap
+  /// allocation.
+  class CsrWriteSet
+  {
+  public:
+
+    /// Forward iterator over the members in increasing number order.
+    class Iterator
+    {
+    public:
+
+      Iterator(const uint64_t* words, unsigned ix)
+	: words_(words), ix_(ix)
+      { bits_ = ix < wordCount_ ? words[ix] : 0; skipEmpty(); }
+
+      CsrNumber operator*() const
+      { return CsrNumber(ix_*64 + __builtin_ctzll(bits_)); }
+
+      Iterator& operator++()
+      { bits_ &= bits_ - 1; skipEmpty(); return *this; }
+
+      bool operator!=(const Iterator& other) const
+      { return ix_ != other.ix_ or bits_ != other.bits_; }
+
+    private:
+
+      void skipEmpty()
+      {
+	while (bits_ == 0 and ix_ < wordCount_)
+	  if (++ix_ < wordCount_)
+	    bits_ = words_[ix_];
+      }
+
+      const uint64_t* words_;
+      unsigned ix_;
+      uint64_t bits_ = 0;
+    };
+
+    void insert(CsrNumber num)
+    {
+      unsigned ix = unsigned(num) & unsigned(CsrNumber::MAX_CSR_);
+      words_[ix / 64] |= uint64_t(1) << (ix % 64);
+      empty_ = false;
+    }
+
+    bool contains(CsrNumber num) const
+    {
+      unsigned ix = unsigned(num) & unsigned(CsrNumber::MAX_CSR_);
+      return (words_[ix / 64] >> (ix % 64)) & 1;
+    }
+
+    bool empty() const
+    { return empty_; }
+
+    void clear()
+    {
+      if (empty_)
+	return;
+      for (auto& word : words_)
+	word = 0;
+      empty_ = true;
+    }
+
+    Iterator begin() const
+    { return Iterator(words_, 0); }
+
+    Iterator end() const
+    { return Iterator(words_, wordCount_); }
+
+  private:
+
+    static constexpr unsigned wordCount_ =
+      (unsigned(CsrNumber::MAX_CSR_) + 1) / 64;
+
+    uint64_t words_[wordCount_] = {};
+    bool empty_ = true;
+  };
+
+
   template <typename URV>
   class CsRegs;
 
@@ -794,6 +885,12 @@ namespace WdRiscv
     /// read-write.
     bool configMachineModePerfCounters(unsigned numCounters);
 
+    /// Configure the number of implemented PMP entries returning true
+    /// on success and false on failure. The pmpaddr registers and the
+    /// pmpcfg bytes of the first count entries are made read-write.
+    /// The remaining ones are made read-only zero.
+    bool configPmpEntries(unsigned count);
+
     /// Helper to write method. Update frm/fflags after fscr is written.
     /// Update fcsr after frm/fflags is written.
     void updateFcsrGroupForWrite(CsrNumber number, URV value);
@@ -802,12 +899,25 @@ namespace WdRiscv
     /// Update fcsr after frm/fflags is poked.
     void updateFcsrGroupForPoke(CsrNumber number, URV value);
 
+    /// Helper to write method. Update vxrm/vxsat after vcsr is written.
+    /// Update vcsr after vxrm/vxsat is written.
+    void updateVcsrGroupForWrite(CsrNumber number, URV value);
+
+    /// Helper to poke method. Update vxrm/vxsat after vcsr is poked.
+    /// Update vcsr after vxrm/vxsat is poked.
+    void updateVcsrGroupForPoke(CsrNumber number, URV value);
+
     /// Helper to construtor. Define machine-mode CSRs
     void defineMachineRegs();
 
     /// Helper to construtor. Define supervisor-mode CSRs
     void defineSupervisorRegs();
 
+    /// Mark the supervisor trap handling and address translation CSRs
+    /// (and medeleg) as implemented. Called by the hart when
+    /// extension S is enabled.
+    void enableSupervisorMode();
+
     /// Helper to construtor. Define user-mode CSRs
     void defineUserRegs();
 
@@ -833,16 +943,20 @@ namespace WdRiscv
 
     /// Record given CSR number as a being written by the current
     /// instruction. Recorded numbers can be later retrieved by the
-    /// getLastWrittenRegs method.
-    void recordWrite(CsrNumber num);
+    /// lastWrittenRegs method.
+    void recordWrite(CsrNumber num)
+    { lastWrittenRegs_.insert(num); }
 
     /// Clear the remembered indices of the CSR register(s) written by
     /// the last instruction.
     void clearLastWrittenRegs()
     {
-      for (auto& csrNum : lastWrittenRegs_)
-	regs_.at(size_t(csrNum)).clearLastWritten();
-      lastWrittenRegs_.clear();
+      if (not lastWrittenRegs_.empty())
+	{
+	  for (CsrNumber csrNum : lastWrittenRegs_)
+	    regs_.at(size_t(csrNum)).clearLastWritten();
+	  lastWrittenRegs_.clear();
+	}
       triggers_.clearLastWrittenTriggers();
     }
 
@@ -861,10 +975,39 @@ namespace WdRiscv
     void getLastWrittenRegs(std::vector<CsrNumber>& csrNums,
 			    std::vector<unsigned>& triggerNums) const
     {
-      csrNums = lastWrittenRegs_;
+      csrNums.clear();
+      for (CsrNumber csr : lastWrittenRegs_)
+	csrNums.push_back(csr);
       triggers_.getLastWrittenTriggers(triggerNums);
     }
 
+    /// Return the set of the CSRs written by the last instruction.
+    const CsrWriteSet& lastWrittenRegs() const
+    { return lastWrittenRegs_; }
+
+    /// Return true if the given trigger was written by the last
+    /// instruction.
+    bool isTriggerLastWritten(unsigned trigger) const
+    { return triggers_.isLastWritten(trigger); }
+
+    /// Return the number of triggers.
+    unsigned triggerCount() const
+    { return triggers_.size(); }
+
+    /// Copy the debug triggers to the given object. Used with
+    /// restoreTriggers to undo a what-if sequence.
+    void saveTriggers(Triggers<URV>& saved) const
+    { saved = triggers_; }
+
+    /// Replace the debug triggers with the given ones (saved by
+    /// saveTriggers).
+    void restoreTriggers(const Triggers<URV>& saved)
+    {
+      triggers_ = saved;
+      hasActiveTrigger_ = triggers_.hasActiveTrigger();
+      hasActiveInstTrigger_ = triggers_.hasActiveInstTrigger();
+    }
+
     bool isInterruptEnabled() const
     { return interruptEnable_; }
 
@@ -889,6 +1032,10 @@ namespace WdRiscv
     bool mdseacLocked() const
     { return mdseacLocked_; }
 
+    /// Make the bits of sie and sip (views of mie and mip) follow the
+    /// interrupts delegated to supervisor mode in mideleg.
+    void updateSupervisorInterruptMasks();
+
   private:
 
     std::vector< Csr<URV> > regs_;
@@ -897,7 +1044,7 @@ namespace WdRiscv
     Triggers<URV> triggers_;
 
     // Register written since most recent clearLastWrittenRegs
-    std::vector<CsrNumber> lastWrittenRegs_;
+    CsrWriteSet lastWrittenRegs_;
 
     // Counters implementing machine performance counters.
     PerfRegs mPerfRegs_;
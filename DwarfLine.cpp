@@ -0,0 +1,532 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <elfio/elfio.hpp>
+#include "DwarfLine.hpp"
+
+
+using namespace WdRiscv;
+
+
+namespace
+{
+
+  // DWARF constants used by the line program decoder.
+  enum
+    {
+      DW_LNS_copy = 1, DW_LNS_advance_pc = 2, DW_LNS_advance_line = 3,
+      DW_LNS_set_file = 4, DW_LNS_const_add_pc = 8,
+      DW_LNS_fixed_advance_pc = 9,
+
+      DW_LNE_end_sequence = 1, DW_LNE_set_address = 2,
+      DW_LNE_define_file = 3,
+
+      DW_LNCT_path = 1, DW_LNCT_directory_index = 2,
+
+      DW_FORM_block = 0x09, DW_FORM_data1 = 0x0b, DW_FORM_data2 = 0x05,
+      DW_FORM_data4 = 0x06, DW_FORM_data8 = 0x07, DW_FORM_data16 = 0x1e,
+      DW_FORM_string = 0x08, DW_FORM_strp = 0x0e, DW_FORM_udata = 0x0f,
+      DW_FORM_line_strp = 0x1f
+    };
+
+
+  /// Bounds-checked little-endian reader over a byte range. Reading
+  /// past the end clears the ok_ flag and yields zeros.
+  struct ByteReader
+  {
+    ByteReader(const uint8_t* begin, const uint8_t* end)
+      : p_(begin), end_(end)
+    { }
+
+    uint64_t fixed(unsigned size)
+    {
+      if (size_t(end_ - p_) < size)
+	{
+	  ok_ = false;
+	  p_ = end_;
+	  return 0;
+	}
+      uint64_t val = 0;
+      for (unsigned i = 0; i < size; ++i)
+	val |= uint64_t(p_[i]) << (8*i);
+      p_ += size;
+      return val;
+    }
+
+    uint64_t uleb()
+    {
+      uint64_t val = 0;
+      unsigned shift = 0;
+      while (p_ < end_)
+	{
+	  uint8_t byte = *p_++;
+	  if (shift < 64)
+	    val |= uint64_t(byte & 0x7f) << shift;
+	  shift += 7;
+	  if ((byte & 0x80) == 0)
+	    return val;
+	}
+      ok_ = false;
+      return val;
+    }
+
+    int64_t sleb()
+    {
+      int64_t val = 0;
+      unsigned shift = 0;
+      while (p_ < end_)
+	{
+	  uint8_t byte = *p_++;
+	  if (shift < 64)
+	    val |= int64_t(uint64_t(byte & 0x7f) << shift);
+	  shift += 7;
+	  if ((byte & 0x80) == 0)
+	    {
+	      if (shift < 64 and (byte & 0x40))
+		val |= - (int64_t(1) << shift);
+	      return val;
+	    }
+	}
+      ok_ = false;
+      return val;
+    }
+
+    std::string cstr()
+    {
+      const uint8_t* start = p_;
+      while (p_ < end_ and *p_)
+	p_++;
+      if (p_ == end_)
+	{
+	  ok_ = false;
+	  return std::string();
+	}
+      std::string result(reinterpret_cast<const char*>(start), p_ - start);
+      p_++;  // Skip terminating null.
+      return result;
+    }
+
+    void skip(uint64_t n)
+    {
+      if (uint64_t(end_ - p_) < n)
+	{
+	  ok_ = false;
+	  p_ = end_;
+	}
+      else
+	p_ += n;
+    }
+
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ = true;
+  };
+}
+
+
+/// Return the null terminated string at the given offset in the given
+/// string section. Return empty string if offset is out of bounds.
+static std::string
+sectionString(const uint8_t* sec, size_t secSize, uint64_t offset)
+{
+  if (not sec or offset >= secSize)
+    return std::string();
+  const char* start = reinterpret_cast<const char*>(sec + offset);
+  size_t len = strnlen(start, secSize - offset);
+  return std::string(start, len);
+}
+
+
+/// Join directory and file name unless file name is absolute.
+static std::string
+joinPath(const std::string& dir, const std::string& name)
+{
+  if (dir.empty() or name.empty() or name.front() == '/')
+    return name;
+  if (dir.back() == '/')
+    return dir + name;
+  return dir + "/" + name;
+}
+
+
+uint32_t
+DwarfLineTable::fileIndex(const std::string& name)
+{
+  auto iter = fileMap_.find(name);
+  if (iter != fileMap_.end())
+    return iter->second;
+  uint32_t ix = uint32_t(files_.size());
+  files_.push_back(name);
+  fileMap_[name] = ix;
+  return ix;
+}
+
+
+bool
+DwarfLineTable::parse(const uint8_t* data, size_t size,
+		      const uint8_t* lineStr, size_t lineStrSize,
+		      const uint8_t* str, size_t strSize)
+{
+  ByteReader sec(data, data + size);
+
+  while (sec.p_ < sec.end_)
+    {
+      // Unit header.
+      unsigned offsetSize = 4;
+      uint64_t unitLength = sec.fixed(4);
+      if (unitLength == 0xffffffff)
+	{
+	  offsetSize = 8;
+	  unitLength = sec.fixed(8);
+	}
+      if (not sec.ok_ or unitLength > uint64_t(sec.end_ - sec.p_))
+	return false;
+
+      const uint8_t* unitEnd = sec.p_ + unitLength;
+      ByteReader unit(sec.p_, unitEnd);
+      sec.p_ = unitEnd;
+
+      unsigned version = unsigned(unit.fixed(2));
+      if (version < 2 or version > 5)
+	{
+	  std::cerr << "Unsupported DWARF line table version " << version
+		    << '\n';
+	  return false;
+	}
+
+      if (version >= 5)
+	{
+	  unit.fixed(1);  // Address size: implied by set_address length.
+	  unit.fixed(1);  // Segment selector size.
+	}
+
+      uint64_t headerLength = unit.fixed(offsetSize);
+      if (headerLength > uint64_t(unitEnd - unit.p_))
+	return false;
+      const uint8_t* programStart = unit.p_ + headerLength;
+
+      unsigned minInstLength = unsigned(unit.fixed(1));
+      if (version >= 4)
+	unit.fixed(1);  // Maximum operations per instruction.
+      unit.fixed(1);  // Default is_stmt.
+      int lineBase = int8_t(unit.fixed(1));
+      unsigned lineRange = unsigned(unit.fixed(1));
+      unsigned opcodeBase = unsigned(unit.fixed(1));
+      if (lineRange == 0 or opcodeBase == 0)
+	return false;
+
+      std::vector<uint8_t> opcodeLengths(opcodeBase);
+      for (unsigned i = 1; i < opcodeBase; ++i)
+	opcodeLengths.at(i) = uint8_t(unit.fixed(1));
+
+      // Directory and file tables. Map file number used by the line
+      // program to an index in files_.
+      std::vector<std::string> dirs;
+      std::vector<uint32_t> cuFiles;
+
+      if (version < 5)
+	{
+	  dirs.push_back(std::string());  // Compilation directory: unknown.
+	  while (unit.ok_)
+	    {
+	      std::string dir = unit.cstr();
+	      if (dir.empty())
+		break;
+	      dirs.push_back(dir);
+	    }
+	  cuFiles.push_back(fileIndex("<unknown>"));  // Files are 1-based.
+	  while (unit.ok_)
+	    {
+	      std::string name = unit.cstr();
+	      if (name.empty())
+		break;
+	      uint64_t dirIx = unit.uleb();
+	      unit.uleb();  // Modification time.
+	      unit.uleb();  // Length.
+	      std::string dir = dirIx < dirs.size() ? dirs.at(dirIx) : "";
+	      cuFiles.push_back(fileIndex(joinPath(dir, name)));
+	    }
+	}
+      else
+	{
+	  // Version 5: Self-describing entry formats.
+	  for (int pass = 0; pass < 2 and unit.ok_; ++pass)
+	    {
+	      unsigned formatCount = unsigned(unit.fixed(1));
+	      std::vector<std::pair<uint64_t, uint64_t>> format;
+	      for (unsigned i = 0; i < formatCount; ++i)
+		{
+		  uint64_t type = unit.uleb();
+		  uint64_t form = unit.uleb();
+		  format.push_back(std::make_pair(type, form));
+		}
+
+	      uint64_t count = unit.uleb();
+	      for (uint64_t entryIx = 0; entryIx < count and unit.ok_; ++entryIx)
+		{
+		  std::string path;
+		  uint64_t dirIx = 0;
+		  for (const auto& tf : format)
+		    {
+		      uint64_t value = 0;
+		      std::string strValue;
+		      switch (tf.second)
+			{
+			case DW_FORM_string:
+			  strValue = unit.cstr();
+			  break;
+			case DW_FORM_line_strp:
+			  value = unit.fixed(offsetSize);
+			  strValue = sectionString(lineStr, lineStrSize, value);
+			  break;
+			case DW_FORM_strp:
+			  value = unit.fixed(offsetSize);
+			  strValue = sectionString(str, strSize, value);
+			  break;
+			case DW_FORM_udata: value = unit.uleb(); break;
+			case DW_FORM_data1: value = unit.fixed(1); break;
+			case DW_FORM_data2: value = unit.fixed(2); break;
+			case DW_FORM_data4: value = unit.fixed(4); break;
+			case DW_FORM_data8: value = unit.fixed(8); break;
+			case DW_FORM_data16: unit.skip(16); break;
+			case DW_FORM_block: unit.skip(unit.uleb()); break;
+			default:
+			  std::cerr << "Unsupported DWARF form 0x" << std::hex
+				    << tf.second << std::dec
+				    << " in line table header\n";
+			  return false;
+			}
+		      if (tf.first == DW_LNCT_path)
+			path = strValue;
+		      else if (tf.first == DW_LNCT_directory_index)
+			dirIx = value;
+		    }
+
+		  if (pass == 0)
+		    dirs.push_back(path);
+		  else
+		    {
+		      std::string dir = dirIx < dirs.size() ? dirs.at(dirIx) : "";
+		      cuFiles.push_back(fileIndex(joinPath(dir, path)));
+		    }
+		}
+	    }
+	}
+
+      if (not unit.ok_)
+	return false;
+
+      // Run the line number program.
+      ByteReader prog(programStart, unitEnd);
+
+      uint64_t address = 0;
+      uint64_t file = 1;
+      int64_t line = 1;
+
+      auto emitRow = [&] (bool endSeq) {
+		       Row row;
+		       row.addr_ = address;
+		       row.file_ = file < cuFiles.size() ? cuFiles.at(file) :
+			 fileIndex("<unknown>");
+		       row.line_ = uint32_t(line);
+		       row.endSeq_ = endSeq;
+		       rows_.push_back(row);
+		     };
+
+      while (prog.p_ < prog.end_ and prog.ok_)
+	{
+	  unsigned opcode = unsigned(prog.fixed(1));
+	  if (opcode >= opcodeBase)
+	    {
+	      // Special opcode.
+	      unsigned adjusted = opcode - opcodeBase;
+	      address += (adjusted / lineRange) * minInstLength;
+	      line += lineBase + int(adjusted % lineRange);
+	      emitRow(false);
+	      continue;
+	    }
+
+	  switch (opcode)
+	    {
+	    case 0:
+	      {
+		// Extended opcode.
+		uint64_t len = prog.uleb();
+		if (len == 0 or len > uint64_t(prog.end_ - prog.p_))
+		  return false;
+		const uint8_t* next = prog.p_ + len;
+		unsigned subOp = unsigned(prog.fixed(1));
+		if (subOp == DW_LNE_end_sequence)
+		  {
+		    emitRow(true);
+		    address = 0;
+		    file = 1;
+		    line = 1;
+		  }
+		else if (subOp == DW_LNE_set_address)
+		  {
+		    if (len > 9)
+		      return false;  // Address wider than 64 bits.
+		    address = prog.fixed(unsigned(len - 1));
+		  }
+		else if (subOp == DW_LNE_define_file)
+		  {
+		    std::string name = prog.cstr();
+		    uint64_t dirIx = prog.uleb();
+		    std::string dir = dirIx < dirs.size() ? dirs.at(dirIx) : "";
+		    cuFiles.push_back(fileIndex(joinPath(dir, name)));
+		  }
+		prog.p_ = next;
+	      }
+	      break;
+
+	    case DW_LNS_copy:
+	      emitRow(false);
+	      break;
+
+	    case DW_LNS_advance_pc:
+	      address += prog.uleb() * minInstLength;
+	      break;
+
+	    case DW_LNS_advance_line:
+	      line += prog.sleb();
+	      break;
+
+	    case DW_LNS_set_file:
+	      file = prog.uleb();
+	      break;
+
+	    case DW_LNS_const_add_pc:
+	      address += ((255 - opcodeBase) / lineRange) * minInstLength;
+	      break;
+
+	    case DW_LNS_fixed_advance_pc:
+	      address += prog.fixed(2);
+	      break;
+
+	    default:
+	      // Skip the operands of other standard opcodes.
+	      for (unsigned i = 0; i < opcodeLengths.at(opcode); ++i)
+		prog.uleb();
+	      break;
+	    }
+	}
+
+      if (not prog.ok_)
+	return false;
+    }
+
+  return true;
+}
+
+
+bool
+DwarfLineTable::loadElfFile(const std::string& path)
+{
+  ELFIO::elfio reader;
+
+  if (not reader.load(path))
+    {
+      std::cerr << "Failed to load ELF file " << path << '\n';
+      return false;
+    }
+
+  const ELFIO::section* lineSec = reader.sections[".debug_line"];
+  if (not lineSec or lineSec->get_size() == 0 or not lineSec->get_data())
+    return true;  // No line information.
+
+  const ELFIO::section* lineStrSec = reader.sections[".debug_line_str"];
+  const ELFIO::section* strSec = reader.sections[".debug_str"];
+
+  auto secData = [] (const ELFIO::section* sec) -> const uint8_t* {
+		   if (not sec)
+		     return nullptr;
+		   return reinterpret_cast<const uint8_t*>(sec->get_data());
+		 };
+  auto secSize = [] (const ELFIO::section* sec) -> size_t {
+		   return sec ? size_t(sec->get_size()) : 0;
+		 };
+
+  size_t origSize = rows_.size();
+  bool ok = parse(secData(lineSec), secSize(lineSec),
+		  secData(lineStrSec), secSize(lineStrSec),
+		  secData(strSec), secSize(strSec));
+  if (not ok)
+    {
+      std::cerr << "File " << path << ": Malformed .debug_line section\n";
+      rows_.resize(origSize);
+      return false;
+    }
+
+  // Sort by address. At equal addresses, an end of sequence row goes
+  // first so that a sequence starting where another ends is found by
+  // lookup.
+  std::stable_sort(rows_.begin(), rows_.end(),
+		   [] (const Row& a, const Row& b) {
+		     if (a.addr_ != b.addr_)
+		       return a.addr_ < b.addr_;
+		     return a.endSeq_ and not b.endSeq_;
+		   });
+
+  // Compact: Drop a row that is superseded by a row at the same
+  // address or that does not change the source location of the
+  // preceding row.
+  size_t count = 0;
+  for (size_t i = 0; i < rows_.size(); ++i)
+    {
+      const Row& row = rows_[i];
+      if (count > 0 and not row.endSeq_ and not rows_[count-1].endSeq_)
+	{
+	  Row& prev = rows_[count-1];
+	  if (prev.file_ == row.file_ and prev.line_ == row.line_)
+	    continue;
+	  if (prev.addr_ == row.addr_)
+	    {
+	      prev = row;
+	      continue;
+	    }
+	}
+      rows_[count++] = row;
+    }
+  rows_.resize(count);
+  rows_.shrink_to_fit();
+
+  return true;
+}
+
+
+bool
+DwarfLineTable::lookup(uint64_t addr, std::string& file, unsigned& line) const
+{
+  auto iter = std::upper_bound(rows_.begin(), rows_.end(), addr,
+			       [] (uint64_t a, const Row& row) {
+				 return a < row.addr_;
+			       });
+  if (iter == rows_.begin())
+    return false;
+  --iter;
+  if (iter->endSeq_)
+    return false;
+
+  file = files_.at(iter->file_);
+  line = iter->line_;
+  return true;
+}
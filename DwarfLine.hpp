@@ -0,0 +1,96 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+namespace WdRiscv
+{
+
+  /// Address to source line mapping extracted from the DWARF
+  /// .debug_line section of ELF files (DWARF versions 2 to 5). Rows
+  /// are kept sorted by address (16 bytes per row, rows that do not
+  /// change the source location are dropped) and looked up by binary
+  /// search.
+  class DwarfLineTable
+  {
+  public:
+
+    /// One row of the line table: Code starting at addr_ (up to the
+    /// address of the next row) belongs to the given line of the given
+    /// file. Row with endSeq_ set marks the end of a contiguous
+    /// sequence of code.
+    struct Row
+    {
+      Row()
+	: file_(0), endSeq_(0)
+      { }
+
+      uint64_t addr_ = 0;
+      uint32_t file_ : 31;  // Index into file name table.
+      uint32_t endSeq_ : 1;
+      uint32_t line_ = 0;
+    };
+
+    /// Read the .debug_line section of the given ELF file and add its
+    /// rows to this table. Return true on success and false if the
+    /// file cannot be read or if the line data is malformed. A file
+    /// without line information is not an error.
+    bool loadElfFile(const std::string& path);
+
+    /// Set file and line to the source location of the given address.
+    /// Return true on success and false if address is not covered by
+    /// the table.
+    bool lookup(uint64_t addr, std::string& file, unsigned& line) const;
+
+    /// Return the rows of the table sorted by address.
+    const std::vector<Row>& rows() const
+    { return rows_; }
+
+    /// Return the name of the file with the given index.
+    const std::string& fileName(unsigned ix) const
+    { return files_.at(ix); }
+
+    /// Return true if table has no rows.
+    bool empty() const
+    { return rows_.empty(); }
+
+  protected:
+
+    /// Parse the line programs in the given .debug_line section data
+    /// appending rows to this table.
+    bool parse(const uint8_t* data, size_t size,
+	       const uint8_t* lineStr, size_t lineStrSize,
+	       const uint8_t* str, size_t strSize);
+
+    /// Return index of given file name adding it to the table if
+    /// not already present.
+    uint32_t fileIndex(const std::string& name);
+
+  private:
+
+    std::vector<Row> rows_;
+    std::vector<std::string> files_;
+    std::unordered_map<std::string, uint32_t> fileMap_;
+  };
+}
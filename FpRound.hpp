@@ -0,0 +1,203 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+// Floating point rounding helpers of the Core class shared by the
+// scalar (Core.cpp) and the vector (vector.cpp) instructions.
+
+#pragma once
+
+#include <algorithm>
+#include <cfenv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "Core.hpp"
+
+
+namespace WdRiscv
+{
+
+  /// Host type with at least 2 more significand bits than double. Used
+  /// to emulate the round to nearest, ties to max magnitude, mode of
+  /// double precision instructions.
+  typedef long double WideDouble;
+
+
+  /// Return true if the least significant bit of the significand of x
+  /// is set.
+  inline bool
+  lsbSet(double x)
+  {
+    uint64_t u = 0;
+    memcpy(&u, &x, sizeof(u));
+    return u & 1;
+  }
+
+
+  /// Long double version of above: The least significant bits of the
+  /// significand are at the lowest address (x87 extended and IEEE
+  /// quad on little endian hosts).
+  inline bool
+  lsbSet(long double x)
+  {
+    uint64_t u = 0;
+    memcpy(&u, &x, sizeof(u));
+    return u & 1;
+  }
+
+
+  /// Round the round-to-odd value x to F using round to nearest, ties
+  /// to max magnitude. Or into flags the RISCV exception flags (see
+  /// FpFlags) for inexact, overflow and underflow (tininess detected
+  /// after rounding). Host rounding mode must be toward zero.
+  template <typename F, typename W>
+  F
+  roundToNearestMax(W x, unsigned& flags)
+  {
+    typedef std::numeric_limits<F> Lim;
+
+    if (not std::isfinite(x))
+      return F(x);
+
+    // Ties of the largest finite value and beyond go to infinity.
+    W halfMaxUlp = std::ldexp(W(1), Lim::max_exponent - Lim::digits - 1);
+    if (std::fabs(x) >= W(Lim::max()) + halfMaxUlp)
+      {
+	flags |= unsigned(FpFlags::Overflow) | unsigned(FpFlags::Inexact);
+	return std::copysign(Lim::infinity(), F(x));
+      }
+
+    F trunc = F(x);
+    W rest = x - W(trunc);  // Exact.
+    if (rest == 0)
+      return trunc;
+
+    flags |= unsigned(FpFlags::Inexact);
+
+    // Unit in the last place of F in the binade of x.
+    int exp = 0;
+    std::frexp(x, &exp);
+    exp = std::max(exp, Lim::min_exponent);
+    W ulp = std::ldexp(W(1), exp - Lim::digits);
+
+    W res = trunc;
+    if (std::fabs(rest) * 2 >= ulp)
+      res += std::copysign(ulp, x);
+
+    if (std::fabs(res) < W(Lim::min()))
+      flags |= unsigned(FpFlags::Underflow);
+
+    return F(res);
+  }
+
+
+  template <typename URV>
+  template <typename F, typename W, typename OP>
+  F
+  Core<URV>::nearestMaxOp(OP op)
+  {
+    // Host flags raised so far belong to earlier instructions.
+    syncFpFlags();
+
+    // Evaluate in round toward zero and make the result round to odd
+    // (sticky bit in the least significant bit). W has at least 2 more
+    // significand bits than F, so rounding that once more to F yields
+    // the correctly rounded result.
+    static_assert(std::numeric_limits<W>::digits >=
+		  std::numeric_limits<F>::digits + 2, "W is too narrow");
+
+    // Volatile: Keep the operations from moving across the host flag
+    // queries.
+    changeHostRoundingMode(RoundingMode::Zero);
+    volatile W wide = op();
+    W odd = wide;
+    if (std::fetestexcept(FE_INEXACT) and std::isfinite(odd) and
+	not lsbSet(odd))
+      {
+	W inf = std::numeric_limits<W>::infinity();
+	odd = std::nextafter(odd, std::copysign(inf, odd));
+      }
+
+    unsigned flags = 0;
+    volatile F res = roundToNearestMax<F>(odd, flags);
+
+    // Invalid may also come from narrowing a signaling NaN.
+    int hostFlags = std::fetestexcept(FE_ALL_EXCEPT);
+    if (hostFlags & FE_INVALID)
+      flags |= unsigned(FpFlags::Invalid);
+    if (hostFlags & FE_DIVBYZERO)
+      flags |= unsigned(FpFlags::DivByZero);
+
+    std::feclearexcept(FE_ALL_EXCEPT);
+    orFpFlags(flags);
+    return res;
+  }
+
+
+  template <typename URV>
+  template <typename INT, typename F>
+  INT
+  Core<URV>::fpToInt(F value, RoundingMode mode)
+  {
+    typedef std::numeric_limits<INT> Lim;
+
+    unsigned flags = 0;
+    INT result = 0;
+
+    if (std::isnan(value))
+      {
+	flags |= unsigned(FpFlags::Invalid);
+	result = Lim::max();
+      }
+    else
+      {
+	F rounded = 0;
+	if (mode == RoundingMode::NearestMax)
+	  rounded = std::round(value);
+	else
+	  {
+	    setHostRoundingMode(mode);
+	    rounded = std::nearbyint(value);
+	  }
+
+	// Range of INT is [min, 2^digits): Both bounds are exact in F.
+	F low = F(Lim::min());
+	F high = std::ldexp(F(1), Lim::digits);
+	if (rounded < low)
+	  {
+	    flags |= unsigned(FpFlags::Invalid);
+	    result = Lim::min();
+	  }
+	else if (rounded >= high)
+	  {
+	    flags |= unsigned(FpFlags::Invalid);
+	    result = Lim::max();
+	  }
+	else
+	  {
+	    result = INT(rounded);
+	    if (rounded != value)
+	      flags |= unsigned(FpFlags::Inexact);
+	  }
+      }
+
+    orFpFlags(flags);
+    return result;
+  }
+}
@@ -0,0 +1,310 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <boost/format.hpp>
+#include "FuncCoverage.hpp"
+#include "InstInfo.hpp"
+
+
+using namespace WdRiscv;
+
+
+// File layout: magic, version, bin count, instruction count, one
+// 32-bit mask per instruction id, then the CSR read and CSR write
+// bitsets (512 bytes each, CSR 0 in bit 0 of byte 0). Integers are
+// little-endian.
+static const char funcCoverageMagic[8] = { 'W', 'H', 'F', 'U', 'N', 'C', 'O', 'V' };
+static const uint32_t funcCoverageVersion = 1;
+
+
+static void
+putInt(std::vector<uint8_t>& buf, uint32_t value)
+{
+  for (unsigned i = 0; i < 4; ++i)
+    buf.push_back(uint8_t(value >> (8*i)));
+}
+
+
+static uint32_t
+getInt(const uint8_t* p)
+{
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+    (uint32_t(p[3]) << 24);
+}
+
+
+const char*
+FuncCoverage::binName(Bin bin)
+{
+  switch (bin)
+    {
+    case Executed:      return "executed";
+    case RdX0:          return "rd=x0";
+    case RdEqRs1:       return "rd=rs1";
+    case Rs1EqRs2:      return "rs1=rs2";
+    case SrcX0:         return "rs=x0";
+    case ImmZero:       return "imm=0";
+    case ImmNegative:   return "imm<0";
+    case ImmMin:        return "imm=min";
+    case ImmMax:        return "imm=max";
+    case Misaligned:    return "misaligned";
+    case RmNearestEven: return "rm=rne";
+    case RmZero:        return "rm=rtz";
+    case RmDown:        return "rm=rdn";
+    case RmUp:          return "rm=rup";
+    case RmNearestMax:  return "rm=rmm";
+    case RmDynamic:     return "rm=dyn";
+    case BinCount:      break;
+    }
+  return "unknown";
+}
+
+
+uint32_t
+FuncCoverage::applicableBins(const InstInfo& info)
+{
+  uint32_t bins = binMask(Executed);
+
+  bool hasRd = (info.ithOperandType(0) == OperandType::IntReg and
+		info.isIthOperandWrite(0));
+  unsigned sources = 0;
+  for (unsigned i = 0; i < info.operandCount(); ++i)
+    if (info.isIthOperandIntRegSource(i))
+      sources++;
+
+  if (hasRd)
+    bins |= binMask(RdX0);
+  if (hasRd and sources >= 1)
+    bins |= binMask(RdEqRs1);
+  if (sources >= 2)
+    bins |= binMask(Rs1EqRs2);
+  if (sources >= 1)
+    bins |= binMask(SrcX0);
+
+  for (unsigned i = 0; i < info.operandCount(); ++i)
+    {
+      if (info.ithOperandType(i) != OperandType::Imm)
+	continue;
+      bins |= binMask(ImmZero);
+      uint32_t mask = info.ithOperandMask(i);
+      bool isSigned = mask == 0 or (mask >> 31);
+      if (isSigned)
+	bins |= binMask(ImmNegative);
+      if (mask)
+	bins |= binMask(ImmMax) | (isSigned ? binMask(ImmMin) : 0);
+      break;
+    }
+
+  if (info.isLoad() or info.isStore() or info.isAtomic())
+    bins |= binMask(Misaligned);
+
+  // Floating point instructions with a rounding mode field (funct3
+  // not part of opcode).
+  if (info.type() == InstType::Fp and (info.codeMask() & 0x7000) == 0 and
+      not info.isLoad() and not info.isStore())
+    for (unsigned rm = RmNearestEven; rm <= RmDynamic; ++rm)
+      bins |= binMask(Bin(rm));
+
+  return bins;
+}
+
+
+FuncCoverage::FuncCoverage()
+  : bins_(size_t(InstId::maxId) + 1)
+{
+}
+
+
+void
+FuncCoverage::merge(const FuncCoverage& other)
+{
+  for (size_t i = 0; i < bins_.size() and i < other.bins_.size(); ++i)
+    bins_[i] |= other.bins_[i];
+  csrRead_ |= other.csrRead_;
+  csrWritten_ |= other.csrWritten_;
+}
+
+
+bool
+FuncCoverage::save(const std::string& path) const
+{
+  std::vector<uint8_t> buf(funcCoverageMagic,
+			   funcCoverageMagic + sizeof(funcCoverageMagic));
+  putInt(buf, funcCoverageVersion);
+  putInt(buf, BinCount);
+  putInt(buf, uint32_t(bins_.size()));
+  for (auto bins : bins_)
+    putInt(buf, bins);
+
+  for (const auto* bits : { &csrRead_, &csrWritten_ })
+    for (size_t byteIx = 0; byteIx < bits->size() / 8; ++byteIx)
+      {
+	uint8_t byte = 0;
+	for (unsigned bitIx = 0; bitIx < 8; ++bitIx)
+	  if (bits->test(byteIx*8 + bitIx))
+	    byte |= uint8_t(1 << bitIx);
+	buf.push_back(byte);
+      }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (not file)
+    {
+      std::cerr << "Failed to open functional coverage file '" << path
+		<< "' for output\n";
+      return false;
+    }
+  bool ok = fwrite(buf.data(), 1, buf.size(), file) == buf.size();
+  ok = fclose(file) == 0 and ok;
+  if (not ok)
+    std::cerr << "Failed to write functional coverage file '" << path
+	      << "'\n";
+  return ok;
+}
+
+
+bool
+FuncCoverage::load(const std::string& path)
+{
+  FILE* file = fopen(path.c_str(), "rb");
+  if (not file)
+    {
+      std::cerr << "Failed to open functional coverage file '" << path
+		<< "' for input\n";
+      return false;
+    }
+
+  // Files are small: Read in one shot.
+  std::vector<uint8_t> buf;
+  uint8_t chunk[8192];
+  size_t count = 0;
+  while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    buf.insert(buf.end(), chunk, chunk + count);
+  fclose(file);
+
+  size_t headerSize = sizeof(funcCoverageMagic) + 12;
+  if (buf.size() < headerSize or
+      memcmp(buf.data(), funcCoverageMagic, sizeof(funcCoverageMagic)) != 0)
+    {
+      std::cerr << "File '" << path << "' is not a functional coverage file\n";
+      return false;
+    }
+
+  const uint8_t* p = buf.data() + sizeof(funcCoverageMagic);
+  uint32_t version = getInt(p), binCount = getInt(p + 4);
+  uint32_t instCount = getInt(p + 8);
+  if (version != funcCoverageVersion or binCount != BinCount or
+      instCount != bins_.size())
+    {
+      std::cerr << "Functional coverage file '" << path
+		<< "' was produced by an incompatible simulator version\n";
+      return false;
+    }
+
+  size_t csrBytes = csrRead_.size() / 8;
+  if (buf.size() != headerSize + 4*size_t(instCount) + 2*csrBytes)
+    {
+      std::cerr << "Functional coverage file '" << path
+		<< "' is truncated\n";
+      return false;
+    }
+
+  p = buf.data() + headerSize;
+  for (size_t i = 0; i < instCount; ++i, p += 4)
+    bins_[i] |= getInt(p);
+
+  for (auto* bits : { &csrRead_, &csrWritten_ })
+    for (size_t byteIx = 0; byteIx < csrBytes; ++byteIx, ++p)
+      if (*p)
+	for (unsigned bitIx = 0; bitIx < 8; ++bitIx)
+	  if ((*p >> bitIx) & 1)
+	    bits->set(byteIx*8 + bitIx);
+
+  return true;
+}
+
+
+bool
+FuncCoverage::report(std::ostream& out, const InstInfoTable& table) const
+{
+  uint64_t totalBins = 0, totalHit = 0;
+  unsigned instTotal = 0, instHit = 0;
+
+  std::vector<std::string> lines;
+
+  for (size_t ix = 0; ix < bins_.size(); ++ix)
+    {
+      InstId id = InstId(ix);
+      if (id == InstId::illegal or not table.hasInfo(id))
+	continue;
+
+      const InstInfo& info = table.getInstInfo(id);
+      uint32_t applicable = applicableBins(info);
+      uint32_t hit = bins_.at(ix) & applicable;
+
+      unsigned applicableCount = __builtin_popcount(applicable);
+      unsigned hitCount = __builtin_popcount(hit);
+      totalBins += applicableCount;
+      totalHit += hitCount;
+      instTotal++;
+      if (hit & binMask(Executed))
+	instHit++;
+
+      std::string line = (boost::format("%-16s %2d/%-2d") % info.name() %
+			  hitCount % applicableCount).str();
+      if (hitCount != applicableCount)
+	{
+	  line += " missing:";
+	  for (unsigned bin = 0; bin < BinCount; ++bin)
+	    if ((applicable & ~hit) & binMask(Bin(bin)))
+	      line += std::string(" ") + binName(Bin(bin));
+	}
+      lines.push_back(line);
+    }
+
+  out << "Instructions executed: " << instHit << " of " << instTotal << '\n';
+  out << "Bins hit: " << totalHit << " of " << totalBins;
+  if (totalBins)
+    out << (boost::format(" (%.2f%%)") % (100.0 * double(totalHit) /
+					   double(totalBins)));
+  out << "\n\n";
+
+  for (const auto& line : lines)
+    out << line << '\n';
+
+  for (unsigned pass = 0; pass < 2; ++pass)
+    {
+      const auto& bits = pass == 0 ? csrRead_ : csrWritten_;
+      out << '\n' << (pass == 0 ? "CSRs read:" : "CSRs written:") << ' '
+	  << bits.count() << '\n';
+      unsigned col = 0;
+      for (size_t csr = 0; csr < bits.size(); ++csr)
+	if (bits.test(csr))
+	  {
+	    out << (boost::format(" 0x%03x") % csr);
+	    if (++col % 12 == 0)
+	      out << '\n';
+	  }
+      if (col % 12)
+	out << '\n';
+    }
+
+  return bool(out);
+}
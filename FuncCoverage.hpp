@@ -0,0 +1,123 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitset>
+#include <iosfwd>
+#include "InstId.hpp"
+
+
+namespace WdRiscv
+{
+
+  class InstInfo;
+  class InstInfoTable;
+
+  /// Functional coverage: For each instruction id, a fixed-size set
+  /// of bins recording which operand corner cases were exercised,
+  /// plus the sets of CSRs that were read and written. Coverage
+  /// objects (and the files they are saved to) merge by or-ing bins.
+  class FuncCoverage
+  {
+  public:
+
+    /// Coverage bins of an instruction. Each bin is a bit in a 32-bit
+    /// mask.
+    enum Bin
+      {
+	Executed,      // Instruction was executed.
+	RdX0,          // Destination register is x0.
+	RdEqRs1,       // Destination same as first source register.
+	Rs1EqRs2,      // First and second source registers are the same.
+	SrcX0,         // A source register is x0.
+	ImmZero,       // Immediate operand is zero.
+	ImmNegative,   // Immediate operand is negative.
+	ImmMin,        // Signed immediate field at its minimum value.
+	ImmMax,        // Immediate field at its maximum value.
+	Misaligned,    // Load/store/atomic to a misaligned address.
+	RmNearestEven, // Static rounding modes (must be consecutive and
+	RmZero,        // in encoding order).
+	RmDown,
+	RmUp,
+	RmNearestMax,
+	RmDynamic,     // Dynamic rounding mode (frm).
+	BinCount
+      };
+
+    /// Return the bit mask of the given bin.
+    static uint32_t binMask(Bin bin)
+    { return uint32_t(1) << unsigned(bin); }
+
+    /// Return the name of the given bin.
+    static const char* binName(Bin bin);
+
+    /// Return the mask of the bins that can be hit by the given
+    /// instruction. An immediate field is signed if it includes bit 31
+    /// of the instruction. The min/max immediate bins apply only to
+    /// instructions whose immediate field is described by the
+    /// instruction table (not the compressed instructions).
+    static uint32_t applicableBins(const InstInfo& info);
+
+    /// Constructor: Empty coverage.
+    FuncCoverage();
+
+    /// Mark the given bins as hit for the given instruction.
+    void record(InstId id, uint32_t bins)
+    { bins_[size_t(id)] |= bins; }
+
+    /// Record a read and/or a write of the given CSR.
+    void recordCsr(unsigned csr, bool read, bool write)
+    {
+      csr &= 0xfff;
+      if (read)
+	csrRead_.set(csr);
+      if (write)
+	csrWritten_.set(csr);
+    }
+
+    /// Return the bins hit by the given instruction.
+    uint32_t bins(InstId id) const
+    { return bins_.at(size_t(id)); }
+
+    /// Or the bins of the given coverage into this one.
+    void merge(const FuncCoverage& other);
+
+    /// Save coverage in binary format to the given file. Return true
+    /// on success and false on failure.
+    bool save(const std::string& path) const;
+
+    /// Read a file produced by save merging its contents into this
+    /// object. Return true on success and false on failure.
+    bool load(const std::string& path);
+
+    /// Print a coverage report to the given stream: Overall bin
+    /// count, missing bins of each instruction and the CSRs accessed.
+    /// Return true on success and false if the stream becomes bad.
+    bool report(std::ostream& out, const InstInfoTable& table) const;
+
+  private:
+
+    std::vector<uint32_t> bins_;       // Indexed by instruction id.
+    std::bitset<4096> csrRead_;
+    std::bitset<4096> csrWritten_;
+  };
+}
@@ -0,0 +1,235 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+// 
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+// 
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+// 
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "HartScheduler.hpp"
+
+
+using namespace WdRiscv;
+
+
+template <typename URV>
+HartScheduler<URV>::HartScheduler(std::vector<Core<URV>*>& cores,
+				  unsigned threadCount, uint64_t quantum,
+				  bool pin)
+  : cores_(cores), workers_(std::max(1u, threadCount)),
+    quantum_(std::max(uint64_t(1), quantum)), pin_(pin)
+{
+}
+
+
+/// Pin given thread to the host cpu with the given index (modulo the
+/// number of cpus). Return true on success and false on failure.
+static bool
+pinThread(std::thread& thread, unsigned cpuIx)
+{
+#ifdef __linux__
+  unsigned cpuCount = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpuIx % cpuCount, &cpuSet);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet),
+				&cpuSet) == 0;
+#else
+  (void) thread;
+  (void) cpuIx;
+  return false;
+#endif
+}
+
+
+template <typename URV>
+bool
+HartScheduler<URV>::run(FILE* traceFile)
+{
+  active_ = cores_.size();
+  ok_ = true;
+  parked_.clear();
+
+  // Deal harts to workers in hart order.
+  for (size_t i = 0; i < cores_.size(); ++i)
+    workers_.at(i % workers_.size()).queue_.push_back(unsigned(i));
+
+  std::vector<std::thread> threads;
+  for (unsigned ix = 0; ix < workers_.size(); ++ix)
+    {
+      threads.emplace_back(&HartScheduler<URV>::worker, this, ix, traceFile);
+      if (pin_ and not pinThread(threads.back(), ix))
+	std::cerr << "Warning: Failed to pin hart scheduler thread " << ix
+		  << " to a host cpu\n";
+    }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  return ok_;
+}
+
+
+template <typename URV>
+void
+HartScheduler<URV>::worker(unsigned ix, FILE* traceFile)
+{
+  while (true)
+    {
+      unsigned hart = 0;
+      if (nextHart(ix, hart))
+	{
+	  runHart(ix, hart, traceFile);
+	  continue;
+	}
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (active_ == 0)
+	break;
+
+      wakeInterrupted(ix);
+
+      if (parked_.size() == active_)
+	{
+	  // Every remaining hart is descheduled and none of them can be
+	  // woken up by another: Resume them all. They will spin as
+	  // they would in a free run.
+	  wakeParked(ix);
+	  continue;
+	}
+
+      // Some hart is being run by another worker: Wait for it to be
+      // requeued (or for harts to be woken up).
+      cv_.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+
+template <typename URV>
+bool
+HartScheduler<URV>::nextHart(unsigned ix, unsigned& hart)
+{
+  // Own queue is used in FIFO order (round robin). Steal from the
+  // back of the queues of the other workers.
+  for (unsigned k = 0; k < workers_.size(); ++k)
+    {
+      Worker& worker = workers_.at((ix + k) % workers_.size());
+      std::lock_guard<std::mutex> lock(worker.mutex_);
+      if (worker.queue_.empty())
+	continue;
+      if (k == 0)
+	{
+	  hart = worker.queue_.front();
+	  worker.queue_.pop_front();
+	}
+      else
+	{
+	  hart = worker.queue_.back();
+	  worker.queue_.pop_back();
+	}
+      return true;
+    }
+  return false;
+}
+
+
+template <typename URV>
+void
+HartScheduler<URV>::runHart(unsigned ix, unsigned hart, FILE* traceFile)
+{
+  Core<URV>& core = *cores_.at(hart);
+  uint64_t writes = core.memoryWriteCount();
+  core.clearWaitForInterrupt();
+
+  bool done = false, spinning = false;
+  bool ok = core.runQuantum(quantum_, traceFile, done);
+  if (ok and not done and not core.isWaitingForInterrupt())
+    ok = core.probeSpinLoop(spinProbeLength, traceFile, done, spinning);
+
+  bool park = not done and (spinning or (core.isWaitingForInterrupt() and
+					 not core.isInterruptPending()));
+  bool wrote = core.memoryWriteCount() != writes;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (not ok)
+    ok_ = false;
+
+  // Memory changed: Parked harts may now make progress.
+  if (wrote and not parked_.empty())
+    wakeParked(ix);
+  else
+    wakeInterrupted(ix);
+
+  if (done)
+    {
+      if (--active_ == 0)
+	cv_.notify_all();
+    }
+  else if (park)
+    parked_.push_back(hart);
+  else
+    {
+      Worker& worker = workers_.at(ix);
+      std::lock_guard<std::mutex> workerLock(worker.mutex_);
+      worker.queue_.push_back(hart);
+    }
+}
+
+
+template <typename URV>
+void
+HartScheduler<URV>::wakeParked(unsigned ix)
+{
+  Worker& worker = workers_.at(ix);
+  std::lock_guard<std::mutex> lock(worker.mutex_);
+  for (auto hart : parked_)
+    worker.queue_.push_back(hart);
+  parked_.clear();
+  cv_.notify_all();
+}
+
+
+template <typename URV>
+void
+HartScheduler<URV>::wakeInterrupted(unsigned ix)
+{
+  if (parked_.empty())
+    return;
+
+  Worker& worker = workers_.at(ix);
+  std::lock_guard<std::mutex> lock(worker.mutex_);
+  size_t kept = 0;
+  for (auto hart : parked_)
+    {
+      if (cores_.at(hart)->isInterruptPending())
+	worker.queue_.push_back(hart);
+      else
+	parked_.at(kept++) = hart;
+    }
+  if (kept != parked_.size())
+    {
+      parked_.resize(kept);
+      cv_.notify_all();
+    }
+}
+
+
+template class WdRiscv::HartScheduler<uint32_t>;
+template class WdRiscv::HartScheduler<uint64_t>;
@@ -0,0 +1,100 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+// 
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+// 
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+// 
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "Core.hpp"
+
+
+namespace WdRiscv
+{
+
+  /// Run many harts on a small pool of host threads. Harts are run
+  /// for a quantum of instructions at a time. Each worker thread owns
+  /// a deque of runnable harts, and a worker that runs out of harts
+  /// steals from the others. A hart that executed a wfi instruction or
+  /// that is caught in a spin-wait loop (see Core::probeSpinLoop) is
+  /// descheduled until some other hart writes memory, an interrupt is
+  /// pending, or every remaining hart is descheduled. The interleaving
+  /// of harts is not reproducible (see --hart-quantum for that).
+  template <typename URV>
+  class HartScheduler
+  {
+  public:
+
+    /// Constructor: Schedule the given harts on threadCount worker
+    /// threads running quantum instructions per turn. Pin worker
+    /// threads to host cpus if pin is true.
+    HartScheduler(std::vector<Core<URV>*>& cores, unsigned threadCount,
+		  uint64_t quantum, bool pin);
+
+    /// Run all harts until they are all done. Return true if no hart
+    /// failed and false otherwise.
+    bool run(FILE* traceFile);
+
+    /// Number of instructions executed after a quantum looking for a
+    /// spin-wait loop.
+    static constexpr unsigned spinProbeLength = 64;
+
+  protected:
+
+    /// Body of worker thread with the given index.
+    void worker(unsigned ix, FILE* traceFile);
+
+    /// Return a runnable hart for the given worker taking it from its
+    /// own queue or stealing it from another one. Return false if
+    /// there is no runnable hart.
+    bool nextHart(unsigned ix, unsigned& hart);
+
+    /// Run given hart for one quantum on behalf of the given worker
+    /// then requeue, park or retire it.
+    void runHart(unsigned ix, unsigned hart, FILE* traceFile);
+
+    /// Make all parked harts runnable placing them in the queue of the
+    /// given worker. Must be called with mutex_ held.
+    void wakeParked(unsigned ix);
+
+    /// Make the parked harts that have a pending interrupt (e.g. one
+    /// posted by a poke) runnable placing them in the queue of the
+    /// given worker. Must be called with mutex_ held.
+    void wakeInterrupted(unsigned ix);
+
+  private:
+
+    struct Worker
+    {
+      std::mutex mutex_;
+      std::deque<unsigned> queue_;
+    };
+
+    std::vector<Core<URV>*>& cores_;
+    std::vector<Worker> workers_;
+    uint64_t quantum_;
+    bool pin_;
+
+    std::mutex mutex_;              // Protects fields below.
+    std::condition_variable cv_;
+    std::vector<unsigned> parked_;  // Descheduled harts.
+    size_t active_ = 0;             // Harts not done yet.
+    bool ok_ = true;
+  };
+}
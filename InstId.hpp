@@ -95,10 +95,31 @@ namespace WdRiscv
       c_ebreak, c_jalr, c_add, c_fsdsp, c_swsp, c_fswsp,
       c_addiw, c_sdsp,
 
-      // zbmini
-      clz, ctz, pcnt, andc, slo, sro, sloi, sroi, min, max, minu, maxu,
-      rol, ror, rori, bswap, brev, pack,
-
-      maxId = pack
+      // Vector: Loads/stores by width, arithmetic by operand category.
+      vsetvli, vsetivli, vsetvl, vle8_v, vle16_v, vle32_v, vle64_v,
+      vle8ff_v, vle16ff_v, vle32ff_v, vle64ff_v, vlm_v, vlre8_v, vlre16_v,
+      vlre32_v, vlre64_v, vlse8_v, vlse16_v, vlse32_v, vlse64_v, vluxei8_v,
+      vluxei16_v, vluxei32_v, vluxei64_v, vloxei8_v, vloxei16_v, vloxei32_v,
+      vloxei64_v, vse8_v, vse16_v, vse32_v, vse64_v, vsm_v, vsr_v, vsse8_v,
+      vsse16_v, vsse32_v, vsse64_v, vsuxei8_v, vsuxei16_v, vsuxei32_v,
+      vsuxei64_v, vsoxei8_v, vsoxei16_v, vsoxei32_v, vsoxei64_v, opivv,
+      opfvv, opmvv, opivi, opivx, opfvf, opmvx,
+
+      // zba
+      add_uw, sh1add, sh1add_uw, sh2add, sh2add_uw, sh3add, sh3add_uw,
+      slli_uw,
+
+      // zbb
+      andn, orn, xnor, clz, clzw, ctz, ctzw, cpop, cpopw, max, maxu, min,
+      minu, sext_b, sext_h, zext_h, rol, rolw, ror, rori, roriw, rorw,
+      orc_b, rev8,
+
+      // zbc
+      clmul, clmulh, clmulr,
+
+      // zbs
+      bclr, bclri, bext, bexti, binv, binvi, bset, bseti,
+
+      maxId = bseti
     };
 }
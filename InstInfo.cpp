@@ -16,7 +16,10 @@
 // this program. If not, see <https://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <map>
 #include "InstInfo.hpp"
+#include "instforms.hpp"
 
 using namespace WdRiscv;
 
@@ -59,6 +62,30 @@ InstInfoTable::InstInfoTable()
   instVec_.at(size_t(InstId::mulhu)).setIsUnsigned(true);
   instVec_.at(size_t(InstId::divu)).setIsUnsigned(true);
   instVec_.at(size_t(InstId::remu)).setIsUnsigned(true);
+
+  // Mark instructions that exist only in RV64.
+  for (auto id : { InstId::lwu, InstId::ld, InstId::sd, InstId::addiw,
+	InstId::slliw, InstId::srliw, InstId::sraiw, InstId::addw,
+	InstId::subw, InstId::sllw, InstId::srlw, InstId::sraw,
+	InstId::mulw, InstId::divw, InstId::divuw, InstId::remw,
+	InstId::remuw, InstId::lr_d, InstId::sc_d, InstId::amoswap_d,
+	InstId::amoadd_d, InstId::amoxor_d, InstId::amoand_d,
+	InstId::amoor_d, InstId::amomin_d, InstId::amomax_d,
+	InstId::amominu_d, InstId::amomaxu_d, InstId::fcvt_l_s,
+	InstId::fcvt_lu_s, InstId::fcvt_s_l, InstId::fcvt_s_lu,
+	InstId::fcvt_l_d, InstId::fcvt_lu_d, InstId::fmv_x_d,
+	InstId::fcvt_d_l, InstId::fcvt_d_lu, InstId::fmv_d_x,
+	InstId::add_uw, InstId::sh1add_uw, InstId::sh2add_uw,
+	InstId::sh3add_uw, InstId::slli_uw, InstId::clzw, InstId::ctzw,
+	InstId::cpopw, InstId::rolw, InstId::roriw, InstId::rorw } )
+    instVec_.at(size_t(id)).setIsRv64Only(true);
+
+  // Instructions encoded differently in RV64 (setupInstVec has the
+  // RV32 code).
+  instVec_.at(size_t(InstId::zext_h)).setRv64Code(0x0800403b);
+  instVec_.at(size_t(InstId::rev8)).setRv64Code(0x6b805013);
+
+  setupDecodeIndex();
 }
 
 
@@ -82,6 +109,228 @@ InstInfoTable::getInstInfo(const std::string& name) const
 }
 
 
+bool
+InstInfoTable::hasInfo(InstId id) const
+{
+  return size_t(id) < instVec_.size();
+}
+
+
+bool
+InstInfoTable::hasInfo(const std::string& name) const
+{
+  return instMap_.count(name) != 0;
+}
+
+
+const InstInfo&
+InstInfoTable::decode32(uint32_t inst, bool rv64, uint32_t& op0, uint32_t& op1,
+			int32_t& op2, int32_t& op3) const
+{
+  // The candidates of a bucket end with a match-all illegal entry
+  // (which also catches the compressed instructions).
+  const DecodeEntry* entry = &entries_[decodeIndex_[rv64][decodeKey(inst)]];
+  while ((inst & entry->mask_) != entry->code_)
+    ++entry;
+
+  uint32_t rd = (inst >> 7) & 0x1f, rs1 = (inst >> 15) & 0x1f;
+  uint32_t rs2 = (inst >> 20) & 0x1f, rs3 = inst >> 27;
+
+  switch (entry->format_)
+    {
+    case DecodeFormat::Fields:
+      op0 = (inst & entry->opMask_[0]) >> entry->shift_[0];
+      op1 = (inst & entry->opMask_[1]) >> entry->shift_[1];
+      op2 = (inst & entry->opMask_[2]) >> entry->shift_[2];
+      op3 = (inst & entry->opMask_[3]) >> entry->shift_[3];
+      break;
+    case DecodeFormat::R2:
+      op0 = rd; op1 = rs1; op2 = 0; op3 = 0;
+      break;
+    case DecodeFormat::R:
+      op0 = rd; op1 = rs1; op2 = rs2; op3 = 0;
+      break;
+    case DecodeFormat::R4:
+      op0 = rd; op1 = rs1; op2 = rs2; op3 = rs3;
+      break;
+    case DecodeFormat::I:
+      op0 = rd; op1 = rs1; op2 = IFormInst(inst).immed(); op3 = 0;
+      break;
+    case DecodeFormat::S:
+      op0 = rs1; op1 = rs2; op2 = SFormInst(inst).immed(); op3 = 0;
+      break;
+    case DecodeFormat::B:
+      op0 = rs1; op1 = rs2; op2 = BFormInst(inst).immed(); op3 = 0;
+      break;
+    case DecodeFormat::U:
+      op0 = rd; op1 = UFormInst(inst).immed(); op2 = 0; op3 = 0;
+      break;
+    case DecodeFormat::J:
+      op0 = rd; op1 = JFormInst(inst).immed(); op2 = 0; op3 = 0;
+      break;
+    }
+
+  return instVec_[size_t(entry->id_)];
+}
+
+
+InstInfoTable::DecodeFormat
+InstInfoTable::decodeFormat(const InstInfo& info)
+{
+  // Operand masks of each format. Format with an immediate with
+  // scattered or sign extended bits: Index of that operand.
+  struct Layout
+  {
+    DecodeFormat format;
+    uint32_t masks[4];
+    unsigned immIx;
+  };
+
+  uint32_t rd = 0x1f << 7, rs1 = 0x1f << 15, rs2 = 0x1f << 20;
+  uint32_t rs3 = 0x1f << 27;
+
+  const Layout layouts[] = {
+    { DecodeFormat::R2, { rd, rs1, 0, 0 }, 0 },
+    { DecodeFormat::R,  { rd, rs1, rs2, 0 }, 0 },
+    { DecodeFormat::R4, { rd, rs1, rs2, rs3 }, 0 },
+    { DecodeFormat::I,  { rd, rs1, 0xfff00000, 0 }, 2 },
+    { DecodeFormat::S,  { rs1, rs2, 0xfe000f80, 0 }, 2 },
+    { DecodeFormat::U,  { rd, 0xfffff000, 0, 0 }, 1 }
+  };
+
+  unsigned opcode = (info.code() >> 2) & 0x1f;
+
+  for (const auto& layout : layouts)
+    {
+      bool match = true;
+      for (unsigned k = 0; k < 4 and match; ++k)
+	{
+	  OperandType type = info.ithOperandType(k);
+	  uint32_t mask = type == OperandType::None ? 0 : info.ithOperandMask(k);
+	  match = mask == layout.masks[k];
+	  if (layout.immIx and k == layout.immIx)
+	    match = match and type == OperandType::Imm;
+	}
+      if (not match)
+	continue;
+
+      // Branches and jal scatter the immediate bits differently.
+      if (layout.format == DecodeFormat::S and opcode == 0x18)
+	return DecodeFormat::B;
+      if (layout.format == DecodeFormat::U and opcode == 0x1b)
+	return DecodeFormat::J;
+      return layout.format;
+    }
+
+  return DecodeFormat::Fields;
+}
+
+
+void
+InstInfoTable::setupDecodeIndex()
+{
+  // Candidates of RV32 (0) and RV64 (1) collected by major opcode.
+  std::vector<std::vector<DecodeEntry>> byOpcode[2];
+  byOpcode[0].resize(32);
+  byOpcode[1].resize(32);
+
+  for (const auto& info : instVec_)
+    {
+      uint32_t code = info.code(), mask = info.codeMask();
+      if (info.instId() == InstId::illegal or not isFullSizeInst(code))
+	continue;
+
+      unsigned opcode = (code >> 2) & 0x1f;
+
+      DecodeEntry entry;
+      entry.code_ = code;
+      entry.mask_ = mask;
+      entry.id_ = info.instId();
+
+      unsigned shamtIx = 0;  // Index of shift amount operand (if any).
+      for (unsigned k = 0; k < 4; ++k)
+	{
+	  if (info.ithOperandType(k) == OperandType::None)
+	    continue;
+
+	  uint32_t opMask = info.ithOperandMask(k);
+	  entry.opMask_[k] = opMask;
+	  if (opMask)
+	    entry.shift_[k] = __builtin_ctz(opMask);
+	  if (info.ithOperandType(k) == OperandType::Imm and
+	      opMask == 0x01f00000 and opcode == 0x04)
+	    shamtIx = k;
+	}
+
+      entry.format_ = decodeFormat(info);
+
+      if (not info.isRv64Only())
+	byOpcode[0].at(opcode).push_back(entry);
+
+      // Shift amount of slli/srli/... includes bit 25 in RV64.
+      if (shamtIx)
+	{
+	  entry.mask_ &= ~uint32_t(0x02000000);
+	  entry.opMask_[shamtIx] = 0x03f00000;
+	  entry.format_ = DecodeFormat::Fields;
+	}
+      if (info.rv64Code())
+	{
+	  entry.code_ = info.rv64Code();
+	  opcode = (entry.code_ >> 2) & 0x1f;
+	}
+      byOpcode[1].at(opcode).push_back(entry);
+    }
+
+  entries_.clear();
+
+  // Match-all entry ending a bucket.
+  const DecodeEntry illegal;
+
+  for (unsigned rv64 = 0; rv64 < 2; ++rv64)
+    {
+      // Most specific (more code bits) candidates first.
+      for (auto& cands : byOpcode[rv64])
+	std::stable_sort(cands.begin(), cands.end(),
+			 [] (const DecodeEntry& a, const DecodeEntry& b) {
+			   return (__builtin_popcount(a.mask_) >
+				   __builtin_popcount(b.mask_));
+			 });
+
+      // Keys with the same candidates share a bucket.
+      std::map<std::vector<InstId>, uint16_t> buckets;
+
+      auto& index = decodeIndex_[rv64];
+      index.assign(size_t(1) << decodeKeyBits, 0);
+      for (uint32_t key = 0; key < index.size(); ++key)
+	{
+	  // Instruction with the opcode/funct3/funct7 of the key.
+	  uint32_t inst = 3 | ((key & 0x1f) << 2) | (((key >> 5) & 7) << 12) |
+	    ((key >> 8) << 25);
+	  const uint32_t keyMask = 0xfe00707f;
+
+	  std::vector<DecodeEntry> bucket;
+	  std::vector<InstId> ids;
+	  for (const auto& cand : byOpcode[rv64].at(key & 0x1f))
+	    if (((inst ^ cand.code_) & cand.mask_ & keyMask) == 0)
+	      {
+		bucket.push_back(cand);
+		ids.push_back(cand.id_);
+	      }
+
+	  auto iter = buckets.find(ids);
+	  if (iter == buckets.end())
+	    {
+	      iter = buckets.emplace(ids, uint16_t(entries_.size())).first;
+	      entries_.insert(entries_.end(), bucket.begin(), bucket.end());
+	      entries_.push_back(illegal);
+	    }
+	  index.at(key) = iter->second;
+	}
+    }
+}
+
+
 void
 InstInfoTable::setupInstVec()
 {
@@ -89,7 +338,7 @@ InstInfoTable::setupInstVec()
   uint32_t rs1Mask = 0x1f << 15;
   uint32_t rs2Mask = 0x1f << 20;
   uint32_t rs3Mask = 0x1f << 27;
-  uint32_t immTop20 = 0xffff << 12;  // Immidiate: top 20 bits.
+  uint32_t immTop20 = 0xfffff << 12; // Immidiate: top 20 bits.
   uint32_t immTop12 = 0xfff << 20;   // Immidiate: top 12 bits.
   uint32_t immBeq = 0xfe000f80;
   uint32_t shamtMask = 0x01f00000;
@@ -538,55 +787,55 @@ InstInfoTable::setupInstVec()
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoswap.w", InstId::amoswap_w, 0x0800202f, 0xf800070f,
+      { "amoswap.w", InstId::amoswap_w, 0x0800202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoadd.w", InstId::amoadd_w, 0x0000202f, 0xf800070f,
+      { "amoadd.w", InstId::amoadd_w, 0x0000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoxor.w", InstId::amoxor_w, 0x2000202f, 0xf800070f,
+      { "amoxor.w", InstId::amoxor_w, 0x2000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoand.w", InstId::amoand_w, 0x6000202f, 0xf800070f,
+      { "amoand.w", InstId::amoand_w, 0x6000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoor.w", InstId::amoor_w, 0x4000202f, 0xf800070f,
+      { "amoor.w", InstId::amoor_w, 0x4000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amomin.w", InstId::amomin_w, 0x8000202f, 0xf800070f,
+      { "amomin.w", InstId::amomin_w, 0x8000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amomax.w", InstId::amomax_w, 0xa000202f, 0xf800070f,
+      { "amomax.w", InstId::amomax_w, 0xa000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amominu.w", InstId::amominu_w, 0xc000202f, 0xf800070f,
+      { "amominu.w", InstId::amominu_w, 0xc000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amomaxu.w", InstId::amomaxu_w, 0xe000202f, 0xf800070f,
+      { "amomaxu.w", InstId::amomaxu_w, 0xe000202f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
@@ -604,55 +853,55 @@ InstInfoTable::setupInstVec()
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoswap.d", InstId::amoswap_d, 0x0800302f, 0xf800070f,
+      { "amoswap.d", InstId::amoswap_d, 0x0800302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoadd.d", InstId::amoadd_d, 0x0000302f, 0xf800070f,
+      { "amoadd.d", InstId::amoadd_d, 0x0000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoxor.d", InstId::amoxor_d, 0x2000302f, 0xf800070f,
+      { "amoxor.d", InstId::amoxor_d, 0x2000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoand.d", InstId::amoand_d, 0x6000302f, 0xf800070f,
+      { "amoand.d", InstId::amoand_d, 0x6000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amoor.d", InstId::amoor_d, 0x4000302f, 0xf800070f,
+      { "amoor.d", InstId::amoor_d, 0x4000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amomin.d", InstId::amomin_d, 0x8000302f, 0xf800070f,
+      { "amomin.d", InstId::amomin_d, 0x8000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amomax.d", InstId::amomax_d, 0xa000302f, 0xf800070f,
+      { "amomax.d", InstId::amomax_d, 0xa000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amominu.d", InstId::amominu_d, 0xc000302f, 0xf800070f,
+      { "amominu.d", InstId::amominu_d, 0xc000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "amomaxu.d", InstId::amomaxu_d, 0xe000302f, 0xf800070f,
+      { "amomaxu.d", InstId::amomaxu_d, 0xe000302f, 0xf800707f,
 	InstType::Atomic,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
@@ -760,15 +1009,15 @@ InstInfoTable::setupInstVec()
 
       { "fcvt.w.s", InstId::fcvt_w_s, 0xc0000053, fsqrtMask,
 	InstType::Fp,
-	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.wu.s", InstId::fcvt_wu_s, 0xc0100053, fsqrtMask,
 	InstType::Fp,
-	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
 
-      { "fmv.x.w", InstId::fmv_x_w, 0xe0900053, 0xfff1c07f,
+      { "fmv.x.w", InstId::fmv_x_w, 0xe0000053, 0xfff0707f,
 	InstType::Fp,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
@@ -791,22 +1040,22 @@ InstInfoTable::setupInstVec()
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
 	OperandType::FpReg, OperandMode::Read, rs2Mask },
 
-      { "fclass.s", InstId::fclass_s, 0xe0001053, 0xfff1c07f,
+      { "fclass.s", InstId::fclass_s, 0xe0001053, 0xfff0707f,
 	InstType::Fp,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.s.w", InstId::fcvt_s_w, 0xd0000053, fsqrtMask,
 	InstType::Fp,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.s.wu", InstId::fcvt_s_wu, 0xd0100053, fsqrtMask,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
-      { "fmv.w.x", InstId::fmv_w_x, 0xf0000053, 0xfff1c07f,
+      { "fmv.w.x", InstId::fmv_w_x, 0xf0000053, 0xfff0707f,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask },
@@ -824,8 +1073,8 @@ InstInfoTable::setupInstVec()
 
       { "fcvt.s.l", InstId::fcvt_s_l, 0xd0200053, 0xfff0007f,
 	InstType::Fp,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.s.lu", InstId::fcvt_s_lu, 0xd0300053, 0xfff0007f,
 	InstType::Fp,
@@ -891,13 +1140,13 @@ InstInfoTable::setupInstVec()
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
 	OperandType::FpReg, OperandMode::Read, rs2Mask },
 
-      { "fdiv.d", InstId::fdiv_d, 0x1b000053, faddMask,
+      { "fdiv.d", InstId::fdiv_d, 0x1a000053, faddMask,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
 	OperandType::FpReg, OperandMode::Read, rs2Mask },
 
-      { "fsqrt.d", InstId::fsqrt_d, 0x5b000053, fsqrtMask,
+      { "fsqrt.d", InstId::fsqrt_d, 0x5a000053, fsqrtMask,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
@@ -920,13 +1169,13 @@ InstInfoTable::setupInstVec()
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
 	OperandType::FpReg, OperandMode::Read, rs2Mask },
 
-      { "fmin.d", InstId::fmin_d, 0x2b000053, top7Funct3Low7Mask,
+      { "fmin.d", InstId::fmin_d, 0x2a000053, top7Funct3Low7Mask,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
 	OperandType::FpReg, OperandMode::Read, rs2Mask },
 
-      { "fmax.d", InstId::fmax_d, 0x2b001053, top7Funct3Low7Mask,
+      { "fmax.d", InstId::fmax_d, 0x2a001053, top7Funct3Low7Mask,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
@@ -960,30 +1209,30 @@ InstInfoTable::setupInstVec()
 	OperandType::FpReg, OperandMode::Read, rs1Mask,
 	OperandType::FpReg, OperandMode::Read, rs2Mask },
 
-      { "fclass.d", InstId::fclass_d, 0xe2001053, 0xfff1c07f,
+      { "fclass.d", InstId::fclass_d, 0xe2001053, 0xfff0707f,
 	InstType::Fp,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
 
-      { "fcvt.w.d", InstId::fcvt_w_d, 0xf2000053, 0xfff1c07f,
+      { "fcvt.w.d", InstId::fcvt_w_d, 0xc2000053, fsqrtMask,
 	InstType::Fp,
-	OperandType::FpReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask },
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::FpReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.wu.d", InstId::fcvt_wu_d, 0xc2100053, fsqrtMask,
 	InstType::Fp,
-	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::FpReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.d.w", InstId::fcvt_d_w, 0xd2000053, fsqrtMask,
 	InstType::Fp,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.d.wu", InstId::fcvt_d_wu, 0xd2100053, fsqrtMask,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
       // rv64f + rv32d
       { "fcvt.l.d", InstId::fcvt_l_d, 0xc2200053, 0xfff0007f,
@@ -1003,24 +1252,24 @@ InstInfoTable::setupInstVec()
 
       { "fcvt.d.l", InstId::fcvt_d_l, 0xd2200053, 0xfff0007f,
 	InstType::Fp,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
       { "fcvt.d.lu", InstId::fcvt_d_lu, 0xd2300053, 0xfff0007f,
 	InstType::Fp,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::FpReg, OperandMode::Read, rs1Mask },
+	OperandType::FpReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
-      { "fmv.d.x", InstId::fmv_d_x, 0xef000053, 0xfff0707f,
+      { "fmv.d.x", InstId::fmv_d_x, 0xf2000053, 0xfff0707f,
 	InstType::Fp,
 	OperandType::FpReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
       // Privileged
-      { "mret", InstId::mret, 0x30100073, 0xffffffff, InstType::Int },
-      { "uret", InstId::uret, 0x00100073, 0xffffffff, InstType::Int },
-      { "sret", InstId::sret, 0x10100073, 0xffffffff, InstType::Int },
-      { "wfi", InstId::wfi, 0x10280073, 0xffffffff, InstType::Int },
+      { "mret", InstId::mret, 0x30200073, 0xffffffff, InstType::Int },
+      { "uret", InstId::uret, 0x00200073, 0xffffffff, InstType::Int },
+      { "sret", InstId::sret, 0x10200073, 0xffffffff, InstType::Int },
+      { "wfi", InstId::wfi, 0x10500073, 0xffffffff, InstType::Int },
 
       // Compressed insts. The operand bits are "swizzled" and the
       // operand masks are not used for obtaining operands. We set the
@@ -1294,92 +1543,551 @@ InstInfoTable::setupInstVec()
 	OperandType::IntReg, OperandMode::Read, 0,
 	OperandType::Imm, OperandMode::None, 0 },
 
-      { "clz", InstId::clz, 0xc0001013, 0xfff0707f,
-	InstType::Int,
+      { "vsetvli", InstId::vsetvli, 0x00007057, 0x8000707f,
+	InstType::Vector,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, 0x7ff00000 },
+
+      { "vsetivli", InstId::vsetivli, 0xc0007057, 0xc000707f,
+	InstType::Vector,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::Imm, OperandMode::None, rs1Mask,
+	OperandType::Imm, OperandMode::None, 0x3ff00000 },
+
+      { "vsetvl", InstId::vsetvl, 0x80007057, 0xfe00707f,
+	InstType::Vector,
 	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vle8.v", InstId::vle8_v, 0x00000007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
-      { "ctz", InstId::ctz, 0xc0101013, 0xfff0707f,
-	InstType::Int,
+      { "vle16.v", InstId::vle16_v, 0x00005007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vle32.v", InstId::vle32_v, 0x00006007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vle64.v", InstId::vle64_v, 0x00007007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vle8ff.v", InstId::vle8ff_v, 0x01000007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vle16ff.v", InstId::vle16ff_v, 0x01005007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vle32ff.v", InstId::vle32ff_v, 0x01006007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vle64ff.v", InstId::vle64ff_v, 0x01007007, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vlm.v", InstId::vlm_v, 0x02b00007, 0xfff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vlre8.v", InstId::vlre8_v, 0x02800007, 0x1ff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vlre16.v", InstId::vlre16_v, 0x02805007, 0x1ff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vlre32.v", InstId::vlre32_v, 0x02806007, 0x1ff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vlre64.v", InstId::vlre64_v, 0x02807007, 0x1ff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vlse8.v", InstId::vlse8_v, 0x08000007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vlse16.v", InstId::vlse16_v, 0x08005007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vlse32.v", InstId::vlse32_v, 0x08006007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vlse64.v", InstId::vlse64_v, 0x08007007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vluxei8.v", InstId::vluxei8_v, 0x04000007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vluxei16.v", InstId::vluxei16_v, 0x04005007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vluxei32.v", InstId::vluxei32_v, 0x04006007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vluxei64.v", InstId::vluxei64_v, 0x04007007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vloxei8.v", InstId::vloxei8_v, 0x0c000007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vloxei16.v", InstId::vloxei16_v, 0x0c005007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vloxei32.v", InstId::vloxei32_v, 0x0c006007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vloxei64.v", InstId::vloxei64_v, 0x0c007007, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vse8.v", InstId::vse8_v, 0x00000027, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vse16.v", InstId::vse16_v, 0x00005027, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vse32.v", InstId::vse32_v, 0x00006027, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vse64.v", InstId::vse64_v, 0x00007027, 0xfdf0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vsm.v", InstId::vsm_v, 0x02b00027, 0xfff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vsr.v", InstId::vsr_v, 0x02800027, 0x1ff0707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "vsse8.v", InstId::vsse8_v, 0x08000027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vsse16.v", InstId::vsse16_v, 0x08005027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vsse32.v", InstId::vsse32_v, 0x08006027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vsse64.v", InstId::vsse64_v, 0x08007027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "vsuxei8.v", InstId::vsuxei8_v, 0x04000027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsuxei16.v", InstId::vsuxei16_v, 0x04005027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsuxei32.v", InstId::vsuxei32_v, 0x04006027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsuxei64.v", InstId::vsuxei64_v, 0x04007027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsoxei8.v", InstId::vsoxei8_v, 0x0c000027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsoxei16.v", InstId::vsoxei16_v, 0x0c005027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsoxei32.v", InstId::vsoxei32_v, 0x0c006027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "vsoxei64.v", InstId::vsoxei64_v, 0x0c007027, 0xfc00707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Read, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask },
+
+      { "opivv", InstId::opivv, 0x00000057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::VecReg, OperandMode::Read, rs1Mask },
+
+      { "opfvv", InstId::opfvv, 0x00001057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::VecReg, OperandMode::Read, rs1Mask },
+
+      { "opmvv", InstId::opmvv, 0x00002057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::VecReg, OperandMode::Read, rs1Mask },
+
+      { "opivi", InstId::opivi, 0x00003057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::Imm, OperandMode::None, rs1Mask },
+
+      { "opivx", InstId::opivx, 0x00004057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "opfvf", InstId::opfvf, 0x00005057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::FpReg, OperandMode::Read, rs1Mask },
+
+      { "opmvx", InstId::opmvx, 0x00006057, 0x0000707f,
+	InstType::Vector,
+	OperandType::VecReg, OperandMode::Write, rdMask,
+	OperandType::VecReg, OperandMode::Read, rs2Mask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "add.uw", InstId::add_uw, 0x0800003b, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "sh1add", InstId::sh1add, 0x20002033, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "sh1add.uw", InstId::sh1add_uw, 0x2000203b, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "sh2add", InstId::sh2add, 0x20004033, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "sh2add.uw", InstId::sh2add_uw, 0x2000403b, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "sh3add", InstId::sh3add, 0x20006033, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "sh3add.uw", InstId::sh3add_uw, 0x2000603b, top7Funct3Low7Mask,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "slli.uw", InstId::slli_uw, 0x0800101b, 0xfc00707f,
+	InstType::Zba,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, 0x03f00000 },
+
+      { "andn", InstId::andn, 0x40007033, top7Funct3Low7Mask,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "orn", InstId::orn, 0x40006033, top7Funct3Low7Mask,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "xnor", InstId::xnor, 0x40004033, top7Funct3Low7Mask,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "clz", InstId::clz, 0x60001013, 0xfff0707f,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
-      { "pcnt", InstId::pcnt, 0xc0201013, 0xfff0707f,
-	InstType::Int,
+      { "clzw", InstId::clzw, 0x6000101b, 0xfff0707f,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask },
 
-      { "andc", InstId::andc, 0x400070b3, top7Funct3Low7Mask,
-	InstType::Int,
+      { "ctz", InstId::ctz, 0x60101013, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "ctzw", InstId::ctzw, 0x6010101b, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "cpop", InstId::cpop, 0x60201013, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "cpopw", InstId::cpopw, 0x6020101b, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "max", InstId::max, 0x0a006033, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "slo", InstId::slo, 0x20001033, top7Funct3Low7Mask,
-	InstType::Int,
+      { "maxu", InstId::maxu, 0x0a007033, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "sro", InstId::sro, 0x20005033, top7Funct3Low7Mask,
-	InstType::Int,
+      { "min", InstId::min, 0x0a004033, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "sloi", InstId::sloi, 0x20001013, 0xf800707f,
-	InstType::Int,
+      { "minu", InstId::minu, 0x0a005033, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "sroi", InstId::sroi, 0x20005013, 0xf800707f,
-	InstType::Int,
+      { "sext.b", InstId::sext_b, 0x60401013, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "sext.h", InstId::sext_h, 0x60501013, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "zext.h", InstId::zext_h, 0x08004033, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "rol", InstId::rol, 0x60001033, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "min", InstId::min, 0x0a004033, top7Funct3Low7Mask,
-	InstType::Int,
+      { "rolw", InstId::rolw, 0x6000103b, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "max", InstId::max, 0x0a005033, top7Funct3Low7Mask,
-	InstType::Int,
+      { "ror", InstId::ror, 0x60005033, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "minu", InstId::minu, 0x0a006033, top7Funct3Low7Mask,
-	InstType::Int,
+      { "rori", InstId::rori, 0x60005013, top7Funct3Low7Mask,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, shamtMask },
+
+      { "roriw", InstId::roriw, 0x6000501b, top7Funct3Low7Mask,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, shamtMask },
+
+      { "rorw", InstId::rorw, 0x6000503b, top7Funct3Low7Mask,
+	InstType::Zbb,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "maxu", InstId::maxu, 0x0a007033, top7Funct3Low7Mask,
-	InstType::Int,
+      { "orc.b", InstId::orc_b, 0x28705013, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "rev8", InstId::rev8, 0x69805013, 0xfff0707f,
+	InstType::Zbb,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask },
+
+      { "clmul", InstId::clmul, 0x0a001033, top7Funct3Low7Mask,
+	InstType::Zbc,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "rol", InstId::rol, 0x60001023, top7Funct3Low7Mask,
-	InstType::Int,
+      { "clmulh", InstId::clmulh, 0x0a003033, top7Funct3Low7Mask,
+	InstType::Zbc,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "ror", InstId::ror, 0x60005023, top7Funct3Low7Mask,
-	InstType::Int,
+      { "clmulr", InstId::clmulr, 0x0a002033, top7Funct3Low7Mask,
+	InstType::Zbc,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
-      { "rori", InstId::rori, 0x60005023, 0xf800707f,
-	InstType::Int,
+      { "bclr", InstId::bclr, 0x48001033, top7Funct3Low7Mask,
+	InstType::Zbs,
 	OperandType::IntReg, OperandMode::Write, rdMask,
 	OperandType::IntReg, OperandMode::Read, rs1Mask,
 	OperandType::IntReg, OperandMode::Read, rs2Mask },
 
+      { "bclri", InstId::bclri, 0x48001013, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, shamtMask },
+
+      { "bext", InstId::bext, 0x48005033, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "bexti", InstId::bexti, 0x48005013, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, shamtMask },
+
+      { "binv", InstId::binv, 0x68001033, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "binvi", InstId::binvi, 0x68001013, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, shamtMask },
+
+      { "bset", InstId::bset, 0x28001033, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::IntReg, OperandMode::Read, rs2Mask },
+
+      { "bseti", InstId::bseti, 0x28001013, top7Funct3Low7Mask,
+	InstType::Zbs,
+	OperandType::IntReg, OperandMode::Write, rdMask,
+	OperandType::IntReg, OperandMode::Read, rs1Mask,
+	OperandType::Imm, OperandMode::None, shamtMask },
+
     };
 }
@@ -27,10 +27,10 @@
 namespace WdRiscv
 {
 
-  enum class OperandType { IntReg, FpReg, CsReg, Imm, None };
+  enum class OperandType { IntReg, FpReg, CsReg, VecReg, Imm, None };
   enum class OperandMode { Read, Write, ReadWrite, None };
   enum class InstType { Load, Store, Multiply, Divide, Branch, Int, Fp,
-			Csr, Atomic };
+			Csr, Atomic, Vector, Zba, Zbb, Zbc, Zbs };
 
   /// Return true if given instruction is a 4-byte instruction.
   inline bool
@@ -193,12 +193,30 @@ namespace WdRiscv
     bool isUnsigned() const
     { return isUns_; }
 
+    /// Return true if this instruction exists only in RV64 (ld, addw ...)
+    bool isRv64Only() const
+    { return isRv64Only_; }
+
+    /// Return the code of this instruction in RV64 if different from
+    /// the RV32 code returned by code() (zext.h, rev8 ...) and zero
+    /// otherwise.
+    uint32_t rv64Code() const
+    { return rv64Code_; }
+
   protected:
 
     /// Mark instruction as having unsigned source operands.
     void setIsUnsigned(bool flag)
     { isUns_ = flag; }
 
+    /// Mark instruction as existing only in RV64.
+    void setIsRv64Only(bool flag)
+    { isRv64Only_ = flag; }
+
+    /// Set the RV64 code of an instruction encoded differently in RV64.
+    void setRv64Code(uint32_t code)
+    { rv64Code_ = code; }
+
   private:
 
     std::string name_;
@@ -225,6 +243,8 @@ namespace WdRiscv
 
     unsigned opCount_;
     bool isUns_ = false;
+    bool isRv64Only_ = false;
+    uint32_t rv64Code_ = 0;  // Code in RV64 if different from code_.
   };
 
 
@@ -249,14 +269,68 @@ namespace WdRiscv
     // Return true if given instance name is present in the table.
     bool hasInfo(const std::string& name) const;
 
+    // Decode the given 32-bit instruction (2 least significant bits
+    // set) returning the info of the matching instruction (the
+    // illegal instruction if none) and setting op0 to op3 to its
+    // operand values (zero for missing operands). Immediate values
+    // are sign extended as required by the instruction format. RV64
+    // shift amounts and RV64-only instructions are recognized only if
+    // rv64 is true.
+    const InstInfo& decode32(uint32_t inst, bool rv64, uint32_t& op0,
+			     uint32_t& op1, int32_t& op2, int32_t& op3) const;
+
   private:
 
     // Helper to the constructor.
     void setupInstVec();
 
+    // Helper to the constructor: Build the decode index from the
+    // code/mask pairs of the 32-bit instructions.
+    void setupDecodeIndex();
+
+    // How the operand values are obtained from the instruction bits:
+    // Fields uses the operand masks of the decode entry, the other
+    // formats have fixed operand positions (rd, rs1, rs2 and rs3) and
+    // sign extended (I) or scattered (S, B, U and J) immediates.
+    enum class DecodeFormat : uint8_t { Fields, R2, R, R4, I, S, B, U, J };
+
+    // Decode index candidate: Instruction matches if its bits masked
+    // by mask_ are equal to code_. A bucket of candidates ends with
+    // an entry matching all instructions (zero mask) and decoding as
+    // illegal.
+    struct DecodeEntry
+    {
+      uint32_t code_ = 0;
+      uint32_t mask_ = 0;
+      InstId id_ = InstId::illegal;
+      DecodeFormat format_ = DecodeFormat::Fields;
+      uint32_t opMask_[4] = { 0, 0, 0, 0 };  // Field bits (zero if none).
+      uint8_t shift_[4] = { 0, 0, 0, 0 };    // Field position.
+    };
+
+    // Helper to setupDecodeIndex: Return the format of the operands
+    // of the given instruction.
+    static DecodeFormat decodeFormat(const InstInfo& info);
+
+    // Number of bits in a decode index key: Opcode (bits 6 to 2),
+    // funct3 and funct7.
+    static constexpr unsigned decodeKeyBits = 15;
+
+    // Return the decode index key of the given 32-bit instruction.
+    static unsigned decodeKey(uint32_t inst)
+    {
+      return ((inst >> 2) & 0x1f) | ((inst >> 7) & 0xe0) |
+	((inst >> 17) & 0x7f00);
+    }
+
   private:
 
     std::vector<InstInfo> instVec_;
     std::unordered_map<std::string, InstId> instMap_;
+
+    // Decode index of RV32 (0) and RV64 (1): Map a key to the first
+    // candidate of its bucket in entries_.
+    std::vector<uint16_t> decodeIndex_[2];
+    std::vector<DecodeEntry> entries_;      // Most specific first in a bucket.
   };
 }
@@ -0,0 +1,184 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+// 
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+// 
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+// 
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include "InstProfile.hpp"
+#include "InstInfo.hpp"
+
+
+using namespace WdRiscv;
+
+
+/// Add the elements of the source vector to the corresponding
+/// elements of the destination vector resizing the destination if
+/// it is smaller than the source.
+static void
+addVec(std::vector<uint64_t>& dest, const std::vector<uint64_t>& src)
+{
+  if (dest.size() < src.size())
+    dest.resize(src.size());
+  for (size_t i = 0; i < src.size(); ++i)
+    dest[i] += src[i];
+}
+
+
+void
+WdRiscv::mergeInstProfile(InstProfile& dest, const InstProfile& src)
+{
+  if (src.freq_ == 0)
+    return;
+
+  if (src.hasImm_)
+    {
+      if (dest.hasImm_)
+	{
+	  dest.minImm_ = std::min(dest.minImm_, src.minImm_);
+	  dest.maxImm_ = std::max(dest.maxImm_, src.maxImm_);
+	}
+      else
+	{
+	  dest.minImm_ = src.minImm_;
+	  dest.maxImm_ = src.maxImm_;
+	}
+      dest.hasImm_ = true;
+    }
+
+  dest.id_ = src.id_;
+  dest.freq_ += src.freq_;
+
+  addVec(dest.rd_, src.rd_);
+  addVec(dest.rs1_, src.rs1_);
+  addVec(dest.rs2_, src.rs2_);
+  addVec(dest.rs1Histo_, src.rs1Histo_);
+  addVec(dest.rs2Histo_, src.rs2Histo_);
+  addVec(dest.immHisto_, src.immHisto_);
+}
+
+
+// Bin labels of the signed/unsigned value histograms (see
+// addToSignedHistogram and addToUnsignedHistogram in Core.cpp).
+static const char* signedBins[] = { "<= -64k", "(-64k, -1k]", "(-1k, -16]",
+				    "(-16, -3]", "-2", "-1", "0", "1", "2",
+				    "(2, 16]", "(16, 1k]", "(1k, 64k]",
+				    "> 64k" };
+
+static const char* unsignedBins[] = { "0", "1", "2", "(2, 16]", "(16, 1k]",
+				      "(1k, 64k]", "> 64k" };
+
+
+/// Return a JSON object mapping bin label to count for the non-empty
+/// bins of the given histogram.
+static nlohmann::json
+histoToJson(const std::vector<uint64_t>& histo, bool isSigned)
+{
+  nlohmann::json js = nlohmann::json::object();
+
+  const char** labels = isSigned ? signedBins : unsignedBins;
+  size_t count = isSigned ? sizeof(signedBins)/sizeof(signedBins[0]) :
+    sizeof(unsignedBins)/sizeof(unsignedBins[0]);
+  count = std::min(count, histo.size());
+
+  for (size_t i = 0; i < count; ++i)
+    if (histo[i])
+      js[labels[i]] = histo[i];
+  return js;
+}
+
+
+/// Return a JSON object mapping register number to count for the
+/// non-zero entries of the given vector.
+static nlohmann::json
+regsToJson(const std::vector<uint64_t>& regs)
+{
+  nlohmann::json js = nlohmann::json::object();
+  for (size_t i = 0; i < regs.size(); ++i)
+    if (regs[i])
+      js[std::to_string(i)] = regs[i];
+  return js;
+}
+
+
+bool
+WdRiscv::printInstProfileJson(std::ostream& out,
+			      const std::vector<InstProfile>& profileVec,
+			      const InstInfoTable& instTable)
+{
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < profileVec.size(); ++i)
+    if (profileVec[i].freq_)
+      indices.push_back(i);
+
+  std::stable_sort(indices.begin(), indices.end(),
+		   [&profileVec] (size_t a, size_t b) {
+		     return profileVec[a].freq_ > profileVec[b].freq_;
+		   });
+
+  uint64_t total = 0;
+  nlohmann::json insts = nlohmann::json::array();
+
+  for (auto ix : indices)
+    {
+      const InstProfile& prof = profileVec[ix];
+      const InstInfo& info = instTable.getInstInfo(InstId(ix));
+      total += prof.freq_;
+
+      nlohmann::json item;
+      item["name"] = info.name();
+      item["freq"] = prof.freq_;
+
+      bool isSigned = not info.isUnsigned();
+
+      auto rd = regsToJson(prof.rd_);
+      if (not rd.empty())
+	item["rd"] = rd;
+
+      auto rs1 = regsToJson(prof.rs1_);
+      if (not rs1.empty())
+	{
+	  item["rs1"] = rs1;
+	  item["rs1_histogram"] = histoToJson(prof.rs1Histo_, isSigned);
+	}
+
+      auto rs2 = regsToJson(prof.rs2_);
+      if (not rs2.empty())
+	{
+	  item["rs2"] = rs2;
+	  item["rs2_histogram"] = histoToJson(prof.rs2Histo_, isSigned);
+	}
+
+      if (prof.hasImm_)
+	{
+	  nlohmann::json imm;
+	  imm["min"] = prof.minImm_;
+	  imm["max"] = prof.maxImm_;
+	  imm["histogram"] = histoToJson(prof.immHisto_, true);
+	  item["imm"] = imm;
+	}
+
+      insts.push_back(item);
+    }
+
+  nlohmann::json js;
+  js["total"] = total;
+  js["instructions"] = insts;
+
+  out << js.dump(2) << '\n';
+  return out.good();
+}
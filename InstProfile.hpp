@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <iosfwd>
 #include "InstId.hpp"
 
 
@@ -51,6 +52,23 @@ namespace WdRiscv
     int32_t minImm_ = 0;  // Minimum immediate operand value.
     int32_t maxImm_ = 0;  // Maximum immediate operand value.
   };
+
+
+  class InstInfoTable;
+
+  /// Add the counts and histograms of the source profile to those of
+  /// the destination profile. Destination vectors are resized as
+  /// needed.
+  void mergeInstProfile(InstProfile& dest, const InstProfile& src);
+
+  /// Print the given profile vector (indexed by instruction id) in
+  /// JSON format on the given stream. Instructions that were not
+  /// executed are skipped. Instructions are sorted by decreasing
+  /// frequency. Return true on success and false if the stream
+  /// becomes bad.
+  bool printInstProfileJson(std::ostream& out,
+			    const std::vector<InstProfile>& profileVec,
+			    const InstInfoTable& instTable);
 }
 
 
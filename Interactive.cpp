@@ -141,6 +141,166 @@ Interactive<URV>::stepCommand(Core<URV>& core, const std::string& /*line*/,
 }
 
 
+/// Return true if reverse execution is available in the given hart.
+/// Print an error message and return false otherwise.
+template <typename URV>
+static
+bool
+checkReverseExecution(Core<URV>& core, size_t hartCount)
+{
+  if (not core.hasSnapshots() or hartCount != 1)
+    {
+      std::cerr << "Error: Reverse execution requires a single hart and "
+		<< "a non-zero --snapshotperiod\n";
+      return false;
+    }
+  return true;
+}
+
+
+template <typename URV>
+bool
+Interactive<URV>::reverseStepCommand(Core<URV>& core, const std::string& line,
+				     const std::vector<std::string>& tokens)
+{
+  if (tokens.size() > 2)
+    {
+      std::cerr << "Invalid bs command: " << line << '\n';
+      std::cerr << "Expecting: bs [<n>]\n";
+      return false;
+    }
+
+  uint64_t count = 1;
+  if (tokens.size() == 2 and
+      not parseCmdLineNumber("instruction-count", tokens.at(1), count))
+    return false;
+
+  if (not checkReverseExecution(core, cores_.size()))
+    return false;
+
+  if (not core.reverseStep(count))
+    std::cerr << "Reached start of history: instruction "
+	      << core.getInstructionCount() << '\n';
+  return true;
+}
+
+
+template <typename URV>
+bool
+Interactive<URV>::reverseContinueCommand(Core<URV>& core,
+					 const std::string& line,
+					 const std::vector<std::string>& tokens)
+{
+  if (tokens.size() != 2)
+    {
+      std::cerr << "Invalid bc command: " << line << '\n';
+      std::cerr << "Expecting: bc <address>\n";
+      return false;
+    }
+
+  URV addr = 0;
+  if (not parseCmdLineNumber("address", tokens.at(1), addr))
+    return false;
+
+  if (not checkReverseExecution(core, cores_.size()))
+    return false;
+
+  bool hadBreakpoint = core.hasBreakpoint(addr);
+  core.addBreakpoint(addr);
+  bool found = core.reverseContinue();
+  if (not hadBreakpoint)
+    core.removeBreakpoint(addr);
+
+  if (not found)
+    std::cerr << "Reached start of history: instruction "
+	      << core.getInstructionCount() << '\n';
+  return true;
+}
+
+
+template <typename URV>
+bool
+Interactive<URV>::gotoCommand(Core<URV>& core, const std::string& line,
+			      const std::vector<std::string>& tokens)
+{
+  if (tokens.size() != 2)
+    {
+      std::cerr << "Invalid goto command: " << line << '\n';
+      std::cerr << "Expecting: goto <n>\n";
+      return false;
+    }
+
+  uint64_t count = 0;
+  if (not parseCmdLineNumber("instruction-count", tokens.at(1), count))
+    return false;
+
+  if (not checkReverseExecution(core, cores_.size()))
+    return false;
+
+  if (count < core.historyStart())
+    {
+      std::cerr << "Error: Instruction " << count << " precedes start of "
+		<< "history: instruction " << core.historyStart() << '\n';
+      return false;
+    }
+
+  if (not core.gotoInstruction(count))
+    std::cerr << "Program stopped at instruction "
+	      << core.getInstructionCount() << '\n';
+  return true;
+}
+
+
+template <typename URV>
+bool
+Interactive<URV>::whatIfCommand(Core<URV>& core, const std::string& line,
+				const std::vector<std::string>& tokens)
+{
+  if (tokens.size() == 2 and tokens.at(1) == "begin")
+    return core.whatIfBegin();
+
+  if (tokens.size() == 2 and tokens.at(1) == "end")
+    {
+      core.whatIfEnd();
+      return true;
+    }
+
+  if (tokens.size() != 3 or tokens.at(1) != "step")
+    {
+      std::cerr << "Invalid whatif command: " << line << '\n';
+      std::cerr << "Expecting: whatif begin, whatif step <inst> or "
+		<< "whatif end\n";
+      return false;
+    }
+
+  uint32_t inst = 0;
+  if (not parseCmdLineNumber("instruction", tokens.at(2), inst))
+    return false;
+
+  ChangeRecord record;
+  if (not core.whatIfStep(inst, record) and not core.inWhatIf())
+    return false;
+
+  std::cout << "pc: " << (boost::format("0x%x") % record.newPc);
+  if (record.hasException)
+    std::cout << " exception";
+  if (record.hasIntReg)
+    std::cout << " x" << record.intRegIx << ": "
+	      << (boost::format("0x%x") % record.intRegValue);
+  if (record.hasFpReg)
+    std::cout << " f" << record.fpRegIx << ": "
+	      << (boost::format("0x%x") % record.fpRegValue);
+  if (record.memSize)
+    std::cout << " m" << (boost::format("0x%x") % record.memAddr) << ": "
+	      << (boost::format("0x%x") % record.memValue);
+  for (size_t i = 0; i < record.csrIx.size(); ++i)
+    std::cout << " c" << (boost::format("0x%x") % unsigned(record.csrIx.at(i)))
+	      << ": " << (boost::format("0x%x") % record.csrValue.at(i));
+  std::cout << '\n';
+  return true;
+}
+
+
 template <typename URV>
 static
 void
@@ -158,6 +318,33 @@ peekAllFpRegs(Core<URV>& core)
 }
 
 
+/// Print the given vector register value most significant byte first.
+static
+void
+printVecReg(const std::vector<uint8_t>& bytes)
+{
+  std::cout << "0x";
+  for (auto iter = bytes.rbegin(); iter != bytes.rend(); ++iter)
+    std::cout << (boost::format("%02x") % unsigned(*iter));
+  std::cout << '\n';
+}
+
+
+template <typename URV>
+static
+void
+peekAllVecRegs(Core<URV>& core)
+{
+  std::vector<uint8_t> bytes;
+  for (unsigned i = 0; i < core.vecRegCount(); ++i)
+    if (core.peekVecReg(i, bytes))
+      {
+	std::cout << "v" << i << ": ";
+	printVecReg(bytes);
+      }
+}
+
+
 template <typename URV>
 static
 void
@@ -288,8 +475,8 @@ Interactive<URV>::peekCommand(Core<URV>& core, const std::string& line,
     {
       std::cerr << "Invalid peek command: " << line << '\n';
       std::cerr << "Expecting: peek <item> <addr>  or  peek pc  or  peek all\n";
-      std::cerr << "  Item is one of r, f, c, t or m for integer, floating point,\n";
-      std::cerr << "  CSR, trigger register or memory location respective\n";
+      std::cerr << "  Item is one of r, f, v, c, t or m for integer, floating point,\n";
+      std::cerr << "  vector, CSR, trigger register or memory location respective\n";
 
       std::cerr << "  example:  peek r x3\n";
       std::cerr << "  example:  peek c mtval\n";
@@ -413,6 +600,35 @@ Interactive<URV>::peekCommand(Core<URV>& core, const std::string& line,
       return false;
     }
 
+  if (resource == "v")
+    {
+      if (not core.isRvv())
+	{
+	  std::cerr << "Vector extension is no enabled\n";
+	  return false;
+	}
+
+      if (addrStr == "all")
+	{
+	  peekAllVecRegs(core);
+	  return true;
+	}
+
+      unsigned vecReg = 0;
+      std::string numStr = addrStr;
+      if (not numStr.empty() and numStr.at(0) == 'v')
+	numStr = numStr.substr(1);
+      std::vector<uint8_t> bytes;
+      if (parseCmdLineNumber("vector-register", numStr, vecReg) and
+	  core.peekVecReg(vecReg, bytes))
+	{
+	  printVecReg(bytes);
+	  return true;
+	}
+      std::cerr << "No such vector register: " << addrStr << '\n';
+      return false;
+    }
+
   if (resource == "c")
     {
       if (addrStr == "all")
@@ -460,7 +676,7 @@ Interactive<URV>::peekCommand(Core<URV>& core, const std::string& line,
     }
 
   std::cerr << "No such resource: " << resource
-	    << " -- expecting r, m, c, t, or pc\n";
+	    << " -- expecting r, f, v, m, c, t, or pc\n";
   return false;
 }
 
@@ -586,6 +802,29 @@ Interactive<URV>::pokeCommand(Core<URV>& core, const std::string& line,
 }
 
 
+/// Helper to disassCommand: Print the source file and line of
+/// disassembled instructions each time they change.
+struct SourceLinePrinter
+{
+  template <typename URV>
+  void print(Core<URV>& core, size_t addr)
+  {
+    std::string file;
+    unsigned line = 0;
+    if (not core.findSourceLine(addr, file, line))
+      return;
+    if (file == file_ and line == line_)
+      return;
+    std::cout << file << ':' << line << '\n';
+    file_ = file;
+    line_ = line;
+  }
+
+  std::string file_;
+  unsigned line_ = 0;
+};
+
+
 template <typename URV>
 bool
 Interactive<URV>::disassCommand(Core<URV>& core, const std::string& line,
@@ -635,9 +874,12 @@ Interactive<URV>::disassCommand(Core<URV>& core, const std::string& line,
 
       std::cout << "disassemble function " << name << ":\n";
 
+      SourceLinePrinter srcPrinter;
       size_t start = symbol.addr_, end = symbol.addr_ + symbol.size_;
       for (size_t addr = start; addr < end; )
 	{
+	  srcPrinter.print(core, addr);
+
 	  uint32_t inst = 0;
 	  if (not core.peekMemory(addr, inst))
 	    {
@@ -676,8 +918,10 @@ Interactive<URV>::disassCommand(Core<URV>& core, const std::string& line,
   if (not parseCmdLineNumber("address", tokens[2], addr2))
     return false;
 
+  SourceLinePrinter srcPrinter;
   for (URV addr = addr1; addr <= addr2; )
     {
+      srcPrinter.print(core, addr);
       uint32_t inst = 0;
       if (not core.peekMemory(addr, inst))
 	{
@@ -1044,6 +1288,14 @@ printInteractiveHelp()
   cout << "  Run until address or interrupted.\n\n";
   cout << "step [<n>]\n";
   cout << "  Execute n instructions (1 if n is missing).\n\n";
+  cout << "bs [<n>]\n";
+  cout << "  Go back n instructions (1 if n is missing).\n\n";
+  cout << "bc <address>\n";
+  cout << "  Go back to the last time the instruction at address was reached.\n\n";
+  cout << "goto <n>\n";
+  cout << "  Go to the state after n executed instructions (back or forward).\n\n";
+  cout << "whatif begin | step <inst> | end\n";
+  cout << "  Execute instructions and undo their effects.\n\n";
   cout << "peek <res> <addr>\n";
   cout << "  Print value of resource res (one of r, f, c, m) and address addr.\n";
   cout << "  For memory (m) up to 2 addresses may be provided to define a range\n";
@@ -1130,6 +1382,44 @@ Interactive<URV>::helpCommand(const std::vector<std::string>& tokens)
       return;
     }
 
+  if (tag == "bs")
+    {
+      cout << "bs [<n>]\n"
+	   << "  Reverse step: Go back n instructions (1 if n is missing) or to\n"
+	   << "  the oldest retained snapshot. Requires --snapshotperiod.\n";
+      return;
+    }
+
+  if (tag == "bc")
+    {
+      cout << "bc <address>\n"
+	   << "  Reverse continue: Go back to the last time the instruction at\n"
+	   << "  the given address was reached (before it was executed) or to\n"
+	   << "  the oldest retained snapshot. Requires --snapshotperiod.\n";
+      return;
+    }
+
+  if (tag == "goto")
+    {
+      cout << "goto <n>\n"
+	   << "  Bring the hart and the memory to their state after n executed\n"
+	   << "  instructions by restoring the nearest preceding snapshot and\n"
+	   << "  re-executing from there. Requires --snapshotperiod.\n";
+      return;
+    }
+
+  if (tag == "whatif")
+    {
+      cout << "whatif begin\n"
+	   << "whatif step <inst>\n"
+	   << "whatif end\n"
+	   << "  Start a what-if sequence, execute the given instruction code\n"
+	   << "  at the current pc within it (printing the changed resources)\n"
+	   << "  and end it restoring the hart and the memory to their state\n"
+	   << "  at its start.\n";
+      return;
+    }
+
   if (tag == "peek")
     {
       cout << "peek <res> <addr>\n"
@@ -1317,6 +1607,42 @@ Interactive<URV>::executeLine(unsigned& currentHartId,
       return true;
     }
 
+  if (command == "bs")
+    {
+      if (not reverseStepCommand(core, line, tokens))
+	return false;
+      if (commandLog)
+	fprintf(commandLog, "%s\n", outLine.c_str());
+      return true;
+    }
+
+  if (command == "bc")
+    {
+      if (not reverseContinueCommand(core, line, tokens))
+	return false;
+      if (commandLog)
+	fprintf(commandLog, "%s\n", outLine.c_str());
+      return true;
+    }
+
+  if (command == "goto")
+    {
+      if (not gotoCommand(core, line, tokens))
+	return false;
+      if (commandLog)
+	fprintf(commandLog, "%s\n", outLine.c_str());
+      return true;
+    }
+
+  if (command == "whatif")
+    {
+      if (not whatIfCommand(core, line, tokens))
+	return false;
+      if (commandLog)
+	fprintf(commandLog, "%s\n", outLine.c_str());
+      return true;
+    }
+
   if (command == "peek")
     {
       if (not peekCommand(core, line, tokens))
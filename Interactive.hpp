@@ -41,6 +41,18 @@ namespace WdRiscv
     bool stepCommand(Core<URV>& core, const std::string& line,
 		     const std::vector<std::string>& tokens, FILE* traceFile);
 
+    bool reverseStepCommand(Core<URV>& core, const std::string& line,
+			    const std::vector<std::string>& tokens);
+
+    bool reverseContinueCommand(Core<URV>& core, const std::string& line,
+				const std::vector<std::string>& tokens);
+
+    bool gotoCommand(Core<URV>& core, const std::string& line,
+		     const std::vector<std::string>& tokens);
+
+    bool whatIfCommand(Core<URV>& core, const std::string& line,
+		       const std::vector<std::string>& tokens);
+
     bool peekCommand(Core<URV>& core, const std::string& line,
 		     const std::vector<std::string>& tokens);
 
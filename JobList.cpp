@@ -0,0 +1,256 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <boost/format.hpp>
+#include <nlohmann/json.hpp>
+#include "JobList.hpp"
+
+
+using namespace WdRiscv;
+
+
+/// Return true if str ends with the given suffix.
+static bool
+endsWith(const std::string& str, const std::string& suffix)
+{
+  return (str.size() >= suffix.size() and
+	  str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+
+bool
+WdRiscv::loadJobList(const std::string& path, std::vector<Job>& jobs)
+{
+  std::ifstream in(path);
+  if (not in)
+    {
+      std::cerr << "Failed to open job list file '" << path << "'\n";
+      return false;
+    }
+
+  unsigned errors = 0;
+  std::string line;
+  for (unsigned lineNum = 1; std::getline(in, line); ++lineNum)
+    {
+      std::istringstream iss(line);
+      std::vector<std::string> tokens;
+      std::string token;
+      while (iss >> token)
+	tokens.push_back(token);
+
+      if (tokens.empty() or tokens.front().at(0) == '#')
+	continue;
+
+      Job job;
+      job.line_ = lineNum;
+      for (const auto& tok : tokens)
+	job.name_ += (job.name_.empty()? "" : " ") + tok;
+
+      const std::string prefix = "expect=";
+      if (tokens.back().compare(0, prefix.size(), prefix) == 0)
+	{
+	  std::string expect = tokens.back().substr(prefix.size());
+	  tokens.pop_back();
+	  if (expect == "pass")
+	    job.expect_ = Job::Expect::Pass;
+	  else if (expect == "fail")
+	    job.expect_ = Job::Expect::Fail;
+	  else
+	    {
+	      job.expect_ = Job::Expect::Value;
+	      try
+		{
+		  size_t end = 0;
+		  job.expectValue_ = std::stoull(expect, &end, 0);
+		  if (end != expect.size())
+		    throw std::invalid_argument(expect);
+		}
+	      catch (...)
+		{
+		  std::cerr << "File " << path << ", line " << lineNum
+			    << ": Invalid expectation: " << expect
+			    << " -- expecting pass, fail or a number\n";
+		  errors++;
+		  continue;
+		}
+	    }
+	}
+
+      if (tokens.empty())
+	{
+	  std::cerr << "File " << path << ", line " << lineNum
+		    << ": Missing program\n";
+	  errors++;
+	  continue;
+	}
+
+      // Program first, then its options.
+      const std::string& program = tokens.front();
+      if (endsWith(program, ".hex"))
+	job.args_.push_back("--hex");
+      job.args_.push_back(program);
+      job.args_.insert(job.args_.end(), tokens.begin() + 1, tokens.end());
+
+      jobs.push_back(job);
+    }
+
+  return errors == 0;
+}
+
+
+bool
+WdRiscv::jobPassed(const Job& job, const JobResult& result)
+{
+  if (not result.ran_)
+    return false;
+
+  bool good = result.ok_ and not result.limitHit_;
+  if (result.finished_)
+    good = result.value_ == (result.exited_? 0 : 1);
+
+  switch (job.expect_)
+    {
+    case Job::Expect::Pass:
+      return good;
+    case Job::Expect::Fail:
+      return result.finished_ and not good;
+    case Job::Expect::Value:
+      return result.finished_ and result.value_ == job.expectValue_;
+    }
+  return false;
+}
+
+
+std::string
+WdRiscv::describeJobResult(const JobResult& result)
+{
+  if (not result.ran_)
+    return "error";
+  if (result.finished_)
+    return ((result.exited_? "exit " : "tohost ") +
+	    std::to_string(result.value_));
+  if (result.limitHit_)
+    return "instruction limit";
+  return result.ok_? "stop address" : "failed";
+}
+
+
+/// Return the given text with the XML special characters escaped.
+static std::string
+xmlEscape(const std::string& text)
+{
+  std::string escaped;
+  for (char c : text)
+    {
+      if      (c == '&')  escaped += "&amp;";
+      else if (c == '<')  escaped += "&lt;";
+      else if (c == '>')  escaped += "&gt;";
+      else if (c == '"')  escaped += "&quot;";
+      else                escaped += c;
+    }
+  return escaped;
+}
+
+
+static double
+mips(const JobResult& result)
+{
+  return result.seconds_ > 0? double(result.instCount_)/result.seconds_/1e6 : 0;
+}
+
+
+bool
+WdRiscv::writeJobReport(const std::string& path, const std::vector<Job>& jobs,
+			const std::vector<JobResult>& results, double seconds)
+{
+  std::ofstream out(path);
+  if (not out)
+    {
+      std::cerr << "Failed to open batch report file '" << path
+		<< "' for output.\n";
+      return false;
+    }
+
+  size_t passed = 0, errors = 0;
+  for (const auto& result : results)
+    {
+      passed += result.passed_;
+      errors += not result.ran_;
+    }
+
+  if (endsWith(path, ".xml"))
+    {
+      out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	  << "<testsuite name=\"whisper\" tests=\"" << jobs.size()
+	  << "\" failures=\"" << jobs.size() - passed - errors
+	  << "\" errors=\"" << errors << "\" time=\""
+	  << (boost::format("%.3f") % seconds) << "\">\n";
+
+      for (size_t i = 0; i < jobs.size(); ++i)
+	{
+	  const Job& job = jobs.at(i);
+	  const JobResult& result = results.at(i);
+	  out << "  <testcase name=\"" << xmlEscape(job.name_)
+	      << "\" classname=\"whisper\" time=\""
+	      << (boost::format("%.3f") % result.seconds_) << "\">\n";
+	  if (not result.ran_)
+	    out << "    <error message=\"job setup failed\"/>\n";
+	  else if (not result.passed_)
+	    out << "    <failure message=\"" << describeJobResult(result)
+		<< "\"/>\n";
+	  out << "    <system-out>instructions=" << result.instCount_
+	      << " mips=" << (boost::format("%.2f") % mips(result))
+	      << " outcome=" << xmlEscape(describeJobResult(result))
+	      << "</system-out>\n"
+	      << "  </testcase>\n";
+	}
+
+      out << "</testsuite>\n";
+      return bool(out);
+    }
+
+  nlohmann::json items = nlohmann::json::array();
+  for (size_t i = 0; i < jobs.size(); ++i)
+    {
+      const Job& job = jobs.at(i);
+      const JobResult& result = results.at(i);
+
+      nlohmann::json item;
+      item["name"] = job.name_;
+      item["line"] = job.line_;
+      item["passed"] = result.passed_;
+      item["outcome"] = describeJobResult(result);
+      item["instructions"] = result.instCount_;
+      item["seconds"] = result.seconds_;
+      item["mips"] = mips(result);
+      items.push_back(item);
+    }
+
+  nlohmann::json report;
+  report["jobs"] = jobs.size();
+  report["passed"] = passed;
+  report["failed"] = jobs.size() - passed;
+  report["seconds"] = seconds;
+  report["results"] = items;
+
+  out << report.dump(2) << '\n';
+  return bool(out);
+}
@@ -0,0 +1,80 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace WdRiscv
+{
+
+  /// A test program of a batch run (see --batch) with its command
+  /// line options and its expected outcome.
+  struct Job
+  {
+    /// Expected outcome. Pass: a write of 1 to tohost, an exit code
+    /// of 0, or reaching the stop address. Fail: any other write to
+    /// tohost or exit code. Value: the given tohost value or exit code.
+    enum class Expect { Pass, Fail, Value };
+
+    std::string name_;              // Job line (with the expectation).
+    unsigned line_ = 0;             // Line number in the job list file.
+    std::vector<std::string> args_; // Command line options and program.
+    Expect expect_ = Expect::Pass;
+    uint64_t expectValue_ = 0;
+  };
+
+  /// Outcome of a job.
+  struct JobResult
+  {
+    bool ran_ = false;        // False if the job could not be set up.
+    bool ok_ = false;         // The simulation session succeeded.
+    bool finished_ = false;   // Program wrote tohost or exited.
+    bool exited_ = false;     // Program exited: value_ is the exit code.
+    bool limitHit_ = false;   // Instruction count limit reached.
+    uint64_t value_ = 0;      // Value written to tohost or exit code.
+    uint64_t instCount_ = 0;  // Instructions retired by all harts.
+    double seconds_ = 0;      // Simulation time.
+    bool passed_ = false;     // Outcome matches expectation (see jobPassed).
+  };
+
+  /// Load the jobs of the given file. Each line defines a job: A
+  /// program (ELF file, or hex file if its name ends with .hex)
+  /// optionally followed by command line options and by one of
+  /// expect=pass, expect=fail or expect=<n> (default pass). Tokens are
+  /// separated by white space. Blank lines and lines starting with #
+  /// are ignored. Return true on success.
+  bool loadJobList(const std::string& path, std::vector<Job>& jobs);
+
+  /// Return true if the given result matches the expectation of the
+  /// given job.
+  bool jobPassed(const Job& job, const JobResult& result);
+
+  /// Return a short description of the outcome of a job (e.g.
+  /// "tohost 3" or "instruction limit").
+  std::string describeJobResult(const JobResult& result);
+
+  /// Write a summary of the given jobs and their results to the given
+  /// file in JUnit XML format if the file name ends with .xml and in
+  /// JSON format otherwise. Seconds is the wall clock time of the whole
+  /// batch. Return true on success.
+  bool writeJobReport(const std::string& path, const std::vector<Job>& jobs,
+		      const std::vector<JobResult>& results, double seconds);
+}
@@ -16,6 +16,7 @@
 // this program. If not, see <https://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -27,6 +28,7 @@
 #endif
 #include <elfio/elfio.hpp>
 #include "Memory.hpp"
+#include "UndoLog.hpp"
 
 using namespace WdRiscv;
 
@@ -124,6 +126,7 @@ Memory::Memory(size_t size, size_t regionSize)
   regionConfigured_.resize(regionCount_);
 
   attribs_.resize(pageCount_);
+  reservedPages_.reset(new std::atomic<uint32_t>[pageCount_]());
 
   // Make whole memory as mapped, writable, allowing data and inst.
   // Some of the pages will be later reconfigured when the user
@@ -216,6 +219,7 @@ Memory::loadHexFile(const std::string& fileName)
 		{
 		  if (data_[address] != 0)
 		    overwrites++;
+		  noteWrite(address, 1);
 		  data_[address++] = value & 0xff;
 		}
 	    }
@@ -327,8 +331,6 @@ Memory::loadElfFile(const std::string& fileName, size_t& entryPoint,
       errors++;
     }
 
-  clearLastWriteInfo();
-
   // Collect symbols.
   for (int secIx = 0; secIx < secCount; ++secIx)
     {
@@ -358,6 +360,18 @@ Memory::loadElfFile(const std::string& fileName, size_t& entryPoint,
 	}
     }
 
+  // Line information is read on demand. The same file is loaded once
+  // per hart: Parse its DWARF once.
+  {
+    std::lock_guard<std::mutex> lock(lineTableMutex_);
+    if (std::find(elfFiles_.begin(), elfFiles_.end(), fileName) ==
+	elfFiles_.end())
+      {
+	elfFiles_.push_back(fileName);
+	lineTableLoaded_ = false;
+      }
+  }
+
   // Get the program entry point.
   if (not errors)
     {
@@ -456,6 +470,50 @@ Memory::getElfFileAddressBounds(const std::string& fileName, size_t& minAddr,
 }
 
 
+const DwarfLineTable&
+Memory::sourceLineTable() const
+{
+  if (not lineTableLoaded_.load(std::memory_order_acquire))
+    {
+      std::lock_guard<std::mutex> lock(lineTableMutex_);
+      if (not lineTableLoaded_)
+	{
+	  auto table = std::make_unique<DwarfLineTable>();
+	  for (const auto& file : elfFiles_)
+	    table->loadElfFile(file);
+	  lineTable_ = std::move(table);
+	  lineTableLoaded_.store(true, std::memory_order_release);
+	}
+    }
+  return *lineTable_;
+}
+
+
+bool
+Memory::getElfFileCodeSections(const std::string& fileName,
+			       std::vector<ElfSymbol>& sections)
+{
+  ELFIO::elfio reader;
+
+  if (not reader.load(fileName))
+    {
+      std::cerr << "Failed to load ELF file " << fileName << '\n';
+      return false;
+    }
+
+  for (int secIx = 0; secIx < reader.sections.size(); ++secIx)
+    {
+      const ELFIO::section* sec = reader.sections[secIx];
+      if (sec->get_type() != SHT_PROGBITS or
+	  (sec->get_flags() & SHF_EXECINSTR) == 0)
+	continue;
+      sections.push_back(ElfSymbol(sec->get_address(), sec->get_size()));
+    }
+
+  return true;
+}
+
+
 void
 Memory::copy(const Memory& other)
 {
@@ -464,6 +522,215 @@ Memory::copy(const Memory& other)
 }
 
 
+void
+Memory::defineReservationHarts(unsigned count)
+{
+  while (reservations_.size() < count)
+    reservations_.emplace_back(0);
+}
+
+
+void
+Memory::makeReservation(unsigned hartId, size_t address)
+{
+  uint64_t granule = address / reservationGranule;
+  reservedPages_[granulePageIx(granule)]++;
+
+  uint64_t prev = reservations_.at(hartId).exchange(granule + 1);
+  if (prev)
+    reservedPages_[granulePageIx(prev - 1)]--;
+}
+
+
+void
+Memory::saveReservations(std::vector<uint64_t>& saved) const
+{
+  saved.clear();
+  for (const auto& entry : reservations_)
+    saved.push_back(entry.load());
+}
+
+
+void
+Memory::restoreReservations(const std::vector<uint64_t>& saved)
+{
+  for (unsigned hartId = 0; hartId < saved.size(); ++hartId)
+    {
+      cancelReservation(hartId);
+      if (saved.at(hartId))
+	makeReservation(hartId, (saved.at(hartId) - 1) * reservationGranule);
+    }
+}
+
+
+void
+Memory::beginHistoryPeriod()
+{
+  if (not historyOn_)
+    {
+      pageSaved_.assign(pageCount_, 0);
+      historyOn_ = true;
+    }
+  else
+    for (size_t page : history_.back().pages_)
+      pageSaved_.at(page) = 0;
+
+  history_.emplace_back();
+}
+
+
+bool
+Memory::rollbackHistory(size_t period)
+{
+  if (period >= history_.size())
+    return false;
+
+  for (size_t page : history_.back().pages_)
+    pageSaved_.at(page) = 0;
+
+  // Most recent period first: The contents saved by the oldest
+  // restored period (the state at its start) prevails.
+  for (size_t ix = history_.size(); ix > period; --ix)
+    {
+      HistoryPeriod& hp = history_.at(ix - 1);
+      const uint8_t* saved = hp.data_.data();
+      for (size_t page : hp.pages_)
+	{
+	  memcpy(data_ + page*pageSize_, saved, pageSize_);
+	  saved += pageSize_;
+	}
+      historyBytes_ -= hp.data_.size();
+      hp.pages_.clear();
+      hp.data_.clear();
+    }
+
+  history_.resize(period + 1);
+  return true;
+}
+
+
+void
+Memory::dropOldestHistoryPeriod()
+{
+  if (history_.size() < 2)
+    return;
+  historyBytes_ -= history_.front().data_.size();
+  history_.pop_front();
+}
+
+
+void
+Memory::saveHistoryPages(size_t address, size_t size)
+{
+  if (size == 0 or history_.empty())
+    return;
+
+  size_t first = getPageIx(address);
+  size_t last = getPageIx(address + size - 1);
+  HistoryPeriod& hp = history_.back();
+  for (size_t page = first; page <= last and page < pageCount_; ++page)
+    {
+      if (pageSaved_[page])
+	continue;
+      pageSaved_[page] = 1;
+      const uint8_t* contents = data_ + page*pageSize_;
+      hp.pages_.push_back(page);
+      hp.data_.insert(hp.data_.end(), contents, contents + pageSize_);
+      historyBytes_ += pageSize_;
+    }
+}
+
+
+void
+Memory::logUndo(size_t address, size_t size)
+{
+  if (address >= size_)
+    return;
+  size = std::min(size, size_ - address);
+
+  while (size)
+    {
+      size_t chunk = std::min(size, size_t(8));
+      uint64_t value = 0;
+      for (size_t i = 0; i < chunk; ++i)
+	value |= uint64_t(data_[address + i]) << (8*i);
+      undoLog_->add(UndoLog::Kind::Memory, address, value, chunk);
+      address += chunk;
+      size -= chunk;
+    }
+}
+
+
+void
+Memory::cancelReservationSlow(unsigned hartId)
+{
+  uint64_t prev = reservations_.at(hartId).exchange(0);
+  if (prev)
+    reservedPages_[granulePageIx(prev - 1)]--;
+}
+
+
+void
+Memory::invalidateReservationsSlow(size_t address, size_t size)
+{
+  uint64_t first = address / reservationGranule;
+  uint64_t last = (address + size - 1) / reservationGranule;
+
+  // A hart whose reservation changes concurrently is skipped by the
+  // compare-exchange: Only one agent decrements a page count. The
+  // lock of the reserved granule keeps a store-conditional from
+  // checking the reservation while it is invalidated (see amoMutex).
+  for (auto& entry : reservations_)
+    {
+      uint64_t res = entry.load();
+      if (res == 0 or res - 1 < first or res - 1 > last)
+	continue;
+      std::lock_guard<std::recursive_mutex>
+	lock(amoMutex((res - 1) * reservationGranule));
+      if (entry.compare_exchange_strong(res, 0))
+	reservedPages_[granulePageIx(res - 1)]--;
+    }
+}
+
+
+void
+Memory::invalidateReservationRange(size_t address, size_t size)
+{
+  if (size == 0)
+    return;
+
+  size_t last = getPageIx(address + size - 1);
+  for (size_t page = getPageIx(address); page <= last and page < pageCount_;
+       ++page)
+    if (reservedPages_[page].load(std::memory_order_relaxed))
+      {
+	invalidateReservationsSlow(address, size);
+	return;
+      }
+}
+
+
+bool
+Memory::isDirectlyAccessible(size_t address, size_t size, bool write) const
+{
+  if (size == 0)
+    return true;
+  if (address >= size_ or size > size_ - address)
+    return false;
+
+  size_t last = getPageIx(address + size - 1);
+  for (size_t page = getPageIx(address); page <= last; ++page)
+    {
+      const PageAttribs& attrib = attribs_.at(page);
+      if (attrib.isMemMappedReg() or not attrib.isMappedRead())
+	return false;
+      if (write and not attrib.isMappedWrite())
+	return false;
+    }
+  return true;
+}
+
+
 bool
 Memory::writeByteNoAccessCheck(size_t addr, uint8_t value)
 {
@@ -476,13 +743,8 @@ Memory::writeByteNoAccessCheck(size_t addr, uint8_t value)
   unsigned byteIx = addr & 3;
   value = value & uint8_t((mask >> (byteIx*8)));
 
-  prevWriteValue_ = *(data_ + addr);
-
+  noteWrite(addr, 1);
   data_[addr] = value;
-  lastWriteSize_ = 1;
-  lastWriteAddr_ = addr;
-  lastWriteValue_ = value;
-  lastWriteIsDccm_ = attrib.isDccm();
   return true;
 }
 
@@ -662,7 +924,10 @@ Memory::resetMemoryMappedRegisters()
       size_t addr1 = addr0 + pageSize_ - 1; // last byte in page.
       size_t hostAddr0 = 0, hostAddr1 = 0;
       if (getSimMemAddr(addr0, hostAddr0) and getSimMemAddr(addr1, hostAddr1))
-	memset(reinterpret_cast<void*>(hostAddr0), 0, pageSize_);
+	{
+	  noteWrite(addr0, pageSize_);
+	  memset(reinterpret_cast<void*>(hostAddr0), 0, pageSize_);
+	}
     }
 }
 
@@ -23,8 +23,14 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <array>
+#include <deque>
+#include <memory>
+#include <atomic>
 #include <type_traits>
+#include <cstring>
 #include <assert.h>
+#include "DwarfLine.hpp"
 
 namespace WdRiscv
 {
@@ -32,6 +38,9 @@ namespace WdRiscv
   template <typename URV>
   class Core;
 
+  class VirtMem;
+  class UndoLog;
+
   /// Page attributes.
   struct PageAttribs
   {
@@ -209,13 +218,46 @@ namespace WdRiscv
   };
 
 
-  /// Model physical memory of system.
+  /// Description of a memory write: Used for tracing and for the
+  /// store queue. Each hart keeps a record of its most recent write so
+  /// that concurrent harts do not share any bookkeeping.
+  struct LastWriteInfo
+  {
+    /// Forget recorded write.
+    void clear()
+    { size_ = 0; }
+
+    /// Record a write.
+    void set(unsigned size, size_t addr, uint64_t value, uint64_t prevValue,
+	     bool isDccm)
+    {
+      size_ = size;
+      addr_ = addr;
+      value_ = value;
+      prevValue_ = prevValue;
+      isDccm_ = isDccm;
+    }
+
+    unsigned size_ = 0;       // Size of write (0 if no write).
+    size_t addr_ = 0;         // Location of write.
+    uint64_t value_ = 0;      // Value written.
+    uint64_t prevValue_ = 0;  // Value replaced by write.
+    bool isDccm_ = false;     // True if write was to DCCM.
+  };
+
+
+  /// Model physical memory of system. Memory is shared by all the
+  /// harts of the system. Naturally aligned data accesses are relaxed
+  /// atomic operations (plain loads and stores on common hosts) so that
+  /// they are never torn by concurrent harts. Misaligned accesses are
+  /// plain copies.
   class Memory
   {
   public:
 
     friend class Core<uint32_t>;
     friend class Core<uint64_t>;
+    friend class VirtMem;
 
     /// Constructor: define a memory of the given size initialized to
     /// zero. Given memory size (byte count) must be a multiple of 4
@@ -267,7 +309,7 @@ namespace WdRiscv
       else if (attrib.isMemMappedReg())
 	return false;
 
-      value = *(reinterpret_cast<const T*>(data_ + address));
+      value = hostLoad<T>(address);
       return true;
     }
 
@@ -282,7 +324,7 @@ namespace WdRiscv
       if (attrib.isMemMappedReg())
 	return false; // Only word access allowed to memory mapped regs.
 
-      value = data_[address];
+      value = hostLoad<uint8_t>(address);
       return true;
     }
 
@@ -324,7 +366,7 @@ namespace WdRiscv
 		}
 	    }
 
-	  value = *(reinterpret_cast<const uint16_t*>(data_ + address));
+	  value = hostLoad<uint16_t>(address);
 	  return true;
 	}
       return false;
@@ -353,7 +395,7 @@ namespace WdRiscv
 		}
 	    }
 
-	  value = *(reinterpret_cast<const uint32_t*>(data_ + address));
+	  value = hostLoad<uint32_t>(address);
 	  return true;
 	}
 	return false;
@@ -406,9 +448,9 @@ namespace WdRiscv
     /// starting at the given address. Return true on success. Return
     /// false if any of the target memory bytes are out of bounds or
     /// fall in inaccessible regions or if the write crosses memory
-    /// region of different attributes.
+    /// region of different attributes. Describe the write in info.
     template <typename T>
-    bool write(size_t address, T value)
+    bool write(size_t address, T value, LastWriteInfo& info)
     {
       PageAttribs attrib1 = getAttrib(address);
       bool dccm1 = attrib1.isDccm();
@@ -437,20 +479,25 @@ namespace WdRiscv
       if constexpr (sizeof(T) == 4)
         {
 	  if (attrib1.isMemMappedReg())
-	    return writeRegister(address, value);
+	    return writeRegister(address, value, info);
 	}
       else if (attrib1.isMemMappedReg())
 	return false;
 
-      prevWriteValue_ = *(reinterpret_cast<T*>(data_ + address));
-      *(reinterpret_cast<T*>(data_ + address)) = value;
-      lastWriteSize_ = sizeof(T);
-      lastWriteAddr_ = address;
-      lastWriteValue_ = value;
-      lastWriteIsDccm_ = dccm1;
+      T prev = hostLoad<T>(address);
+      hostStore<T>(address, value);
+      info.set(sizeof(T), address, value, prev, dccm1);
       return true;
     }
 
+    /// Same as above but without a description of the write.
+    template <typename T>
+    bool write(size_t address, T value)
+    {
+      LastWriteInfo info;
+      return write(address, value, info);
+    }
+
     /// Write byte to given address. Return true on success. Return
     /// false if address is out of bounds or is not writable.
     bool writeByte(size_t address, uint8_t value)
@@ -462,13 +509,7 @@ namespace WdRiscv
       if (attrib.isMemMappedReg())
 	return false;  // Only word access allowed to memory mapped regs.
 
-      prevWriteValue_ = *(data_ + address);
-
-      data_[address] = value;
-      lastWriteSize_ = 1;
-      lastWriteAddr_ = address;
-      lastWriteValue_ = value;
-      lastWriteIsDccm_ = attrib.isDccm();
+      hostStore<uint8_t>(address, value);
       return true;
     }
 
@@ -525,6 +566,18 @@ namespace WdRiscv
     /// <name> <value>
     void printElfSymbols(std::ostream& out) const;
 
+    /// Locate the source file and line corresponding to the given
+    /// address using the DWARF line information of the loaded ELF
+    /// files. Return true on success and false if no line information
+    /// covers the address. The line information is read on first use.
+    bool findSourceLine(size_t addr, std::string& file, unsigned& line) const
+    { return sourceLineTable().lookup(addr, file, line); }
+
+    /// Return the line table of the loaded ELF files reading it on
+    /// first use. Table is empty if the files have no line
+    /// information.
+    const DwarfLineTable& sourceLineTable() const;
+
     /// Return the min and max addresses corresponding to the segments
     /// in the given ELF file. Return true on success and false if
     /// the ELF file does not exist or cannot be read (in which
@@ -532,6 +585,13 @@ namespace WdRiscv
     static bool getElfFileAddressBounds(const std::string& file,
 					size_t& minAddr, size_t& maxAddr);
 
+    /// Collect the address and size of each executable section of
+    /// the given ELF file into the sections vector. Return true on
+    /// success and false if the ELF file does not exist or cannot be
+    /// read.
+    static bool getElfFileCodeSections(const std::string& file,
+				       std::vector<ElfSymbol>& sections);
+
     /// Copy data from the given memory into this memory. If the two
     /// memories have different sizes then copy data from location
     /// zero up to n-1 where n is the minimum of the sizes.
@@ -539,7 +599,7 @@ namespace WdRiscv
 
   protected:
 
-    /// Same as write but effects not recorded in last-write info.
+    /// Same as write but without a description of the write.
     template <typename T>
     bool poke(size_t address, T value)
     {
@@ -568,11 +628,11 @@ namespace WdRiscv
       else if (attrib.isMemMappedReg())
 	return false;
 
-      *(reinterpret_cast<T*>(data_ + address)) = value;
+      hostStore<T>(address, value);
       return true;
     }
 
-    /// Same as writeByte but effects are not record in last-write info.
+    /// Same as writeByte but without memory mapped register checks.
     bool pokeByte(size_t address, uint8_t value)
     {
       PageAttribs attrib = getAttrib(address);
@@ -582,7 +642,7 @@ namespace WdRiscv
       if (attrib.isMemMappedReg())
 	return false;  // Only word access allowed to memory mapped regs.
 
-      data_[address] = value;
+      hostStore<uint8_t>(address, value);
       return true;
     }
 
@@ -591,52 +651,134 @@ namespace WdRiscv
     /// memory.
     bool writeByteNoAccessCheck(size_t address, uint8_t value);
 
-    /// Set addr to the address of the last write and value to the
-    /// corresponding value and return the size of that write. Return
-    /// 0 if no write since the most recent clearLastWriteInfo in
-    /// which case addr and value are not modified.
-    unsigned getLastWriteNewValue(size_t& addr, uint64_t& value) const
-    {
-      if (lastWriteSize_)
-	{
-	  addr = lastWriteAddr_;
-	  value = lastWriteValue_;
-	}
-      return lastWriteSize_;
-    }
-
-    /// Set addr to the address of the last write and value to the
-    /// corresponding previous value (value before last write) and
-    /// return the size of that write. Return 0 if no write since the
-    /// most recent clearLastWriteInfo in which case addr and value
-    /// are not modified.
-    unsigned getLastWriteOldValue(size_t& addr, uint64_t& value) const
-    {
-      if (lastWriteSize_)
-	{
-	  addr = lastWriteAddr_;
-	  value = prevWriteValue_;
-	}
-      return lastWriteSize_;
-    }
-
-    /// Set value to the memory value before last write.  Return 0 if
-    /// no write since the most recent clearLastWriteInfo in which
-    /// case is not modified.
-    unsigned getLastWriteOldValue(uint64_t& value) const
+    /// Return a pointer to the host memory of the given naturally
+    /// aligned location if it can be updated with a host atomic
+    /// operation: location is mapped for read and write and is not a
+    /// memory mapped register. Return nullptr otherwise.
+    template <typename T>
+    T* atomicPtr(size_t address)
     {
-      if (lastWriteSize_)
-	value = prevWriteValue_;
-      return lastWriteSize_;
-    }
-
-    /// Clear the information associated with last write.
-    void clearLastWriteInfo()
-    { lastWriteSize_ = 0; }
+      if (address & (sizeof(T) - 1))
+	return nullptr;
+      PageAttribs attrib = getAttrib(address);
+      if (not attrib.isMappedRead() or not attrib.isMappedWrite() or
+	  attrib.isMemMappedReg())
+	return nullptr;
+      noteWrite(address, sizeof(T));
+      return reinterpret_cast<T*>(data_ + address);
+    }
+
+    /// Return the lock serializing the atomic memory operations to the
+    /// given address. The lock depends only on the offset of the
+    /// address in its page so that a virtual address and its physical
+    /// address select the same lock. A store-conditional holds it from
+    /// its reservation check to its write and the invalidation of
+    /// reservations takes it: It is recursive because a hart holding
+    /// it invalidates reservations when it writes.
+    std::recursive_mutex& amoMutex(size_t address)
+    { return amoMutexes_[(address >> 3) % amoMutexes_.size()]; }
+
+    /// Size in bytes of a reservation granule: A load-reserve reserves
+    /// the naturally aligned granule containing its address.
+    static constexpr unsigned reservationGranule = 8;
+
+    /// Make room in the reservation table for the given number of
+    /// harts. Must not be called while harts are running.
+    void defineReservationHarts(unsigned count);
+
+    /// Return true if more than one hart uses this memory.
+    bool isShared() const
+    { return reservations_.size() > 1; }
+
+    /// Make the given hart reserve the granule containing the given
+    /// address dropping its previous reservation (if any).
+    void makeReservation(unsigned hartId, size_t address);
+
+    /// Return true if the given hart holds a reservation on the granule
+    /// containing the given address.
+    bool hasReservation(unsigned hartId, size_t address) const
+    {
+      uint64_t granule = address / reservationGranule;
+      return reservations_.at(hartId).load() == granule + 1;
+    }
+
+    /// Drop the reservation of the given hart (if any).
+    void cancelReservation(unsigned hartId)
+    {
+      if (reservations_.at(hartId).load(std::memory_order_relaxed))
+	cancelReservationSlow(hartId);
+    }
+
+    /// Set the ith element of the given vector to the reservation of
+    /// hart i: One plus the reserved granule number or zero if the
+    /// hart holds no reservation. Used with restoreReservations to undo
+    /// a what-if sequence (see Core::whatIfBegin).
+    void saveReservations(std::vector<uint64_t>& saved) const;
+
+    /// Give each hart the reservation recorded for it in the given
+    /// vector by saveReservations.
+    void restoreReservations(const std::vector<uint64_t>& saved);
+
+    /// Start a new history period. The first call enables the page
+    /// history: From then on the contents of a page is saved before
+    /// its first write in a period so that the memory can be rolled
+    /// back to the start of any retained period (see rollbackHistory).
+    /// Used for reverse execution with a single hart.
+    void beginHistoryPeriod();
+
+    /// Restore the memory to its contents at the start of the given
+    /// period (0 being the oldest retained period) and drop the periods
+    /// following it. Return false if there is no such period.
+    bool rollbackHistory(size_t period);
+
+    /// Drop the oldest history period unless it is the current one.
+    void dropOldestHistoryPeriod();
+
+    /// Return the number of bytes of page contents saved in the
+    /// retained history periods.
+    size_t historyBytes() const
+    { return historyBytes_; }
+
+    /// Record the previous contents of each written location in the
+    /// given undo log until called with nullptr. Used by the hart
+    /// running a what-if sequence (see Core::whatIfBegin).
+    void setUndoLog(UndoLog* log)
+    { undoLog_ = log; }
+
+    /// Called before writing the size bytes at the given address. All
+    /// writes go through here including those done directly in host
+    /// memory (see isDirectlyAccessible). Costs two loads unless the
+    /// page history is enabled or a what-if sequence is active.
+    void noteWrite(size_t address, size_t size)
+    {
+      if (historyOn_)
+	saveHistoryPages(address, size);
+      if (undoLog_)
+	logUndo(address, size);
+    }
+
+    /// Invalidate the reservations of all the harts on the granules
+    /// overlapping the size bytes at the given address. This is called
+    /// after each write and costs a single load unless the written
+    /// page has a reservation.
+    void invalidateReservations(size_t address, unsigned size)
+    {
+      size_t page = getPageIx(address), page2 = getPageIx(address + size - 1);
+      if (page2 < pageCount_ and
+	  (reservedPages_[page].load(std::memory_order_relaxed) or
+	   reservedPages_[page2].load(std::memory_order_relaxed)))
+	invalidateReservationsSlow(address, size);
+    }
+
+    /// Same as invalidateReservations but for a range of bytes that
+    /// may span any number of pages.
+    void invalidateReservationRange(size_t address, size_t size);
 
-    /// Return true if last write was to data closed coupled memory.
-    bool isLastWriteToDccm() const
-    { return lastWriteIsDccm_; }
+    /// Return true if the size bytes at the given address can be
+    /// accessed directly in host memory: All the pages of the range
+    /// are mapped and readable (and writable if write is true) and
+    /// none of them holds memory-mapped registers.
+    bool isDirectlyAccessible(size_t address, size_t size, bool write) const;
 
     /// Return the page size.
     size_t pageSize() const
@@ -707,7 +849,7 @@ namespace WdRiscv
     {
       if ((addr & 3) != 0)
 	return false;  // Address must be workd-aligned.
-      value = *(reinterpret_cast<const uint32_t*>(data_ + addr));
+      value = hostLoad<uint32_t>(addr);
       return true;
     }
 
@@ -739,8 +881,8 @@ namespace WdRiscv
       return value;
     }
 
-    /// Write a memory mapped register.
-    bool writeRegister(size_t addr, uint32_t value)
+    /// Write a memory mapped register. Describe the write in info.
+    bool writeRegister(size_t addr, uint32_t value, LastWriteInfo& info)
     {
       if ((addr & 3) != 0)
 	return false;  // Address must be word-aligned.
@@ -749,13 +891,9 @@ namespace WdRiscv
 
       PageAttribs attrib = getAttrib(addr);
 
-      prevWriteValue_ = *(reinterpret_cast<uint32_t*>(data_ + addr));
-
-      *(reinterpret_cast<uint32_t*>(data_ + addr)) = value;
-      lastWriteSize_ = 4;
-      lastWriteAddr_ = addr;
-      lastWriteValue_ = value;
-      lastWriteIsDccm_ = attrib.isDccm();
+      uint32_t prev = hostLoad<uint32_t>(addr);
+      hostStore<uint32_t>(addr, value);
+      info.set(4, addr, value, prev, attrib.isDccm());
       return true;
     }
 
@@ -778,6 +916,53 @@ namespace WdRiscv
       return true;
     }
 
+    /// Return the value of type T at the given address. Access is a
+    /// relaxed atomic if the address is naturally aligned (see class
+    /// description).
+    template <typename T>
+    T hostLoad(size_t address) const
+    {
+      if ((address & (sizeof(T) - 1)) == 0)
+	return __atomic_load_n(reinterpret_cast<const T*>(data_ + address),
+			       __ATOMIC_RELAXED);
+      T value;
+      memcpy(&value, data_ + address, sizeof(T));
+      return value;
+    }
+
+    /// Store given value of type T at the given address. Access is a
+    /// relaxed atomic if the address is naturally aligned (see class
+    /// description).
+    template <typename T>
+    void hostStore(size_t address, T value)
+    {
+      noteWrite(address, sizeof(T));
+      if ((address & (sizeof(T) - 1)) == 0)
+	__atomic_store_n(reinterpret_cast<T*>(data_ + address), value,
+			 __ATOMIC_RELAXED);
+      else
+	memcpy(data_ + address, &value, sizeof(T));
+    }
+
+    /// Helper to noteWrite: Save the pages overlapping the given
+    /// range that were not yet saved in the current history period.
+    void saveHistoryPages(size_t address, size_t size);
+
+    /// Helper to noteWrite: Add the contents of the given range to the
+    /// undo log in chunks of at most 8 bytes.
+    void logUndo(size_t address, size_t size);
+
+    /// Helper to cancelReservation.
+    void cancelReservationSlow(unsigned hartId);
+
+    /// Helper to invalidateReservations.
+    void invalidateReservationsSlow(size_t address, size_t size);
+
+    /// Return the index of the page containing the given reservation
+    /// granule.
+    size_t granulePageIx(uint64_t granule) const
+    { return getPageIx(granule * reservationGranule); }
+
   private:
 
     size_t size_;        // Size of memory in bytes.
@@ -796,7 +981,13 @@ namespace WdRiscv
     unsigned pageShift_   = 12;        // Shift address by this to get page no.
     unsigned regionShift_ = 28;        // Shift address by this to get region no
 
-    std::mutex amoMutex_;
+    std::array<std::recursive_mutex, 64> amoMutexes_;  // By double-word.
+
+    // Reservation table: One entry per hart holding the reserved
+    // granule number plus 1 (0 if no reservation). A count of the
+    // reservations in each page keeps the common write path cheap.
+    std::deque<std::atomic<uint64_t>> reservations_;
+    std::unique_ptr<std::atomic<uint32_t>[]> reservedPages_;
 
     // Attributes are assigned to pages.
     std::vector<PageAttribs> attribs_;      // One entry per page.
@@ -804,12 +995,27 @@ namespace WdRiscv
 
     std::vector<size_t> mmrPages_;  // Memory mapped register pages.
 
-    unsigned lastWriteSize_ = 0;    // Size of last write.
-    size_t lastWriteAddr_ = 0;      // Location of most recent write.
-    uint64_t lastWriteValue_ = 0;   // Value of most recent write.
-    uint64_t prevWriteValue_ = 0;   // Value replaced by most recent write.
-    bool lastWriteIsDccm_ = false;  // Last write was to DCCM.
+    // Page history (see beginHistoryPeriod): Each period holds the
+    // numbers of the pages written during the period and their
+    // contents at the start of the period (one page after the other).
+    struct HistoryPeriod
+    {
+      std::vector<size_t> pages_;
+      std::vector<uint8_t> data_;
+    };
+    std::deque<HistoryPeriod> history_;
+    std::vector<uint8_t> pageSaved_;  // Per page: Saved in current period.
+    size_t historyBytes_ = 0;
+    bool historyOn_ = false;
+
+    UndoLog* undoLog_ = nullptr;  // Non-null during a what-if sequence.
 
     std::unordered_map<std::string, ElfSymbol> symbols_;
+
+    // Source line table: Loaded from elfFiles_ on first use.
+    std::vector<std::string> elfFiles_;
+    mutable std::unique_ptr<DwarfLineTable> lineTable_;
+    mutable std::atomic<bool> lineTableLoaded_{false};
+    mutable std::mutex lineTableMutex_;
   };
 }
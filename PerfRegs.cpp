@@ -41,7 +41,8 @@ PerfRegs::config(unsigned numCounters)
 
   unsigned numEvents = unsigned(EventNumber::_End);
   countersOfEvent_.resize(numEvents);
-  modified_.resize(numEvents);
+  counterMaskOfEvent_.resize(numEvents);
+  modified_ = 0;
 }
 
 
@@ -66,6 +67,20 @@ PerfRegs::assignEventToCounter(EventNumber event, unsigned counter)
     countersOfEvent_.at(size_t(event)).push_back(counter);
 
   eventOfCounter_.at(counter) = event;
+
+  // Update the table-driven view of the event to counter mapping.
+  activeEvents_ = 0;
+  for (size_t ix = 0; ix < countersOfEvent_.size(); ++ix)
+    {
+      uint64_t mask = 0;
+      if (ix != size_t(EventNumber::None))
+	for (auto counterIx : countersOfEvent_.at(ix))
+	  mask |= uint64_t(1) << counterIx;
+      counterMaskOfEvent_.at(ix) = mask;
+      if (mask)
+	activeEvents_ |= uint64_t(1) << ix;
+    }
+
   return true;
 }
 
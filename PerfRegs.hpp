@@ -98,6 +98,9 @@ namespace WdRiscv
       _End               // 54: Non-event serving as count of events
     };
 
+  static_assert(unsigned(EventNumber::_End) <= 64,
+		"Event mask (uint64_t) too small for event count");
+
 
   template <typename URV>
   class CsRegs;
@@ -136,11 +139,42 @@ namespace WdRiscv
       for (auto counterIx : counterIndices)
 	{
 	  counters_.at(counterIx)++;
-	  modified_.at(counterIx) = true;
+	  modified_ |= uint64_t(1) << counterIx;
 	}
       return true;
     }
 
+    /// Return the bit corresponding to the given event in an event
+    /// mask (see updateCounters(uint64_t)).
+    static uint64_t eventBit(EventNumber event)
+    { return uint64_t(1) << unsigned(event); }
+
+    /// Return a mask with a bit set for each event that is currently
+    /// associated with one or more counters. Return zero if no event
+    /// is being counted.
+    uint64_t activeEvents() const
+    { return activeEvents_; }
+
+    /// Update (count-up) all the performance counters currently
+    /// associated with the events in the given mask: Bit i of the
+    /// mask corresponds to event number i.
+    void updateCounters(uint64_t eventMask)
+    {
+      eventMask &= activeEvents_;
+      while (eventMask)
+	{
+	  unsigned eventIx = __builtin_ctzll(eventMask);
+	  eventMask &= eventMask - 1;
+	  uint64_t counterMask = counterMaskOfEvent_[eventIx];
+	  modified_ |= counterMask;
+	  while (counterMask)
+	    {
+	      counters_[__builtin_ctzll(counterMask)]++;
+	      counterMask &= counterMask - 1;
+	    }
+	}
+    }
+
     /// Associate given event number with given counter.
     /// Subsequent calls to updatePerofrmanceCounters(en) will cause
     /// given counter to count up by 1. Return true on success. Return
@@ -152,17 +186,14 @@ namespace WdRiscv
     /// Unmark registers marked as modified by current instruction. This
     /// is done at the end of each instruction.
     void clearModified()
-    {
-      for (auto& m : modified_)
-	m = false;
-    }
+    { modified_ = 0; }
 
     /// Return true if given number corresponds to a valid performance
     /// counter and if that counter was modified by the current
     /// instruction.
     bool isModified(unsigned ix)
     {
-      if (ix < modified_.size()) return modified_[ix];
+      if (ix < counters_.size()) return (modified_ >> ix) & 1;
       return false;
     }
 
@@ -175,7 +206,14 @@ namespace WdRiscv
     // counters currently associated with that event.
     std::vector< std::vector<unsigned> > countersOfEvent_;
 
+    // Map an event number to a mask with a bit set for each counter
+    // associated with that event. Derived from countersOfEvent_.
+    std::vector<uint64_t> counterMaskOfEvent_;
+
     std::vector<uint64_t> counters_;
-    std::vector<unsigned> modified_;
+    uint64_t modified_ = 0;  // Bit i set if counter i modified.
+
+    // Bit i is set if event i is associated with at least one counter.
+    uint64_t activeEvents_ = 0;
   };
 }
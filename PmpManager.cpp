@@ -0,0 +1,180 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "PmpManager.hpp"
+
+
+using namespace WdRiscv;
+
+
+void
+PmpManager::update(const uint8_t* cfg, const uint64_t* addr, unsigned count)
+{
+  count_ = count < maxEntries ? count : maxEntries;
+  anyLocked_ = false;
+  regions_.clear();
+
+  for (unsigned ix = 0; ix <= maxEntries; ++ix)
+    cfg_[ix] = ix < count_ ? cfg[ix] : 0;
+
+  for (unsigned ix = 0; ix < count_; ++ix)
+    {
+      uint8_t byte = cfg_[ix];
+      Type type = Type((byte >> 3) & 3);
+      if (type == Type::Off)
+	continue;
+
+      Region region;
+      region.perm_ = byte & 7;
+      region.locked_ = byte & lockBit_;
+      anyLocked_ = anyLocked_ or region.locked_;
+
+      uint64_t a = addr[ix];
+      if (type == Type::Tor)
+	{
+	  uint64_t first = ix == 0 ? 0 : addr[ix - 1] << 2;
+	  uint64_t end = a << 2;
+	  if (first >= end)
+	    continue;  // Empty range matches nothing.
+	  region.first_ = first;
+	  region.last_ = end - 1;
+	}
+      else if (type == Type::Na4)
+	{
+	  region.first_ = a << 2;
+	  region.last_ = region.first_ + 3;
+	}
+      else
+	{
+	  // Trailing ones of pmpaddr encode the size: 2^(ones+3) bytes.
+	  unsigned ones = __builtin_ctzll(~a | (uint64_t(1) << 63));
+	  if (ones + 3 >= 64)
+	    {
+	      region.first_ = 0;
+	      region.last_ = ~uint64_t(0);
+	    }
+	  else
+	    {
+	      uint64_t size = uint64_t(1) << (ones + 3);
+	      region.first_ = (a << 2) & ~(size - 1);
+	      region.last_ = region.first_ + size - 1;
+	    }
+	}
+
+      regions_.push_back(region);
+    }
+
+  // Machine mode is only constrained by locked entries. Other modes
+  // are checked as soon as one entry is implemented.
+  for (unsigned mode = 0; mode < 4; ++mode)
+    checked_[mode] = count_ != 0;
+  checked_[unsigned(PrivilegeMode::Machine)] = anyLocked_;
+
+  // An empty fetch window for checked modes, everything for others.
+  for (unsigned mode = 0; mode < 4; ++mode)
+    {
+      fetchFirst_[mode] = 0;
+      fetchSpan_[mode] = checked_[mode] ? 0 : ~uint64_t(0);
+    }
+
+  invalidateCache();
+}
+
+
+const PmpManager::Region*
+PmpManager::findRegion(uint64_t first, uint64_t last) const
+{
+  for (const auto& region : regions_)
+    if (first <= region.last_ and last >= region.first_)
+      return &region;
+  return nullptr;
+}
+
+
+bool
+PmpManager::checkAccess(uint64_t address, unsigned size, PrivilegeMode mode,
+			Access access)
+{
+  if (isCached(address, size, mode, access))
+    return true;
+
+  // Refill the cache entry of the page of the first byte. A page is
+  // uniform if the highest priority region overlapping it covers all
+  // of it, or if no region overlaps it.
+  uint64_t page = address >> pageShift_;
+  uint64_t pageFirst = page << pageShift_;
+  uint64_t pageLast = pageFirst + (uint64_t(1) << pageShift_) - 1;
+
+  PageEntry& entry = cache_[page & (cacheSize_ - 1)];
+  entry = PageEntry();
+  entry.page_ = page;
+
+  uint8_t all = Read | Write | Exec;
+  unsigned machine = unsigned(PrivilegeMode::Machine);
+  const Region* region = findRegion(pageFirst, pageLast);
+  if (not region)
+    entry.perm_[machine] = all;
+  else if (region->first_ <= pageFirst and region->last_ >= pageLast)
+    {
+      for (auto& perm : entry.perm_)
+	perm = region->perm_;
+      if (not region->locked_)
+	entry.perm_[machine] = all;
+    }
+
+  // Check the access itself: All its bytes must fall in the highest
+  // priority matching region.
+  uint64_t last = address + size - 1;
+  region = findRegion(address, last);
+  if (not region)
+    return mode == PrivilegeMode::Machine;
+
+  if (region->first_ > address or region->last_ < last)
+    return false;
+
+  if (mode == PrivilegeMode::Machine and not region->locked_)
+    return true;
+
+  return (region->perm_ & access) == access;
+}
+
+
+bool
+PmpManager::checkFetch(uint64_t address, unsigned size, PrivilegeMode mode)
+{
+  if (not checkAccess(address, size, mode, Exec))
+    return false;
+
+  if (isCached(address, size, mode, Exec))
+    {
+      // Window covers the addresses at which a fetch of up to 4 bytes
+      // stays within the page.
+      unsigned m = unsigned(mode) & 3;
+      fetchFirst_[m] = (address >> pageShift_) << pageShift_;
+      fetchSpan_[m] = (uint64_t(1) << pageShift_) - 3;
+    }
+  return true;
+}
+
+
+void
+PmpManager::invalidateCache()
+{
+  for (auto& entry : cache_)
+    entry = PageEntry();
+}
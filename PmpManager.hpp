@@ -0,0 +1,169 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "CsRegs.hpp"
+
+namespace WdRiscv
+{
+
+  /// Physical memory protection. Holds the regions decoded from the
+  /// pmpcfg/pmpaddr CSRs and answers access checks. Regions are
+  /// decoded only when a PMP CSR changes (see update). Access checks
+  /// go through a small page cache recording, for each page, whether
+  /// the page lies entirely within one region (or entirely outside
+  /// all regions) in which case the permissions of the whole page are
+  /// known without a search.
+  class PmpManager
+  {
+  public:
+
+    /// Access type. Values match the R/W/X bits of a pmpcfg byte.
+    enum Access { Read = 1, Write = 2, Exec = 4 };
+
+    /// Address matching mode: Field A of a pmpcfg byte.
+    enum Type { Off = 0, Tor = 1, Na4 = 2, Napot = 3 };
+
+    /// Maximum number of PMP entries.
+    static constexpr unsigned maxEntries = 16;
+
+    /// Redefine the regions. Entry i is defined by cfg[i] (a pmpcfg
+    /// byte) and addr[i] (the contents of pmpaddr i). Only the first
+    /// count entries (at most maxEntries) are implemented.
+    void update(const uint8_t* cfg, const uint64_t* addr, unsigned count);
+
+    /// Return true if an access of the given type to the size bytes
+    /// starting at address is allowed in the given privilege mode. An
+    /// AMO passes Read|Write and needs both permissions. The page
+    /// cache lookup is out of line to keep the load/store paths of the
+    /// callers small.
+    bool isAllowed(uint64_t address, unsigned size, PrivilegeMode mode,
+		   Access access)
+    {
+      if (not checked_[unsigned(mode) & 3])
+	return true;
+      return checkAccess(address, size, mode, access);
+    }
+
+    /// Same as isAllowed for an instruction fetch of at most 4
+    /// bytes. Fetch is checked on every instruction: The common case
+    /// is a single compare against the last page found executable in
+    /// the given mode (the whole address space if the mode is not
+    /// subject to PMP).
+    bool isFetchAllowed(uint64_t address, unsigned size, PrivilegeMode mode)
+    {
+      unsigned m = unsigned(mode) & 3;
+      if (address - fetchFirst_[m] < fetchSpan_[m])
+	return true;
+      return checkFetch(address, size, mode);
+    }
+
+    /// Set first and span to the fetch window of the given mode: A
+    /// fetch of at most 4 bytes at an address a is allowed if
+    /// a - first < span.
+    void getFetchWindow(PrivilegeMode mode, uint64_t& first,
+			uint64_t& span) const
+    {
+      unsigned m = unsigned(mode) & 3;
+      first = fetchFirst_[m];
+      span = fetchSpan_[m];
+    }
+
+    /// Return true if the given pmpcfg byte is locked.
+    bool isEntryLocked(unsigned ix) const
+    { return ix < count_ and (cfg_[ix] & lockBit_); }
+
+    /// Return true if writes to pmpaddr ix are ignored: Entry ix is
+    /// locked or the next entry is locked and of type TOR.
+    bool isAddrLocked(unsigned ix) const
+    {
+      if (isEntryLocked(ix))
+	return true;
+      return (isEntryLocked(ix + 1) and
+	      Type((cfg_[ix + 1] >> 3) & 3) == Type::Tor);
+    }
+
+  protected:
+
+    /// A decoded active entry covering addresses first_ to last_
+    /// (inclusive).
+    struct Region
+    {
+      uint64_t first_ = 0;
+      uint64_t last_ = 0;
+      uint8_t perm_ = 0;    // R/W/X bits.
+      bool locked_ = false;
+    };
+
+    /// Cached permissions of a page indexed by privilege mode. A
+    /// page that is not uniformly covered grants nothing here, which
+    /// sends all its accesses to the slow path.
+    struct PageEntry
+    {
+      uint64_t page_ = ~uint64_t(0);
+      uint8_t perm_[4] = {};
+    };
+
+    /// Return true if the access falls in a cached page having
+    /// uniform permissions that grant the access.
+    bool isCached(uint64_t address, unsigned size, PrivilegeMode mode,
+		  Access access) const
+    {
+      uint64_t page = address >> pageShift_;
+      const PageEntry& entry = cache_[page & (cacheSize_ - 1)];
+      return (entry.page_ == page and
+	      (entry.perm_[unsigned(mode) & 3] & access) == access and
+	      ((address + size - 1) >> pageShift_) == page);
+    }
+
+    /// Helper to isAllowed: Look up the page cache and if that fails
+    /// search the regions and refill the cache entry of the page
+    /// containing address.
+    bool checkAccess(uint64_t address, unsigned size, PrivilegeMode mode,
+		     Access access);
+
+    /// Slow path of isFetchAllowed: Check the access and, if its page
+    /// is uniformly executable, make it the fetch window of the mode.
+    bool checkFetch(uint64_t address, unsigned size, PrivilegeMode mode);
+
+    /// Return the first region overlapping the given address range
+    /// or nullptr if none does.
+    const Region* findRegion(uint64_t first, uint64_t last) const;
+
+    /// Invalidate all cached page entries.
+    void invalidateCache();
+
+  private:
+
+    static constexpr unsigned pageShift_ = 12;
+    static constexpr unsigned cacheSize_ = 256;  // Power of 2.
+    static constexpr uint8_t lockBit_ = 0x80;
+
+    unsigned count_ = 0;          // Number of implemented entries.
+    uint8_t cfg_[maxEntries + 1] = {};
+    bool anyLocked_ = false;
+    bool checked_[4] = {};        // Indexed by privilege mode.
+    uint64_t fetchFirst_[4] = {};  // Fetch window per privilege mode.
+    uint64_t fetchSpan_[4] = {};
+    std::vector<Region> regions_; // Active entries in priority order.
+    PageEntry cache_[cacheSize_];
+  };
+}
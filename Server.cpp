@@ -287,6 +287,21 @@ Server<URV>::pokeCommand(const WhisperMessage& req, WhisperMessage& reply)
       }
       break;
 
+    case 'v':
+      {
+	// Address is (chunk << 16) | reg: Poke the 64-bit chunk.
+	unsigned reg = req.address & 0xffff;
+	size_t chunk = req.address >> 16;
+	std::vector<uint8_t> bytes;
+	if (core.peekVecReg(reg, bytes) and chunk*8 < bytes.size())
+	  {
+	    memcpy(bytes.data() + chunk*8, &req.value, 8);
+	    if (core.pokeVecReg(reg, bytes))
+	      return true;
+	  }
+      }
+      break;
+
     case 'm':
       if (sizeof(URV) == 4)
 	{
@@ -353,6 +368,21 @@ Server<URV>::peekCommand(const WhisperMessage& req, WhisperMessage& reply)
 	  return true;
 	}
       break;
+    case 'v':
+      {
+	// Address is (chunk << 16) | reg: Peek the 64-bit chunk.
+	unsigned reg = req.address & 0xffff;
+	size_t chunk = req.address >> 16;
+	std::vector<uint8_t> bytes;
+	if (core.peekVecReg(reg, bytes) and chunk*8 < bytes.size())
+	  {
+	    uint64_t val = 0;
+	    memcpy(&val, bytes.data() + chunk*8, 8);
+	    reply.value = val;
+	    return true;
+	  }
+      }
+      break;
     case 'm':
       if (core.peekMemory(req.address, value))
 	{
@@ -460,74 +490,40 @@ Server<URV>::processStepCahnges(Core<URV>& core,
 	}
     }
 
-  // Collect CSR and trigger changes.
-  std::vector<CsrNumber> csrs;
-  std::vector<unsigned> triggers;
-  core.lastCsr(csrs, triggers);
-
-  // Map to keep CSRs in order and to drop duplicate entries.
-  std::map<URV,URV> csrMap;
-
-  // Components of the triggers that changed (if any).
-  std::vector<bool> tdataChanged(3);
-
-  // Collect changed CSRs and their values. Collect components of
-  // changed trigger.
-  for (CsrNumber csr : csrs)
-    {
-      URV value;
-      if (core.peekCsr(csr, value))
-	{
-	  if (csr >= CsrNumber::TDATA1 and csr <= CsrNumber::TDATA3)
-	    {
-	      size_t ix = size_t(csr) - size_t(CsrNumber::TDATA1);
-	      tdataChanged.at(ix) = true;
-	    }
-	  else
-	    csrMap[URV(csr)] = value;
-	}
-    }
-
-  // Collect changes associated with trigger register.
-  for (unsigned trigger : triggers)
+  // Collect vector register changes: One change per 64-bit chunk of
+  // each register of the written group. Address is (chunk << 16) | reg.
+  unsigned groupSize = 0;
+  int vecRegIx = core.lastVecReg(groupSize);
+  std::vector<uint8_t> vecBytes;
+  for (unsigned i = 0; vecRegIx >= 0 and i < groupSize; ++i)
     {
-      URV data1(0), data2(0), data3(0);
-      if (not core.peekTrigger(trigger, data1, data2, data3))
+      if (not core.peekVecReg(vecRegIx + i, vecBytes))
 	continue;
-      if (tdataChanged.at(0))
+      for (size_t chunk = 0; chunk*8 < vecBytes.size(); ++chunk)
 	{
-	  URV addr = (trigger << 16) | unsigned(CsrNumber::TDATA1);
-	  csrMap[addr] = data1;
-	}
-      if (tdataChanged.at(1))
-	{
-	  URV addr = (trigger << 16) | unsigned(CsrNumber::TDATA2);
-	  csrMap[addr] = data2;
-	}
-      if (tdataChanged.at(2))
-	{
-	  URV addr = (trigger << 16) | unsigned(CsrNumber::TDATA3);
-	  csrMap[addr] = data3;
+	  uint64_t val = 0;
+	  memcpy(&val, vecBytes.data() + chunk*8, 8);
+	  WhisperMessage msg;
+	  msg.type = Change;
+	  msg.resource = 'v';
+	  msg.address = (chunk << 16) | (vecRegIx + i);
+	  msg.value = val;
+	  pendingChanges.push_back(msg);
 	}
     }
 
-  for (const auto& [key, val] : csrMap)
-    {
-      WhisperMessage msg(0, Change, 'c', key, val);
-      pendingChanges.push_back(msg);
-    }
-
-  std::vector<size_t> addresses;
-  std::vector<uint32_t> words;
-
-  core.lastMemory(addresses, words);
-  assert(addresses.size() == words.size());
-
-  for (size_t i = 0; i < addresses.size(); ++i)
-    {
-      WhisperMessage msg(0, Change, 'm', addresses.at(i), words.at(i));
-      pendingChanges.push_back(msg);
-    }
+  // Collect CSR and trigger changes (in order of CSR number).
+  auto peekCsr = [&core] (CsrNumber csr, URV& value) {
+    return core.peekCsr(csr, value);
+  };
+  core.forEachCsrChange(peekCsr, [&pendingChanges] (URV key, URV value) {
+      pendingChanges.push_back(WhisperMessage(0, Change, 'c', key, value));
+    });
+
+  // Collect memory changes.
+  core.forEachMemoryChange([&pendingChanges] (size_t addr, uint32_t word) {
+      pendingChanges.push_back(WhisperMessage(0, Change, 'm', addr, word));
+    });
 
   // Add count of changes to reply.
   reply.value = pendingChanges.size();
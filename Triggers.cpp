@@ -85,6 +85,7 @@ Triggers<URV>::writeData1(URV trigIx, bool debugMode, URV value)
   if (prevChain != newChain)
     defineChainBounds();
 
+  updateFilters();
   return true;
 }
 
@@ -96,7 +97,11 @@ Triggers<URV>::writeData2(URV trigger, bool debugMode, URV value)
   if (trigger >= triggers_.size())
     return false;
 
-  return triggers_.at(trigger).writeData2(debugMode, value);
+  if (not triggers_.at(trigger).writeData2(debugMode, value))
+    return false;
+
+  updateFilters();
+  return true;
 }
 
 
@@ -140,8 +145,8 @@ Triggers<URV>::updateChainHitBit(Trigger<URV>& trigger)
 
 template <typename URV>
 bool
-Triggers<URV>::ldStAddrTriggerHit(URV address, TriggerTiming timing,
-				  bool isLoad, bool interruptEnabled)
+Triggers<URV>::evalLdStAddr(URV address, TriggerTiming timing, bool isLoad,
+			    bool interruptEnabled)
 {
   bool hit = false;
   for (auto& trigger : triggers_)
@@ -153,6 +158,7 @@ Triggers<URV>::ldStAddrTriggerHit(URV address, TriggerTiming timing,
 	continue;
 
       trigger.setLocalHit(true);
+      touched_ = true;
 
       if (updateChainHitBit(trigger))
 	hit = true;
@@ -163,8 +169,8 @@ Triggers<URV>::ldStAddrTriggerHit(URV address, TriggerTiming timing,
 
 template <typename URV>
 bool
-Triggers<URV>::ldStDataTriggerHit(URV value, TriggerTiming timing, bool isLoad,
-				  bool interruptEnabled)
+Triggers<URV>::evalLdStData(URV value, TriggerTiming timing, bool isLoad,
+			    bool interruptEnabled)
 {
   bool hit = false;
   for (auto& trigger : triggers_)
@@ -176,6 +182,7 @@ Triggers<URV>::ldStDataTriggerHit(URV value, TriggerTiming timing, bool isLoad,
 	continue;
 
       trigger.setLocalHit(true);
+      touched_ = true;
 
       if (updateChainHitBit(trigger))
 	hit = true;
@@ -187,8 +194,8 @@ Triggers<URV>::ldStDataTriggerHit(URV value, TriggerTiming timing, bool isLoad,
 
 template <typename URV>
 bool
-Triggers<URV>::instAddrTriggerHit(URV address, TriggerTiming timing,
-				  bool interruptEnabled)
+Triggers<URV>::evalInstAddr(URV address, TriggerTiming timing,
+			    bool interruptEnabled)
 {
   bool hit = false;
   for (auto& trigger : triggers_)
@@ -200,6 +207,7 @@ Triggers<URV>::instAddrTriggerHit(URV address, TriggerTiming timing,
 	continue;
 
       trigger.setLocalHit(true);
+      touched_ = true;
 
       if (updateChainHitBit(trigger))
 	hit = true;
@@ -210,8 +218,8 @@ Triggers<URV>::instAddrTriggerHit(URV address, TriggerTiming timing,
 
 template <typename URV>
 bool
-Triggers<URV>::instOpcodeTriggerHit(URV opcode, TriggerTiming timing,
-				    bool interruptEnabled)
+Triggers<URV>::evalInstOpcode(URV opcode, TriggerTiming timing,
+			      bool interruptEnabled)
 {
   bool hit = false;
   for (auto& trigger : triggers_)
@@ -223,6 +231,7 @@ Triggers<URV>::instOpcodeTriggerHit(URV opcode, TriggerTiming timing,
 	continue;
 
       trigger.setLocalHit(true);
+      touched_ = true;
 
       if (updateChainHitBit(trigger))
 	hit = true;
@@ -234,7 +243,7 @@ Triggers<URV>::instOpcodeTriggerHit(URV opcode, TriggerTiming timing,
 
 template <typename URV>
 bool
-Triggers<URV>::icountTriggerHit(bool interruptEnabled)
+Triggers<URV>::evalIcount(bool interruptEnabled)
 {
   bool hit = false;
 
@@ -252,6 +261,7 @@ Triggers<URV>::icountTriggerHit(bool interruptEnabled)
       hit = true;
       trig.setHit(true);
       trig.setLocalHit(true);
+      touched_ = true;
     }
   return hit;
 }
@@ -273,6 +283,7 @@ Triggers<URV>::config(unsigned trigger, URV reset1, URV reset2, URV reset3,
   triggers_.at(trigger).writeData2(true, reset2);  // Define compare mask.
 
   defineChainBounds();
+  updateFilters();
 
   return true;
 }
@@ -285,6 +296,7 @@ Triggers<URV>::reset()
   for (auto& trigger : triggers_)
     trigger.reset();
   defineChainBounds();
+  updateFilters();
 }
 
 
@@ -327,6 +339,7 @@ Triggers<URV>::poke(URV trigger, URV v1, URV v2, URV v3)
   trig.pokeData2(v2);
   trig.pokeData3(v3);
 
+  updateFilters();
   return true;
 }
 
@@ -347,6 +360,7 @@ Triggers<URV>::pokeData1(URV trigger, URV val)
   if (prevChain != newChain)
     defineChainBounds();
 
+  updateFilters();
   return true;
 }
 
@@ -361,6 +375,7 @@ Triggers<URV>::pokeData2(URV trigger, URV val)
   Trigger<URV>& trig = triggers_.at(trigger);
 
   trig.pokeData2(val);
+  updateFilters();
   return true;
 }
 
@@ -420,6 +435,44 @@ Triggers<URV>::defineChainBounds()
 }
 
 
+template <typename URV>
+void
+Triggers<URV>::updateFilters()
+{
+  loadAddr_ = storeAddr_ = loadData_ = storeData_ = TriggerFilter<URV>();
+  instAddr_ = instOpcode_ = TriggerFilter<URV>();
+  hasIcount_ = false;
+
+  // Writes set the modified bit of the written trigger.
+  touched_ = true;
+
+  for (const auto& trig : triggers_)
+    {
+      if (TriggerType(trig.data1_.data1_.type_) == TriggerType::InstCount and
+	  trig.data1_.icount_.m_)
+	hasIcount_ = true;
+
+      if (TriggerType(trig.data1_.data1_.type_) != TriggerType::AddrData or
+	  not trig.data1_.mcontrol_.m_)
+	continue;
+
+      URV low = 0, high = 0;
+      if (not trig.matchRange(low, high))
+	continue;
+
+      const Mcontrol<URV>& ctl = trig.data1_.mcontrol_;
+      bool data = (typename Trigger<URV>::Select(ctl.select_) ==
+		   Trigger<URV>::Select::MatchData);
+      if (ctl.load_)
+	(data ? loadData_ : loadAddr_).add(low, high);
+      if (ctl.store_)
+	(data ? storeData_ : storeAddr_).add(low, high);
+      if (ctl.execute_)
+	(data ? instOpcode_ : instAddr_).add(low, high);
+    }
+}
+
+
 template <typename URV>
 bool
 Trigger<URV>::matchLdStAddr(URV address, TriggerTiming timing, bool isLoad) const
@@ -505,6 +558,40 @@ Trigger<URV>::doMatch(URV item) const
 }
 
 
+template <typename URV>
+bool
+Trigger<URV>::matchRange(URV& low, URV& high) const
+{
+  low = 0;
+  high = ~URV(0);
+
+  switch (Match(data1_.mcontrol_.match_))
+    {
+    case Match::Equal:
+      low = high = data2_;
+      return true;
+
+    case Match::Masked:
+      low = data2_ & data2CompareMask_;
+      high = low | ~data2CompareMask_;
+      return true;
+
+    case Match::GE:
+      low = data2_;
+      return true;
+
+    case Match::LT:
+      if (data2_ == 0)
+	return false;
+      high = data2_ - 1;
+      return true;
+
+    default:
+      return true;  // Half-word compares: Anything may match.
+    }
+}
+
+
 template <typename URV>
 bool
 Trigger<URV>::matchInstAddr(URV address, TriggerTiming timing) const
@@ -22,6 +22,7 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <algorithm>
 
 namespace WdRiscv
 {
@@ -80,12 +81,15 @@ namespace WdRiscv
     unsigned timing_  : 1;
     unsigned select_  : 1;
     unsigned hit_     : 1;
-    unsigned          : 32;  // 8*sizeof(URV) - 32;
+    uint64_t          : 32;  // 8*sizeof(URV) - 32: Bits 21 to 52.
     unsigned maskMax_ : 6;
     unsigned dmode_   : 1;
     unsigned type_    : 4;
   };
 
+  static_assert(sizeof(Mcontrol<uint64_t>) == sizeof(uint64_t),
+		"Mcontrol fields must fit in tdata1");
+
 
   // Bit fields for Icount trigger register view.
   template <typename URV>
@@ -355,6 +359,10 @@ namespace WdRiscv
     /// according to the match field.
     bool doMatch(URV item) const;
 
+    /// Set low/high to the bounds of the items that doMatch may
+    /// accept. Return false if it accepts none.
+    bool matchRange(URV& low, URV& high) const;
+
     /// Set the hit bit of this trigger. For a chained trigger, this
     /// should be called only if all the triggers in the chain have
     /// tripped.
@@ -504,6 +512,33 @@ namespace WdRiscv
   };
 
 
+  /// Conservative summary of the enabled triggers of one kind (e.g.
+  /// load-address): None of them can match an item (address, data
+  /// value or opcode) outside of [low_, high_]. Empty if low_ > high_.
+  template <typename URV>
+  struct TriggerFilter
+  {
+    bool mayMatch(URV item) const
+    { return item >= low_ and item <= high_; }
+
+    /// Widen the filter to cover [low, high].
+    void add(URV low, URV high)
+    {
+      if (low_ > high_)
+	{
+	  low_ = low;
+	  high_ = high;
+	  return;
+	}
+      low_ = std::min(low_, low);
+      high_ = std::max(high_, high);
+    }
+
+    URV low_ = 1;
+    URV high_ = 0;
+  };
+
+
   template <typename URV>
   class Triggers
   {
@@ -583,16 +618,41 @@ namespace WdRiscv
     /// the triggers in that chain. If the trigger action is
     /// contingent on interrupts being enabled (ie == true), then the
     /// trigger will not trip even if its condition is satisfied.
-    bool ldStAddrTriggerHit(URV address, TriggerTiming, bool isLoad, bool ie);
+    /// Most accesses match no trigger: They are rejected by a filter
+    /// rebuilt whenever a trigger changes, without visiting the
+    /// triggers.
+    bool ldStAddrTriggerHit(URV address, TriggerTiming timing, bool isLoad,
+			    bool ie)
+    {
+      if (not (isLoad ? loadAddr_ : storeAddr_).mayMatch(address))
+	return false;
+      return evalLdStAddr(address, timing, isLoad, ie);
+    }
 
     /// Similar to ldStAddrTriggerHit but for data match.
-    bool ldStDataTriggerHit(URV value, TriggerTiming, bool isLoad, bool ie);
+    bool ldStDataTriggerHit(URV value, TriggerTiming timing, bool isLoad,
+			    bool ie)
+    {
+      if (not (isLoad ? loadData_ : storeData_).mayMatch(value))
+	return false;
+      return evalLdStData(value, timing, isLoad, ie);
+    }
 
     /// Similar to ldStAddrTriggerHit but for instruction address.
-    bool instAddrTriggerHit(URV address, TriggerTiming timing, bool ie);
+    bool instAddrTriggerHit(URV address, TriggerTiming timing, bool ie)
+    {
+      if (not instAddr_.mayMatch(address))
+	return false;
+      return evalInstAddr(address, timing, ie);
+    }
 
     /// Similar to instAddrTriggerHit but for instruction opcode.
-    bool instOpcodeTriggerHit(URV opcode, TriggerTiming timing, bool ie);
+    bool instOpcodeTriggerHit(URV opcode, TriggerTiming timing, bool ie)
+    {
+      if (not instOpcode_.mayMatch(opcode))
+	return false;
+      return evalInstOpcode(opcode, timing, ie);
+    }
 
     /// Make every active icount trigger count down unless it was
     /// written by the current instruction. If a count-down register
@@ -601,7 +661,12 @@ namespace WdRiscv
     /// interrupts are disabled), then consider the trigger as having
     /// tripped and set its hit bit to 1. Return true if any icount
     /// trigger trips; otherwise, return false.
-    bool icountTriggerHit(bool interruptEnabled);
+    bool icountTriggerHit(bool interruptEnabled)
+    {
+      if (not hasIcount_)
+	return false;
+      return evalIcount(interruptEnabled);
+    }
 
     /// Reset the given trigger with the given data1, data2, and data3
     /// values and corresponding write and poke masks. Values are applied
@@ -641,6 +706,9 @@ namespace WdRiscv
     /// last instruction.
     void clearLastWrittenTriggers()
     {
+      if (not touched_)
+	return;
+      touched_ = false;
       for (auto& trig : triggers_)
 	{
 	  trig.setLocalHit(false);
@@ -649,6 +717,11 @@ namespace WdRiscv
 	}
     }
 
+    /// Return true if the given trigger was written by the last
+    /// instruction.
+    bool isLastWritten(unsigned trigger) const
+    { return trigger < triggers_.size() and triggers_[trigger].isModified(); }
+
     /// Fill the trigs vector with the indices of the triggers written
     /// by the last instruction.
     void getLastWrittenTriggers(std::vector<unsigned>& trigs) const
@@ -698,9 +771,30 @@ namespace WdRiscv
     /// Define the chain bounds of each trigger.
     void defineChainBounds();
 
+    /// Rebuild the filters from the enabled triggers. Called whenever
+    /// a trigger is written, poked, configured or reset.
+    void updateFilters();
+
+    /// Helpers to ldStAddrTriggerHit, ldStDataTriggerHit,
+    /// instAddrTriggerHit and instOpcodeTriggerHit: Visit the
+    /// triggers.
+    bool evalLdStAddr(URV address, TriggerTiming, bool isLoad, bool ie);
+    bool evalLdStData(URV value, TriggerTiming, bool isLoad, bool ie);
+    bool evalInstAddr(URV address, TriggerTiming, bool ie);
+    bool evalInstOpcode(URV opcode, TriggerTiming, bool ie);
+    bool evalIcount(bool interruptEnabled);
+
   private:
 
     std::vector< Trigger<URV> > triggers_;
     bool chainPairs_ = false;
+
+    TriggerFilter<URV> loadAddr_, storeAddr_, loadData_, storeData_;
+    TriggerFilter<URV> instAddr_, instOpcode_;
+    bool hasIcount_ = false;  // True if an icount trigger is enabled.
+
+    // True if a trigger may have been written or hit since the last
+    // clearLastWrittenTriggers (which is then a no-op otherwise).
+    bool touched_ = false;
   };
 }
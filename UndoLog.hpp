@@ -0,0 +1,70 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace WdRiscv
+{
+
+  /// Undo log of a hart: Records the previous value of each register,
+  /// CSR and memory location modified during a what-if sequence (see
+  /// Core::whatIfBegin) so that the sequence can be rolled back in
+  /// time proportional to the number of changes. Entries are undone
+  /// in the reverse order of their recording.
+  class UndoLog
+  {
+  public:
+
+    /// Kind of resource of an entry. A page table entry is a memory
+    /// location written by the page table walker: Undoing it requires
+    /// a TLB flush.
+    enum class Kind : uint8_t { IntReg, FpReg, Csr, Memory, Pte };
+
+    struct Entry
+    {
+      Kind kind_ = Kind::IntReg;
+      uint8_t size_ = 0;    // Size in bytes of a memory entry.
+      uint64_t index_ = 0;  // Register number, CSR number or address.
+      uint64_t value_ = 0;  // Previous value.
+    };
+
+    /// Record the previous value of the given resource. The size is
+    /// that of a memory entry (at most 8 bytes).
+    void add(Kind kind, uint64_t index, uint64_t value, unsigned size = 0)
+    { entries_.push_back(Entry{kind, uint8_t(size), index, value}); }
+
+    /// Return the recorded entries, oldest first.
+    const std::vector<Entry>& entries() const
+    { return entries_; }
+
+    bool empty() const
+    { return entries_.empty(); }
+
+    /// Drop all entries keeping the capacity: A log reused across
+    /// sequences does not allocate.
+    void clear()
+    { entries_.clear(); }
+
+  private:
+
+    std::vector<Entry> entries_;
+  };
+}
@@ -0,0 +1,239 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace WdRiscv
+{
+
+  template <typename URV>
+  class Core;
+
+  /// Model a RISCV vector register file: 32 registers of VLEN bits
+  /// each. The registers are stored back to back so that a register
+  /// group (LMUL > 1) is a plain array of elements that the host
+  /// compiler can vectorize loops over. Also hold the decoded
+  /// contents of the vl and vtype CSRs.
+  class VecRegs
+  {
+  public:
+
+    friend class Core<uint32_t>;
+    friend class Core<uint64_t>;
+
+    /// Constructor: Define a register file of 32 registers of the
+    /// given width in bits. All registers initialized to zero.
+    VecRegs(unsigned bitsPerReg = 128)
+    { setBitsPerReg(bitsPerReg); }
+
+    /// Return the count of registers in this register file.
+    size_t size() const
+    { return regCount_; }
+
+    /// Return the number of bits in a register (VLEN).
+    unsigned bitsPerReg() const
+    { return bytesPerReg_*8; }
+
+    /// Return the number of bytes in a register (value of vlenb).
+    unsigned bytesPerReg() const
+    { return bytesPerReg_; }
+
+    /// Change the number of bits in a register. Clear all registers.
+    /// Return false leaving register file unmodified if bits is not a
+    /// power of 2 between 64 and 65536.
+    bool setBitsPerReg(unsigned bits)
+    {
+      if (bits < 64 or bits > 65536 or (bits & (bits - 1)) != 0)
+	return false;
+      bytesPerReg_ = bits / 8;
+      // Extra 8 registers at the end: Scratch area for results that
+      // must not be written in place (slides, gathers, widening).
+      data_.assign(size_t(bytesPerReg_) * (regCount_ + 8), 0);
+      reset();
+      return true;
+    }
+
+    /// Set bytes to the contents of the given register (least
+    /// significant byte first) returning true on success. Return
+    /// false leaving bytes unmodified if reg is out of bounds.
+    bool peek(unsigned reg, std::vector<uint8_t>& bytes) const
+    {
+      if (reg >= regCount_)
+	return false;
+      const uint8_t* data = regData(reg);
+      bytes.assign(data, data + bytesPerReg_);
+      return true;
+    }
+
+    /// Set the contents of the given register from the given bytes
+    /// (least significant byte first) returning true on success. Missing
+    /// bytes are set to zero and extra bytes ignored. Return false if
+    /// reg is out of bounds.
+    bool poke(unsigned reg, const std::vector<uint8_t>& bytes)
+    {
+      if (reg >= regCount_)
+	return false;
+      uint8_t* data = regData(reg);
+      for (unsigned i = 0; i < bytesPerReg_; ++i)
+	data[i] = i < bytes.size() ? bytes[i] : 0;
+      return true;
+    }
+
+    /// Return the current selected element width in bits (SEW).
+    unsigned sew() const
+    { return sew_; }
+
+    /// Return the current vector length (value of vl).
+    unsigned vl() const
+    { return vl_; }
+
+    /// Return the base 2 logarithm of the current register group
+    /// multiplier (LMUL): -3 to 3.
+    int lmulLog2() const
+    { return lmulLog2_; }
+
+    /// Return the number of registers in a group: LMUL or 1 for a
+    /// fractional LMUL.
+    unsigned groupSize() const
+    { return lmulLog2_ > 0 ? 1 << lmulLog2_ : 1; }
+
+    /// Return true if vtype holds an unsupported value.
+    bool vill() const
+    { return vill_; }
+
+    /// Return the maximum number of elements of a group for the given
+    /// element width and LMUL (base 2 logarithm).
+    unsigned vlmax(unsigned sew, int lmulLog2) const
+    {
+      unsigned elems = bytesPerReg_ * 8 / sew;
+      return lmulLog2 >= 0 ? elems << lmulLog2 : elems >> -lmulLog2;
+    }
+
+  protected:
+
+    void reset()
+    {
+      for (auto& byte : data_)
+	byte = 0;
+      sew_ = 8;
+      lmulLog2_ = 0;
+      vl_ = 0;
+      vill_ = true;
+      clearLastWrittenReg();
+    }
+
+    /// Return pointer to the first byte of the given register.
+    uint8_t* regData(unsigned reg)
+    { return data_.data() + size_t(reg) * bytesPerReg_; }
+
+    const uint8_t* regData(unsigned reg) const
+    { return data_.data() + size_t(reg) * bytesPerReg_; }
+
+    /// Return a pointer to the elements of the group starting with the
+    /// given register viewed as an array of T.
+    template <typename T>
+    T* elems(unsigned reg)
+    { return reinterpret_cast<T*>(regData(reg)); }
+
+    /// Return a pointer to the scratch area which can hold a group of
+    /// 8 registers.
+    template <typename T>
+    T* scratch()
+    { return reinterpret_cast<T*>(regData(regCount_)); }
+
+    /// Return the ith bit of the mask held in the given register.
+    bool maskBit(unsigned reg, unsigned i) const
+    { return (regData(reg)[i >> 3] >> (i & 7)) & 1; }
+
+    /// Set the ith bit of the mask held in the given register.
+    void setMaskBit(unsigned reg, unsigned i, bool flag)
+    {
+      uint8_t& byte = regData(reg)[i >> 3];
+      byte = (byte & ~(1 << (i & 7))) | (unsigned(flag) << (i & 7));
+    }
+
+    /// Decode and cache the given vtype and vl values. Return false if
+    /// vtype is not supported, in which case vill is set.
+    bool setVtype(uint64_t vtype, bool vill, unsigned vl)
+    {
+      unsigned sewCode = (vtype >> 3) & 7, lmulCode = vtype & 7;
+      unsigned sew = 8 << sewCode;
+      int lmulLog2 = lmulCode < 4 ? lmulCode : int(lmulCode) - 8;
+
+      // Reserved fields and encodings, and fractional LMUL with SEW
+      // larger than ELEN*LMUL (ELEN is 64), are not supported.
+      if (vill or (vtype >> 8) != 0 or sewCode > 3 or lmulCode == 4 or
+	  (lmulLog2 < 0 and (sew << -lmulLog2) > 64))
+	{
+	  vill_ = true;
+	  vl_ = 0;
+	  return false;
+	}
+
+      vill_ = false;
+      sew_ = sew;
+      lmulLog2_ = lmulLog2;
+      vl_ = vl;
+      return true;
+    }
+
+    /// Clear the record of the last written register group.
+    void clearLastWrittenReg()
+    {
+      lastWrittenReg_ = -1;
+      lastGroupSize_ = 0;
+    }
+
+    /// Record that the last executed instruction wrote the group of
+    /// count registers starting with reg.
+    void setLastWrittenReg(unsigned reg, unsigned count)
+    {
+      lastWrittenReg_ = reg;
+      lastGroupSize_ = count;
+    }
+
+    /// Return the number of the first register of the group written
+    /// by the last executed instruction or -1 if no vector register was
+    /// written since the last clearLastWrittenReg. Set groupSize to the
+    /// number of registers in that group.
+    int getLastWrittenReg(unsigned& groupSize) const
+    {
+      groupSize = lastGroupSize_;
+      return lastWrittenReg_;
+    }
+
+  private:
+
+    static constexpr unsigned regCount_ = 32;
+
+    std::vector<uint8_t> data_;   // Register contents followed by scratch.
+    unsigned bytesPerReg_ = 16;   // VLEN/8.
+    unsigned sew_ = 8;            // Selected element width in bits.
+    int lmulLog2_ = 0;            // Base 2 logarithm of LMUL.
+    unsigned vl_ = 0;             // Vector length.
+    bool vill_ = true;            // True if vtype is illegal.
+    int lastWrittenReg_ = -1;     // First reg of group written by last inst.
+    unsigned lastGroupSize_ = 0;  // Size of group written by last inst.
+  };
+}
@@ -0,0 +1,363 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <iostream>
+#include <boost/format.hpp>
+#include "VirtMem.hpp"
+
+
+using namespace WdRiscv;
+
+
+const Tlb::Entry*
+Tlb::findLarge(uint64_t vpn, uint32_t asid) const
+{
+  for (const auto& entry : large_)
+    if (matches(entry, vpn, asid))
+      return &entry;
+  return nullptr;
+}
+
+
+void
+Tlb::insert(const Entry& entry)
+{
+  if (entry.mask_ == 0)
+    {
+      small_[entry.vpn_ & (smallSize_ - 1)] = entry;
+      return;
+    }
+
+  // Replace the entry of the same page (its A/D bits may have
+  // changed), otherwise the next one in round-robin order.
+  for (auto& large : large_)
+    if (large.valid_ and large.vpn_ == entry.vpn_ and
+	large.mask_ == entry.mask_ and large.asid_ == entry.asid_)
+      {
+	large = entry;
+	return;
+      }
+
+  large_[nextLarge_] = entry;
+  nextLarge_ = (nextLarge_ + 1) % largeSize_;
+}
+
+
+void
+Tlb::flush(bool allVa, uint64_t vpn, bool allAsid, uint32_t asid)
+{
+  auto flushEntry = [allVa, vpn, allAsid, asid] (Entry& entry) {
+    if (not allVa and (vpn & ~entry.mask_) != entry.vpn_)
+      return;
+    if (not allAsid and (entry.asid_ != asid or (entry.pte_ & globalBit_)))
+      return;
+    entry.valid_ = false;
+  };
+
+  for (auto& entry : small_)
+    flushEntry(entry);
+  for (auto& entry : large_)
+    flushEntry(entry);
+}
+
+
+void
+VirtMem::setSatp(Mode mode, uint32_t asid, uint64_t rootPpn)
+{
+  if (mode != mode_)
+    {
+      itlb_.flush(true, 0, true, 0);
+      dtlb_.flush(true, 0, true, 0);
+    }
+
+  mode_ = mode;
+  asid_ = asid;
+  rootPpn_ = rootPpn;
+  updateActive();
+}
+
+
+void
+VirtMem::setPrivilege(PrivilegeMode instMode, PrivilegeMode dataMode,
+		      bool sum, bool mxr)
+{
+  instMode_ = instMode;
+  dataMode_ = dataMode;
+  sum_ = sum;
+  mxr_ = mxr;
+  updateActive();
+}
+
+
+void
+VirtMem::updateActive()
+{
+  clearWindows();
+
+  instActive_ = mode_ != Bare and instMode_ != PrivilegeMode::Machine;
+  dataActive_ = mode_ != Bare and dataMode_ != PrivilegeMode::Machine;
+}
+
+
+void
+VirtMem::flush(bool allVa, uint64_t va, bool allAsid, uint32_t asid)
+{
+  uint64_t vpn = va >> pageShift;
+  itlb_.flush(allVa, vpn, allAsid, asid);
+  dtlb_.flush(allVa, vpn, allAsid, asid);
+  clearWindows();
+}
+
+
+bool
+VirtMem::isAllowed(uint8_t pte, PrivilegeMode mode,
+		   PmpManager::Access access) const
+{
+  // User pages are accessible in supervisor mode only for loads and
+  // stores and only if SUM is set. Supervisor pages are never
+  // accessible in user mode.
+  bool user = pte & U;
+  if (mode == PrivilegeMode::User and not user)
+    return false;
+  if (mode == PrivilegeMode::Supervisor and user and
+      ((access & PmpManager::Exec) or not sum_))
+    return false;
+
+  if (access & PmpManager::Exec)
+    return pte & X;
+
+  bool readable = (pte & R) or (mxr_ and (pte & X));
+  if ((access & PmpManager::Read) and not readable)
+    return false;
+  if ((access & PmpManager::Write) and not (pte & W))
+    return false;
+  return true;
+}
+
+
+bool
+VirtMem::readPte(uint64_t addr, uint64_t& pte) const
+{
+  // Page table accesses are checked by PMP as supervisor accesses.
+  if (mode_ == Sv32)
+    {
+      uint32_t val = 0;
+      if (not pmp_.isAllowed(addr, 4, PrivilegeMode::Supervisor,
+			     PmpManager::Read) or
+	  not memory_.read(addr, val))
+	return false;
+      pte = val;
+      return true;
+    }
+
+  return (pmp_.isAllowed(addr, 8, PrivilegeMode::Supervisor,
+			 PmpManager::Read) and
+	  memory_.read(addr, pte));
+}
+
+
+template <typename T>
+bool
+VirtMem::casPte(uint64_t addr, uint64_t& pte, uint64_t next, bool& changed)
+{
+  // Like the AMO fast path: A host compare-and-swap in regular memory,
+  // a plain write elsewhere.
+  T* ptr = memory_.atomicPtr<T>(addr);
+  if (not ptr)
+    return memory_.write(addr, T(next));
+
+  T expected = T(pte);
+  if (__atomic_compare_exchange_n(ptr, &expected, T(next), false,
+				  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    return true;
+
+  pte = expected;
+  changed = true;
+  return false;
+}
+
+
+bool
+VirtMem::updatePte(uint64_t addr, uint64_t& pte, uint64_t bits,
+		   bool& changed)
+{
+  changed = false;
+  unsigned size = mode_ == Sv32 ? 4 : 8;
+  if (not pmp_.isAllowed(addr, size, PrivilegeMode::Supervisor,
+			 PmpManager::Write))
+    return false;
+
+  uint64_t prev = pte;
+  bool ok = (mode_ == Sv32 ? casPte<uint32_t>(addr, pte, pte | bits, changed) :
+	     casPte<uint64_t>(addr, pte, pte | bits, changed));
+  if (not ok)
+    return false;
+
+  if (undoLog_)
+    undoLog_->add(UndoLog::Kind::Pte, addr, prev, size);
+  memory_.invalidateReservations(addr, size);
+  pte = prev | bits;
+  return true;
+}
+
+
+VirtMem::Result
+VirtMem::translateWindow(Window& window, Tlb& tlb, uint64_t va,
+			 PrivilegeMode mode, PmpManager::Access access,
+			 uint64_t& pa)
+{
+  Result result = translate(tlb, va, mode, access, pa);
+  if (result == Result::Ok)
+    {
+      window.va_ = (va >> pageShift) << pageShift;
+      window.pa_ = (pa >> pageShift) << pageShift;
+      window.span_ = pageSize;
+    }
+  return result;
+}
+
+
+VirtMem::Result
+VirtMem::translate(Tlb& tlb, uint64_t va, PrivilegeMode mode,
+		   PmpManager::Access access, uint64_t& pa)
+{
+  bool isInst = &tlb == &itlb_;
+
+  // In Sv39 bits 63 to 39 of the address must all equal bit 38.
+  if (mode_ == Sv39 and uint64_t((int64_t(va) << 25) >> 25) != va)
+    return Result::PageFault;
+
+  uint64_t vpn = va >> pageShift;
+  const Tlb::Entry* entry = tlb.find(vpn, asid_);
+
+  // A store to a clean page is a miss: The walk sets the dirty bit.
+  if (entry and isAllowed(entry->pte_, mode, access) and
+      (not (access & PmpManager::Write) or (entry->pte_ & D)))
+    {
+      isInst ? ++instHits_ : ++dataHits_;
+      uint64_t ppn = entry->ppn_ | (vpn & entry->mask_);
+      pa = (ppn << pageShift) | (va & (pageSize - 1));
+      return Result::Ok;
+    }
+
+  isInst ? ++instMisses_ : ++dataMisses_;
+  return walk(tlb, va, mode, access, pa);
+}
+
+
+VirtMem::Result
+VirtMem::walk(Tlb& tlb, uint64_t va, PrivilegeMode mode,
+	      PmpManager::Access access, uint64_t& pa)
+{
+  bool sv32 = mode_ == Sv32;
+  int levels = sv32 ? 2 : 3;
+  unsigned vpnBits = sv32 ? 10 : 9;
+  unsigned pteSize = sv32 ? 4 : 8;
+  uint64_t ppnMask = sv32 ? 0x3fffff : (uint64_t(1) << 44) - 1;
+
+  uint64_t vpn = va >> pageShift;
+  uint64_t table = rootPpn_ << pageShift;
+
+  for (int level = levels - 1; level >= 0; --level)
+    {
+      uint64_t index = (vpn >> (level*vpnBits)) & ((1u << vpnBits) - 1);
+      uint64_t pteAddr = table + index*pteSize;
+
+      uint64_t pte = 0;
+      if (not readPte(pteAddr, pte))
+	return Result::AccessFault;
+
+      if (not (pte & V) or ((pte & W) and not (pte & R)))
+	return Result::PageFault;
+
+      // Bits 63 to 54 of an Sv39 entry are reserved.
+      if (not sv32 and (pte >> 54) != 0)
+	return Result::PageFault;
+
+      uint64_t ppn = (pte >> 10) & ppnMask;
+
+      // Physical addresses of RV32 are limited to 32 bits.
+      if (sv32 and (ppn >> 20) != 0)
+	return Result::AccessFault;
+
+      if (not (pte & (R | X)))
+	{
+	  // Pointer to next level. Bits D, A and U are reserved.
+	  if (pte & (D | A | U))
+	    return Result::PageFault;
+	  table = ppn << pageShift;
+	  continue;
+	}
+
+      if (not isAllowed(uint8_t(pte), mode, access))
+	return Result::PageFault;
+
+      // A large page must be aligned to its size.
+      uint64_t mask = (uint64_t(1) << (level*vpnBits)) - 1;
+      if (ppn & mask)
+	return Result::PageFault;
+
+      uint64_t update = A;
+      if (access & PmpManager::Write)
+	update |= D;
+      if ((pte & update) != update)
+	{
+	  bool changed = false;
+	  if (not updatePte(pteAddr, pte, update, changed))
+	    {
+	      if (not changed)
+		return Result::AccessFault;
+	      ++level;  // Changed by another hart: Check the entry again.
+	      continue;
+	    }
+	}
+
+      Tlb::Entry entry;
+      entry.vpn_ = vpn & ~mask;
+      entry.ppn_ = ppn;
+      entry.mask_ = mask;
+      entry.asid_ = asid_;
+      entry.pte_ = uint8_t(pte);
+      entry.valid_ = true;
+      tlb.insert(entry);
+
+      pa = ((ppn | (vpn & mask)) << pageShift) | (va & (pageSize - 1));
+      return Result::Ok;
+    }
+
+  return Result::PageFault;  // No leaf entry.
+}
+
+
+void
+VirtMem::printStats(std::ostream& out, unsigned hartId) const
+{
+  auto print = [&out, hartId] (const char* tag, uint64_t hits,
+			       uint64_t misses) {
+    uint64_t total = hits + misses;
+    if (total == 0)
+      return;
+    out << "Hart " << hartId << ' ' << tag << ": " << total
+	<< " lookups, " << misses << " misses, "
+	<< (boost::format("%.2f%%") % (100.0*double(hits)/double(total)))
+	<< " hit rate\n";
+  };
+
+  print("ITLB", instHits_, instMisses_);
+  print("DTLB", dataHits_, dataMisses_);
+}
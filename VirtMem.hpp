@@ -0,0 +1,256 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include "Memory.hpp"
+#include "PmpManager.hpp"
+#include "UndoLog.hpp"
+
+namespace WdRiscv
+{
+
+  /// Translation lookaside buffer: Caches leaf page table entries
+  /// tagged by virtual page number and address space id. Base pages
+  /// live in a direct mapped array indexed by virtual page number.
+  /// Large pages (megapages/gigapages) live in a small fully
+  /// associative array replaced round-robin.
+  class Tlb
+  {
+  public:
+
+    struct Entry
+    {
+      uint64_t vpn_ = 0;    // Virtual page number of first page.
+      uint64_t ppn_ = 0;    // Physical page number of first page.
+      uint64_t mask_ = 0;   // Page number bits spanned by a large page.
+      uint32_t asid_ = 0;
+      uint8_t pte_ = 0;     // Bits V R W X U G A D of the leaf PTE.
+      bool valid_ = false;
+    };
+
+    /// Return the entry mapping the given virtual page number in the
+    /// given address space or nullptr if there is no such entry.
+    const Entry* find(uint64_t vpn, uint32_t asid) const
+    {
+      const Entry& entry = small_[vpn & (smallSize_ - 1)];
+      if (matches(entry, vpn, asid))
+	return &entry;
+      return findLarge(vpn, asid);
+    }
+
+    /// Insert given entry replacing any entry for the same page.
+    void insert(const Entry& entry);
+
+    /// Invalidate the entries selected by an sfence.vma: All entries
+    /// if allVa and allAsid are both true, otherwise the ones mapping
+    /// vpn (unless allVa) in address space asid (unless allAsid).
+    /// Global entries are kept when a specific asid is given.
+    void flush(bool allVa, uint64_t vpn, bool allAsid, uint32_t asid);
+
+  protected:
+
+    static bool matches(const Entry& entry, uint64_t vpn, uint32_t asid)
+    {
+      return (entry.valid_ and (vpn & ~entry.mask_) == entry.vpn_ and
+	      (entry.asid_ == asid or (entry.pte_ & globalBit_)));
+    }
+
+    const Entry* findLarge(uint64_t vpn, uint32_t asid) const;
+
+  private:
+
+    static constexpr unsigned smallSize_ = 64;  // Power of 2.
+    static constexpr unsigned largeSize_ = 8;
+    static constexpr uint8_t globalBit_ = 0x20;
+
+    Entry small_[smallSize_];
+    Entry large_[largeSize_];
+    unsigned nextLarge_ = 0;  // Next large entry to replace.
+  };
+
+
+  /// Supervisor address translation (Sv32 in RV32 and Sv39 in RV64).
+  /// Translation state is derived from satp and mstatus by the hart
+  /// (see setSatp and setPrivilege). Page tables are walked in the
+  /// simulated memory only on a TLB miss. Accessed and dirty bits are
+  /// set by the walk. Page table accesses are subject to PMP.
+  class VirtMem
+  {
+  public:
+
+    /// Translation mode: Field MODE of satp.
+    enum Mode { Bare = 0, Sv32 = 1, Sv39 = 8 };
+
+    /// Outcome of a translation.
+    enum class Result { Ok, PageFault, AccessFault };
+
+    static constexpr unsigned pageShift = 12;
+    static constexpr uint64_t pageSize = uint64_t(1) << pageShift;
+
+    VirtMem(Memory& memory, PmpManager& pmp)
+      : memory_(memory), pmp_(pmp)
+    { }
+
+    /// Define the translation mode, the current address space id and
+    /// the physical page number of the root page table (the fields of
+    /// satp). Changing the mode flushes the TLBs.
+    void setSatp(Mode mode, uint32_t asid, uint64_t rootPpn);
+
+    /// Define the effective privilege modes of instruction fetches
+    /// and of data accesses (these differ when mstatus.MPRV is set)
+    /// and the mstatus SUM and MXR bits.
+    void setPrivilege(PrivilegeMode instMode, PrivilegeMode dataMode,
+		      bool sum, bool mxr);
+
+    /// Return true if instruction addresses are translated.
+    bool isInstActive() const
+    { return instActive_; }
+
+    /// Return true if data addresses are translated.
+    bool isDataActive() const
+    { return dataActive_; }
+
+    /// Translate the virtual address of an instruction fetch setting
+    /// pa to the corresponding physical address on success. The hart
+    /// keeps its own window of the last page fetched and calls this
+    /// only when a fetch falls outside of it.
+    Result translateInst(uint64_t va, uint64_t& pa)
+    { return translate(itlb_, va, instMode_, PmpManager::Exec, pa); }
+
+    /// Translate the virtual address of a data access of the given
+    /// type (Read|Write for an AMO). Writable pages are readable, so
+    /// AMOs share the window of stores.
+    Result translateData(uint64_t va, PmpManager::Access access,
+			 uint64_t& pa)
+    {
+      Window& window = access == PmpManager::Read ? readWindow_ : writeWindow_;
+      if (window.hit(va, pa))
+	{
+	  ++dataHits_;
+	  return Result::Ok;
+	}
+      return translateWindow(window, dtlb_, va, dataMode_, access, pa);
+    }
+
+    /// Execute an sfence.vma: See Tlb::flush.
+    void flush(bool allVa, uint64_t va, bool allAsid, uint32_t asid);
+
+    /// Record the address and previous value of each page table entry
+    /// updated by a walk in the given log. Pass nullptr to stop
+    /// recording.
+    void setUndoLog(UndoLog* log)
+    { undoLog_ = log; }
+
+    /// Print the TLB hit statistics of the given hart. Print nothing
+    /// if no address was ever translated.
+    void printStats(std::ostream& out, unsigned hartId) const;
+
+  protected:
+
+    /// The last page translated for a kind of data access (load or
+    /// store). Covers nothing when span_ is zero.
+    struct Window
+    {
+      bool hit(uint64_t va, uint64_t& pa) const
+      {
+	uint64_t offset = va - va_;
+	if (offset >= span_)
+	  return false;
+	pa = pa_ + offset;
+	return true;
+      }
+
+      uint64_t va_ = 0;
+      uint64_t pa_ = 0;
+      uint64_t span_ = 0;
+    };
+
+    /// Translate through the given TLB and on success make the page
+    /// of va the given window.
+    Result translateWindow(Window& window, Tlb& tlb, uint64_t va,
+			   PrivilegeMode mode, PmpManager::Access access,
+			   uint64_t& pa);
+
+    /// Empty all the windows. Called when the translation state
+    /// changes or the TLBs are flushed.
+    void clearWindows()
+    { readWindow_.span_ = writeWindow_.span_ = 0; }
+
+    Result translate(Tlb& tlb, uint64_t va, PrivilegeMode mode,
+		     PmpManager::Access access, uint64_t& pa);
+
+    /// Walk the page table on a TLB miss, update the A/D bits of the
+    /// leaf entry and insert it in the given TLB.
+    Result walk(Tlb& tlb, uint64_t va, PrivilegeMode mode,
+		PmpManager::Access access, uint64_t& pa);
+
+    /// Return true if the given leaf PTE bits grant the access.
+    bool isAllowed(uint8_t pte, PrivilegeMode mode,
+		   PmpManager::Access access) const;
+
+    bool readPte(uint64_t addr, uint64_t& pte) const;
+
+    /// Set the given bits (accessed/dirty) in the page table entry at
+    /// the given address read as pte. Other harts may change the entry
+    /// concurrently: Return false setting changed if it no longer holds
+    /// pte (pte is then updated to its current value). Return false
+    /// with changed cleared on an access fault.
+    bool updatePte(uint64_t addr, uint64_t& pte, uint64_t bits,
+		   bool& changed);
+
+    /// Helper to updatePte: Compare-and-swap the entry of type T.
+    template <typename T>
+    bool casPte(uint64_t addr, uint64_t& pte, uint64_t next, bool& changed);
+
+    /// Recompute instActive_ and dataActive_.
+    void updateActive();
+
+  private:
+
+    enum PteBits { V = 1, R = 2, W = 4, X = 8, U = 0x10, G = 0x20, A = 0x40,
+		   D = 0x80 };
+
+    Memory& memory_;
+    PmpManager& pmp_;
+
+    Mode mode_ = Bare;
+    uint32_t asid_ = 0;
+    uint64_t rootPpn_ = 0;
+
+    PrivilegeMode instMode_ = PrivilegeMode::Machine;
+    PrivilegeMode dataMode_ = PrivilegeMode::Machine;
+    bool sum_ = false;
+    bool mxr_ = false;
+    bool instActive_ = false;
+    bool dataActive_ = false;
+
+    Tlb itlb_;
+    Tlb dtlb_;
+
+    Window readWindow_;
+    Window writeWindow_;
+
+    UndoLog* undoLog_ = nullptr;  // Non-null during a what-if sequence.
+
+    uint64_t instHits_ = 0, instMisses_ = 0;
+    uint64_t dataHits_ = 0, dataMisses_ = 0;
+  };
+}
@@ -0,0 +1,170 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Merge functional coverage files produced by whisper --funccoverage
+// and report the merged coverage.
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include "FuncCoverage.hpp"
+#include "InstInfo.hpp"
+
+
+using namespace WdRiscv;
+
+typedef std::vector<std::string> StringVec;
+
+
+/// Append to files the non-empty lines of the given list file. Return
+/// true on success and false if file cannot be read.
+static bool
+readFileList(const std::string& listFile, StringVec& files)
+{
+  std::ifstream in(listFile);
+  if (not in)
+    {
+      std::cerr << "Failed to open file list '" << listFile << "'\n";
+      return false;
+    }
+  std::string line;
+  while (std::getline(in, line))
+    if (not line.empty())
+      files.push_back(line);
+  return true;
+}
+
+
+/// Merge the given coverage files into result using the given number
+/// of threads. Return the number of files that could not be loaded.
+static unsigned
+mergeFiles(const StringVec& files, unsigned threadCount, FuncCoverage& result)
+{
+  std::vector<FuncCoverage> partial(threadCount);
+  std::atomic<size_t> next(0);
+  std::atomic<unsigned> errors(0);
+
+  auto worker = [&] (unsigned ix) {
+		  size_t fileIx;
+		  while ((fileIx = next++) < files.size())
+		    if (not partial.at(ix).load(files.at(fileIx)))
+		      errors++;
+		};
+
+  std::vector<std::thread> threads;
+  for (unsigned ix = 0; ix < threadCount; ++ix)
+    threads.emplace_back(worker, ix);
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const auto& cov : partial)
+    result.merge(cov);
+
+  return errors;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  namespace po = boost::program_options;
+
+  std::string outFile, reportFile;
+  StringVec listFiles, files;
+  unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  try
+    {
+      po::options_description desc("options");
+      desc.add_options()
+	("help,h", "Produce this message.")
+	("output,o", po::value(&outFile),
+	 "Save merged coverage to given file.")
+	("report,r", po::value(&reportFile),
+	 "Write coverage report to given file (use - for standard output). "
+	 "Report goes to standard output if neither --output nor --report "
+	 "is used.")
+	("list,l", po::value(&listFiles)->multitoken(),
+	 "Read coverage file names (one per line) from given file.")
+	("threads,j", po::value(&threadCount),
+	 "Number of threads used to read coverage files.")
+	("files", po::value(&files)->multitoken(),
+	 "Coverage files to merge.");
+
+      po::positional_options_description pdesc;
+      pdesc.add("files", -1);
+
+      po::variables_map varMap;
+      po::store(po::command_line_parser(argc, argv)
+		.options(desc).positional(pdesc).run(), varMap);
+      po::notify(varMap);
+
+      if (varMap.count("help"))
+	{
+	  std::cout << "Merge functional coverage files produced by whisper "
+		    << "--funccoverage.\nUsage: covmerge [options] file ...\n";
+	  std::cout << desc;
+	  return 0;
+	}
+    }
+  catch (std::exception& exp)
+    {
+      std::cerr << "Failed to parse command line args: " << exp.what() << '\n';
+      return 1;
+    }
+
+  unsigned errors = 0;
+  for (const auto& listFile : listFiles)
+    if (not readFileList(listFile, files))
+      errors++;
+
+  if (files.empty())
+    {
+      std::cerr << "No coverage file specified.\n";
+      return 1;
+    }
+
+  threadCount = std::max(1u, threadCount);
+  if (threadCount > files.size())
+    threadCount = unsigned(files.size());
+
+  FuncCoverage coverage;
+  errors += mergeFiles(files, threadCount, coverage);
+
+  if (not outFile.empty() and not coverage.save(outFile))
+    errors++;
+
+  if (reportFile == "-" or (reportFile.empty() and outFile.empty()))
+    {
+      if (not coverage.report(std::cout, InstInfoTable()))
+	errors++;
+    }
+  else if (not reportFile.empty())
+    {
+      std::ofstream out(reportFile);
+      if (not out or not coverage.report(out, InstInfoTable()))
+	{
+	  std::cerr << "Failed to write report file '" << reportFile << "'\n";
+	  errors++;
+	}
+    }
+
+  return errors ? 1 : 0;
+}
@@ -24,130 +24,6 @@
 using namespace WdRiscv;
 
 
-template <typename URV>
-const InstInfo&
-Core<URV>::decodeFp(uint32_t inst, uint32_t& op0, uint32_t& op1, int32_t& op2)
-{
-  if (not isRvf())
-    return instTable_.getInstInfo(InstId::illegal);  
-
-  RFormInst rform(inst);
-
-  op0 = rform.bits.rd, op1 = rform.bits.rs1, op2 = rform.bits.rs2;
-
-  unsigned f7 = rform.bits.funct7, f3 = rform.bits.funct3;
-  instRoundingMode_ = RoundingMode(f3);
-  if (f7 & 1)
-    {
-      if (not isRvd())
-	return instTable_.getInstInfo(InstId::illegal);  
-
-      if (f7 == 1)              return instTable_.getInstInfo(InstId::fadd_d);
-      if (f7 == 5)              return instTable_.getInstInfo(InstId::fsub_d);
-      if (f7 == 9)              return instTable_.getInstInfo(InstId::fmul_d);
-      if (f7 == 0xd)            return instTable_.getInstInfo(InstId::fdiv_d);
-      if (f7 == 0x11)
-	{
-	  if (f3 == 0)          return instTable_.getInstInfo(InstId::fsgnj_d);
-	  if (f3 == 1)          return instTable_.getInstInfo(InstId::fsgnjn_d);
-	  if (f3 == 2)          return instTable_.getInstInfo(InstId::fsgnjx_d);
-	}
-      if (f7 == 0x15)
-	{
-	  if (f3 == 0)          return instTable_.getInstInfo(InstId::fmin_d);
-	  if (f3 == 1)          return instTable_.getInstInfo(InstId::fmax_d);
-	}
-      if (f7==0x21 and op2==0)  return instTable_.getInstInfo(InstId::fcvt_d_s);
-      if (f7 == 0x2d)           return instTable_.getInstInfo(InstId::fsqrt_d);
-      if (f7 == 0x51)
-	{
-	  if (f3 == 0)          return instTable_.getInstInfo(InstId::fle_d);
-	  if (f3 == 1)          return instTable_.getInstInfo(InstId::flt_d);
-	  if (f3 == 2)          return instTable_.getInstInfo(InstId::feq_d);
-	}
-      if (f7 == 0x61)
-	{
-	  if (op2 == 0)         return instTable_.getInstInfo(InstId::fcvt_w_d);
-	  if (op2 == 1)         return instTable_.getInstInfo(InstId::fcvt_wu_d);
-	  if (op2 == 2)         return instTable_.getInstInfo(InstId::fcvt_l_d);
-	  if (op2 == 3)         return instTable_.getInstInfo(InstId::fcvt_lu_d);
-	}
-      if (f7 == 0x69)
-	{
-	  if (op2 == 0)         return instTable_.getInstInfo(InstId::fcvt_d_w);
-	  if (op2 == 1)         return instTable_.getInstInfo(InstId::fcvt_d_wu);
-	  if (op2 == 2)         return instTable_.getInstInfo(InstId::fcvt_d_l);
-	  if (op2 == 3)         return instTable_.getInstInfo(InstId::fcvt_d_lu);
-	}
-      if (f7 == 0x71)
-	{
-	  if (op2==0 and f3==0) return instTable_.getInstInfo(InstId::fmv_x_d);
-	  if (op2==0 and f3==1) return instTable_.getInstInfo(InstId::fclass_d);
-	}
-      if (f7 == 0x74)
-	if (op2==0 and f3==0)   return instTable_.getInstInfo(InstId::fmv_w_x);
-      if (f7 == 0x79)
-	if (op2==0 and f3==0)   return instTable_.getInstInfo(InstId::fmv_d_x);
-
-      return instTable_.getInstInfo(InstId::illegal);
-    }
-
-  if (f7 == 0)      return instTable_.getInstInfo(InstId::fadd_s);
-  if (f7 == 4)      return instTable_.getInstInfo(InstId::fsub_s);
-  if (f7 == 8)      return instTable_.getInstInfo(InstId::fmul_s);
-  if (f7 == 0xc)    return instTable_.getInstInfo(InstId::fdiv_s);
-  if (f7 == 0x2c)   return instTable_.getInstInfo(InstId::fsqrt_s);
-  if (f7 == 0x10)
-    {
-      if (f3 == 0)  return instTable_.getInstInfo(InstId::fsgnj_s);
-      if (f3 == 1)  return instTable_.getInstInfo(InstId::fsgnjn_s);
-      if (f3 == 2)  return instTable_.getInstInfo(InstId::fsgnjx_s);
-    }
-  if (f7 == 0x14)
-    {
-      if (f3 == 0)  return instTable_.getInstInfo(InstId::fmin_s);
-      if (f3 == 1)  return instTable_.getInstInfo(InstId::fmax_s);
-    }
-  if (f7 == 0x50)
-    {
-      if (f3 == 0)  return instTable_.getInstInfo(InstId::fle_s);
-      if (f3 == 1)  return instTable_.getInstInfo(InstId::flt_s);
-      if (f3 == 2)  return instTable_.getInstInfo(InstId::feq_s);
-      return instTable_.getInstInfo(InstId::illegal);
-    }
-  if (f7 == 0x60)
-    {
-      if (op2 == 0) return instTable_.getInstInfo(InstId::fcvt_w_s);
-      if (op2 == 1) return instTable_.getInstInfo(InstId::fcvt_wu_s);
-      if (op2 == 2) return instTable_.getInstInfo(InstId::fcvt_l_s);
-      if (op2 == 3) return instTable_.getInstInfo(InstId::fcvt_lu_s);
-      return instTable_.getInstInfo(InstId::illegal);
-    }
-  if (f7 == 0x68)
-    {
-      if (op2 == 0) return instTable_.getInstInfo(InstId::fcvt_s_w);
-      if (op2 == 1) return instTable_.getInstInfo(InstId::fcvt_s_wu);
-      if (op2 == 2) return instTable_.getInstInfo(InstId::fcvt_s_l);
-      if (op2 == 3) return instTable_.getInstInfo(InstId::fcvt_s_lu);
-      return instTable_.getInstInfo(InstId::illegal);
-    }
-  if (f7 == 0x70)
-    {
-      if (op2 == 0)
-	{
-	  if (f3 == 0) return instTable_.getInstInfo(InstId::fmv_x_w);
-	  if (f3 == 1) return instTable_.getInstInfo(InstId::fclass_s);
-	}
-    }
-  if (f7 == 0x74)
-    {
-      if (op2 == 0)
-	if (f3 == 0) return instTable_.getInstInfo(InstId::fmv_w_x);
-    }
-  return instTable_.getInstInfo(InstId::illegal);
-}
-
-
 template <typename URV>
 const InstInfo&
 Core<URV>::decode16(uint16_t inst, uint32_t& op0, uint32_t& op1, int32_t& op2)
@@ -476,516 +352,207 @@ Core<URV>::decode16(uint16_t inst, uint32_t& op0, uint32_t& op1, int32_t& op2)
 
 template <typename URV>
 const InstInfo&
-Core<URV>::decode(uint32_t inst, uint32_t& op0, uint32_t& op1, int32_t& op2,
-		  int32_t& op3)
+Core<URV>::decode32(uint32_t inst, uint32_t& op0, uint32_t& op1, int32_t& op2,
+		    int32_t& op3)
 {
-#pragma GCC diagnostic ignored "-Wpedantic"
+  const InstInfo& info = instTable_.decode32(inst, isRv64(), op0, op1, op2,
+					     op3);
 
-  static void *opcodeLabels[] = { &&l0, &&l1, &&l2, &&l3, &&l4, &&l5,
-				  &&l6, &&l7, &&l8, &&l9, &&l10, &&l11,
-				  &&l12, &&l13, &&l14, &&l15, &&l16, &&l17,
-				  &&l18, &&l19, &&l20, &&l21, &&l22, &&l23,
-				  &&l24, &&l25, &&l26, &&l27, &&l28, &&l29,
-				  &&l30, &&l31 };
+  // Instructions of extensions not enabled in this core are illegal.
+  if (not (instTypesOn_ & (1u << unsigned(info.type()))))
+    {
+      op0 = 0; op1 = 0; op2 = 0; op3 = 0;
+      return instTable_.getInstInfo(InstId::illegal);
+    }
 
+  // Floating point arithmetic: Rounding mode in funct3, rs3 in top bits.
+  uint32_t opcode = inst & 0x7f;
+  if (opcode >= 0x43 and opcode <= 0x53)
+    {
+      instRoundingMode_ = RoundingMode((inst >> 12) & 7);
+      if (opcode != 0x53)
+	instRs3_ = op3;
+    }
+
+  return info;
+}
+
+
+template <typename URV>
+const InstInfo&
+Core<URV>::decode(uint32_t inst, uint32_t& op0, uint32_t& op1, int32_t& op2,
+		  int32_t& op3)
+{
   if (isCompressedInst(inst))
     {
-      // return decode16(inst, op0, op1, op2);
+      op3 = 0;
       if (not isRvc())
 	inst = 0; // All zeros: illegal 16-bit instruction.
       return decode16(uint16_t(inst), op0, op1, op2);
     }
 
-  op0 = 0; op1 = 0; op2 = 0; op3 = 0;
+  // Most executed instructions are base integer ones: Decode those
+  // with a switch and everything else from the instruction table.
+  op3 = 0;
+  unsigned funct3 = (inst >> 12) & 7;
 
-  bool quad3 = (inst & 0x3) == 0x3;
-  if (quad3)
+  switch ((inst >> 2) & 0x1f)
     {
-      unsigned opcode = (inst & 0x7f) >> 2;  // Upper 5 bits of opcode.
-
-      goto *opcodeLabels[opcode];
-
-
-    l0:  // 00000   I-form
-      {
-	IFormInst iform(inst);
-	op0 = iform.fields.rd;
-	op1 = iform.fields.rs1;
-	op2 = iform.immed(); 
-	switch (iform.fields.funct3)
-	  {
-	  case 0:  return instTable_.getInstInfo(InstId::lb);
-	  case 1:  return instTable_.getInstInfo(InstId::lh);
-	  case 2:  return instTable_.getInstInfo(InstId::lw);
-	  case 3:  return instTable_.getInstInfo(InstId::ld);
-	  case 4:  return instTable_.getInstInfo(InstId::lbu);
-	  case 5:  return instTable_.getInstInfo(InstId::lhu);
-	  case 6:  return instTable_.getInstInfo(InstId::lwu);
-	  default: return instTable_.getInstInfo(InstId::illegal);
-	  }
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l1:
-      {
-	IFormInst iform(inst);
-	op0 = iform.fields.rd;
-	op1 = iform.fields.rs1;
-	op2 = iform.immed();
-	uint32_t f3 = iform.fields.funct3;
-	if      (f3 == 2)  return instTable_.getInstInfo(InstId::flw);
-	else if (f3 == 3)  return instTable_.getInstInfo(InstId::fld);
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l2:
-    l7:
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l9:
-      {
-	SFormInst sform(inst);
-	op0 = sform.bits.rs1;
-	op1 = sform.bits.rs2;
-	op2 = sform.immed();
-	unsigned funct3 = sform.bits.funct3;
-	if      (funct3 == 2)  return instTable_.getInstInfo(InstId::fsw);
-	else if (funct3 == 3)  return instTable_.getInstInfo(InstId::fsd);
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l10:
-    l15:
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l16:
-      {
-	RFormInst rform(inst);
-	op0 = rform.bits.rd, op1 = rform.bits.rs1, op2 = rform.bits.rs2;
-	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
-	instRoundingMode_ = RoundingMode(funct3);
-	if ((funct7 & 3) == 0)
-	  {
-	    instRs3_ = funct7 >> 2;
-	    op3 = instRs3_;
-	    return instTable_.getInstInfo(InstId::fmadd_s);
-	  }
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l17:
-      {
-	RFormInst rform(inst);
-	op0 = rform.bits.rd, op1 = rform.bits.rs1, op2 = rform.bits.rs2;
-	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
-	instRoundingMode_ = RoundingMode(funct3);
-	if ((funct7 & 3) == 0)
-	  {
-	    instRs3_ = funct7 >> 2;
-	    op3 = instRs3_;
-	    return instTable_.getInstInfo(InstId::fmsub_s);
-	  }
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l18:
-      {
-	RFormInst rform(inst);
-	op0 = rform.bits.rd, op1 = rform.bits.rs1, op2 = rform.bits.rs2;
-	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
-	instRoundingMode_ = RoundingMode(funct3);
-	if ((funct7 & 3) == 0)
-	  {
-	    instRs3_ = funct7 >> 2;
-	    op3 = instRs3_;
-	    return instTable_.getInstInfo(InstId::fnmsub_s);
-	  }
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l19:
-      {
-	RFormInst rform(inst);
-	op0 = rform.bits.rd, op1 = rform.bits.rs1, op2 = rform.bits.rs2;
-	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
-	instRoundingMode_ = RoundingMode(funct3);
-	if ((funct7 & 3) == 0)
-	  {
-	    instRs3_ = funct7 >> 2;
-	    op3 = instRs3_;
-	    return instTable_.getInstInfo(InstId::fnmadd_s);
-	  }
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l20:
-      return decodeFp(inst, op0, op1, op2);
-
-    l21:
-    l22:
-    l23:
-    l26:
-    l29:
-    l30:
-    l31:
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l3: // 00011  I-form
+    case 0x00:  // Loads: I-form.
       {
 	IFormInst iform(inst);
-	unsigned funct3 = iform.fields.funct3;
-	if (iform.fields.rd == 0 and iform.fields.rs1 == 0)
+	op0 = iform.fields.rd; op1 = iform.fields.rs1; op2 = iform.immed();
+	switch (funct3)
 	  {
-	    if (funct3 == 0)
-	      {
-		if (iform.top4() == 0)
-		  {
-		    op0 = iform.pred();
-		    op1 = iform.succ();
-		    return instTable_.getInstInfo(InstId::fence);
-		  }
-	      }
-	    else if (funct3 == 1)
-	      {
-		if (iform.uimmed() == 0)
-		  return instTable_.getInstInfo(InstId::fencei);
-	      }
+	  case 0: return instTable_.getInstInfo(InstId::lb);
+	  case 1: return instTable_.getInstInfo(InstId::lh);
+	  case 2: return instTable_.getInstInfo(InstId::lw);
+	  case 4: return instTable_.getInstInfo(InstId::lbu);
+	  case 5: return instTable_.getInstInfo(InstId::lhu);
+	  case 3:
+	    if (isRv64())
+	      return instTable_.getInstInfo(InstId::ld);
+	    break;
+	  case 6:
+	    if (isRv64())
+	      return instTable_.getInstInfo(InstId::lwu);
+	    break;
 	  }
+	break;
       }
-      return instTable_.getInstInfo(InstId::illegal);
 
-    l4:  // 00100  I-form
+    case 0x04:  // OP-IMM: I-form.
       {
 	IFormInst iform(inst);
-	op0 = iform.fields.rd;
-	op1 = iform.fields.rs1;
-	op2 = iform.immed();
-	unsigned funct3 = iform.fields.funct3;
-
-	if      (funct3 == 0)  return instTable_.getInstInfo(InstId::addi);
-	else if (funct3 == 1)
+	op0 = iform.fields.rd; op1 = iform.fields.rs1; op2 = iform.immed();
+	unsigned topBits = 0, shamt = 0;
+	switch (funct3)
 	  {
-	    unsigned topBits = 0, shamt = 0;
+	  case 0: return instTable_.getInstInfo(InstId::addi);
+	  case 2: return instTable_.getInstInfo(InstId::slti);
+	  case 3: return instTable_.getInstInfo(InstId::sltiu);
+	  case 4: return instTable_.getInstInfo(InstId::xori);
+	  case 6: return instTable_.getInstInfo(InstId::ori);
+	  case 7: return instTable_.getInstInfo(InstId::andi);
+	  case 1:
 	    iform.getShiftFields(isRv64(), topBits, shamt);
+	    op2 = shamt;
 	    if (topBits == 0)
-	      {
-		op2 = shamt;
-		return instTable_.getInstInfo(InstId::slli);
-	      }
-	    else if ((topBits >> 1) == 4)
-	      {
-		op2 = shamt;
-		return instTable_.getInstInfo(InstId::sloi);
-	      }
-	    else if (op2 == 0x600)
-	      return instTable_.getInstInfo(InstId::clz);
-	    else if (op2 == 0x601)
-	      return instTable_.getInstInfo(InstId::ctz);
-	    else if (op2 == 0x601)
-	      return instTable_.getInstInfo(InstId::pcnt);
-	  }
-	else if (funct3 == 2)  return instTable_.getInstInfo(InstId::slti);
-	else if (funct3 == 3)  return instTable_.getInstInfo(InstId::sltiu);
-	else if (funct3 == 4)  return instTable_.getInstInfo(InstId::xori);
-	else if (funct3 == 5)
-	  {
-	    unsigned topBits = 0, shamt = 0;
+	      return instTable_.getInstInfo(InstId::slli);
+	    break;
+	  case 5:
 	    iform.getShiftFields(isRv64(), topBits, shamt);
 	    op2 = shamt;
 	    if (topBits == 0)
 	      return instTable_.getInstInfo(InstId::srli);
-	    if ((topBits >> 1) == 4)
-	      return instTable_.getInstInfo(InstId::sroi);
-	    if ((topBits >> 1) == 0xc)
-	      return instTable_.getInstInfo(InstId::rori);
-	    if (isRv64())
-	      topBits <<= 1;
-	    if (topBits == 0x20)
+	    if (topBits == (isRv64() ? 0x10 : 0x20))
 	      return instTable_.getInstInfo(InstId::srai);
+	    break;
 	  }
-	else if (funct3 == 6)  return instTable_.getInstInfo(InstId::ori);
-	else if (funct3 == 7)  return instTable_.getInstInfo(InstId::andi);
+	break;
       }
-      return instTable_.getInstInfo(InstId::illegal);
 
-    l5:  // 00101   U-form
+    case 0x05:  // auipc: U-form.
       {
 	UFormInst uform(inst);
-	op0 = uform.bits.rd;
-	op1 = uform.immed();
+	op0 = uform.bits.rd; op1 = uform.immed(); op2 = 0;
 	return instTable_.getInstInfo(InstId::auipc);
       }
-      return instTable_.getInstInfo(InstId::illegal);
 
-    l6:  // 00110  I-form
-      {
-	IFormInst iform(inst);
-	op0 = iform.fields.rd;
-	op1 = iform.fields.rs1;
-	op2 = iform.immed();
-	unsigned funct3 = iform.fields.funct3;
-	if (funct3 == 0)
-	  return instTable_.getInstInfo(InstId::addiw);
-	else if (funct3 == 1)
-	  {
-	    if (iform.top7() == 0)
-	      {
-		op2 = iform.fields2.shamt;
-		return instTable_.getInstInfo(InstId::slliw);
-	      }
-	  }
-	else if (funct3 == 5)
-	  {
-	    op2 = iform.fields2.shamt;
-	    if (iform.top7() == 0)
-	      return instTable_.getInstInfo(InstId::srliw);
-	    else if (iform.top7() == 0x20)
-	      return instTable_.getInstInfo(InstId::sraiw);
-	  }
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l8:  // 01000  S-form
+    case 0x08:  // Stores: S-form.
       {
 	SFormInst sform(inst);
-	op0 = sform.bits.rs1;
-	op1 = sform.bits.rs2;
-	op2 = sform.immed();
-	uint32_t funct3 = sform.bits.funct3;
-
-	if (funct3 == 0) return instTable_.getInstInfo(InstId::sb);
-	if (funct3 == 1) return instTable_.getInstInfo(InstId::sh);
-	if (funct3 == 2) return instTable_.getInstInfo(InstId::sw);
-	if (funct3 == 3 and isRv64()) return instTable_.getInstInfo(InstId::sd);
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l11:  // 01011  R-form atomics
-      if (not isRva())
-	return instTable_.getInstInfo(InstId::illegal);
-
-      if (false)  // Not implemented
-      {
-	if (not isRva())
-	  return instTable_.getInstInfo(InstId::illegal);
-	RFormInst rf(inst);
-	uint32_t top5 = rf.top5(), f3 = rf.bits.funct3;
-	op0 = rf.bits.rd; op1 = rf.bits.rs1; op2 = rf.bits.rs2;
-
-	if (f3 == 2)
+	op0 = sform.bits.rs1; op1 = sform.bits.rs2; op2 = sform.immed();
+	switch (funct3)
 	  {
-	    if (top5 == 0)    return instTable_.getInstInfo(InstId::amoadd_w);
-	    if (top5 == 1)    return instTable_.getInstInfo(InstId::amoswap_w);
-	    if (top5 == 2)    return instTable_.getInstInfo(InstId::lr_w);
-	    if (top5 == 3)    return instTable_.getInstInfo(InstId::sc_w);
-	    if (top5 == 4)    return instTable_.getInstInfo(InstId::amoxor_w);
-	    if (top5 == 8)    return instTable_.getInstInfo(InstId::amoor_w);
-	    if (top5 == 0x0c) return instTable_.getInstInfo(InstId::amoand_w);
-	    if (top5 == 0x10) return instTable_.getInstInfo(InstId::amomin_w);
-	    if (top5 == 0x14) return instTable_.getInstInfo(InstId::amomax_w);
-	    if (top5 == 0x18) return instTable_.getInstInfo(InstId::amominu_w);
-	    if (top5 == 0x1c) return instTable_.getInstInfo(InstId::amomaxu_w);
-	  }
-	else if (f3 == 3)
-	  {
-	    if (not isRv64()) return instTable_.getInstInfo(InstId::illegal);
-	    if (top5 == 0)    return instTable_.getInstInfo(InstId::amoadd_d);
-	    if (top5 == 1)    return instTable_.getInstInfo(InstId::amoswap_d);
-	    if (top5 == 2)    return instTable_.getInstInfo(InstId::lr_d);
-	    if (top5 == 3)    return instTable_.getInstInfo(InstId::sc_d);
-	    if (top5 == 4)    return instTable_.getInstInfo(InstId::amoxor_d);
-	    if (top5 == 8)    return instTable_.getInstInfo(InstId::amoor_d);
-	    if (top5 == 0xc)  return instTable_.getInstInfo(InstId::amoand_d);
-	    if (top5 == 0x10) return instTable_.getInstInfo(InstId::amomin_d);
-	    if (top5 == 0x14) return instTable_.getInstInfo(InstId::amomax_d);
-	    if (top5 == 0x18) return instTable_.getInstInfo(InstId::amominu_d);
-	    if (top5 == 0x1c) return instTable_.getInstInfo(InstId::amomaxu_d);
+	  case 0: return instTable_.getInstInfo(InstId::sb);
+	  case 1: return instTable_.getInstInfo(InstId::sh);
+	  case 2: return instTable_.getInstInfo(InstId::sw);
+	  case 3:
+	    if (isRv64())
+	      return instTable_.getInstInfo(InstId::sd);
+	    break;
 	  }
+	break;
       }
-      return instTable_.getInstInfo(InstId::illegal);
 
-    l12:  // 01100  R-form
+    case 0x0c:  // OP: R-form.
       {
 	RFormInst rform(inst);
-	op0 = rform.bits.rd;
-	op1 = rform.bits.rs1;
-	op2 = rform.bits.rs2;
-	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
+	op0 = rform.bits.rd; op1 = rform.bits.rs1; op2 = rform.bits.rs2;
+	unsigned funct7 = rform.bits.funct7;
 	if (funct7 == 0)
-	  {
-	    if      (funct3 == 0) return instTable_.getInstInfo(InstId::add);
-	    else if (funct3 == 1) return instTable_.getInstInfo(InstId::sll);
-	    else if (funct3 == 2) return instTable_.getInstInfo(InstId::slt);
-	    else if (funct3 == 3) return instTable_.getInstInfo(InstId::sltu);
-	    else if (funct3 == 4) return instTable_.getInstInfo(InstId::xor_);
-	    else if (funct3 == 5) return instTable_.getInstInfo(InstId::srl);
-	    else if (funct3 == 6) return instTable_.getInstInfo(InstId::or_);
-	    else if (funct3 == 7) return instTable_.getInstInfo(InstId::and_);
-	  }
-	else if (funct7 == 1)
-	  {
-	    if      (not isRvm()) return instTable_.getInstInfo(InstId::illegal);
-	    else if (funct3 == 0) return instTable_.getInstInfo(InstId::mul);
-	    else if (funct3 == 1) return instTable_.getInstInfo(InstId::mulh);
-	    else if (funct3 == 2) return instTable_.getInstInfo(InstId::mulhsu);
-	    else if (funct3 == 3) return instTable_.getInstInfo(InstId::mulhu);
-	    else if (funct3 == 4) return instTable_.getInstInfo(InstId::div);
-	    else if (funct3 == 5) return instTable_.getInstInfo(InstId::divu);
-	    else if (funct3 == 6) return instTable_.getInstInfo(InstId::rem);
-	    else if (funct3 == 7) return instTable_.getInstInfo(InstId::remu);
-	  }
-	else if (funct7 == 4)
-	  {
-	    if      (funct3 == 0) return instTable_.getInstInfo(InstId::pack);
-	  }
-	else if (funct7 == 5)
-	  {
-
-	    if      (funct3 == 2) return instTable_.getInstInfo(InstId::min);
-	    else if (funct3 == 3) return instTable_.getInstInfo(InstId::minu);
-	    else if (funct3 == 6) return instTable_.getInstInfo(InstId::max);
-	    else if (funct3 == 7) return instTable_.getInstInfo(InstId::maxu);
-	  }
-	else if (funct7 == 0x10)
-	  {
-	    if      (funct3 == 1) return instTable_.getInstInfo(InstId::slo);
-	    else if (funct3 == 5) return instTable_.getInstInfo(InstId::sro);
-	  }
-	else if (funct7 == 0x20)
-	  {
-	    if      (funct3 == 0) return instTable_.getInstInfo(InstId::sub);
-	    else if (funct3 == 5) return instTable_.getInstInfo(InstId::sra);
-	  }
-	else if (funct7 == 0x30)
-	  {
-	    if      (funct3 == 1) return instTable_.getInstInfo(InstId::rol);
-	    if      (funct3 == 5) return instTable_.getInstInfo(InstId::ror);
-	  }
+	  switch (funct3)
+	    {
+	    case 0: return instTable_.getInstInfo(InstId::add);
+	    case 1: return instTable_.getInstInfo(InstId::sll);
+	    case 2: return instTable_.getInstInfo(InstId::slt);
+	    case 3: return instTable_.getInstInfo(InstId::sltu);
+	    case 4: return instTable_.getInstInfo(InstId::xor_);
+	    case 5: return instTable_.getInstInfo(InstId::srl);
+	    case 6: return instTable_.getInstInfo(InstId::or_);
+	    case 7: return instTable_.getInstInfo(InstId::and_);
+	    }
+	else if (funct7 == 1 and isRvm())
+	  switch (funct3)
+	    {
+	    case 0: return instTable_.getInstInfo(InstId::mul);
+	    case 1: return instTable_.getInstInfo(InstId::mulh);
+	    case 2: return instTable_.getInstInfo(InstId::mulhsu);
+	    case 3: return instTable_.getInstInfo(InstId::mulhu);
+	    case 4: return instTable_.getInstInfo(InstId::div);
+	    case 5: return instTable_.getInstInfo(InstId::divu);
+	    case 6: return instTable_.getInstInfo(InstId::rem);
+	    case 7: return instTable_.getInstInfo(InstId::remu);
+	    }
+	else if (funct7 == 0x20 and funct3 == 0)
+	  return instTable_.getInstInfo(InstId::sub);
+	else if (funct7 == 0x20 and funct3 == 5)
+	  return instTable_.getInstInfo(InstId::sra);
+	break;
       }
-      return instTable_.getInstInfo(InstId::illegal);
 
-    l13:  // 01101  U-form
+    case 0x0d:  // lui: U-form.
       {
 	UFormInst uform(inst);
-	op0 = uform.bits.rd;
-	op1 = uform.immed();
+	op0 = uform.bits.rd; op1 = uform.immed(); op2 = 0;
 	return instTable_.getInstInfo(InstId::lui);
       }
 
-    l14: // 01110  R-Form
+    case 0x18:  // Branches: B-form.
       {
-	const RFormInst rform(inst);
-	op0 = rform.bits.rd;
-	op1 = rform.bits.rs1;
-	op2 = rform.bits.rs2;
-	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
-	if (funct7 == 0)
-	  {
-	    if      (funct3 == 0) return instTable_.getInstInfo(InstId::addw);
-	    else if (funct3 == 1) return instTable_.getInstInfo(InstId::sllw);
-	    else if (funct3 == 5) return instTable_.getInstInfo(InstId::srlw);
-	  }
-	else if (funct7 == 1)
-	  {
-	    if      (funct3 == 0) return instTable_.getInstInfo(InstId::mulw);
-	    else if (funct3 == 4) return instTable_.getInstInfo(InstId::divw);
-	    else if (funct3 == 5) return instTable_.getInstInfo(InstId::divuw);
-	    else if (funct3 == 6) return instTable_.getInstInfo(InstId::remw);
-	    else if (funct3 == 7) return instTable_.getInstInfo(InstId::remuw);
-	  }
-	else if (funct7 == 0x20)
+	BFormInst bform(inst);
+	op0 = bform.bits.rs1; op1 = bform.bits.rs2; op2 = bform.immed();
+	switch (funct3)
 	  {
-	    if      (funct3 == 0)  return instTable_.getInstInfo(InstId::subw);
-	    else if (funct3 == 5)  return instTable_.getInstInfo(InstId::sraw);
+	  case 0: return instTable_.getInstInfo(InstId::beq);
+	  case 1: return instTable_.getInstInfo(InstId::bne);
+	  case 4: return instTable_.getInstInfo(InstId::blt);
+	  case 5: return instTable_.getInstInfo(InstId::bge);
+	  case 6: return instTable_.getInstInfo(InstId::bltu);
+	  case 7: return instTable_.getInstInfo(InstId::bgeu);
 	  }
+	break;
       }
-      return instTable_.getInstInfo(InstId::illegal);
 
-    l24: // 11000   B-form
-      {
-	BFormInst bform(inst);
-	op0 = bform.bits.rs1;
-	op1 = bform.bits.rs2;
-	op2 = bform.immed();
-	uint32_t funct3 = bform.bits.funct3;
-	if      (funct3 == 0)  return instTable_.getInstInfo(InstId::beq);
-	else if (funct3 == 1)  return instTable_.getInstInfo(InstId::bne);
-	else if (funct3 == 4)  return instTable_.getInstInfo(InstId::blt);
-	else if (funct3 == 5)  return instTable_.getInstInfo(InstId::bge);
-	else if (funct3 == 6)  return instTable_.getInstInfo(InstId::bltu);
-	else if (funct3 == 7)  return instTable_.getInstInfo(InstId::bgeu);
-      }
-      return instTable_.getInstInfo(InstId::illegal);
-
-    l25:  // 11001  I-form
-      {
-	IFormInst iform(inst);
-	op0 = iform.fields.rd;
-	op1 = iform.fields.rs1;
-	op2 = iform.immed();
-	if (iform.fields.funct3 == 0)
+    case 0x19:  // jalr: I-form.
+      if (funct3 == 0)
+	{
+	  IFormInst iform(inst);
+	  op0 = iform.fields.rd; op1 = iform.fields.rs1; op2 = iform.immed();
 	  return instTable_.getInstInfo(InstId::jalr);
-      }
-      return instTable_.getInstInfo(InstId::illegal);
+	}
+      break;
 
-    l27:  // 11011  J-form
+    case 0x1b:  // jal: J-form.
       {
 	JFormInst jform(inst);
-	op0 = jform.bits.rd;
-	op1 = jform.immed();
+	op0 = jform.bits.rd; op1 = jform.immed(); op2 = 0;
 	return instTable_.getInstInfo(InstId::jal);
       }
-
-    l28:  // 11100  I-form
-      {
-	IFormInst iform(inst);
-	op0 = iform.fields.rd;
-	op1 = iform.fields.rs1;
-	op2 = iform.uimmed(); // csr
-	switch (iform.fields.funct3)
-	  {
-	  case 0:
-	    {
-	      uint32_t funct7 = op2 >> 5;
-	      if (funct7 == 0) // ecall ebreak uret
-		{
-		  if (op1 != 0 or op0 != 0)
-		    return instTable_.getInstInfo(InstId::illegal);
-		  else if (op2 == 0)
-		    return instTable_.getInstInfo(InstId::ecall);
-		  else if (op2 == 1)
-		    return instTable_.getInstInfo(InstId::ebreak);
-		  else if (op2 == 2)
-		    return instTable_.getInstInfo(InstId::uret);
-		}
-	      else if (funct7 == 9)
-		{
-		  if (op0 != 0)
-		    return instTable_.getInstInfo(InstId::illegal);
-		  else // sfence.vma
-		    return instTable_.getInstInfo(InstId::illegal);
-		}
-	      else if (op2 == 0x102)
-		return instTable_.getInstInfo(InstId::sret);
-	      else if (op2 == 0x302)
-		return instTable_.getInstInfo(InstId::mret);
-	      else if (op2 == 0x105)
-		return instTable_.getInstInfo(InstId::wfi);
-	    }
-	    break;
-	  case 1:  return instTable_.getInstInfo(InstId::csrrw);
-	  case 2:  return instTable_.getInstInfo(InstId::csrrs);
-	  case 3:  return instTable_.getInstInfo(InstId::csrrc);
-	  case 5:  return instTable_.getInstInfo(InstId::csrrwi);
-	  case 6:  return instTable_.getInstInfo(InstId::csrrsi);
-	  case 7:  return instTable_.getInstInfo(InstId::csrrci);
-	  default: return instTable_.getInstInfo(InstId::illegal);
-	  }
-	return instTable_.getInstInfo(InstId::illegal);
-      }
     }
-  else
-    return instTable_.getInstInfo(InstId::illegal);
+
+  return decode32(inst, op0, op1, op2, op3);
 }
 
 
@@ -54,8 +54,9 @@ void
 printRdRs1Rs2(const Core<URV>& core, std::ostream& stream, const char* inst,
 	      unsigned rd, unsigned rs1, unsigned rs2)
 {
-  // Print instruction in a 9 character field.
-  stream << std::left << std::setw(9) << inst;
+  // Print instruction in a 9 character field (at least one space
+  // after longer names such as sh1add.uw).
+  stream << std::left << std::setw(8) << inst << ' ';
 
   stream << core.intRegName(rd) << ", " << core.intRegName(rs1) << ", "
 	 << core.intRegName(rs2);
@@ -543,6 +544,285 @@ Core<URV>::disassembleFp(uint32_t inst, std::ostream& os)
 }
 
 
+/// Names of the OPIVV/OPIVX/OPIVI instructions indexed by funct6.
+static const char* opiNames[64] =
+  {
+    "vadd", nullptr, "vsub", "vrsub", "vminu", "vmin", "vmaxu", "vmax",
+    nullptr, "vand", "vor", "vxor", "vrgather", nullptr, "vslideup", "vslidedown",
+    "vadc", "vmadc", "vsbc", "vmsbc", nullptr, nullptr, nullptr, "vmerge",
+    "vmseq", "vmsne", "vmsltu", "vmslt", "vmsleu", "vmsle", "vmsgtu", "vmsgt",
+    "vsaddu", "vsadd", "vssubu", "vssub", nullptr, "vsll", nullptr, "vsmul",
+    "vsrl", "vsra", "vssrl", "vssra", "vnsrl", "vnsra", "vnclipu", "vnclip",
+  };
+
+
+/// Names of the OPMVV/OPMVX instructions indexed by funct6.
+static const char* opmNames[64] =
+  {
+    "vredsum", "vredand", "vredor", "vredxor", "vredminu", "vredmin", "vredmaxu", "vredmax",
+    "vaaddu", "vaadd", "vasubu", "vasub", nullptr, nullptr, "vslide1up", "vslide1down",
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "vcompress",
+    "vmandn", "vmand", "vmor", "vmxor", "vmorn", "vmnand", "vmnor", "vmxnor",
+    "vdivu", "vdiv", "vremu", "vrem", "vmulhu", "vmul", "vmulhsu", "vmulh",
+    nullptr, "vmadd", nullptr, "vnmsub", nullptr, "vmacc", nullptr, "vnmsac",
+    "vwaddu", "vwadd", "vwsubu", "vwsub", "vwaddu.w", "vwadd.w", "vwsubu.w", "vwsub.w",
+    "vwmulu", nullptr, "vwmulsu", "vwmul", "vwmaccu", "vwmacc", "vwmaccus", "vwmaccsu",
+  };
+
+
+/// Names of the OPFVV/OPFVF instructions indexed by funct6.
+static const char* opfNames[64] =
+  {
+    "vfadd", "vfredusum", "vfsub", "vfredosum", "vfmin", "vfredmin", "vfmax", "vfredmax",
+    "vfsgnj", "vfsgnjn", "vfsgnjx", nullptr, nullptr, nullptr, "vfslide1up", "vfslide1down",
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "vfmerge",
+    "vmfeq", "vmfle", nullptr, "vmflt", "vmfne", "vmfgt", nullptr, "vmfge",
+    "vfdiv", "vfrdiv", nullptr, nullptr, "vfmul", nullptr, nullptr, "vfrsub",
+    "vfmadd", "vfnmadd", "vfmsub", "vfnmsub", "vfmacc", "vfnmacc", "vfmsac", "vfnmsac",
+  };
+
+
+template <typename URV>
+void
+Core<URV>::disassembleVec(uint32_t inst, std::ostream& os)
+{
+  unsigned opcode = (inst & 0x7f) >> 2;
+  unsigned f3 = (inst >> 12) & 7, f6 = inst >> 26;
+  unsigned vd = (inst >> 7) & 0x1f, rs1 = (inst >> 15) & 0x1f, vs2 = (inst >> 20) & 0x1f;
+  bool masked = ((inst >> 25) & 1) == 0;
+  const char* maskSuffix = masked ? ", v0.t" : "";
+
+  auto vreg = [] (unsigned reg) { return "v" + std::to_string(reg); };
+
+  auto print = [&os] (const std::string& name) {
+    os << std::left << std::setw(8) << name << ' ';
+  };
+
+  if (opcode == 1 or opcode == 9)
+    {
+      // Loads and stores.
+      unsigned mop = (inst >> 26) & 3, nf = inst >> 29;
+      std::string width = std::to_string(f3 == 0 ? 8 : 8 << (f3 - 4));
+      std::string name = opcode == 1 ? "vl" : "vs";
+      std::string extra;
+      if (mop == 0)
+	{
+	  if (vs2 == 8)
+	    name += std::to_string(nf + 1) + (opcode == 1 ? "re" + width : "r") + ".v";
+	  else if (vs2 == 0xb)
+	    name += "m.v";
+	  else if (vs2 == 0x10 and opcode == 1)
+	    name += "e" + width + "ff.v";
+	  else
+	    name += "e" + width + ".v";
+	}
+      else if (mop == 2)
+	{
+	  name += "se" + width + ".v";
+	  extra = ", " + intRegName(vs2);
+	}
+      else
+	{
+	  name += (mop == 1 ? "uxei" : "oxei") + width + ".v";
+	  extra = ", " + vreg(vs2);
+	}
+      print(name);
+      os << vreg(vd) << ", (" << intRegName(rs1) << ")" << extra << maskSuffix;
+      return;
+    }
+
+  if (f3 == 7)
+    {
+      // vsetvli, vsetivli, vsetvl
+      if ((inst >> 31) == 0)
+	{
+	  print("vsetvli");
+	  os << intRegName(vd) << ", " << intRegName(rs1) << ", 0x" << std::hex
+	     << ((inst >> 20) & 0x7ff) << std::dec;
+	}
+      else if ((inst >> 30) == 3)
+	{
+	  print("vsetivli");
+	  os << intRegName(vd) << ", " << rs1 << ", 0x" << std::hex
+	     << ((inst >> 20) & 0x3ff) << std::dec;
+	}
+      else
+	{
+	  print("vsetvl");
+	  os << intRegName(vd) << ", " << intRegName(rs1) << ", " << intRegName(vs2);
+	}
+      return;
+    }
+
+  // Third operand by category: vs1, rs1, simm5 or fs1.
+  std::string src;
+  std::string suffix;
+  switch (f3)
+    {
+    case 0: case 1: case 2: src = vreg(rs1); suffix = ".vv"; break;
+    case 3: src = std::to_string(int32_t(inst << 12) >> 27); suffix = ".vi"; break;
+    case 4: case 6: src = intRegName(rs1); suffix = ".vx"; break;
+    case 5: src = "f" + std::to_string(rs1); suffix = ".vf"; break;
+    }
+
+  const char* base = nullptr;
+  if (f3 == 0 or f3 == 3 or f3 == 4)
+    {
+      base = opiNames[f6];
+      if (f6 == 0x17 and not masked)
+	{
+	  print("vmv.v." + suffix.substr(2));
+	  os << vreg(vd) << ", " << src;
+	  return;
+	}
+      if (f6 == 0x27 and f3 == 3)
+	{
+	  print("vmv" + std::to_string(rs1 + 1) + "r.v");
+	  os << vreg(vd) << ", " << vreg(vs2);
+	  return;
+	}
+      if (f6 >= 0x2c and f6 <= 0x2f)
+	suffix = ".w" + suffix.substr(2);
+      if (f6 >= 0x10 and f6 <= 0x17 and masked and f6 != 0x11 and f6 != 0x13)
+	{
+	  os << std::left << std::setw(8) << (std::string(base) + suffix + "m") << ' '
+	     << vreg(vd) << ", " << vreg(vs2) << ", " << src << ", v0";
+	  return;
+	}
+      if ((f6 == 0x11 or f6 == 0x13) and masked)
+	{
+	  print(std::string(base) + suffix + "m");
+	  os << vreg(vd) << ", " << vreg(vs2) << ", " << src << ", v0";
+	  return;
+	}
+    }
+  else if (f3 == 2 or f3 == 6)
+    {
+      base = opmNames[f6];
+      if (f6 == 0x10)
+	{
+	  if (f3 == 6)
+	    {
+	      print("vmv.s.x");
+	      os << vreg(vd) << ", " << src;
+	    }
+	  else if (rs1 == 0)
+	    {
+	      print("vmv.x.s");
+	      os << intRegName(vd) << ", " << vreg(vs2);
+	    }
+	  else
+	    {
+	      print(rs1 == 0x10 ? "vcpop.m" : (rs1 == 0x11 ? "vfirst.m" : "illegal"));
+	      os << intRegName(vd) << ", " << vreg(vs2) << maskSuffix;
+	    }
+	  return;
+	}
+      if (f6 == 0x12 and f3 == 2)
+	{
+	  static const char* ext[8] = { nullptr, nullptr, "vzext.vf8", "vsext.vf8",
+					"vzext.vf4", "vsext.vf4", "vzext.vf2", "vsext.vf2" };
+	  print(rs1 < 8 and ext[rs1] ? ext[rs1] : "illegal");
+	  os << vreg(vd) << ", " << vreg(vs2) << maskSuffix;
+	  return;
+	}
+      if (f6 == 0x14 and f3 == 2)
+	{
+	  const char* name = "illegal";
+	  if (rs1 == 1) name = "vmsbf.m";
+	  else if (rs1 == 2) name = "vmsof.m";
+	  else if (rs1 == 3) name = "vmsif.m";
+	  else if (rs1 == 0x10) name = "viota.m";
+	  else if (rs1 == 0x11) name = "vid.v";
+	  print(name);
+	  os << vreg(vd);
+	  if (rs1 != 0x11)
+	    os << ", " << vreg(vs2);
+	  os << maskSuffix;
+	  return;
+	}
+      if (f6 <= 7)
+	suffix = ".vs";
+      else if (f6 == 0x17)
+	suffix = ".vm";
+      else if (f6 >= 0x18 and f6 <= 0x1f)
+	suffix = ".mm";
+      if (base and ((f6 >= 0x29 and f6 <= 0x2f) or f6 >= 0x3c))
+	{
+	  // Multiply-add: Scalar/vs1 operand comes first.
+	  print(std::string(base) + suffix);
+	  os << vreg(vd) << ", " << src << ", " << vreg(vs2) << maskSuffix;
+	  return;
+	}
+    }
+  else
+    {
+      base = opfNames[f6];
+      if (f6 == 0x10)
+	{
+	  if (f3 == 5)
+	    {
+	      print("vfmv.s.f");
+	      os << vreg(vd) << ", " << src;
+	    }
+	  else
+	    {
+	      print("vfmv.f.s");
+	      os << "f" << vd << ", " << vreg(vs2);
+	    }
+	  return;
+	}
+      if ((f6 == 0x12 or f6 == 0x13) and f3 == 1)
+	{
+	  static const char* cvt[8] = { "vfcvt.xu.f.v", "vfcvt.x.f.v", "vfcvt.f.xu.v",
+					"vfcvt.f.x.v", nullptr, nullptr,
+					"vfcvt.rtz.xu.f.v", "vfcvt.rtz.x.f.v" };
+	  const char* name = "illegal";
+	  if (f6 == 0x12 and rs1 < 8 and cvt[rs1])
+	    name = cvt[rs1];
+	  else if (f6 == 0x13 and rs1 == 0)
+	    name = "vfsqrt.v";
+	  else if (f6 == 0x13 and rs1 == 0x10)
+	    name = "vfclass.v";
+	  print(name);
+	  os << vreg(vd) << ", " << vreg(vs2) << maskSuffix;
+	  return;
+	}
+      if (f6 == 0x17)
+	{
+	  if (masked)
+	    {
+	      print("vfmerge.vfm");
+	      os << vreg(vd) << ", " << vreg(vs2) << ", " << src << ", v0";
+	    }
+	  else
+	    {
+	      print("vfmv.v.f");
+	      os << vreg(vd) << ", " << src;
+	    }
+	  return;
+	}
+      if (f6 == 0x01 or f6 == 0x03 or f6 == 0x05 or f6 == 0x07)
+	suffix = ".vs";
+      if (base and f6 >= 0x28 and f6 <= 0x2f)
+	{
+	  print(std::string(base) + suffix);
+	  os << vreg(vd) << ", " << src << ", " << vreg(vs2) << maskSuffix;
+	  return;
+	}
+    }
+
+  if (not base)
+    {
+      os << "illegal";
+      return;
+    }
+
+  print(std::string(base) + suffix);
+  os << vreg(vd) << ", " << vreg(vs2) << ", " << src << maskSuffix;
+}
+
+
 template <typename URV>
 void
 Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
@@ -596,6 +876,8 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	    else
 	      out << "illegal";
 	  }
+	else if (isRvv() and (f3 == 0 or f3 >= 5))
+	  disassembleVec(inst, out);
 	else
 	  out << "illegal";
       }
@@ -641,16 +923,27 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	    {
 	      unsigned topBits = 0, shamt = 0;
 	      iform.getShiftFields(isRv64(), topBits, shamt);
+	      unsigned top6 = isRv64() ? topBits : topBits >> 1;
 	      if (topBits == 0)
 		printShiftImm(*this, out, "slli", rd, rs1, shamt);
-	      else if ((topBits >> 1) == 4)
-		printShiftImm(*this, out, "sloi", rd, rs1, shamt);
-	      else if (topBits == 0x600)
+	      else if (not isRv64() and (topBits & 1))
+		out << "illegal";
+	      else if (top6 == 0x0a)
+		printShiftImm(*this, out, "bseti", rd, rs1, shamt);
+	      else if (top6 == 0x12)
+		printShiftImm(*this, out, "bclri", rd, rs1, shamt);
+	      else if (top6 == 0x1a)
+		printShiftImm(*this, out, "binvi", rd, rs1, shamt);
+	      else if (imm == 0x600)
 		printRdRs1(*this, out, "clz", rd, rs1);
-	      else if (topBits == 0x601)
+	      else if (imm == 0x601)
 		printRdRs1(*this, out, "ctz", rd, rs1);
-	      else if (topBits == 0x602)
-		printRdRs1(*this, out, "pcnt", rd, rs1);
+	      else if (imm == 0x602)
+		printRdRs1(*this, out, "cpop", rd, rs1);
+	      else if (imm == 0x604)
+		printRdRs1(*this, out, "sext.b", rd, rs1);
+	      else if (imm == 0x605)
+		printRdRs1(*this, out, "sext.h", rd, rs1);
 	      else
 		out << "illegal";
 	    }
@@ -668,21 +961,23 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	    {
 	      unsigned topBits = 0, shamt = 0;
 	      iform.getShiftFields(isRv64(), topBits, shamt);
+	      unsigned top6 = isRv64() ? topBits : topBits >> 1;
 	      if (topBits == 0)
 		printShiftImm(*this, out, "srli", rd, rs1, shamt);
-	      else if ((topBits >> 1) == 4)
-		printShiftImm(*this, out, "sroi", rd, rs1, shamt);
-	      else if ((topBits >> 1) == 0xc)
+	      else if (not isRv64() and (topBits & 1))
+		out << "illegal";
+	      else if (top6 == 0x10)
+		printShiftImm(*this, out, "srai", rd, rs1, shamt);
+	      else if (top6 == 0x18)
 		printShiftImm(*this, out, "rori", rd, rs1, shamt);
+	      else if (top6 == 0x12)
+		printShiftImm(*this, out, "bexti", rd, rs1, shamt);
+	      else if (imm == 0x287)
+		printRdRs1(*this, out, "orc.b", rd, rs1);
+	      else if (imm == (isRv64() ? 0x6b8 : 0x698))
+		printRdRs1(*this, out, "rev8", rd, rs1);
 	      else
-		{
-		  if (isRv64())
-		    topBits <<= 1;
-		  if (topBits == 0x20)
-		    printShiftImm(*this, out, "srai", rd, rs1, shamt);
-		  else
-		    out << "illegal";
-		}
+		out << "illegal";
 	    }
 	    break;
 	  case 6:
@@ -721,10 +1016,18 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	  }
 	else if (funct3 == 1)
 	  {
-	    if (iform.top7() != 0)
+	    if (not isRv64())
 	      out << "illegal";
-	    else if (isRv64())
+	    else if (iform.top7() == 0)
 	      printShiftImm(*this, out, "slliw", rd, rs1, iform.fields2.shamt);
+	    else if ((iform.top7() >> 1) == 2)
+	      printShiftImm(*this, out, "slli.uw", rd, rs1, iform.fields3.shamt);
+	    else if (imm == 0x600)
+	      printRdRs1(*this, out, "clzw", rd, rs1);
+	    else if (imm == 0x601)
+	      printRdRs1(*this, out, "ctzw", rd, rs1);
+	    else if (imm == 0x602)
+	      printRdRs1(*this, out, "cpopw", rd, rs1);
 	    else
 	      out << "illegal";
 	  }
@@ -734,6 +1037,8 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	      printShiftImm(*this, out, "srliw", rd, rs1, iform.fields2.shamt);
 	    else if (iform.top7() == 0x20)
 	      printShiftImm(*this, out, "sraiw", rd, rs1, iform.fields2.shamt);
+	    else if (iform.top7() == 0x30)
+	      printShiftImm(*this, out, "roriw", rd, rs1, iform.fields2.shamt);
 	    else
 	      out << "illegal";
 	  }
@@ -781,6 +1086,8 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	    else
 	      out << "illegal";
 	  }
+	else if (isRvv() and (f3 == 0 or f3 >= 5))
+	  disassembleVec(inst, out);
 	else
 	  out << "illegal";
       }
@@ -886,28 +1193,47 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	  }
 	else if (f7 == 4)
 	  {
-	    if      (f3 == 0) printRdRs1Rs2(*this, out, "pack", rd, rs1, rs2);
-	    else              out << "illegal";
+	    if (f3 == 4 and rs2 == 0 and not isRv64())
+	      printRdRs1(*this, out, "zext.h", rd, rs1);
+	    else
+	      out << "illegal";
 	  }
 	else if (f7 == 5)
 	  {
-	    if      (f3 == 2) printRdRs1Rs2(*this, out, "min",  rd, rs1, rs2);
-	    else if (f3 == 3) printRdRs1Rs2(*this, out, "minu", rd, rs1, rs2);
-	    else if (f3 == 6) printRdRs1Rs2(*this, out, "max",  rd, rs1, rs2);
-	    else if (f3 == 7) printRdRs1Rs2(*this, out, "maxu", rd, rs1, rs2);
+	    if      (f3 == 1) printRdRs1Rs2(*this, out, "clmul",  rd, rs1, rs2);
+	    else if (f3 == 2) printRdRs1Rs2(*this, out, "clmulr", rd, rs1, rs2);
+	    else if (f3 == 3) printRdRs1Rs2(*this, out, "clmulh", rd, rs1, rs2);
+	    else if (f3 == 4) printRdRs1Rs2(*this, out, "min",    rd, rs1, rs2);
+	    else if (f3 == 5) printRdRs1Rs2(*this, out, "minu",   rd, rs1, rs2);
+	    else if (f3 == 6) printRdRs1Rs2(*this, out, "max",    rd, rs1, rs2);
+	    else if (f3 == 7) printRdRs1Rs2(*this, out, "maxu",   rd, rs1, rs2);
 	    else              out << "illegal";
 	  }
 	else if (f7 == 0x10)
 	  {
-	    if      (f3 == 1) printRdRs1Rs2(*this, out, "slo", rd, rs1, rs2);
-	    else if (f3 == 5) printRdRs1Rs2(*this, out, "sro", rd, rs1, rs2);
+	    if      (f3 == 2) printRdRs1Rs2(*this, out, "sh1add", rd, rs1, rs2);
+	    else if (f3 == 4) printRdRs1Rs2(*this, out, "sh2add", rd, rs1, rs2);
+	    else if (f3 == 6) printRdRs1Rs2(*this, out, "sh3add", rd, rs1, rs2);
+	    else              out << "illegal";
+	  }
+	else if (f7 == 0x14)
+	  {
+	    if      (f3 == 1) printRdRs1Rs2(*this, out, "bset", rd, rs1, rs2);
 	    else              out << "illegal";
 	  }
 	else if (f7 == 0x20)
 	  {
-	    if      (f3 == 0)  printRdRs1Rs2(*this, out, "sub", rd, rs1, rs2);
-	    else if (f3 == 5)  printRdRs1Rs2(*this, out, "sra", rd, rs1, rs2);
-	    else if (f3 == 7)  printRdRs1Rs2(*this, out, "andc", rd, rs1, rs2);
+	    if      (f3 == 0)  printRdRs1Rs2(*this, out, "sub",  rd, rs1, rs2);
+	    else if (f3 == 4)  printRdRs1Rs2(*this, out, "xnor", rd, rs1, rs2);
+	    else if (f3 == 5)  printRdRs1Rs2(*this, out, "sra",  rd, rs1, rs2);
+	    else if (f3 == 6)  printRdRs1Rs2(*this, out, "orn",  rd, rs1, rs2);
+	    else if (f3 == 7)  printRdRs1Rs2(*this, out, "andn", rd, rs1, rs2);
+	    else               out << "illegal";
+	  }
+	else if (f7 == 0x24)
+	  {
+	    if      (f3 == 1)  printRdRs1Rs2(*this, out, "bclr", rd, rs1, rs2);
+	    else if (f3 == 5)  printRdRs1Rs2(*this, out, "bext", rd, rs1, rs2);
 	    else               out << "illegal";
 	  }
 	else if (f7 == 0x30)
@@ -916,6 +1242,11 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	    else if (f3 == 5)  printRdRs1Rs2(*this, out, "ror", rd, rs1, rs2);
 	    else               out << "illegal";
 	  }
+	else if (f7 == 0x34)
+	  {
+	    if      (f3 == 1)  printRdRs1Rs2(*this, out, "binv", rd, rs1, rs2);
+	    else               out << "illegal";
+	  }
 	else
 	  out << "illegal";
       }
@@ -952,12 +1283,31 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
 	    else if (f3 == 7)  printRdRs1Rs2(*this, out, "remuw", rd, rs1, rs2);
 	    else               out << "illegal";
 	  }
+	else if (f7 == 4)
+	  {
+	    if      (f3 == 0)  printRdRs1Rs2(*this, out, "add.uw", rd, rs1, rs2);
+	    else if (f3 == 4 and rs2 == 0)  printRdRs1(*this, out, "zext.h", rd, rs1);
+	    else               out << "illegal";
+	  }
+	else if (f7 == 0x10)
+	  {
+	    if      (f3 == 2)  printRdRs1Rs2(*this, out, "sh1add.uw", rd, rs1, rs2);
+	    else if (f3 == 4)  printRdRs1Rs2(*this, out, "sh2add.uw", rd, rs1, rs2);
+	    else if (f3 == 6)  printRdRs1Rs2(*this, out, "sh3add.uw", rd, rs1, rs2);
+	    else               out << "illegal";
+	  }
 	else if (f7 == 0x20)
 	  {
 	    if      (f3 == 0)  printRdRs1Rs2(*this, out, "subw", rd, rs1, rs2);
 	    else if (f3 == 5)  printRdRs1Rs2(*this, out, "sraw", rd, rs1, rs2);
 	    else               out << "illegal";
 	  }
+	else if (f7 == 0x30)
+	  {
+	    if      (f3 == 1)  printRdRs1Rs2(*this, out, "rolw", rd, rs1, rs2);
+	    else if (f3 == 5)  printRdRs1Rs2(*this, out, "rorw", rd, rs1, rs2);
+	    else               out << "illegal";
+	  }
 	else
 	  out << "illegal";
       }
@@ -1031,6 +1381,13 @@ Core<URV>::disassembleInst32(uint32_t inst, std::ostream& out)
       disassembleFp(inst, out);
       break;
 
+    case 21:  // 10101   vector
+      if (isRvv())
+	disassembleVec(inst, out);
+      else
+	out << "illegal";
+      break;
+
     case 24:  // 11000   B-form
       {
 	BFormInst bform(inst);
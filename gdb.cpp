@@ -348,6 +348,29 @@ handlePeekRegisterForGdb(WdRiscv::Core<URV>& core, unsigned regNum,
 }
 
 
+/// Put in the given stream a stop reply of the form T xx n1:r1;... where
+/// xx is the signal number and ni is a resource (e.g. register number)
+/// and ri is the resource data (e.g. content of register). If
+/// atHistoryStart is true, report that reverse execution reached the
+/// oldest retained state.
+template <typename URV>
+static
+void
+stopReplyForGdb(WdRiscv::Core<URV>& core, unsigned signalNum,
+		bool atHistoryStart, std::ostream& reply)
+{
+  reply << "T" << (boost::format("%02x") % signalNum);
+  if (atHistoryStart)
+    reply << "replaylog:begin;";
+
+  URV spVal = 0;
+  unsigned spNum = WdRiscv::RegSp;
+  core.peekIntReg(spNum, spVal);
+  reply << (boost::format("%02x") % spNum) << ':'
+	<< littleEndianIntToHex(spVal) << ';';
+}
+
+
 template <typename URV>
 void
 handleExceptionForGdb(WdRiscv::Core<URV>& core)
@@ -355,9 +378,6 @@ handleExceptionForGdb(WdRiscv::Core<URV>& core)
   // The trap handler is expected to set the PC to point to the instruction
   // after the one with the exception if necessary/possible.
 
-  // Construct a reply of the form T xx n1:r1;n2:r2;... where xx is
-  // the trap cause and ni is a resource (e.g. register number) and ri
-  // is the resource data (e.g. content of register).
   std::ostringstream reply;
 
   unsigned signalNum = SIGTRAP;
@@ -369,13 +389,7 @@ handleExceptionForGdb(WdRiscv::Core<URV>& core)
       // FIX:  implement other caues.
     }
 
-  reply << "T" << (boost::format("%02x") % signalNum);
-
-  URV spVal = 0;
-  unsigned spNum = WdRiscv::RegSp;
-  core.peekIntReg(spNum, spVal);
-  reply << (boost::format("%02x") % spNum) << ':'
-	<< littleEndianIntToHex(spVal) << ';';
+  stopReplyForGdb(core, signalNum, false, reply);
   sendPacketToGdb(reply.str());
 
   bool gotQuit = false;
@@ -552,6 +566,45 @@ handleExceptionForGdb(WdRiscv::Core<URV>& core)
 	  handleExceptionForGdb(core);
 	  return;
 
+	case 'b':  // bs: reverse step, bc: reverse continue
+	  if ((packet == "bs" or packet == "bc") and core.hasSnapshots())
+	    {
+	      bool ok = (packet == "bs" ? core.reverseStep() :
+			 core.reverseContinue());
+	      stopReplyForGdb(core, SIGTRAP, not ok, reply);
+	    }
+	  else
+	    {
+	      std::cerr << "Unhandled gdb request: " << packet << '\n';
+	      reply << ""; // Unsupported: Empty response.
+	    }
+	  break;
+
+	case 'Z':  // Z0,AA..AA,K  Insert breakpoint at address AA..AA
+	case 'z':  // z0,AA..AA,K  Remove breakpoint
+	  {
+	    // Breakpoints are needed for reverse continue. Without reverse
+	    // execution gdb falls back to writing ebreak in memory.
+	    std::string type, addrStr, kind;
+	    URV addr = 0;
+	    if (not core.hasSnapshots() or
+		not getStringComponents(packet.substr(1), ',', ',', type,
+					addrStr, kind) or
+		type != "0")
+	      reply << ""; // Unsupported: Empty response.
+	    else if (not hexToInt(addrStr, addr))
+	      reply << "E01";
+	    else
+	      {
+		if (packet.at(0) == 'Z')
+		  core.addBreakpoint(addr);
+		else
+		  core.removeBreakpoint(addr);
+		reply << "OK";
+	      }
+	  }
+	  break;
+
 	case 'k':  // kill
 	  reply << "OK";
 	  gotQuit = true;
@@ -564,6 +617,8 @@ handleExceptionForGdb(WdRiscv::Core<URV>& core)
 	    reply << "Text=0;Data=0;Bss=0";
 	  else if (packet == "qSymbol::")
 	    reply << "OK";
+	  else if (packet.find("qSupported") == 0 and core.hasSnapshots())
+	    reply << "ReverseStep+;ReverseContinue+";
 	  else
 	    {
 	      std::cerr << "Unhandled gdb request: " << packet << '\n';
@@ -583,7 +583,7 @@ IFormInst::encodeSlli(unsigned rd, unsigned rs1, unsigned shamt)
   if (rd > 31 or rs1 > 31)
     return false;  // Register(s) out of bounds.
 
-  if (shamt > 31)
+  if (shamt > 63)
     return false;  // Shift amount out ofbounds.
 
   fields2.opcode = 0x13;
@@ -591,7 +591,7 @@ IFormInst::encodeSlli(unsigned rd, unsigned rs1, unsigned shamt)
   fields2.funct3 = 1;
   fields2.rs1 = rs1 & 0x1f;
   fields2.shamt = shamt & 0x1f;
-  fields2.top7 = 0;
+  fields2.top7 = (shamt >> 5) & 1;  // Bit 5 of shift amount (RV64).
   return true;
 }
 
@@ -612,7 +612,7 @@ IFormInst::encodeSrai(unsigned rd, unsigned rs1, unsigned shamt)
   if (not encodeSlli(rd, rs1, shamt))
     return false;
   fields2.funct3 = 5;
-  fields2.top7 = 0x20;
+  fields2.top7 |= 0x20;
   return true;
 }
 
@@ -662,7 +662,7 @@ IFormInst::encodeAddiw(unsigned rd, unsigned rs1, int imm)
 {
   if (not encodeAddi(rd, rs1, imm))
     return false;
-  fields.opcode = 0x033;
+  fields.opcode = 0x1b;
   fields.funct3 = 0;
   return true;
 }
@@ -674,10 +674,10 @@ IFormInst::encodeSlliw(unsigned rd, unsigned rs1, unsigned shamt)
   if (rd > 31 or rs1 > 31)
     return false;  // Register(s) out of bounds.
 
-  if (shamt > 63)
+  if (shamt > 31)
     return false;  // Shift amount out ofbounds.
 
-  fields2.opcode = 0x033;
+  fields2.opcode = 0x1b;
   fields2.rd = rd & 0x1f;
   fields2.funct3 = 1;
   fields2.rs1 = rs1 & 0x1f;
@@ -0,0 +1,234 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+#include "Core.hpp"
+
+
+using namespace WdRiscv;
+
+
+template <typename URV>
+bool
+Core<URV>::defineIntercepts(const std::vector<std::string>& names,
+			    uint64_t instCost, uint64_t cycleCost)
+{
+  const std::vector<std::pair<std::string, Intercept>> routines =
+    {
+      { "memcpy",  Intercept::Memcpy },
+      { "memmove", Intercept::Memmove },
+      { "memset",  Intercept::Memset },
+      { "strlen",  Intercept::Strlen },
+      { "strcmp",  Intercept::Strcmp }
+    };
+
+  unsigned errors = 0;
+
+  for (const auto& name : names)
+    {
+      bool all = name == "all", found = false;
+      for (const auto& routine : routines)
+	{
+	  if (not all and name != routine.first)
+	    continue;
+	  found = true;
+	  ElfSymbol sym;
+	  if (memory_.findElfSymbol(routine.first, sym))
+	    intercepts_[URV(sym.addr_)] = routine.second;
+	  else if (not all)
+	    {
+	      std::cerr << "Cannot intercept " << name << ": No such ELF "
+			<< "symbol\n";
+	      errors++;
+	    }
+	}
+
+      if (not found)
+	{
+	  std::cerr << "Cannot intercept " << name << ": Expecting memcpy, "
+		    << "memmove, memset, strlen, strcmp or all\n";
+	  errors++;
+	}
+    }
+
+  // Entry point range: Lets the run loops dismiss most pc values with
+  // two compares.
+  interceptLow_ = ~URV(0);
+  interceptHigh_ = 0;
+  for (const auto& kv : intercepts_)
+    {
+      interceptLow_ = std::min(interceptLow_, kv.first);
+      interceptHigh_ = std::max(interceptHigh_, kv.first);
+    }
+
+  interceptInsts_ = instCost;
+  interceptCycles_ = cycleCost;
+
+  return errors == 0;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::interceptCall()
+{
+  auto iter = intercepts_.find(pc_);
+  if (iter == intercepts_.end())
+    return false;
+
+  if (debugMode_ or debugStepMode_ or forceAccessFail_)
+    return false;
+
+  // The routines access physical memory directly: Let the library
+  // run when addresses are translated or when an access could hit a
+  // trigger.
+  if (virtMem_.isDataActive() or hasActiveTrigger())
+    return false;
+
+  // Return address must be fetchable without a misaligned exception.
+  URV ra = intRegs_.read(RegRa) & ~URV(1);
+  if ((ra & 2) and not isRvc())
+    return false;
+
+  size_t a0 = intRegs_.read(RegA0);
+  size_t a1 = intRegs_.read(RegA1);
+  size_t a2 = intRegs_.read(RegA2);
+  uint8_t* data = memory_.data_;
+  URV result = 0;
+
+  // Number of bytes from addr to the end of its page.
+  auto pageRest = [this] (size_t addr) -> size_t {
+    return memory_.getPageStartAddr(addr) + memory_.pageSize() - addr;
+  };
+
+  // A direct access must be allowed by PMP: Any fault is left to the
+  // library code to take. PMP is checked a page at a time.
+  auto allowed = [this, &pageRest] (size_t addr, size_t size,
+				    PmpManager::Access access) -> bool {
+    while (size)
+      {
+	size_t chunk = std::min(size, pageRest(addr));
+	if (not pmpAllows(URV(addr), unsigned(chunk), access))
+	  return false;
+	addr += chunk;
+	size -= chunk;
+      }
+    return true;
+  };
+
+  auto readable = [this, &allowed] (size_t addr, size_t size) -> bool {
+    return (memory_.isDirectlyAccessible(addr, size, false) and
+	    allowed(addr, size, PmpManager::Read));
+  };
+
+  // A direct write must not touch the locations with side effects.
+  auto writable = [this, &allowed] (size_t addr, size_t size) -> bool {
+    if (size == 0)
+      return true;
+    if (toHostValid_ and toHost_ >= addr and toHost_ - addr < size)
+      return false;
+    if (conIoValid_ and conIo_ >= addr and conIo_ - addr < size)
+      return false;
+    return (memory_.isDirectlyAccessible(addr, size, true) and
+	    allowed(addr, size, PmpManager::Write));
+  };
+
+  switch (iter->second)
+    {
+    case Intercept::Memcpy:
+    case Intercept::Memmove:
+      if (not writable(a0, a2) or not readable(a1, a2))
+	return false;
+      // Overlapping memcpy is undefined: Let the library decide.
+      if (iter->second == Intercept::Memcpy and a2 and
+	  a0 < a1 + a2 and a1 < a0 + a2)
+	return false;
+      memory_.noteWrite(a0, a2);
+      memmove(data + a0, data + a1, a2);
+      memory_.invalidateReservationRange(a0, a2);
+      ++memWriteCount_;
+      result = a0;
+      break;
+
+    case Intercept::Memset:
+      if (not writable(a0, a2))
+	return false;
+      memory_.noteWrite(a0, a2);
+      memset(data + a0, uint8_t(a1), a2);
+      memory_.invalidateReservationRange(a0, a2);
+      ++memWriteCount_;
+      result = a0;
+      break;
+
+    case Intercept::Strlen:
+      {
+	size_t len = 0;
+	for (size_t addr = a0; ; )
+	  {
+	    size_t chunk = pageRest(addr);
+	    if (not readable(addr, chunk))
+	      return false;
+	    const void* nul = memchr(data + addr, 0, chunk);
+	    if (nul)
+	      {
+		len += static_cast<const uint8_t*>(nul) - (data + addr);
+		break;
+	      }
+	    len += chunk;
+	    addr += chunk;
+	  }
+	result = len;
+      }
+      break;
+
+    case Intercept::Strcmp:
+      for (size_t s1 = a0, s2 = a1; ; )
+	{
+	  size_t chunk = std::min(pageRest(s1), pageRest(s2));
+	  if (not readable(s1, chunk) or not readable(s2, chunk))
+	    return false;
+	  const uint8_t* p1 = data + s1;
+	  const uint8_t* p2 = data + s2;
+	  size_t i = 0;
+	  while (i < chunk and p1[i] == p2[i] and p1[i])
+	    ++i;
+	  if (i < chunk)
+	    {
+	      result = SRV(int(p1[i]) - int(p2[i]));
+	      break;
+	    }
+	  s1 += chunk;
+	  s2 += chunk;
+	}
+      break;
+    }
+
+  intRegs_.write(RegA0, result);
+  pc_ = ra;
+
+  retiredInsts_ += interceptInsts_;
+  cycleCount_ += interceptCycles_;
+  return true;
+}
+
+
+template class WdRiscv::Core<uint32_t>;
+template class WdRiscv::Core<uint64_t>;
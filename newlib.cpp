@@ -37,6 +37,11 @@
 using namespace WdRiscv;
 
 
+// Upper bound on the size of the riscv kernel_stat buffer written by
+// the functions below.
+static constexpr size_t riscvStatSize = 128;
+
+
 // Copy x86 stat buffer to riscv kernel_stat buffer (32-bit version).
 static void
 copyStatBufferToRiscv32(const struct stat& buff, void* rvBuff)
@@ -180,6 +185,7 @@ Core<URV>::emulateNewlib()
 	int count = a2;
 
 	unsigned errors = 0;
+	size_t total = 0;
 	struct iovec* iov = new struct iovec [count];
 	for (int i = 0; i < count; ++i)
 	  {
@@ -194,10 +200,11 @@ Core<URV>::emulateNewlib()
 	      }
 	    iov[i].iov_base = (void*) addr;
 	    iov[i].iov_len = len;
+	    total += len;
 	  }
 	ssize_t rc = -1;
 	if (not errors)
-	  rc = writev(fd, iov, count);
+	  rc = replaying_ ? ssize_t(total) : writev(fd, iov, count);
 	delete [] iov;
 	return SRV(rc);
       }
@@ -216,6 +223,7 @@ Core<URV>::emulateNewlib()
 	size_t bufAddr = 0;
 	if (not memory_.getSimMemAddr(buf, bufAddr))
 	  return SRV(-1);
+	memory_.noteWrite(buf, bufSize);
 	ssize_t rc = readlinkat(dirfd, (const char*) pathAddr,
 				(char*) bufAddr, bufSize);
 	return SRV(rc);
@@ -241,6 +249,7 @@ Core<URV>::emulateNewlib()
 	  return rv;
 
 	// RvBuff contains an address: We cast it to a pointer.
+	memory_.noteWrite(a2, riscvStatSize);
 	if (sizeof(URV) == 4)
 	  copyStatBufferToRiscv32(buff, (void*) rvBuff);
 	else
@@ -261,6 +270,7 @@ Core<URV>::emulateNewlib()
 	  return rv;
 
 	// RvBuff contains an address: We cast it to a pointer.
+	memory_.noteWrite(a1, riscvStatSize);
 	if (sizeof(URV) == 4)
 	  copyStatBufferToRiscv32(buff, (void*) rvBuff);
 	else
@@ -292,6 +302,7 @@ Core<URV>::emulateNewlib()
 	if (not memory_.getSimMemAddr(a1, buffAddr))
 	  return SRV(-1);
 	size_t count = a2;
+	memory_.noteWrite(a1, count);
 	ssize_t rv = read(fd, (void*) buffAddr, count);
 	return URV(rv);
       }
@@ -303,6 +314,11 @@ Core<URV>::emulateNewlib()
 	if (not memory_.getSimMemAddr(a1, buffAddr))
 	  return SRV(-1);
 	size_t count = a2;
+
+	// Output was produced before going back in time: Do not repeat.
+	if (replaying_)
+	  return URV(count);
+
 	auto rv = write(fd, (void*) buffAddr, count);
 	if (rv < 0)
 	  {
@@ -0,0 +1,62 @@
+# Multi-hart atomics benchmark and test. Each hart adds 1 ITERS times
+# to a shared counter with amoadd.w, ITERS times to a shared counter
+# with lr.w/sc.w and ITERS times to a private counter with amoadd.w
+# (3 * ITERS atomic updates per hart). The number of harts, at most
+# 16, is passed in a1 (e.g. --harts 4 --setreg a1=4). When all the
+# harts are done, each of them checks the counters and writes 1
+# (pass) to tohost (0x2000) or 3 (fail).
+  .equ ITERS, 100000
+  .globl _start
+  .text
+_start:
+  csrr s0, mhartid
+  mv s1, a1
+  bnez s1, 1f
+  li s1, 1
+1:
+  la s2, shared
+  addi s5, s2, 4          # Counter updated with lr/sc.
+  la s3, private
+  slli t0, s0, 6          # Private counters 64 bytes apart.
+  add s3, s3, t0
+  li t1, 1
+  li s4, ITERS
+loop:
+  amoadd.w zero, t1, (s2)
+  amoadd.w zero, t1, (s3)
+2:
+  lr.w t2, (s5)
+  addi t2, t2, 1
+  sc.w t3, t2, (s5)
+  bnez t3, 2b
+  addi s4, s4, -1
+  bnez s4, loop
+
+  # Wait for the other harts.
+  la t0, finished
+  amoadd.w zero, t1, (t0)
+3:
+  lw t2, 0(t0)
+  bne t2, s1, 3b
+
+  li t4, 3
+  li t5, ITERS
+  lw t2, 0(s3)
+  bne t2, t5, fin
+  mul t5, t5, s1
+  lw t2, 0(s2)
+  bne t2, t5, fin
+  lw t2, 0(s5)
+  bne t2, t5, fin
+  li t4, 1
+fin:
+  li t0, 0x2000
+  sw t4, 0(t0)
+4: j 4b
+
+  .balign 64
+shared: .word 0, 0
+  .balign 64
+finished: .word 0
+  .balign 64
+private: .space 64*16
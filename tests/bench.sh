@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+# Copyright 2018 Western Digital Corporation or its affiliates.
+#
+# Compare the simulation speed of whisper executables. Each benchmark
+# runs under every executable in turn, N rounds interleaved so that a
+# busy host penalizes all of them alike, and the best rate of each
+# (millions of instructions per second) is reported.
+#
+# Usage: bench.sh [-n rounds] whisper-command ...
+#
+# A whisper command may carry options of its own, quoted as one
+# argument (e.g. "build-Linux/whisper --fusion").
+
+T=$(dirname "$0")
+rounds=5
+if [ "$1" = "-n" ]; then
+    rounds=$2
+    shift 2
+fi
+
+# bench <name> <whisper-options>: Uses the whisper commands in $cmds
+# (one per line).
+bench()
+{
+    name=$1
+    shift
+    rm -f "$tmp"
+    i=0
+    while [ $i -lt "$rounds" ]; do
+	echo "$cmds" | while read -r w; do
+	    r=$($w "$@" 2>&1 | sed -n 's/.* \([0-9][0-9]*\) inst\/s.*/\1/p')
+	    echo "${r:-0} $w" >> "$tmp"
+	done
+	i=$((i + 1))
+    done
+    echo "$cmds" | while read -r w; do
+	grep -F " $w" "$tmp" | awk -v n="$name" -v w="$w" \
+	    '$0 == $1 " " w && $1 > best { best = $1 }
+	     END { printf("%-9s %6.1f  %s\n", n, best / 1e6, w) }'
+    done
+}
+
+tmp=${TMPDIR:-/tmp}/bench.$$
+cmds=$(for w in "$@"; do echo "$w"; done)
+
+bench RV32IMC --isa imc --hex "$T/coremark_mix.hex" --startpc 0x1000 \
+      --tohost 0x2000
+bench RV32IMAC --isa imac --hex "$T/coremark_mix.hex" --startpc 0x1000 \
+      --tohost 0x2000
+bench RV64GC --xlen 64 --isa imafdc --hex "$T/coremark_mix64.hex" \
+      --startpc 0x1000 --tohost 0x2000
+rm -f "$tmp"
@@ -0,0 +1,201 @@
+# CoreMark-style benchmark: crc16, 6x6 matrix multiply, list walk and
+# a state machine, run ITERS times (44.2M instructions). Used to
+# measure the instruction dispatch cost of the interpreter. Writes 1
+# (pass) to tohost (0x2000) if the low 32 bits of the checksum of all
+# the kernels are the expected ones and 3 (fail) otherwise. Assemble
+# with --defsym RV64=1 for RV64 (coremark_mix64.hex).
+  .equ ITERS, 2000
+  .ifdef RV64
+  .equ ZEXT16, 48
+  .else
+  .equ ZEXT16, 16
+  .endif
+  .globl _start
+  .text
+_start:
+  la sp, stack_top
+  li s0, ITERS
+  li s2, 0
+main_loop:
+  la a0, buffer
+  li a1, 256
+  call crc16
+  add s2, s2, a0
+  call matmul
+  add s2, s2, a0
+  la a0, list
+  call listwalk
+  add s2, s2, a0
+  la a0, text
+  call state
+  add s2, s2, a0
+  # zero-extend halfword of checksum and mix
+  slli t0, s2, ZEXT16
+  srli t0, t0, ZEXT16
+  add s2, s2, t0
+  slli t1, s2, 5
+  xor s2, s2, t1
+  addi s0, s0, -1
+  bnez s0, main_loop
+  .ifdef RV64
+  slli s2, s2, 32
+  srli s2, s2, 32
+  .endif
+  li t1, 0xb03b5102       # Expected checksum.
+  li t2, 3
+  bne s2, t1, 2f
+  li t2, 1
+2:
+  li t0, 0x2000           # tohost
+  sw t2, 0(t0)
+1: j 1b
+
+# crc16(a0 = buf, a1 = len)
+crc16:
+  addi sp, sp, -16
+  sw ra, 12(sp)
+  sw s0, 8(sp)
+  sw s1, 4(sp)
+  li t2, 0xffff
+  li s0, 0
+  li s1, 0x1021
+1:
+  lbu t0, 0(a0)
+  slli t0, t0, 8
+  xor s0, s0, t0
+  li t1, 8
+2:
+  slli s0, s0, 1
+  srli t3, s0, 16
+  andi t3, t3, 1
+  beqz t3, 3f
+  xor s0, s0, s1
+3:
+  and s0, s0, t2
+  addi t1, t1, -1
+  bnez t1, 2b
+  addi a0, a0, 1
+  addi a1, a1, -1
+  bnez a1, 1b
+  mv a0, s0
+  lw ra, 12(sp)
+  lw s0, 8(sp)
+  lw s1, 4(sp)
+  addi sp, sp, 16
+  ret
+
+# matmul: 6x6 int matrices A*B accumulate trace
+matmul:
+  addi sp, sp, -16
+  sw ra, 12(sp)
+  sw s0, 8(sp)
+  sw s1, 4(sp)
+  sw s3, 0(sp)
+  li a0, 0
+  li s0, 0          # i
+1:
+  li s1, 0          # j
+2:
+  li t4, 0
+  li s3, 0          # k
+3:
+  li t0, 24
+  mul t1, s0, t0
+  slli t2, s3, 2
+  add t1, t1, t2
+  lui t5, %hi(mata)
+  addi t5, t5, %lo(mata)
+  add t1, t1, t5
+  lw t1, 0(t1)
+  mul t2, s3, t0
+  slli t3, s1, 2
+  add t2, t2, t3
+9:
+  auipc t5, %pcrel_hi(matb)
+  addi t5, t5, %pcrel_lo(9b)
+  add t2, t2, t5
+  lw t2, 0(t2)
+  mul t1, t1, t2
+  add t4, t4, t1
+  addi s3, s3, 1
+  li t6, 6
+  bne s3, t6, 3b
+  add a0, a0, t4
+  addi s1, s1, 1
+  bne s1, t6, 2b
+  addi s0, s0, 1
+  bne s0, t6, 1b
+  lw ra, 12(sp)
+  lw s0, 8(sp)
+  lw s1, 4(sp)
+  lw s3, 0(sp)
+  addi sp, sp, 16
+  ret
+
+# listwalk(a0 = head): sum of values until null
+listwalk:
+  li t0, 0
+1:
+  beqz a0, 2f
+  lw t1, 4(a0)
+  add t0, t0, t1
+  lw a0, 0(a0)
+  j 1b
+2:
+  mv a0, t0
+  ret
+
+# state(a0 = text): count digit/alpha transitions
+state:
+  addi sp, sp, -16
+  sw ra, 12(sp)
+  sw s0, 8(sp)
+  li t0, 0   # state
+  li t1, 0   # count
+1:
+  lbu t2, 0(a0)
+  beqz t2, 4f
+  addi t3, t2, -48
+  li t4, 10
+  bltu t3, t4, 2f
+  li t5, 1
+  j 3f
+2:
+  li t5, 2
+3:
+  beq t5, t0, 5f
+  addi t1, t1, 1
+5:
+  mv t0, t5
+  addi a0, a0, 1
+  j 1b
+4:
+  mv a0, t1
+  lw ra, 12(sp)
+  lw s0, 8(sp)
+  addi sp, sp, 16
+  ret
+
+  .balign 4
+buffer:
+  .rept 64
+  .word 0x12345678, 0x9abcdef0, 0x0f1e2d3c, 0x4b5a6978
+  .endr
+mata:
+  .rept 36
+  .word 3
+  .endr
+matb:
+  .rept 36
+  .word 7
+  .endr
+list:
+  .word n1, 5
+n1: .word n2, 7
+n2: .word n3, 11
+n3: .word n4, 13
+n4: .word 0, 17
+text: .asciz "abc123def456ghi789jkl0mnopq12rstu34"
+  .balign 16
+  .space 1024
+stack_top:
@@ -0,0 +1,38 @@
+# Performance counters across exceptions: A faulting misaligned load
+# must not count the next load (first of the trap handler) as
+# misaligned, and an ecall (which takes an exception) must be counted.
+# Writes 1 (pass) to tohost if mhpmcounter3 (misaligned loads) is 0
+# and mhpmcounter4 (ecalls) is 1, and 3 (fail) otherwise.
+  .globl _start
+  .text
+_start:
+  la t0, handler
+  csrw mtvec, t0
+  li t0, 13               # Misaligned loads.
+  csrw mhpmevent3, t0
+  li t0, 20               # Ecalls.
+  csrw mhpmevent4, t0
+  csrw mhpmcounter3, zero
+  csrw mhpmcounter4, zero
+  li t0, 0xfffffffe       # Misaligned, crossing the end of memory.
+  lw t1, 0(t0)
+  ecall
+  csrr t1, mhpmcounter3
+  csrr t2, mhpmcounter4
+  li t3, 3
+  bnez t1, done
+  li t4, 1
+  bne t2, t4, done
+  li t3, 1
+done:
+  li t0, 0x2000           # tohost
+  sw t3, 0(t0)
+1:
+  j 1b
+
+handler:
+  lw t5, 0(zero)          # Aligned load.
+  csrr t5, mepc
+  addi t5, t5, 4
+  csrw mepc, t5
+  mret
@@ -0,0 +1,35 @@
+# Machine mode with MPRV set and MPP = user stores to memory that PMP
+# makes read/execute only for user mode. The store must be checked
+# in user mode and fault (mcause 7): The handler then writes 1 (pass)
+# to tohost, otherwise 3 (fail).
+  .globl _start
+  .text
+_start:
+  la t0, handler
+  csrw mtvec, t0
+  li t0, -1
+  csrw pmpaddr0, t0       # NAPOT: whole address space
+  li t0, 0x1d
+  csrw pmpcfg0, t0        # NAPOT, R and X, not locked
+  li t0, 0x1800
+  csrc mstatus, t0        # MPP = user
+  li t0, 0x20000
+  csrs mstatus, t0        # MPRV
+  li t0, 0x3000
+  sw t0, 0(t0)
+  li t3, 3
+  j done
+
+handler:
+  li t0, 0x20000
+  csrc mstatus, t0        # Clear MPRV
+  csrr t1, mcause
+  li t2, 7
+  li t3, 1
+  beq t1, t2, done
+  li t3, 3
+done:
+  li t0, 0x2000           # tohost
+  sw t3, 0(t0)
+1:
+  j 1b
@@ -0,0 +1,30 @@
+# Machine mode drops to user mode and executes an ecall. With no PMP
+# entry implemented user mode is unrestricted: The trap handler sees
+# an environment call (mcause 8) and writes 1 (pass) to tohost. With
+# PMP entries implemented but not programmed, the user mode fetch
+# faults (mcause 1) and the handler writes 3 (fail) to tohost.
+  .globl _start
+  .text
+_start:
+  la t0, handler
+  csrw mtvec, t0
+  li t0, 0x1800
+  csrc mstatus, t0        # MPP = user
+  la t0, ucode
+  csrw mepc, t0
+  mret
+
+ucode:
+  ecall
+
+handler:
+  csrr t1, mcause
+  li t2, 8
+  li t3, 1
+  beq t1, t2, done
+  li t3, 3
+done:
+  li t0, 0x2000           # tohost
+  sw t3, 0(t0)
+1:
+  j 1b
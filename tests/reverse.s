@@ -0,0 +1,30 @@
+# Reverse execution test program (see tests/run.sh). A loop of ITERS
+# iterations updates registers and stores into a 64-word array at
+# 0x1400 so that going back in time must restore both. The store of
+# the loop is at 0x102c. Writes 1 to tohost (0x2000).
+  .equ ITERS, 1000
+  .globl _start
+  .text
+_start:
+  li s0, 0x1400
+  li s1, 1
+  li s2, 0
+  li s3, ITERS
+loop:
+  slli t0, s1, 1
+  add s1, s1, t0
+  add s1, s1, s2
+  andi t1, s2, 63
+  slli t1, t1, 2
+  add t1, t1, s0
+  sw s1, 0(t1)
+  addi s2, s2, 1
+  bne s2, s3, loop
+
+  li t0, 1
+  li t1, 0x2000
+  sw t0, 0(t1)
+1: j 1b
+
+  .org 0x400
+array: .space 64 * 4
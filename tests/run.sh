@@ -0,0 +1,158 @@
+#!/bin/sh
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+# Copyright 2018 Western Digital Corporation or its affiliates.
+#
+# Run the whisper regression tests. Each test runs a program and
+# checks the value it writes to tohost. The hex files are built from
+# the assembly sources of the same name (linked at 0x1000).
+#
+# Usage: run.sh [whisper-executable]
+
+W=${1:-build-Linux/whisper}
+T=$(dirname "$0")
+failed=0
+
+# expect <tohost-value> <whisper-options>
+expect()
+{
+    value=$1
+    shift
+    out=$("$W" "$@" 2>&1 | grep "stop: write to to-host")
+    if [ "${out##*: }" = "$value" ]; then
+	echo "PASS: $*"
+    else
+	echo "FAIL: $* (expecting tohost $value, got: $out)"
+	failed=$((failed + 1))
+    fi
+}
+
+# same <description> <output> <expected-output>
+same()
+{
+    if [ -n "$2" ] && [ "$2" = "$3" ]; then
+	echo "PASS: $1"
+    else
+	echo "FAIL: $1"
+	failed=$((failed + 1))
+    fi
+}
+
+# Registers, CSRs and memory at the end of the given interactive
+# commands with reverse execution on.
+# revstate <commands> [<whisper-options>]
+revstate()
+{
+    printf "$1\npeek all\npeek m 0x1400 0x14fc\nquit\n" |
+	"$W" --hex "$T/reverse.hex" --startpc 0x1000 --tohost 0x2000 \
+	     --interactive --snapshotperiod 100 $2 2>/dev/null | grep -v '^#'
+}
+
+# gdb remote packet for the given data followed by the ack of its reply.
+# pkt <data> [<count>]
+pkt()
+{
+    sum=$(printf %s "$1" | od -An -tu1 |
+	      awk '{for (i = 1; i <= NF; i++) s += $i} END {print s % 256}')
+    i=0
+    while [ $i -lt "${2:-1}" ]; do
+	printf '$%s#%02x+' "$1" "$sum"
+	i=$((i + 1))
+    done
+}
+
+# Replies to the given gdb packets (ending with a continue) with
+# reverse execution on.
+# gdbstate <packets>
+gdbstate()
+{
+    printf "+$1$(pkt g)$(pkt p20)$(pkt c)" |
+	"$W" --hex "$T/reverse.hex" --startpc 0x1000 --tohost 0x2000 \
+	     --gdb --snapshotperiod 10 2>&1 | tr '$' '\n' |
+	grep -o '^[0-9a-f]*#..'
+}
+
+for xlen in 32 64; do
+    # No PMP entry by default: User mode is not restricted.
+    expect 1 --xlen $xlen --hex "$T/pmp_umode_ecall.hex" --startpc 0x1000 \
+	   --tohost 0x2000
+    # PMP entries implemented but not programmed: User fetch faults.
+    expect 3 --xlen $xlen --configfile "$T/pmp16.json" \
+	   --hex "$T/pmp_umode_ecall.hex" --startpc 0x1000 --tohost 0x2000
+    # Machine mode loads and stores are checked in MPP when MPRV is set.
+    expect 1 --xlen $xlen --configfile "$T/pmp16.json" \
+	   --hex "$T/pmp_mprv.hex" --startpc 0x1000 --tohost 0x2000
+    # Performance counters count the ecall and do not carry the
+    # misaligned event of a faulting load (fast and logging loops).
+    for log in "" --log; do
+	expect 1 --xlen $xlen --counters --configfile "$T/perf4.json" \
+	       --hex "$T/perf_exception.hex" --startpc 0x1000 --tohost 0x2000 \
+	       $log
+    done
+    # Vector loop (also a benchmark: 8.2M elements, see vec_saxpy.s).
+    expect 1 --xlen $xlen --isa imv --hex "$T/vec_saxpy.hex" --startpc 0x1000 \
+	   --tohost 0x2000
+    # Load, store (NAPOT) and execute address triggers take a breakpoint
+    # exception on matching accesses only.
+    expect 1 --xlen $xlen --triggers --hex "$T/triggers.hex" \
+	   --startpc 0x1000 --tohost 0x2000
+    # Supervisor interrupt delegated through mideleg and raised by
+    # setting mip.STIP between steps.
+    expect 1 --xlen $xlen --isa imsu --hex "$T/sint.hex" --startpc 0x1000 \
+	   --tohost 0x2000 --interactive <<EOF
+step 40
+poke c mip 0x20
+step 1
+run
+EOF
+    # A what-if sequence with a store, a CSR write and an ecall (a trap,
+    # or newlib writing memory directly) leaves no trace.
+    for newlib in "" --newlib; do
+	expect 1 --xlen $xlen --hex "$T/whatif.hex" --startpc 0x1000 \
+	       --tohost 0x2000 --interactive $newlib <<EOF
+until 0x1100
+whatif begin
+whatif step 0x00942023
+whatif step 0x34049073
+whatif step 0x00000073
+whatif end
+run
+EOF
+    done
+    # Sv32 or Sv39: A/D bit updates, store to a read-only page, misaligned
+    # superpage, sfence.vma and an instruction straddling two pages.
+    sfx=
+    [ $xlen = 64 ] && sfx=64
+    expect 1 --xlen $xlen --isa imcsu --hex "$T/vm_sv$sfx.hex" \
+	   --startpc 0x1000 --tohost 0x2000
+    # Translation benchmark without (a1=0) and with (a1=1) translation.
+    for vm in 0 1; do
+	expect 1 --xlen $xlen --isa imsu --setreg a1=$vm \
+	       --hex "$T/vm_loop$sfx.hex" --startpc 0x1000 --tohost 0x2000
+    done
+done
+
+# Atomics and lr/sc of several harts on shared counters (also a
+# benchmark: vary --harts, see amo_harts.s).
+for harts in 1 4; do
+    expect 1 --isa ima --harts $harts --setreg a1=$harts \
+	   --hex "$T/amo_harts.hex" --startpc 0x1000 --tohost 0x2000
+done
+
+# Reverse execution: Going back (bs, bc, goto) reaches the state of
+# going forward the same number of instructions. The store of the loop
+# of reverse.s at 0x102c is last reached at instruction 1694 before
+# instruction 1700 (11 + 9k) and at 56 before 60.
+same "bs" "$(revstate 'step 1700\nbs 1200')" "$(revstate 'step 500')"
+same "goto back" "$(revstate 'step 1700\ngoto 500')" "$(revstate 'step 500')"
+same "goto forward" "$(revstate 'step 300\ngoto 500')" "$(revstate 'step 500')"
+same "bc" "$(revstate 'step 1700\nbc 0x102c')" "$(revstate 'step 1694')"
+# A zero budget keeps only the latest snapshot (at 1600).
+same "bs --snapshotbudget 0" \
+     "$(revstate 'step 1700\nbs 1200' '--snapshotbudget 0')" \
+     "$(revstate 'step 1600')"
+same "gdb bs" "$(gdbstate "$(pkt s 60)$(pkt bs 2)")" "$(gdbstate "$(pkt s 58)")"
+same "gdb bc" "$(gdbstate "$(pkt s 60)$(pkt Z0,102c,4)$(pkt bc)$(pkt z0,102c,4)")" \
+     "$(gdbstate "$(pkt s 56)")"
+
+[ $failed -eq 0 ]
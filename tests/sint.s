@@ -0,0 +1,56 @@
+# Supervisor interrupt delivery test (RV32 or RV64, --isa imsu, run
+# interactively). Machine mode delegates the supervisor timer interrupt
+# through mideleg, enables it in sie and spins in supervisor mode with
+# sstatus.SIE set. Setting mip.STIP (poke c mip 0x20) must trap to stvec
+# with an interrupt scause of 5 and sstatus.SPP set. Writes 1 (pass) to
+# tohost (0x2000) or 3 (fail, also if no interrupt arrives within
+# 1000 iterations); an interrupt taken in machine mode writes 5.
+  .globl _start
+  .text
+_start:
+  la t0, mhandler
+  csrw mtvec, t0
+  la t0, shandler
+  csrw stvec, t0
+  li t0, 0x20
+  csrw mideleg, t0
+  csrs mie, t0
+  csrr t1, sie
+  bne t0, t1, fail
+  csrsi sstatus, 2
+  li t0, 0x1800
+  csrc mstatus, t0
+  li t0, 0x800
+  csrs mstatus, t0
+  la t0, spin
+  csrw mepc, t0
+  li t2, 1000
+  mret
+
+spin:
+  addi t2, t2, -1
+  bnez t2, spin
+  j fail
+
+shandler:
+  csrr t0, scause
+  bgez t0, fail
+  andi t0, t0, 0xff
+  li t1, 5
+  bne t0, t1, fail
+  csrr t0, sstatus
+  andi t0, t0, 0x100
+  beqz t0, fail
+  li t0, 1
+  j fin
+
+fail:
+  li t0, 3
+  j fin
+
+mhandler:
+  li t0, 5
+fin:
+  li t1, 0x2000
+  sw t0, 0(t1)
+1: j 1b
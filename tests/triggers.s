@@ -0,0 +1,107 @@
+# Address trigger test (RV32 or RV64, run with --triggers). Programs
+# mcontrol triggers in machine mode (breakpoint action, which requires
+# mstatus.MIE) and checks that only the matching accesses take a
+# breakpoint exception:
+#  1. Load address trigger (equal) on data.
+#  2. Store address trigger (NAPOT) on the 16 bytes at data.
+#  3. Execute address trigger (equal) on target.
+#  4. The load trigger disabled (m bit clear) no longer trips.
+# Writes 1 (pass) to tohost (0x2000) or 2n+1 if check n fails.
+  .globl _start
+  .text
+_start:
+  la t0, handler
+  csrw mtvec, t0
+  csrsi mstatus, 8
+  li s5, 0                 # Breakpoint count.
+
+  # Address/data match trigger type (2) in the top 4 bits of tdata1.
+  li t0, -1
+  srli t1, t0, 2
+  srli t2, t0, 3
+  xor s4, t1, t2
+  la s0, data
+
+  # 1. Load, m bit and load bit.
+  li a7, 1
+  csrwi tselect, 0
+  csrw tdata2, s0
+  ori t0, s4, 0x41
+  csrw tdata1, t0
+  lw t1, 4(s0)
+  sw zero, 0(s0)
+  bnez s5, fail
+load:
+  lw t1, 0(s0)
+  li t0, 1
+  bne s5, t0, fail
+  la t0, load
+  bne s6, t0, fail
+
+  # 2. Store, NAPOT match: tdata2 low bits 0b0111 select 16 bytes.
+  li a7, 2
+  csrwi tselect, 1
+  addi t0, s0, 7
+  csrw tdata2, t0
+  ori t0, s4, 0xc2
+  csrw tdata1, t0
+  sw zero, 16(s0)
+  lw t1, 12(s0)
+  li t0, 1
+  bne s5, t0, fail
+store:
+  sw zero, 12(s0)
+  li t0, 2
+  bne s5, t0, fail
+  la t0, store
+  bne s6, t0, fail
+
+  # 3. Execute.
+  li a7, 3
+  csrwi tselect, 2
+  la t0, target
+  csrw tdata2, t0
+  ori t0, s4, 0x44
+  csrw tdata1, t0
+  j target
+  nop
+target:
+  nop
+  li t0, 3
+  bne s5, t0, fail
+  la t0, target
+  bne s6, t0, fail
+
+  # 4. Disable the load trigger.
+  li a7, 4
+  csrwi tselect, 0
+  csrw tdata1, s4
+  lw t1, 0(s0)
+  li t0, 3
+  bne s5, t0, fail
+
+  li t0, 1
+  j fin
+
+fail:
+  slli t0, a7, 1
+  addi t0, t0, 1
+fin:
+  li t1, 0x2000
+  sw t0, 0(t1)
+1: j 1b
+
+  # Count breakpoints, record their pc and skip the instruction. Any
+  # other trap is a failure.
+handler:
+  csrr t6, mcause
+  li t5, 3
+  bne t6, t5, fail
+  addi s5, s5, 1
+  csrr s6, mepc
+  addi t6, s6, 4
+  csrw mepc, t6
+  mret
+
+  .balign 16
+data: .word 0, 0, 0, 0, 0, 0, 0, 0
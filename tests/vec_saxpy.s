@@ -0,0 +1,62 @@
+# Vector loop benchmark and test: y[i] += 3 * x[i] over 4096 32-bit
+# elements (strip-mined with LMUL=8), repeated 2000 times (8.2M
+# elements). The result is then checked with scalar code against
+# y[i] = 2000 * 3 * i. Writes 1 (pass) to tohost or 3 (fail).
+  .globl _start
+  .text
+_start:
+  li s0, 0x10000          # x
+  li s1, 0x20000          # y
+  li s4, 4096             # Element count.
+
+  # x[i] = i, y[i] = 0.
+  mv t2, s0
+  mv t3, s1
+  li t0, 0
+1:
+  sw t0, 0(t2)
+  sw zero, 0(t3)
+  addi t2, t2, 4
+  addi t3, t3, 4
+  addi t0, t0, 1
+  bne t0, s4, 1b
+
+  li s2, 2000             # Repeat count.
+  li s3, 3
+outer:
+  mv a1, s0
+  mv a2, s1
+  mv a0, s4
+2:
+  vsetvli t0, a0, e32, m8, ta, ma
+  vle32.v v8, (a1)
+  vle32.v v16, (a2)
+  vmacc.vx v16, s3, v8
+  vse32.v v16, (a2)
+  slli t1, t0, 2
+  add a1, a1, t1
+  add a2, a2, t1
+  sub a0, a0, t0
+  bnez a0, 2b
+  addi s2, s2, -1
+  bnez s2, outer
+
+  # Check y[i] = 6000 * i.
+  li t3, 3
+  mv t2, s1
+  li t0, 0
+  li t1, 0
+  li t4, 6000
+3:
+  lw t5, 0(t2)
+  bne t5, t1, done
+  add t1, t1, t4
+  addi t2, t2, 4
+  addi t0, t0, 1
+  bne t0, s4, 3b
+  li t3, 1
+done:
+  li t0, 0x2000           # tohost
+  sw t3, 0(t0)
+4:
+  j 4b
@@ -0,0 +1,92 @@
+# Address translation benchmark. A loop of loads and stores spread over
+# 4 pages runs in machine mode without translation (a1=0) or in
+# supervisor mode with Sv32, or Sv39 when assembled with --defsym
+# RV64=1 (vm_loop64.hex), with a1=1 (--setreg a1=1 --isa imsu).
+# Comparing the two gives the translation overhead. Writes 1 (pass) to
+# tohost (0x2000) or 3 (fail).
+  .equ ITERS, 500000
+  .ifdef RV64
+  .equ SATP, (8 << 60) | 0x10
+  .macro SPTE reg, offset, base
+  sd \reg, (\offset * 8)(\base)
+  .endm
+  .else
+  .equ SATP, (1 << 31) | 0x10
+  .macro SPTE reg, offset, base
+  sw \reg, (\offset * 4)(\base)
+  .endm
+  .endif
+
+  .globl _start
+  .text
+_start:
+  li s2, 0x20000
+  beqz a1, loop_start
+
+  # Identity superpage for the code, va 0x40000000 to 0x40003fff
+  # mapped to 0x20000 to 0x23fff (see vm_sv.s).
+  li s0, 0x10000
+  li t0, 0xcf
+  SPTE t0, 0, s0
+  .ifdef RV64
+  li t0, 0x4401
+  SPTE t0, 1, s0
+  li s1, 0x11000
+  li t0, 0x4801
+  SPTE t0, 0, s1
+  .else
+  li t0, 0x4801
+  SPTE t0, 256, s0
+  .endif
+  li s1, 0x12000
+  li t0, 0x80c7
+  SPTE t0, 0, s1
+  li t0, 0x84c7
+  SPTE t0, 1, s1
+  li t0, 0x88c7
+  SPTE t0, 2, s1
+  li t0, 0x8cc7
+  SPTE t0, 3, s1
+
+  li s2, 0x40000000
+  li t0, SATP
+  csrw satp, t0
+  li t0, 0x1800
+  csrc mstatus, t0
+  li t0, 0x800
+  csrs mstatus, t0
+  la t0, loop_start
+  csrw mepc, t0
+  mret
+
+loop_start:
+  li t0, 4096
+  add s3, s2, t0
+  add s4, s3, t0
+  add s5, s4, t0
+  li s6, ITERS
+loop:
+  lw t1, 0(s2)
+  lw t2, 0(s3)
+  lw t3, 0(s4)
+  lw t4, 0(s5)
+  addi t1, t1, 1
+  addi t2, t2, 2
+  addi t3, t3, 3
+  addi t4, t4, 4
+  sw t1, 0(s2)
+  sw t2, 0(s3)
+  sw t3, 0(s4)
+  sw t4, 0(s5)
+  addi s6, s6, -1
+  bnez s6, loop
+
+  li t0, 3
+  li t5, ITERS * 4
+  lw t4, 0(s5)
+  bne t4, t5, fin
+  li t0, 1
+fin:
+  li t1, 0x2000
+  sw t0, 0(t1)
+1: j 1b
@@ -0,0 +1,195 @@
+# Address translation test: Sv32, or Sv39 when assembled with
+# --defsym RV64=1 (vm_sv64.hex). Run with --isa imcsu. Machine mode
+# builds the page tables and enters supervisor mode, which checks:
+#  1. A load sets the accessed bit of a clean leaf entry, a store sets
+#     its dirty bit.
+#  2. A store to a read-only page takes a store page fault.
+#  3. A misaligned superpage takes a load page fault.
+#  4. sfence.vma drops a stale translation.
+#  5. A 4-byte instruction straddling two pages mapped to
+#     non-contiguous physical pages executes.
+# Writes 1 (pass) to tohost (0x2000) or 2n+1 if check n fails.
+#
+# Physical layout: root table at 0x10000 (Sv39 level 1 at 0x11000),
+# leaf table at 0x12000 mapping va 0x40000000 to 0x40003fff, data
+# pages at 0x20000 to 0x24000. The low 4 MiB (Sv32) or 1 GiB (Sv39)
+# are identity mapped by a superpage.
+  .ifdef RV64
+  .equ SATP, (8 << 60) | 0x10
+  .equ MISALIGNED_VA, 0x40200000   # Level 1 entry 1.
+  .macro SPTE reg, offset, base
+  sd \reg, (\offset * 8)(\base)
+  .endm
+  .macro LPTE reg, offset, base
+  ld \reg, (\offset * 8)(\base)
+  .endm
+  .else
+  .equ SATP, (1 << 31) | 0x10
+  .equ MISALIGNED_VA, 0x40400000   # Root entry 257.
+  .macro SPTE reg, offset, base
+  sw \reg, (\offset * 4)(\base)
+  .endm
+  .macro LPTE reg, offset, base
+  lw \reg, (\offset * 4)(\base)
+  .endm
+  .endif
+
+  .globl _start
+  .text
+_start:
+  la t0, mhandler
+  csrw mtvec, t0
+
+  # Superpage identity map of code and tables: RWX, accessed, dirty.
+  li s0, 0x10000
+  li t0, 0xcf
+  SPTE t0, 0, s0
+  .ifdef RV64
+  li t0, 0x4401            # Root entry 1 -> level 1 table at 0x11000.
+  SPTE t0, 1, s0
+  li s1, 0x11000
+  li t0, 0x4801            # Level 1 entry 0 -> leaf table at 0x12000.
+  SPTE t0, 0, s1
+  li t0, 0x84c3            # Level 1 entry 1: Megapage at 0x21000.
+  SPTE t0, 1, s1
+  .else
+  li t0, 0x4801            # Root entry 256 -> leaf table at 0x12000.
+  SPTE t0, 256, s0
+  li t0, 0x84c3            # Root entry 257: Megapage at 0x21000.
+  SPTE t0, 257, s0
+  .endif
+
+  li s2, 0x12000
+  li t0, 0x8007            # 0x40000000 -> 0x20000 RW, not accessed.
+  SPTE t0, 0, s2
+  li t0, 0x8443            # 0x40001000 -> 0x21000 R.
+  SPTE t0, 1, s2
+  li t0, 0x88cf            # 0x40002000 -> 0x22000 RWX.
+  SPTE t0, 2, s2
+  li t0, 0x9049            # 0x40003000 -> 0x24000 X.
+  SPTE t0, 3, s2
+
+  # Page markers.
+  li t0, 0x20000
+  li t1, 0x20
+  sw t1, 0(t0)
+  li t0, 0x21000
+  li t1, 0x21
+  sw t1, 0(t0)
+  li t0, 0x23000
+  li t1, 0x23
+  sw t1, 0(t0)
+
+  # Instruction at the end of 0x22000 continued at 0x24000.
+  la t0, straddle
+  li t1, 0x22ffe
+  li t2, 0x24000
+  lhu t3, 0(t0)
+  sh t3, 0(t1)
+  lhu t3, 2(t0)
+  sh t3, 0(t2)
+  lhu t3, 4(t0)
+  sh t3, 2(t2)
+  lhu t3, 6(t0)
+  sh t3, 4(t2)
+
+  # Delegate page faults, enter supervisor mode with translation on.
+  li t0, 0xb000
+  csrw medeleg, t0
+  la t0, shandler
+  csrw stvec, t0
+  li t0, SATP
+  csrw satp, t0
+  li t0, 0x1800
+  csrc mstatus, t0
+  li t0, 0x800
+  csrs mstatus, t0
+  la t0, scode
+  csrw mepc, t0
+  mret
+
+scode:
+  # 1. Accessed and dirty bits.
+  li a7, 1
+  li a0, 0x40000000
+  lw t0, 0(a0)
+  li t1, 0x20
+  bne t0, t1, fail
+  LPTE t0, 0, s2
+  andi t0, t0, 0xc0
+  li t1, 0x40
+  bne t0, t1, fail
+  sw t0, 4(a0)
+  LPTE t0, 0, s2
+  andi t0, t0, 0xc0
+  li t1, 0xc0
+  bne t0, t1, fail
+
+  # 2. Store to a read-only page.
+  li a7, 2
+  li a1, 0x40001000
+  lw t0, 0(a1)
+  li t1, 0x21
+  bne t0, t1, fail
+  li s5, 0
+  sw t0, 0(a1)
+  li t1, 15
+  bne s5, t1, fail
+  bne s6, a1, fail
+
+  # 3. Misaligned superpage.
+  li a7, 3
+  li a1, MISALIGNED_VA
+  li s5, 0
+  lw t0, 0(a1)
+  li t1, 13
+  bne s5, t1, fail
+  bne s6, a1, fail
+
+  # 4. Remap 0x40000000 to 0x23000.
+  li a7, 4
+  li t0, 0x8cc7
+  SPTE t0, 0, s2
+  sfence.vma a0, zero
+  lw t0, 0(a0)
+  li t1, 0x23
+  bne t0, t1, fail
+
+  # 5. Straddling instruction (sets s7) followed by a return.
+  li a7, 5
+  li s7, 0
+  li t0, 0x40002ffe
+  jalr ra, 0(t0)
+  li t1, 0x5a
+  bne s7, t1, fail
+
+  li t0, 1
+  j fin
+
+fail:
+  slli t0, a7, 1
+  addi t0, t0, 1
+fin:
+  li t1, 0x2000
+  sw t0, 0(t1)
+1: j 1b
+
+  # Record the cause and the value of a delegated trap and skip the
+  # faulting instruction.
+shandler:
+  csrr s5, scause
+  csrr s6, stval
+  csrr t6, sepc
+  addi t6, t6, 4
+  csrw sepc, t6
+  sret
+
+mhandler:
+  li t0, 0x2000
+  li t1, 0xff
+  sw t1, 0(t0)
+2: j 2b
+
+straddle:
+  addi s7, zero, 0x5a
+  jalr zero, 0(ra)
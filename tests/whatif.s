@@ -0,0 +1,64 @@
+# What-if sequence test (run interactively). The program stops at
+# ready (0x1100) where the script runs a what-if sequence of
+#   sw s1, 0(s0)          0x00942023
+#   csrw mscratch, s1     0x34049073
+#   ecall                 0x00000073
+# which writes buf, mscratch and, with --newlib, a0 and the 128-byte
+# stat structure at buf (fstat of fd 1) or, without it, the trap CSRs.
+# After whatif end, the program checks that a0, mscratch, mcause and
+# buf are unchanged. Writes 1 (pass) to tohost (0x2000) or 3 (fail);
+# a trap taken outside the sequence writes 5.
+  .equ WORDS, 40
+  .globl _start
+  .text
+_start:
+  la t0, mtrap
+  csrw mtvec, t0
+  la s0, buf
+  li t1, 0x55555555
+  li t2, WORDS
+  mv t3, s0
+1:
+  sw t1, 0(t3)
+  addi t3, t3, 4
+  addi t2, t2, -1
+  bnez t2, 1b
+  li t2, 0x1234
+  csrw mscratch, t2
+  li s1, 0xabc
+  li a0, 1
+  mv a1, s0
+  li a7, 80                # fstat
+  j ready
+
+  .org 0x100
+ready:
+  li t0, 3
+  li t2, 1
+  bne a0, t2, fin
+  li t2, 0x1234
+  csrr t3, mscratch
+  bne t3, t2, fin
+  csrr t3, mcause
+  bnez t3, fin
+  li t1, 0x55555555
+  li t2, WORDS
+  mv t3, s0
+2:
+  lw t4, 0(t3)
+  bne t4, t1, fin
+  addi t3, t3, 4
+  addi t2, t2, -1
+  bnez t2, 2b
+  li t0, 1
+fin:
+  li t1, 0x2000
+  sw t0, 0(t1)
+3: j 3b
+
+mtrap:
+  li t0, 5
+  j fin
+
+  .balign 64
+buf: .space WORDS * 4
@@ -0,0 +1,2033 @@
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright 2018 Western Digital Corporation or its affiliates.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Vector extension (RVV 1.0) instructions of the Core class. The
+// element loops are written over plain arrays of host integers and
+// floats and, when unmasked, without a per element branch so that the
+// host compiler turns them into host SIMD code.
+
+#include <algorithm>
+#include <iostream>
+#include <type_traits>
+#include <string.h>
+
+#if __x86_64__
+  typedef __int128_t Int128;
+  typedef __uint128_t Uint128;
+#else
+  #include <boost/multiprecision/cpp_int.hpp>
+  typedef boost::multiprecision::int128_t Int128;
+  typedef boost::multiprecision::uint128_t Uint128;
+#endif
+
+#include "Core.hpp"
+#include "FpRound.hpp"
+
+
+using namespace WdRiscv;
+
+
+namespace
+{
+  /// Integer type of twice the width of T with the same signedness.
+  template <typename T> struct WideType;
+  template <> struct WideType<int8_t>   { typedef int16_t  type; };
+  template <> struct WideType<int16_t>  { typedef int32_t  type; };
+  template <> struct WideType<int32_t>  { typedef int64_t  type; };
+  template <> struct WideType<int64_t>  { typedef Int128   type; };
+  template <> struct WideType<uint8_t>  { typedef uint16_t type; };
+  template <> struct WideType<uint16_t> { typedef uint32_t type; };
+  template <> struct WideType<uint32_t> { typedef uint64_t type; };
+  template <> struct WideType<uint64_t> { typedef Uint128  type; };
+
+  /// Integer type of half the width of T with the same signedness.
+  template <typename T> struct HalfType;
+  template <> struct HalfType<int8_t>   { typedef int8_t   type; };  // Unused.
+  template <> struct HalfType<int16_t>  { typedef int8_t   type; };
+  template <> struct HalfType<int32_t>  { typedef int16_t  type; };
+  template <> struct HalfType<int64_t>  { typedef int32_t  type; };
+
+  /// Unsigned integer type with the same width as the float type F.
+  template <typename F> struct FpBits;
+  template <> struct FpBits<float>  { typedef uint32_t type; typedef int32_t stype; };
+  template <> struct FpBits<double> { typedef uint64_t type; typedef int64_t stype; };
+
+
+  /// Range of elements processed by an instruction: Elements vstart
+  /// to vl-1 that are enabled in the mask register (all elements if
+  /// the instruction is not masked).
+  struct ElemRange
+  {
+    unsigned start;
+    unsigned end;
+    const uint8_t* mask;   // Null if instruction is not masked.
+
+    bool active(unsigned i) const
+    { return not mask or ((mask[i >> 3] >> (i & 7)) & 1); }
+  };
+
+
+  /// Scalar operand (.vx, .vi and .vf forms) made to look like an
+  /// array of identical elements.
+  template <typename T>
+  struct Splat
+  {
+    T value;
+
+    T operator[](unsigned) const
+    { return value; }
+  };
+
+
+  /// Set d[i] to op(a[i], b[i]) for the elements in the given range.
+  template <typename TD, typename A, typename B, typename OP>
+  inline void
+  apply(TD* d, A a, B b, const ElemRange& r, OP op)
+  {
+    if (not r.mask)
+      {
+	for (unsigned i = r.start; i < r.end; ++i)
+	  d[i] = op(a[i], b[i]);
+	return;
+      }
+
+    for (unsigned i = r.start; i < r.end; ++i)
+      if (r.active(i))
+	d[i] = op(a[i], b[i]);
+  }
+
+
+  /// Set d[i] to op(a[i], b[i], d[i]) for the elements in the given
+  /// range.
+  template <typename TD, typename A, typename B, typename OP>
+  inline void
+  apply3(TD* d, A a, B b, const ElemRange& r, OP op)
+  {
+    if (not r.mask)
+      {
+	for (unsigned i = r.start; i < r.end; ++i)
+	  d[i] = op(a[i], b[i], d[i]);
+	return;
+      }
+
+    for (unsigned i = r.start; i < r.end; ++i)
+      if (r.active(i))
+	d[i] = op(a[i], b[i], d[i]);
+  }
+
+
+  /// Set bit i of mask m to op(a[i], b[i]) for the elements in the
+  /// given range.
+  template <typename A, typename B, typename OP>
+  inline void
+  compare(uint8_t* m, A a, B b, const ElemRange& r, OP op)
+  {
+    for (unsigned i = r.start; i < r.end; ++i)
+      if (r.active(i))
+	{
+	  unsigned bit = unsigned(op(a[i], b[i])) << (i & 7);
+	  m[i >> 3] = (m[i >> 3] & ~(1 << (i & 7))) | bit;
+	}
+  }
+
+
+  /// Return bit i of mask m.
+  inline bool
+  maskBit(const uint8_t* m, unsigned i)
+  { return (m[i >> 3] >> (i & 7)) & 1; }
+
+
+  /// Set bit i of mask m to flag.
+  inline void
+  setMaskBit(uint8_t* m, unsigned i, bool flag)
+  { m[i >> 3] = (m[i >> 3] & ~(1 << (i & 7))) | (unsigned(flag) << (i & 7)); }
+
+
+  /// Return true if the register groups [r1, r1+n1) and [r2, r2+n2)
+  /// overlap.
+  inline bool
+  groupsOverlap(unsigned r1, unsigned n1, unsigned r2, unsigned n2)
+  { return r1 < r2 + n2 and r2 < r1 + n1; }
+
+
+  /// Return v shifted right by d bits and rounded according to the
+  /// given fixed-point rounding mode (value of vxrm).
+  template <typename T>
+  T
+  roundoff(T v, unsigned d, unsigned vxrm)
+  {
+    if (d == 0)
+      return v;
+
+    T one = 1;
+    T rest = v & ((one << d) - 1);     // Bits shifted out.
+    T half = one << (d - 1);
+    T r = 0;
+    switch (vxrm & 3)
+      {
+      case 0:  // Round to nearest up.
+	r = (rest & half) != 0;
+	break;
+      case 1:  // Round to nearest even.
+	r = (rest & half) != 0 and ((rest & (half - 1)) != 0 or ((v >> d) & 1));
+	break;
+      case 2:  // Round down (truncate).
+	break;
+      case 3:  // Round to odd.
+	r = ((v >> d) & 1) == 0 and rest != 0;
+	break;
+      }
+    return (v >> d) + r;
+  }
+
+
+  /// Return the RISCV class (see FpClassifyMasks) of x.
+  template <typename F>
+  unsigned
+  classify(F x)
+  {
+    typedef typename FpBits<F>::type U;
+
+    bool neg = std::signbit(x);
+    switch (std::fpclassify(x))
+      {
+      case FP_INFINITE:
+	return unsigned(neg? FpClassifyMasks::NegInfinity : FpClassifyMasks::PosInfinity);
+      case FP_NORMAL:
+	return unsigned(neg? FpClassifyMasks::NegNormal : FpClassifyMasks::PosNormal);
+      case FP_SUBNORMAL:
+	return unsigned(neg? FpClassifyMasks::NegSubnormal : FpClassifyMasks::PosSubnormal);
+      case FP_ZERO:
+	return unsigned(neg? FpClassifyMasks::NegZero : FpClassifyMasks::PosZero);
+      default:
+	{
+	  U bits = 0;
+	  memcpy(&bits, &x, sizeof(bits));
+	  U quietBit = U(1) << (std::numeric_limits<F>::digits - 2);
+	  return unsigned((bits & quietBit)? FpClassifyMasks::QuietNan :
+			  FpClassifyMasks::SignalingNan);
+	}
+      }
+  }
+
+
+  /// Element layout of a vector load or store.
+  struct VecAccess
+  {
+    unsigned evl = 0;         // Effective vector length (element count).
+    unsigned size = 0;        // Data element size in bytes.
+    unsigned indexSize = 0;   // Index element size in bytes (indexed only).
+    unsigned regs = 1;        // Registers in the data group.
+  };
+
+
+  /// Compute the element layout of the vector load/store instruction
+  /// inst given the current vtype/vl. Return false if the instruction
+  /// is illegal or not supported (segments).
+  bool
+  vecAccessLayout(uint32_t inst, const VecRegs& vr, VecAccess& acc)
+  {
+    unsigned f3 = (inst >> 12) & 7, width = f3 == 0 ? 1 : 1 << (f3 - 4);
+    unsigned nf = inst >> 29, mop = (inst >> 26) & 3, lumop = (inst >> 20) & 0x1f;
+    unsigned vd = (inst >> 7) & 0x1f, vs2 = (inst >> 20) & 0x1f;
+    bool masked = ((inst >> 25) & 1) == 0;
+
+    if ((inst >> 28) & 1)
+      return false;  // mew: Reserved.
+
+    if (mop == 0 and lumop == 8)
+      {
+	// Whole register: nf+1 registers regardless of vtype.
+	unsigned count = nf + 1;
+	if (masked or (count & (count - 1)) != 0 or vd % count != 0)
+	  return false;
+	acc.size = width;
+	acc.regs = count;
+	acc.evl = count * vr.bytesPerReg() / width;
+	return true;
+      }
+
+    if (vr.vill() or nf != 0)
+      return false;
+
+    if (mop == 0 and lumop == 0xb)
+      {
+	// Mask: ceil(vl/8) bytes.
+	if (width != 1 or masked)
+	  return false;
+	acc.size = 1;
+	acc.evl = (vr.vl() + 7) / 8;
+	return true;
+      }
+
+    if (mop == 0 and lumop != 0 and lumop != 0x10)
+      return false;
+
+    // Data EEW is the width field except for indexed accesses where it
+    // is SEW and where width is the EEW of the index elements.
+    int sewLog2 = __builtin_ctz(vr.sew() / 8);
+    bool indexed = mop & 1;
+    unsigned size = indexed ? vr.sew() / 8 : width;
+    int emulLog2 = __builtin_ctz(size) - sewLog2 + vr.lmulLog2();
+    if (emulLog2 < -3 or emulLog2 > 3)
+      return false;
+    acc.regs = emulLog2 > 0 ? 1 << emulLog2 : 1;
+    if (vd % acc.regs != 0 or (masked and vd == 0))
+      return false;
+
+    if (indexed)
+      {
+	int indexLog2 = __builtin_ctz(width) - sewLog2 + vr.lmulLog2();
+	if (indexLog2 < -3 or indexLog2 > 3)
+	  return false;
+	unsigned indexRegs = indexLog2 > 0 ? 1 << indexLog2 : 1;
+	if (vs2 % indexRegs != 0)
+	  return false;
+	acc.indexSize = width;
+      }
+
+    acc.size = size;
+    acc.evl = vr.vl();
+    return true;
+  }
+
+
+  /// Return the little-endian element of the given size (1, 2, 4, or
+  /// 8 bytes) at the given address. Each case is a single host load.
+  inline uint64_t
+  readElem(const uint8_t* p, unsigned size)
+  {
+    switch (size)
+      {
+      case 1: return *p;
+      case 2: { uint16_t x; memcpy(&x, p, 2); return x; }
+      case 4: { uint32_t x; memcpy(&x, p, 4); return x; }
+      default: { uint64_t x; memcpy(&x, p, 8); return x; }
+      }
+  }
+}
+
+
+template <typename URV>
+URV
+Core<URV>::vecStart() const
+{
+  auto csr = csRegs_.getImplementedCsr(CsrNumber::VSTART);
+  return csr ? csr->read() : 0;
+}
+
+
+template <typename URV>
+void
+Core<URV>::setVecStart(URV value)
+{
+  auto csr = csRegs_.getImplementedCsr(CsrNumber::VSTART);
+  if (csr and csr->read() != value)
+    {
+      csr->poke(value);
+      csRegs_.recordWrite(CsrNumber::VSTART);
+    }
+}
+
+
+template <typename URV>
+void
+Core<URV>::setVecLength(URV value)
+{
+  auto csr = csRegs_.getImplementedCsr(CsrNumber::VL);
+  if (csr)
+    {
+      csr->poke(value);
+      csRegs_.recordWrite(CsrNumber::VL);
+    }
+  vecRegs_.vl_ = value;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::configVectorLength(unsigned width)
+{
+  if (not vecRegs_.setBitsPerReg(width))
+    {
+      std::cerr << "Invalid vector register width: " << width
+		<< ": Expecting a power of 2 between 64 and 65536\n";
+      return false;
+    }
+
+  auto csr = csRegs_.getImplementedCsr(CsrNumber::VLENB);
+  if (csr)
+    {
+      csr->setInitialValue(vecRegs_.bytesPerReg());
+      csr->poke(vecRegs_.bytesPerReg());
+    }
+  return true;
+}
+
+
+template <typename URV>
+bool
+Core<URV>::peekVecReg(unsigned reg, std::vector<uint8_t>& value) const
+{
+  if (not isRvv())
+    return false;
+  return vecRegs_.peek(reg, value);
+}
+
+
+template <typename URV>
+bool
+Core<URV>::pokeVecReg(unsigned reg, const std::vector<uint8_t>& value)
+{
+  if (not isRvv())
+    return false;
+  return vecRegs_.poke(reg, value);
+}
+
+
+template <typename URV>
+int
+Core<URV>::lastVecReg(unsigned& groupSize) const
+{
+  return vecRegs_.getLastWrittenReg(groupSize);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execVsetvl(unsigned rd, URV avl, URV vtype, bool keepVl)
+{
+  constexpr URV villBit = URV(1) << (8*sizeof(URV) - 1);
+
+  unsigned oldVl = vecRegs_.vl();
+  bool ok = vecRegs_.setVtype(vtype & ~villBit, vtype & villBit, 0);
+
+  unsigned vl = 0;
+  if (ok)
+    {
+      unsigned vlmax = vecRegs_.vlmax(vecRegs_.sew(), vecRegs_.lmulLog2());
+      if (keepVl)
+	vl = std::min(oldVl, vlmax);
+      else
+	vl = avl < vlmax ? unsigned(avl) : vlmax;
+    }
+  else
+    vtype = villBit;
+
+  csRegs_.poke(CsrNumber::VTYPE, vtype);
+  csRegs_.recordWrite(CsrNumber::VTYPE);
+  setVecLength(vl);
+  setVecStart(0);
+
+  intRegs_.write(rd, vl);
+}
+
+
+template <typename URV>
+void
+Core<URV>::executeVec(uint32_t inst)
+{
+  if (not isRvv())
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned f3 = (inst >> 12) & 7;
+  unsigned rd = (inst >> 7) & 0x1f, rs1 = (inst >> 15) & 0x1f;
+
+  if (f3 == 7)
+    {
+      if ((inst >> 31) == 0)
+	{
+	  // vsetvli: With rs1 == x0, rd != x0 selects vlmax and rd ==
+	  // rs1 == x0 keeps vl.
+	  URV avl = rs1 ? intRegs_.read(rs1) : ~URV(0);
+	  execVsetvl(rd, avl, (inst >> 20) & 0x7ff, rd == 0 and rs1 == 0);
+	}
+      else if ((inst >> 30) == 3)
+	execVsetvl(rd, rs1, (inst >> 20) & 0x3ff, false);  // vsetivli
+      else if (((inst >> 25) & 0x3f) == 0)
+	{
+	  // vsetvl
+	  URV avl = rs1 ? intRegs_.read(rs1) : ~URV(0);
+	  URV vtype = intRegs_.read((inst >> 20) & 0x1f);
+	  execVsetvl(rd, avl, vtype, rd == 0 and rs1 == 0);
+	}
+      else
+	illegalInst();
+      return;
+    }
+
+  if (vecRegs_.vill())
+    {
+      illegalInst();
+      return;
+    }
+
+  bool ok = false;
+  unsigned sew = vecRegs_.sew();
+
+  switch (f3)
+    {
+    case 0:  // OPIVV
+    case 3:  // OPIVI
+    case 4:  // OPIVX
+      if      (sew == 8)  ok = execVecInt<int8_t>(inst);
+      else if (sew == 16) ok = execVecInt<int16_t>(inst);
+      else if (sew == 32) ok = execVecInt<int32_t>(inst);
+      else if (sew == 64) ok = execVecInt<int64_t>(inst);
+      break;
+
+    case 2:  // OPMVV
+    case 6:  // OPMVX
+      if      (sew == 8)  ok = execVecMul<int8_t>(inst);
+      else if (sew == 16) ok = execVecMul<int16_t>(inst);
+      else if (sew == 32) ok = execVecMul<int32_t>(inst);
+      else if (sew == 64) ok = execVecMul<int64_t>(inst);
+      break;
+
+    case 1:  // OPFVV
+    case 5:  // OPFVF
+      if (sew == 32 and isRvf())
+	ok = execVecFp<float>(inst);
+      else if (sew == 64 and isRvd())
+	ok = execVecFp<double>(inst);
+      break;
+    }
+
+  if (not ok)
+    {
+      illegalInst();
+      return;
+    }
+
+  setVecStart(0);
+}
+
+
+template <typename URV>
+template <typename T>
+bool
+Core<URV>::execVecInt(uint32_t inst)
+{
+  typedef typename std::make_unsigned<T>::type U;
+  constexpr unsigned bits = 8*sizeof(T);
+
+  unsigned f3 = (inst >> 12) & 7, f6 = inst >> 26;
+  unsigned vd = (inst >> 7) & 0x1f, vs1 = (inst >> 15) & 0x1f, vs2 = (inst >> 20) & 0x1f;
+  bool masked = ((inst >> 25) & 1) == 0;
+  bool vv = f3 == 0, vi = f3 == 3;
+
+  // Scalar operand: Sign extended x[rs1] or simm5. Shifts, slides and
+  // gathers use the unsigned (zero extended) form.
+  T scalar = vi ? T(int32_t(inst << 12) >> 27) : T(SRV(intRegs_.read(vs1)));
+  URV uscalar = vi ? URV(vs1) : intRegs_.read(vs1);
+
+  unsigned group = vecRegs_.groupSize();
+  unsigned vl = vecRegs_.vl(), start = vecStart();
+  unsigned vlmax = vecRegs_.vlmax(bits, vecRegs_.lmulLog2());
+
+  if (f6 != 0x27 and (vs2 % group != 0 or (vv and vs1 % group != 0)))
+    return false;
+
+  // Mask producing instructions: compares, vmadc and vmsbc.
+  bool maskDest = (f6 >= 0x18 and f6 <= 0x1f) or f6 == 0x11 or f6 == 0x13;
+
+  // Whole register move (vmv<nr>r) does not depend on vtype.
+  bool wholeMove = f6 == 0x27 and vi;
+
+  if (wholeMove)
+    ;
+  else if (not maskDest)
+    {
+      if (vd % group != 0 or (masked and vd == 0 and f6 != 0x10 and f6 != 0x12 and f6 != 0x17))
+	return false;
+    }
+  else if (vd != vs2 and groupsOverlap(vd, 1, vs2, group))
+    return false;
+
+  ElemRange r{start, vl, masked ? vecRegs_.regData(0) : nullptr};
+  T* d = vecRegs_.elems<T>(vd);
+  const T* a = vecRegs_.elems<T>(vs2);
+  const T* b = vecRegs_.elems<T>(vs1);
+  uint8_t* md = vecRegs_.regData(vd);
+  const uint8_t* v0 = vecRegs_.regData(0);
+
+  URV vxrm = 0;
+  csRegs_.peek(CsrNumber::VXRM, vxrm);
+  bool sat = false;
+
+  auto binary = [&] (auto op) {
+    if (vv)
+      apply(d, a, b, r, op);
+    else
+      apply(d, a, Splat<T>{scalar}, r, op);
+  };
+
+  auto cmp = [&] (auto op) {
+    if (vv)
+      compare(md, a, b, r, op);
+    else
+      compare(md, a, Splat<T>{scalar}, r, op);
+  };
+
+  // Shift amounts use the low log2(SEW) bits of the operand.
+  auto shift = [&] (auto op) {
+    if (vv)
+      apply(d, a, b, r, op);
+    else
+      apply(d, a, Splat<T>{T(uscalar)}, r, op);
+  };
+
+  unsigned destRegs = maskDest ? 1 : group;
+
+  switch (f6)
+    {
+    case 0x00:  // vadd
+      binary([] (T x, T y) { return T(U(x) + U(y)); });
+      break;
+
+    case 0x02:  // vsub
+      if (vi) return false;
+      binary([] (T x, T y) { return T(U(x) - U(y)); });
+      break;
+
+    case 0x03:  // vrsub
+      if (vv) return false;
+      binary([] (T x, T y) { return T(U(y) - U(x)); });
+      break;
+
+    case 0x04:  // vminu
+      if (vi) return false;
+      binary([] (T x, T y) { return U(x) < U(y) ? x : y; });
+      break;
+
+    case 0x05:  // vmin
+      if (vi) return false;
+      binary([] (T x, T y) { return x < y ? x : y; });
+      break;
+
+    case 0x06:  // vmaxu
+      if (vi) return false;
+      binary([] (T x, T y) { return U(x) > U(y) ? x : y; });
+      break;
+
+    case 0x07:  // vmax
+      if (vi) return false;
+      binary([] (T x, T y) { return x > y ? x : y; });
+      break;
+
+    case 0x09:  // vand
+      binary([] (T x, T y) { return T(x & y); });
+      break;
+
+    case 0x0a:  // vor
+      binary([] (T x, T y) { return T(x | y); });
+      break;
+
+    case 0x0b:  // vxor
+      binary([] (T x, T y) { return T(x ^ y); });
+      break;
+
+    case 0x0c:  // vrgather
+      if (groupsOverlap(vd, group, vs2, group) or (vv and groupsOverlap(vd, group, vs1, group)))
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	if (r.active(i))
+	  {
+	    uint64_t ix = vv ? uint64_t(U(b[i])) : uint64_t(uscalar);
+	    d[i] = ix < vlmax ? a[ix] : 0;
+	  }
+      break;
+
+    case 0x0e:  // vslideup
+      if (vv or groupsOverlap(vd, group, vs2, group))
+	return false;
+      for (uint64_t i = std::max<uint64_t>(start, uscalar); i < vl; ++i)
+	if (r.active(i))
+	  d[i] = a[i - uscalar];
+      break;
+
+    case 0x0f:  // vslidedown
+      if (vv)
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	if (r.active(i))
+	  d[i] = uscalar < vlmax - i ? a[i + uscalar] : 0;
+      break;
+
+    case 0x10:  // vadc
+    case 0x12:  // vsbc
+      if (not masked or vd == 0 or (vi and f6 == 0x12))
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	{
+	  U x = a[i], y = vv ? b[i] : scalar, c = maskBit(v0, i);
+	  d[i] = f6 == 0x10 ? T(x + y + c) : T(x - y - c);
+	}
+      break;
+
+    case 0x11:  // vmadc
+    case 0x13:  // vmsbc
+      if (vi and f6 == 0x13)
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	{
+	  U x = a[i], y = vv ? b[i] : scalar, c = masked ? maskBit(v0, i) : 0;
+	  bool out = false;
+	  if (f6 == 0x11)
+	    out = U(x + y) < x or (c and U(x + y + c) == 0);
+	  else
+	    out = x < y or (c and x == y);
+	  setMaskBit(md, i, out);
+	}
+      break;
+
+    case 0x17:  // vmerge, vmv.v
+      if (masked)
+	{
+	  if (vd == 0)
+	    return false;
+	  for (unsigned i = start; i < vl; ++i)
+	    d[i] = maskBit(v0, i) ? (vv ? b[i] : scalar) : a[i];
+	}
+      else
+	{
+	  if (vs2 != 0)
+	    return false;
+	  ElemRange all{start, vl, nullptr};
+	  if (vv)
+	    apply(d, b, b, all, [] (T x, T) { return x; });
+	  else
+	    apply(d, a, Splat<T>{scalar}, all, [] (T, T y) { return y; });
+	}
+      break;
+
+    case 0x18:  // vmseq
+      cmp([] (T x, T y) { return x == y; });
+      break;
+
+    case 0x19:  // vmsne
+      cmp([] (T x, T y) { return x != y; });
+      break;
+
+    case 0x1a:  // vmsltu
+      if (vi) return false;
+      cmp([] (T x, T y) { return U(x) < U(y); });
+      break;
+
+    case 0x1b:  // vmslt
+      if (vi) return false;
+      cmp([] (T x, T y) { return x < y; });
+      break;
+
+    case 0x1c:  // vmsleu
+      cmp([] (T x, T y) { return U(x) <= U(y); });
+      break;
+
+    case 0x1d:  // vmsle
+      cmp([] (T x, T y) { return x <= y; });
+      break;
+
+    case 0x1e:  // vmsgtu
+      if (vv) return false;
+      cmp([] (T x, T y) { return U(x) > U(y); });
+      break;
+
+    case 0x1f:  // vmsgt
+      if (vv) return false;
+      cmp([] (T x, T y) { return x > y; });
+      break;
+
+    case 0x20:  // vsaddu
+      binary([&sat] (T x, T y) {
+	  U s = U(x) + U(y);
+	  bool over = s < U(x);
+	  sat |= over;
+	  return over ? T(~U(0)) : T(s);
+	});
+      break;
+
+    case 0x21:  // vsadd
+      binary([&sat] (T x, T y) {
+	  T s = T(U(x) + U(y));
+	  bool over = (x < 0) == (y < 0) and (s < 0) != (x < 0);
+	  sat |= over;
+	  return over ? (x < 0 ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max()) : s;
+	});
+      break;
+
+    case 0x22:  // vssubu
+      if (vi) return false;
+      binary([&sat] (T x, T y) {
+	  bool over = U(x) < U(y);
+	  sat |= over;
+	  return over ? T(0) : T(U(x) - U(y));
+	});
+      break;
+
+    case 0x23:  // vssub
+      if (vi) return false;
+      binary([&sat] (T x, T y) {
+	  T s = T(U(x) - U(y));
+	  bool over = (x < 0) != (y < 0) and (s < 0) != (x < 0);
+	  sat |= over;
+	  return over ? (x < 0 ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max()) : s;
+	});
+      break;
+
+    case 0x25:  // vsll
+      shift([] (T x, T y) { return T(U(x) << (y & (bits - 1))); });
+      break;
+
+    case 0x27:
+      if (vi)
+	{
+	  // vmv<nr>r: Copy nr whole registers.
+	  unsigned nr = vs1 + 1;
+	  if (masked or (nr & (nr - 1)) != 0 or vd % nr != 0 or vs2 % nr != 0)
+	    return false;
+	  size_t bytes = size_t(nr) * vecRegs_.bytesPerReg();
+	  size_t offset = std::min(size_t(start) * sizeof(T), bytes);
+	  if (vd != vs2)
+	    memcpy(vecRegs_.regData(vd) + offset, vecRegs_.regData(vs2) + offset, bytes - offset);
+	  destRegs = nr;
+	}
+      else
+	{
+	  // vsmul: Fractional multiply with rounding and saturation.
+	  typedef typename WideType<T>::type WT;
+	  auto vxrmVal = unsigned(vxrm);
+	  binary([&sat, vxrmVal] (T x, T y) {
+	      if (x == y and x == std::numeric_limits<T>::min())
+		{
+		  sat = true;
+		  return std::numeric_limits<T>::max();
+		}
+	      return T(roundoff(WT(x) * WT(y), bits - 1, vxrmVal));
+	    });
+	}
+      break;
+
+    case 0x28:  // vsrl
+      shift([] (T x, T y) { return T(U(x) >> (y & (bits - 1))); });
+      break;
+
+    case 0x29:  // vsra
+      shift([] (T x, T y) { return T(x >> (y & (bits - 1))); });
+      break;
+
+    case 0x2a:  // vssrl
+      {
+	auto vxrmVal = unsigned(vxrm);
+	shift([vxrmVal] (T x, T y) { return T(roundoff(U(x), y & (bits - 1), vxrmVal)); });
+      }
+      break;
+
+    case 0x2b:  // vssra
+      {
+	auto vxrmVal = unsigned(vxrm);
+	shift([vxrmVal] (T x, T y) { return roundoff(x, y & (bits - 1), vxrmVal); });
+      }
+      break;
+
+    case 0x2c:  // vnsrl
+    case 0x2d:  // vnsra
+    case 0x2e:  // vnclipu
+    case 0x2f:  // vnclip
+      if constexpr (sizeof(T) < 8)
+	{
+	  typedef typename WideType<T>::type WT;
+	  typedef typename WideType<U>::type WU;
+	  if (vecRegs_.lmulLog2() >= 3)
+	    return false;
+	  unsigned wideRegs = 2*group;
+	  if (vecRegs_.lmulLog2() < 0)
+	    wideRegs = 1;
+	  if (vs2 % wideRegs != 0 or (vd != vs2 and groupsOverlap(vd, group, vs2, wideRegs)))
+	    return false;
+	  const WT* wa = vecRegs_.elems<WT>(vs2);
+	  auto amount = [&] (unsigned i) -> unsigned {
+	    return (vv ? U(b[i]) : U(uscalar)) & (2*bits - 1);
+	  };
+	  for (unsigned i = start; i < vl; ++i)
+	    {
+	      if (not r.active(i))
+		continue;
+	      unsigned sh = amount(i);
+	      if (f6 == 0x2c)
+		d[i] = T(WU(wa[i]) >> sh);
+	      else if (f6 == 0x2d)
+		d[i] = T(wa[i] >> sh);
+	      else if (f6 == 0x2e)
+		{
+		  WU v = roundoff(WU(wa[i]), sh, unsigned(vxrm));
+		  bool over = v > WU(U(~U(0)));
+		  sat |= over;
+		  d[i] = over ? T(~U(0)) : T(v);
+		}
+	      else
+		{
+		  WT v = roundoff(wa[i], sh, unsigned(vxrm));
+		  WT lo = std::numeric_limits<T>::min(), hi = std::numeric_limits<T>::max();
+		  bool over = v < lo or v > hi;
+		  sat |= over;
+		  d[i] = v < lo ? T(lo) : (v > hi ? T(hi) : T(v));
+		}
+	    }
+	}
+      else
+	return false;
+      break;
+
+    default:
+      return false;
+    }
+
+  if (sat)
+    {
+      URV prev = 0;
+      if (csRegs_.peek(CsrNumber::VXSAT, prev) and prev == 0)
+	csRegs_.write(CsrNumber::VXSAT, PrivilegeMode::Machine, debugMode_, 1);
+    }
+
+  vecRegs_.setLastWrittenReg(vd, destRegs);
+  return true;
+}
+
+
+template <typename URV>
+template <typename T>
+bool
+Core<URV>::execVecMul(uint32_t inst)
+{
+  typedef typename std::make_unsigned<T>::type U;
+  typedef typename WideType<T>::type WT;
+  typedef typename WideType<U>::type WU;
+  constexpr unsigned bits = 8*sizeof(T);
+
+  unsigned f3 = (inst >> 12) & 7, f6 = inst >> 26;
+  unsigned vd = (inst >> 7) & 0x1f, vs1 = (inst >> 15) & 0x1f, vs2 = (inst >> 20) & 0x1f;
+  bool masked = ((inst >> 25) & 1) == 0;
+  bool vv = f3 == 2;
+
+  T scalar = T(SRV(intRegs_.read(vs1)));
+  unsigned group = vecRegs_.groupSize();
+  unsigned vl = vecRegs_.vl(), start = vecStart();
+  int lmulLog2 = vecRegs_.lmulLog2();
+
+  ElemRange r{start, vl, masked ? vecRegs_.regData(0) : nullptr};
+  T* d = vecRegs_.elems<T>(vd);
+  const T* a = vecRegs_.elems<T>(vs2);
+  const T* b = vecRegs_.elems<T>(vs1);
+  unsigned destRegs = group;
+
+  auto binary = [&] (auto op) {
+    if (vv)
+      apply(d, a, b, r, op);
+    else
+      apply(d, a, Splat<T>{scalar}, r, op);
+  };
+
+  auto ternary = [&] (auto op) {
+    if (vv)
+      apply3(d, a, b, r, op);
+    else
+      apply3(d, a, Splat<T>{scalar}, r, op);
+  };
+
+  // Register alignment of the common (single width) case. Unary
+  // instructions use the vs1 field as an opcode.
+  auto singleOk = [&] (bool vs1IsReg = true) {
+    return vd % group == 0 and vs2 % group == 0 and
+      (not vv or not vs1IsReg or vs1 % group == 0) and not (masked and vd == 0);
+  };
+
+  // Widening: Destination is a group of 2*LMUL registers of 2*SEW
+  // elements. It may overlap a (single width) source only in its
+  // highest numbered part with a source LMUL of at least 1.
+  unsigned wideRegs = lmulLog2 >= 0 ? 2*group : 1;
+  auto wideOk = [&] (bool wideA) {
+    if (sizeof(T) == 8 or lmulLog2 >= 3 or vd % wideRegs != 0 or (masked and vd == 0))
+      return false;
+    if (vs2 % (wideA ? wideRegs : group) != 0 or (vv and vs1 % group != 0))
+      return false;
+    auto srcOk = [&] (unsigned vs) {
+      return not groupsOverlap(vd, wideRegs, vs, group) or
+	(lmulLog2 >= 0 and vs == vd + wideRegs - group);
+    };
+    if (not wideA and not srcOk(vs2))
+      return false;
+    if (vv and not srcOk(vs1))
+      return false;
+    destRegs = wideRegs;
+    return true;
+  };
+
+  if (f6 <= 0x07)
+    {
+      // Single width reductions: vd[0] = op(vs1[0], active vs2 elements).
+      if (not vv or vs2 % group != 0 or start != 0)
+	return false;
+      if (vl == 0)
+	return true;
+      T acc = b[0];
+      for (unsigned i = 0; i < vl; ++i)
+	{
+	  if (not r.active(i))
+	    continue;
+	  T x = a[i];
+	  switch (f6)
+	    {
+	    case 0: acc = T(U(acc) + U(x)); break;               // vredsum
+	    case 1: acc = acc & x; break;                        // vredand
+	    case 2: acc = acc | x; break;                        // vredor
+	    case 3: acc = acc ^ x; break;                        // vredxor
+	    case 4: acc = U(x) < U(acc) ? x : acc; break;        // vredminu
+	    case 5: acc = std::min(acc, x); break;               // vredmin
+	    case 6: acc = U(x) > U(acc) ? x : acc; break;        // vredmaxu
+	    case 7: acc = std::max(acc, x); break;               // vredmax
+	    }
+	}
+      d[0] = acc;
+      vecRegs_.setLastWrittenReg(vd, 1);
+      return true;
+    }
+
+  URV vxrm = 0;
+  csRegs_.peek(CsrNumber::VXRM, vxrm);
+  unsigned vxrmVal = vxrm;
+
+  switch (f6)
+    {
+    case 0x08:  // vaaddu
+      if (not singleOk()) return false;
+      binary([vxrmVal] (T x, T y) { return T(roundoff(WU(U(x)) + WU(U(y)), 1, vxrmVal)); });
+      break;
+
+    case 0x09:  // vaadd
+      if (not singleOk()) return false;
+      binary([vxrmVal] (T x, T y) { return T(roundoff(WT(x) + WT(y), 1, vxrmVal)); });
+      break;
+
+    case 0x0a:  // vasubu
+      if (not singleOk()) return false;
+      binary([vxrmVal] (T x, T y) { return T(roundoff(WU(U(x)) - WU(U(y)), 1, vxrmVal)); });
+      break;
+
+    case 0x0b:  // vasub
+      if (not singleOk()) return false;
+      binary([vxrmVal] (T x, T y) { return T(roundoff(WT(x) - WT(y), 1, vxrmVal)); });
+      break;
+
+    case 0x0e:  // vslide1up
+      if (vv or not singleOk() or vd == vs2)
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	if (r.active(i))
+	  d[i] = i == 0 ? scalar : a[i - 1];
+      break;
+
+    case 0x0f:  // vslide1down
+      if (vv or not singleOk())
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	if (r.active(i))
+	  d[i] = i + 1 < vl ? a[i + 1] : scalar;
+      break;
+
+    case 0x10:
+      if (vv)
+	{
+	  // VWXUNARY0: Integer register destination.
+	  const uint8_t* m = vecRegs_.regData(vs2);
+	  if (vs1 == 0 and not masked)
+	    intRegs_.write(vd, SRV(a[0]));   // vmv.x.s
+	  else if (vs1 == 0x10 or vs1 == 0x11)
+	    {
+	      if (start != 0)
+		return false;
+	      URV res = vs1 == 0x10 ? 0 : ~URV(0);
+	      for (unsigned i = 0; i < vl; ++i)
+		if (r.active(i) and maskBit(m, i))
+		  {
+		    if (vs1 == 0x11)
+		      {
+			res = i;   // vfirst
+			break;
+		      }
+		    ++res;       // vcpop
+		  }
+	      intRegs_.write(vd, res);
+	    }
+	  else
+	    return false;
+	  return true;
+	}
+
+      // vmv.s.x
+      if (masked or vs2 != 0)
+	return false;
+      if (start < vl)
+	d[0] = scalar;
+      destRegs = 1;
+      break;
+
+    case 0x12:
+      {
+	// VXUNARY0: vzext/vsext by a factor of 8, 4 or 2.
+	if (not vv or not singleOk(false))
+	  return false;
+	unsigned factor = 0;
+	if (vs1 == 2 or vs1 == 3)
+	  factor = 8;
+	else if (vs1 == 4 or vs1 == 5)
+	  factor = 4;
+	else if (vs1 == 6 or vs1 == 7)
+	  factor = 2;
+	if (factor == 0 or factor > sizeof(T) or lmulLog2 - __builtin_ctz(factor) < -3)
+	  return false;
+	int srcLog2 = lmulLog2 - __builtin_ctz(factor);
+	unsigned srcRegs = srcLog2 > 0 ? 1 << srcLog2 : 1;
+	if (vs2 % srcRegs != 0 or
+	    (groupsOverlap(vd, group, vs2, srcRegs) and
+	     not (srcLog2 >= 0 and vs2 == vd + group - srcRegs)))
+	  return false;
+	bool sign = vs1 & 1;
+	auto extend = [&] (auto tag) {
+	  typedef decltype(tag) S;
+	  typedef typename std::make_unsigned<S>::type US;
+	  const S* src = vecRegs_.elems<S>(vs2);
+	  if (sign)
+	    apply(d, src, src, r, [] (S x, S) { return T(x); });
+	  else
+	    apply(d, src, src, r, [] (S x, S) { return T(US(x)); });
+	};
+	if (factor * 1 == sizeof(T))
+	  extend(int8_t());
+	else if (factor * 2 == sizeof(T))
+	  extend(int16_t());
+	else
+	  extend(int32_t());
+      }
+      break;
+
+    case 0x14:
+      if (not vv)
+	return false;
+      if (vs1 == 0x10 or vs1 == 0x11)
+	{
+	  // viota, vid
+	  if (not singleOk(false) or (vs1 == 0x10 and (start != 0 or groupsOverlap(vd, group, vs2, 1))))
+	    return false;
+	  if (vs1 == 0x11 and vs2 != 0)
+	    return false;
+	  const uint8_t* m = vecRegs_.regData(vs2);
+	  U count = 0;
+	  for (unsigned i = start; i < vl; ++i)
+	    if (r.active(i))
+	      {
+		if (vs1 == 0x11)
+		  d[i] = T(i);
+		else
+		  {
+		    d[i] = T(count);
+		    count += maskBit(m, i);
+		  }
+	      }
+	}
+      else if (vs1 == 1 or vs1 == 2 or vs1 == 3)
+	{
+	  // vmsbf, vmsof, vmsif
+	  if (start != 0 or vd == vs2 or (masked and vd == 0))
+	    return false;
+	  uint8_t* md = vecRegs_.regData(vd);
+	  const uint8_t* m = vecRegs_.regData(vs2);
+	  bool found = false;
+	  for (unsigned i = 0; i < vl; ++i)
+	    if (r.active(i))
+	      {
+		bool set = maskBit(m, i), bit = false;
+		if (vs1 == 1)
+		  bit = not found and not set;
+		else if (vs1 == 2)
+		  bit = not found and set;
+		else
+		  bit = not found;
+		found = found or set;
+		setMaskBit(md, i, bit);
+	      }
+	  destRegs = 1;
+	}
+      else
+	return false;
+      break;
+
+    case 0x17:  // vcompress
+      {
+	if (not vv or masked or start != 0 or not singleOk() or
+	    groupsOverlap(vd, group, vs2, group) or groupsOverlap(vd, group, vs1, 1))
+	  return false;
+	const uint8_t* m = vecRegs_.regData(vs1);
+	unsigned j = 0;
+	for (unsigned i = 0; i < vl; ++i)
+	  if (maskBit(m, i))
+	    d[j++] = a[i];
+      }
+      break;
+
+    case 0x18: case 0x19: case 0x1a: case 0x1b:
+    case 0x1c: case 0x1d: case 0x1e: case 0x1f:
+      {
+	// Mask logical: vmandn, vmand, vmor, vmxor, vmorn, vmnand, vmnor, vmxnor.
+	if (not vv or masked)
+	  return false;
+	uint8_t* md = vecRegs_.regData(vd);
+	const uint8_t* ma = vecRegs_.regData(vs2);
+	const uint8_t* mb = vecRegs_.regData(vs1);
+	auto op = [f6] (unsigned x, unsigned y) -> uint8_t {
+	  switch (f6)
+	    {
+	    case 0x18: return x & ~y;
+	    case 0x19: return x & y;
+	    case 0x1a: return x | y;
+	    case 0x1b: return x ^ y;
+	    case 0x1c: return x | ~y;
+	    case 0x1d: return ~(x & y);
+	    case 0x1e: return ~(x | y);
+	    default:   return ~(x ^ y);
+	    }
+	};
+	unsigned i = start;
+	for ( ; i < vl and (i & 7) != 0; ++i)
+	  setMaskBit(md, i, op(maskBit(ma, i), maskBit(mb, i)) & 1);
+	for ( ; i + 8 <= vl; i += 8)
+	  md[i >> 3] = op(ma[i >> 3], mb[i >> 3]);
+	for ( ; i < vl; ++i)
+	  setMaskBit(md, i, op(maskBit(ma, i), maskBit(mb, i)) & 1);
+	destRegs = 1;
+      }
+      break;
+
+    case 0x20:  // vdivu
+      if (not singleOk()) return false;
+      binary([] (T x, T y) { return y == 0 ? T(~U(0)) : T(U(x) / U(y)); });
+      break;
+
+    case 0x21:  // vdiv
+      if (not singleOk()) return false;
+      binary([] (T x, T y) {
+	  if (y == 0)
+	    return T(-1);
+	  if (y == -1 and x == std::numeric_limits<T>::min())
+	    return x;
+	  return T(x / y);
+	});
+      break;
+
+    case 0x22:  // vremu
+      if (not singleOk()) return false;
+      binary([] (T x, T y) { return y == 0 ? x : T(U(x) % U(y)); });
+      break;
+
+    case 0x23:  // vrem
+      if (not singleOk()) return false;
+      binary([] (T x, T y) {
+	  if (y == 0)
+	    return x;
+	  if (y == -1)
+	    return T(0);
+	  return T(x % y);
+	});
+      break;
+
+    case 0x24:  // vmulhu
+      if (not singleOk()) return false;
+      binary([] (T x, T y) { return T((WU(U(x)) * WU(U(y))) >> bits); });
+      break;
+
+    case 0x25:  // vmul
+      if (not singleOk()) return false;
+      binary([] (T x, T y) { return T(U(x) * U(y)); });
+      break;
+
+    case 0x26:  // vmulhsu
+      if (not singleOk()) return false;
+      binary([] (T x, T y) { return T((WT(x) * WT(U(y))) >> bits); });
+      break;
+
+    case 0x27:  // vmulh
+      if (not singleOk()) return false;
+      binary([] (T x, T y) { return T((WT(x) * WT(y)) >> bits); });
+      break;
+
+    case 0x29:  // vmadd: vd = vs1 * vd + vs2
+      if (not singleOk()) return false;
+      ternary([] (T x, T y, T z) { return T(U(y) * U(z) + U(x)); });
+      break;
+
+    case 0x2b:  // vnmsub: vd = -(vs1 * vd) + vs2
+      if (not singleOk()) return false;
+      ternary([] (T x, T y, T z) { return T(U(x) - U(y) * U(z)); });
+      break;
+
+    case 0x2d:  // vmacc: vd = vs1 * vs2 + vd
+      if (not singleOk()) return false;
+      ternary([] (T x, T y, T z) { return T(U(y) * U(x) + U(z)); });
+      break;
+
+    case 0x2f:  // vnmsac: vd = -(vs1 * vs2) + vd
+      if (not singleOk()) return false;
+      ternary([] (T x, T y, T z) { return T(U(z) - U(y) * U(x)); });
+      break;
+
+    case 0x30: case 0x31: case 0x32: case 0x33:
+    case 0x34: case 0x35: case 0x36: case 0x37:
+    case 0x38: case 0x3a: case 0x3b:
+    case 0x3c: case 0x3d: case 0x3e: case 0x3f:
+      if constexpr (sizeof(T) < 8)
+	{
+	  // Widening add/sub (.vv/.vx and .wv/.wx), mul and macc.
+	  bool wideA = f6 >= 0x34 and f6 <= 0x37;
+	  if (not wideOk(wideA) or (f6 == 0x3e and vv))
+	    return false;
+	  WT* wd = vecRegs_.elems<WT>(vd);
+	  const WT* wa = vecRegs_.elems<WT>(vs2);
+	  auto widen = [&] (auto op) {
+	    if (vv)
+	      apply(wd, a, b, r, op);
+	    else
+	      apply(wd, a, Splat<T>{scalar}, r, op);
+	  };
+	  auto widenW = [&] (auto op) {
+	    if (vv)
+	      apply(wd, wa, b, r, op);
+	    else
+	      apply(wd, wa, Splat<T>{scalar}, r, op);
+	  };
+	  auto widen3 = [&] (auto op) {
+	    if (vv)
+	      apply3(wd, a, b, r, op);
+	    else
+	      apply3(wd, a, Splat<T>{scalar}, r, op);
+	  };
+	  switch (f6)
+	    {
+	    case 0x30: widen([] (T x, T y) { return WT(WU(U(x)) + WU(U(y))); }); break; // vwaddu
+	    case 0x31: widen([] (T x, T y) { return WT(WT(x) + WT(y)); }); break;       // vwadd
+	    case 0x32: widen([] (T x, T y) { return WT(WU(U(x)) - WU(U(y))); }); break; // vwsubu
+	    case 0x33: widen([] (T x, T y) { return WT(WT(x) - WT(y)); }); break;       // vwsub
+	    case 0x34: widenW([] (WT x, T y) { return WT(WU(x) + WU(U(y))); }); break;  // vwaddu.w
+	    case 0x35: widenW([] (WT x, T y) { return WT(WU(x) + WU(WT(y))); }); break; // vwadd.w
+	    case 0x36: widenW([] (WT x, T y) { return WT(WU(x) - WU(U(y))); }); break;  // vwsubu.w
+	    case 0x37: widenW([] (WT x, T y) { return WT(WU(x) - WU(WT(y))); }); break; // vwsub.w
+	    case 0x38: widen([] (T x, T y) { return WT(WU(U(x)) * WU(U(y))); }); break; // vwmulu
+	    case 0x3a: widen([] (T x, T y) { return WT(WT(x) * WT(U(y))); }); break;    // vwmulsu
+	    case 0x3b: widen([] (T x, T y) { return WT(WT(x) * WT(y)); }); break;       // vwmul
+	    case 0x3c:  // vwmaccu
+	      widen3([] (T x, T y, WT z) { return WT(WU(U(y)) * WU(U(x)) + WU(z)); });
+	      break;
+	    case 0x3d:  // vwmacc
+	      widen3([] (T x, T y, WT z) { return WT(WU(WT(y) * WT(x)) + WU(z)); });
+	      break;
+	    case 0x3e:  // vwmaccus: Unsigned rs1, signed vs2.
+	      widen3([] (T x, T y, WT z) { return WT(WU(WT(U(y)) * WT(x)) + WU(z)); });
+	      break;
+	    case 0x3f:  // vwmaccsu: Signed vs1/rs1, unsigned vs2.
+	      widen3([] (T x, T y, WT z) { return WT(WU(WT(y) * WT(U(x))) + WU(z)); });
+	      break;
+	    }
+	}
+      else
+	return false;
+      break;
+
+    default:
+      return false;
+    }
+
+  vecRegs_.setLastWrittenReg(vd, destRegs);
+  return true;
+}
+
+
+template <typename URV>
+template <typename F>
+bool
+Core<URV>::execVecFp(uint32_t inst)
+{
+  typedef typename FpBits<F>::type U;
+  typedef typename FpBits<F>::stype S;
+  typedef typename std::conditional<sizeof(F) == 4, double, WideDouble>::type W;
+
+  unsigned f3 = (inst >> 12) & 7, f6 = inst >> 26;
+  unsigned vd = (inst >> 7) & 0x1f, vs1 = (inst >> 15) & 0x1f, vs2 = (inst >> 20) & 0x1f;
+  bool masked = ((inst >> 25) & 1) == 0;
+  bool vv = f3 == 1;
+
+  F scalar = 0;
+  if constexpr (sizeof(F) == 4)
+    scalar = fpRegs_.readSingle(vs1);
+  else
+    scalar = fpRegs_.read(vs1);
+
+  unsigned group = vecRegs_.groupSize();
+  unsigned vl = vecRegs_.vl(), start = vecStart();
+
+  ElemRange r{start, vl, masked ? vecRegs_.regData(0) : nullptr};
+  F* d = vecRegs_.elems<F>(vd);
+  const F* a = vecRegs_.elems<F>(vs2);
+  const F* b = vecRegs_.elems<F>(vs1);
+  uint8_t* md = vecRegs_.regData(vd);
+  unsigned destRegs = group;
+
+  // Unary instructions use the vs1 field as an opcode.
+  bool maskDest = f6 >= 0x18 and f6 <= 0x1f;
+  bool unary = f6 == 0x10 or f6 == 0x12 or f6 == 0x13;
+  if (vs2 % group != 0 or (vv and not unary and vs1 % group != 0))
+    return false;
+  if (maskDest)
+    {
+      if (vd != vs2 and groupsOverlap(vd, 1, vs2, group))
+	return false;
+    }
+  else if (masked and vd == 0)
+    return false;
+
+  // Reductions and moves to/from element 0 take a single register
+  // (or an FP register) as destination.
+  bool scalarDest = f6 == 0x10 or (f6 <= 7 and (f6 & 1));
+  if (not scalarDest and not maskDest and vd % group != 0)
+    return false;
+
+  // Vector instructions take the rounding mode from frm.
+  instRoundingMode_ = RoundingMode::Dynamic;
+  RoundingMode mode = effectiveRoundingMode();
+
+  // Rounding binary operation: op is applied to F operands with the
+  // host rounding mode set or to W operands (exact or round to odd)
+  // for round to nearest, ties to max magnitude.
+  auto arith = [&] (auto op) -> bool {
+    if (mode >= RoundingMode::Invalid1)
+      return false;
+    if (mode == RoundingMode::NearestMax)
+      {
+	auto rmm = [this, op] (F x, F y) {
+	  return this->template nearestMaxOp<F, W>([=] { return op(W(x), W(y)); });
+	};
+	if (vv)
+	  apply(d, a, b, r, rmm);
+	else
+	  apply(d, a, Splat<F>{scalar}, r, rmm);
+      }
+    else
+      {
+	setHostRoundingMode(mode);
+	if (vv)
+	  apply(d, a, b, r, op);
+	else
+	  apply(d, a, Splat<F>{scalar}, r, op);
+      }
+    updateAccruedFpBits();
+    return true;
+  };
+
+  // Rounding ternary operation: op(vs2, vs1/rs1, vd).
+  auto arith3 = [&] (auto op) -> bool {
+    if (mode >= RoundingMode::Invalid1)
+      return false;
+    if (mode == RoundingMode::NearestMax)
+      {
+	auto rmm = [this, op] (F x, F y, F z) {
+	  return this->template nearestMaxOp<F, W>([=] { return op(W(x), W(y), W(z)); });
+	};
+	if (vv)
+	  apply3(d, a, b, r, rmm);
+	else
+	  apply3(d, a, Splat<F>{scalar}, r, rmm);
+      }
+    else
+      {
+	setHostRoundingMode(mode);
+	if (vv)
+	  apply3(d, a, b, r, op);
+	else
+	  apply3(d, a, Splat<F>{scalar}, r, op);
+      }
+    updateAccruedFpBits();
+    return true;
+  };
+
+  // Non rounding operation.
+  auto exact = [&] (auto op) {
+    if (vv)
+      apply(d, a, b, r, op);
+    else
+      apply(d, a, Splat<F>{scalar}, r, op);
+    updateAccruedFpBits();
+  };
+
+  auto cmp = [&] (auto op) {
+    if (vv)
+      compare(md, a, b, r, op);
+    else
+      compare(md, a, Splat<F>{scalar}, r, op);
+    updateAccruedFpBits();
+    destRegs = 1;
+  };
+
+  // Sign injection works on the bits.
+  auto sgnj = [&] (auto op) {
+    auto bitOp = [op] (F x, F y) {
+      U ux = 0, uy = 0;
+      memcpy(&ux, &x, sizeof(ux));
+      memcpy(&uy, &y, sizeof(uy));
+      U res = op(ux, uy);
+      F f = 0;
+      memcpy(&f, &res, sizeof(f));
+      return f;
+    };
+    if (vv)
+      apply(d, a, b, r, bitOp);
+    else
+      apply(d, a, Splat<F>{scalar}, r, bitOp);
+  };
+
+  constexpr U signBit = U(1) << (8*sizeof(F) - 1);
+
+  // RISCV min/max: A NaN operand is ignored unless both are NaN in
+  // which case the result is the canonical NaN. Negative zero is
+  // smaller than positive zero.
+  auto minMax = [] (F x, F y, bool isMax) {
+    if (std::isnan(x) and std::isnan(y))
+      return std::numeric_limits<F>::quiet_NaN();
+    if (std::isnan(x))
+      return y;
+    if (std::isnan(y))
+      return x;
+    if (x == y)
+      return (std::signbit(x) != isMax) ? x : y;
+    return (x < y) != isMax ? x : y;
+  };
+
+  // A signaling NaN operand of min/max, compare (for feq/fne) raises
+  // invalid.
+  auto snan = [] (F x) {
+    return std::isnan(x) and classify(x) == unsigned(FpClassifyMasks::SignalingNan);
+  };
+
+  bool invalid = false;
+
+  switch (f6)
+    {
+    case 0x00:  // vfadd
+      if (not arith([] (auto x, auto y) { return x + y; }))
+	return false;
+      break;
+
+    case 0x02:  // vfsub
+      if (not arith([] (auto x, auto y) { return x - y; }))
+	return false;
+      break;
+
+    case 0x24:  // vfmul
+      if (not arith([] (auto x, auto y) { return x * y; }))
+	return false;
+      break;
+
+    case 0x20:  // vfdiv
+      if (not arith([] (auto x, auto y) { return x / y; }))
+	return false;
+      break;
+
+    case 0x21:  // vfrdiv
+      if (vv) return false;
+      if (not arith([] (auto x, auto y) { return y / x; }))
+	return false;
+      break;
+
+    case 0x27:  // vfrsub
+      if (vv) return false;
+      if (not arith([] (auto x, auto y) { return y - x; }))
+	return false;
+      break;
+
+    case 0x04:  // vfmin
+    case 0x06:  // vfmax
+      {
+	bool isMax = f6 == 0x06;
+	exact([&invalid, minMax, snan, isMax] (F x, F y) {
+	    invalid |= snan(x) or snan(y);
+	    return minMax(x, y, isMax);
+	  });
+      }
+      break;
+
+    case 0x08:  // vfsgnj
+      sgnj([] (U x, U y) { return U((x & ~signBit) | (y & signBit)); });
+      break;
+
+    case 0x09:  // vfsgnjn
+      sgnj([] (U x, U y) { return U((x & ~signBit) | (~y & signBit)); });
+      break;
+
+    case 0x0a:  // vfsgnjx
+      sgnj([] (U x, U y) { return U(x ^ (y & signBit)); });
+      break;
+
+    case 0x01:  // vfredusum
+    case 0x03:  // vfredosum
+    case 0x05:  // vfredmin
+    case 0x07:  // vfredmax
+      {
+	if (not vv or start != 0)
+	  return false;
+	bool sum = f6 == 0x01 or f6 == 0x03;
+	if (sum and mode >= RoundingMode::Invalid1)
+	  return false;
+	if (vl == 0)
+	  return true;
+	F acc = b[0];
+	if (sum and mode != RoundingMode::NearestMax)
+	  setHostRoundingMode(mode);
+	for (unsigned i = 0; i < vl; ++i)
+	  {
+	    if (not r.active(i))
+	      continue;
+	    F x = a[i];
+	    if (not sum)
+	      {
+		invalid |= snan(x) or snan(acc);
+		acc = minMax(acc, x, f6 == 0x07);
+	      }
+	    else if (mode == RoundingMode::NearestMax)
+	      acc = this->template nearestMaxOp<F, W>([=] { return W(acc) + W(x); });
+	    else
+	      acc = acc + x;
+	  }
+	d[0] = acc;
+	destRegs = 1;
+	updateAccruedFpBits();
+      }
+      break;
+
+    case 0x0e:  // vfslide1up
+      if (vv or vd == vs2)
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	if (r.active(i))
+	  d[i] = i == 0 ? scalar : a[i - 1];
+      break;
+
+    case 0x0f:  // vfslide1down
+      if (vv)
+	return false;
+      for (unsigned i = start; i < vl; ++i)
+	if (r.active(i))
+	  d[i] = i + 1 < vl ? a[i + 1] : scalar;
+      break;
+
+    case 0x10:
+      if (masked)
+	return false;
+      if (vv)
+	{
+	  // vfmv.f.s
+	  if (vs1 != 0)
+	    return false;
+	  if constexpr (sizeof(F) == 4)
+	    fpRegs_.writeSingle(vd, a[0]);
+	  else
+	    fpRegs_.write(vd, a[0]);
+	  return true;
+	}
+      // vfmv.s.f
+      if (vs2 != 0)
+	return false;
+      if (start < vl)
+	d[0] = scalar;
+      destRegs = 1;
+      break;
+
+    case 0x12:
+      {
+	// VFUNARY0: Single width conversions.
+	if (not vv)
+	  return false;
+	RoundingMode cvtMode = mode;
+	if (vs1 == 6 or vs1 == 7)
+	  cvtMode = RoundingMode::Zero;
+	if (cvtMode >= RoundingMode::Invalid1)
+	  return false;
+	U* ud = reinterpret_cast<U*>(d);
+	S* sd = reinterpret_cast<S*>(d);
+	const U* ua = reinterpret_cast<const U*>(a);
+	const S* sa = reinterpret_cast<const S*>(a);
+	switch (vs1)
+	  {
+	  case 0: case 6:  // vfcvt.xu.f.v, vfcvt.rtz.xu.f.v
+	    for (unsigned i = start; i < vl; ++i)
+	      if (r.active(i))
+		ud[i] = this->template fpToInt<U>(a[i], cvtMode);
+	    break;
+	  case 1: case 7:  // vfcvt.x.f.v, vfcvt.rtz.x.f.v
+	    for (unsigned i = start; i < vl; ++i)
+	      if (r.active(i))
+		sd[i] = this->template fpToInt<S>(a[i], cvtMode);
+	    break;
+	  case 2: case 3:  // vfcvt.f.xu.v, vfcvt.f.x.v
+	    for (unsigned i = start; i < vl; ++i)
+	      if (r.active(i))
+		{
+		  if (cvtMode == RoundingMode::NearestMax)
+		    {
+		      U u = ua[i];
+		      S s = sa[i];
+		      if (vs1 == 2)
+			d[i] = this->template nearestMaxOp<F, W>([=] { return W(u); });
+		      else
+			d[i] = this->template nearestMaxOp<F, W>([=] { return W(s); });
+		    }
+		  else
+		    {
+		      setHostRoundingMode(cvtMode);
+		      d[i] = vs1 == 2 ? F(ua[i]) : F(sa[i]);
+		    }
+		}
+	    break;
+	  default:
+	    return false;
+	  }
+	updateAccruedFpBits();
+      }
+      break;
+
+    case 0x13:
+      if (not vv)
+	return false;
+      if (vs1 == 0)
+	{
+	  // vfsqrt
+	  if (mode >= RoundingMode::Invalid1)
+	    return false;
+	  for (unsigned i = start; i < vl; ++i)
+	    if (r.active(i))
+	      {
+		F x = a[i];
+		if (mode == RoundingMode::NearestMax)
+		  d[i] = this->template nearestMaxOp<F, W>([=] { return std::sqrt(W(x)); });
+		else
+		  {
+		    setHostRoundingMode(mode);
+		    d[i] = std::sqrt(x);
+		  }
+	      }
+	  updateAccruedFpBits();
+	}
+      else if (vs1 == 0x10)
+	{
+	  // vfclass
+	  U* ud = reinterpret_cast<U*>(d);
+	  for (unsigned i = start; i < vl; ++i)
+	    if (r.active(i))
+	      ud[i] = classify(a[i]);
+	}
+      else
+	return false;
+      break;
+
+    case 0x17:  // vfmerge, vfmv.v.f
+      if (vv)
+	return false;
+      if (masked)
+	{
+	  const uint8_t* v0 = vecRegs_.regData(0);
+	  for (unsigned i = start; i < vl; ++i)
+	    d[i] = maskBit(v0, i) ? scalar : a[i];
+	}
+      else
+	{
+	  if (vs2 != 0)
+	    return false;
+	  ElemRange all{start, vl, nullptr};
+	  apply(d, a, Splat<F>{scalar}, all, [] (F, F y) { return y; });
+	}
+      break;
+
+    case 0x18:  // vmfeq
+      cmp([&invalid, snan] (F x, F y) { invalid |= snan(x) or snan(y); return x == y; });
+      break;
+
+    case 0x19:  // vmfle
+      cmp([] (F x, F y) { return x <= y; });
+      break;
+
+    case 0x1b:  // vmflt
+      cmp([] (F x, F y) { return x < y; });
+      break;
+
+    case 0x1c:  // vmfne
+      cmp([&invalid, snan] (F x, F y) { invalid |= snan(x) or snan(y); return x != y; });
+      break;
+
+    case 0x1d:  // vmfgt
+      if (vv) return false;
+      cmp([] (F x, F y) { return x > y; });
+      break;
+
+    case 0x1f:  // vmfge
+      if (vv) return false;
+      cmp([] (F x, F y) { return x >= y; });
+      break;
+
+    case 0x28:  // vfmadd: vd = (vs1 * vd) + vs2
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(y, z, x); }))
+	return false;
+      break;
+
+    case 0x29:  // vfnmadd: vd = -(vs1 * vd) - vs2
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(-y, z, -x); }))
+	return false;
+      break;
+
+    case 0x2a:  // vfmsub: vd = (vs1 * vd) - vs2
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(y, z, -x); }))
+	return false;
+      break;
+
+    case 0x2b:  // vfnmsub: vd = -(vs1 * vd) + vs2
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(-y, z, x); }))
+	return false;
+      break;
+
+    case 0x2c:  // vfmacc: vd = (vs1 * vs2) + vd
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(y, x, z); }))
+	return false;
+      break;
+
+    case 0x2d:  // vfnmacc: vd = -(vs1 * vs2) - vd
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(-y, x, -z); }))
+	return false;
+      break;
+
+    case 0x2e:  // vfmsac: vd = (vs1 * vs2) - vd
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(y, x, -z); }))
+	return false;
+      break;
+
+    case 0x2f:  // vfnmsac: vd = -(vs1 * vs2) + vd
+      if (not arith3([] (auto x, auto y, auto z) { return std::fma(-y, x, z); }))
+	return false;
+      break;
+
+    default:
+      return false;
+    }
+
+  if (invalid)
+    orFpFlags(unsigned(FpFlags::Invalid));
+
+  vecRegs_.setLastWrittenReg(vd, destRegs);
+  return true;
+}
+
+
+template <typename URV>
+void
+Core<URV>::execVecLoad(uint32_t inst)
+{
+  VecAccess acc;
+  if (not isRvv() or not vecAccessLayout(inst, vecRegs_, acc))
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned vd = (inst >> 7) & 0x1f, rs1 = (inst >> 15) & 0x1f, rs2 = (inst >> 20) & 0x1f;
+  unsigned mop = (inst >> 26) & 3;
+  bool masked = ((inst >> 25) & 1) == 0;
+  bool faultFirst = mop == 0 and rs2 == 0x10;
+
+  URV base = intRegs_.read(rs1);
+  URV stride = mop == 2 ? intRegs_.read(rs2) : URV(acc.size);
+  uint8_t* data = vecRegs_.regData(vd);
+  const uint8_t* index = vecRegs_.regData(rs2);
+  const uint8_t* mask = masked ? vecRegs_.regData(0) : nullptr;
+  unsigned start = vecStart();
+
+  loadAddr_ = base;    // For reporting load addr in trace-mode.
+  loadAddrValid_ = true;
+
+  if (start >= acc.evl)
+    {
+      setVecStart(0);
+      return;
+    }
+  vecRegs_.setLastWrittenReg(vd, acc.regs);
+
+  // Fast path: Unit stride, unmasked, aligned access to memory that
+  // can be accessed directly: One host copy.
+  if (mop == 0 and not mask and not hasActiveTrigger() and not forceAccessFail_ and
+      not eaCompatWithBase_ and not virtMem_.isDataActive())
+    {
+      URV addr = base + URV(start) * acc.size;
+      size_t bytes = size_t(acc.evl - start) * acc.size;
+      if ((addr & (acc.size - 1)) == 0 and addr <= ~URV(0) - (bytes - 1) and
+	  memory_.isDirectlyAccessible(addr, bytes, false) and
+	  pmpAllows(addr, bytes, PmpManager::Read))
+	{
+	  memcpy(data + size_t(start) * acc.size, memory_.data_ + addr, bytes);
+	  setVecStart(0);
+	  return;
+	}
+    }
+
+  for (unsigned i = start; i < acc.evl; ++i)
+    {
+      if (mask and not maskBit(mask, i))
+	continue;
+
+      URV offset = URV(i) * stride;
+      if (acc.indexSize)
+	{
+	  uint64_t ix = 0;
+	  memcpy(&ix, index + size_t(i) * acc.indexSize, acc.indexSize);
+	  offset = URV(ix);
+	}
+
+      URV addr = base + offset;
+      uint64_t value = 0;
+      bool trap = not faultFirst or i == 0;
+      if (not vecLoadElem(base, addr, acc.size, value, trap))
+	{
+	  if (trap)
+	    {
+	      setVecStart(i);
+	      return;
+	    }
+	  setVecLength(i);  // Fault only first: Trim vl instead of trapping.
+	  break;
+	}
+      memcpy(data + size_t(i) * acc.size, &value, acc.size);
+    }
+
+  setVecStart(0);
+}
+
+
+template <typename URV>
+void
+Core<URV>::execVecStore(uint32_t inst)
+{
+  VecAccess acc;
+  unsigned mop = (inst >> 26) & 3, rs2 = (inst >> 20) & 0x1f;
+  if (not isRvv() or (mop == 0 and rs2 == 0x10) or
+      not vecAccessLayout(inst, vecRegs_, acc))
+    {
+      illegalInst();
+      return;
+    }
+
+  unsigned vs3 = (inst >> 7) & 0x1f, rs1 = (inst >> 15) & 0x1f;
+  bool masked = ((inst >> 25) & 1) == 0;
+
+  URV base = intRegs_.read(rs1);
+  URV stride = mop == 2 ? intRegs_.read(rs2) : URV(acc.size);
+  const uint8_t* data = vecRegs_.regData(vs3);
+  const uint8_t* index = vecRegs_.regData(rs2);
+  const uint8_t* mask = masked ? vecRegs_.regData(0) : nullptr;
+  unsigned start = vecStart();
+
+  // Element writes are kept for the trace of this instruction only:
+  // Drop those of the previous store (clearTraceData is not called
+  // when not tracing).
+  vecWrites_.clear();
+
+  if (start >= acc.evl)
+    {
+      setVecStart(0);
+      return;
+    }
+
+  // Fast path: Unit stride, unmasked, aligned store to memory that can
+  // be written directly and that does not hold a location with side
+  // effects: One host copy.
+  if (mop == 0 and not mask and not hasActiveTrigger() and not forceAccessFail_ and
+      not eaCompatWithBase_ and not virtMem_.isDataActive())
+    {
+      URV addr = base + URV(start) * acc.size;
+      size_t bytes = size_t(acc.evl - start) * acc.size;
+      bool special = ((toHostValid_ and toHost_ >= addr and toHost_ - addr < bytes) or
+		      (conIoValid_ and conIo_ >= addr and conIo_ - addr < bytes));
+      if ((addr & (acc.size - 1)) == 0 and addr <= ~URV(0) - (bytes - 1) and
+	  not special and memory_.isDirectlyAccessible(addr, bytes, true) and
+	  pmpAllows(addr, bytes, PmpManager::Write))
+	{
+	  memory_.noteWrite(addr, bytes);
+	  uint8_t* mem = memory_.data_ + addr;
+	  const uint8_t* src = data + size_t(start) * acc.size;
+	  vecWrites_.resize(acc.evl - start);
+	  for (size_t i = 0; i < vecWrites_.size(); ++i)
+	    {
+	      auto& info = vecWrites_[i];
+	      size_t offset = i * acc.size;
+	      info.size_ = acc.size;
+	      info.addr_ = addr + offset;
+	      info.prevValue_ = readElem(mem + offset, acc.size);
+	      info.value_ = readElem(src + offset, acc.size);
+	      info.isDccm_ = false;
+	    }
+	  memcpy(mem, src, bytes);
+	  memory_.invalidateReservationRange(addr, bytes);
+	  ++memWriteCount_;
+	  lastWrite_ = vecWrites_.back();
+	  setVecStart(0);
+	  return;
+	}
+    }
+
+  for (unsigned i = start; i < acc.evl; ++i)
+    {
+      if (mask and not maskBit(mask, i))
+	continue;
+
+      URV offset = URV(i) * stride;
+      if (acc.indexSize)
+	{
+	  uint64_t ix = 0;
+	  memcpy(&ix, index + size_t(i) * acc.indexSize, acc.indexSize);
+	  offset = URV(ix);
+	}
+
+      uint64_t value = 0;
+      memcpy(&value, data + size_t(i) * acc.size, acc.size);
+      if (not vecStoreElem(base, base + offset, acc.size, value))
+	{
+	  setVecStart(i);
+	  return;
+	}
+      vecWrites_.push_back(lastWrite_);
+    }
+
+  setVecStart(0);
+}
+
+
+template class WdRiscv::Core<uint32_t>;
+template class WdRiscv::Core<uint64_t>;
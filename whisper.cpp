@@ -20,6 +20,11 @@
 #include <fstream>
 #include <sstream>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
@@ -42,6 +47,8 @@ typedef int socklen_t;
 #include "Core.hpp"
 #include "Server.hpp"
 #include "Interactive.hpp"
+#include "HartScheduler.hpp"
+#include "JobList.hpp"
 
 
 using namespace WdRiscv;
@@ -113,10 +120,18 @@ struct Args
   std::string consoleOutFile;  // Console io output file.
   std::string serverFile;      // File in which to write server host and port.
   std::string instFreqFile;    // Instruction frequency file.
+  std::string instFreqJsonFile; // Instruction frequency file (JSON).
+  std::string branchPredictor; // Branch predictor type.
+  std::string branchFile;      // Branch prediction report file.
+  std::string coverageFile;    // Code coverage report file (lcov format).
+  std::string coverageMapFile; // Code coverage map output file.
+  StringVec   coverageInFiles; // Code coverage maps to merge.
+  std::string funcCoverageFile; // Functional coverage output file.
   std::string configFile;      // Configuration (JSON) file.
   std::string isa;
   StringVec   regInits;        // Initial values of regs
   StringVec   codes;           // Instruction codes to disassemble
+  StringVec   intercepts;      // C library routines to run natively.
   StringVec   targets;         // Target (ELF file) programs and associated
                                // program options to be loaded into simulator
                                // memory. Each target plus args is one string.
@@ -132,7 +147,18 @@ struct Args
   uint64_t instCountLim = ~uint64_t(0);
   
   unsigned regWidth = 32;
+  unsigned vecRegWidth = 128;  // Vector register width in bits (VLEN).
   unsigned harts = 1;
+  uint64_t hartQuantum = 0;    // Instructions per hart per turn (0: free run).
+  unsigned quantumThreads = 1; // Host threads used with hartQuantum.
+  unsigned hartThreads = 0;    // Host threads of hart scheduler (0: none).
+  uint64_t interceptInsts = 1; // Instructions charged per intercepted call.
+  uint64_t interceptCycles = 1; // Cycles charged per intercepted call.
+  uint64_t snapshotPeriod = 0; // Instructions between snapshots (0: off).
+  uint64_t snapshotBudget = 256; // Snapshot memory budget in MiB.
+  std::string batchFile;       // Job list of a batch run.
+  std::string batchReport;     // Summary of a batch run (JSON or JUnit).
+  unsigned batchThreads = 0;   // Host threads of a batch run (0: all cpus).
 
   bool help = false;
   bool hasStartPc = false;
@@ -140,16 +166,19 @@ struct Args
   bool hasToHost = false;
   bool hasConsoleIo = false;
   bool hasRegWidth = false;
+  bool hasVecRegWidth = false;
   bool trace = false;
   bool interactive = false;
   bool verbose = false;
   bool version = false;
   bool traceLoad = false;  // Trace load address if true.
+  bool traceSource = false; // Trace source file and line if true.
   bool triggers = false;   // Enable debug triggers when true.
   bool counters = false;   // Enable performance counters when true.
   bool gdb = false;        // Enable gdb mode when true.
   bool abiNames = false;   // Use ABI register names in inst disassembly.
   bool newlib = false;     // True if target program linked with newlib.
+  bool pinThreads = false; // Pin hart scheduler threads to host cpus.
 };
 
 
@@ -176,11 +205,32 @@ parseCmdLineArgs(int argc, char* argv[], Args& args)
 	 "Enable tracing to standard output of executed instructions.")
 	("isa", po::value(&args.isa),
 	 "Specify instruction set extensions to enable. Supported extensions "
-	 "are a, c, d, f, i, m, s and u. Default is imc.")
+	 "are a, b, c, d, f, i, m, s, u and v optionally followed by zba, "
+	 "zbb, zbc and zbs separated by underscores (e.g. imc_zba_zbc). "
+	 "Default is imc.")
 	("xlen", po::value(&args.regWidth),
 	 "Specify register width (32 or 64), defaults to 32")
+	("vlen", po::value(&args.vecRegWidth),
+	 "Specify vector register width in bits (power of 2 between 64 and "
+	 "65536), defaults to 128")
 	("harts", po::value(&args.harts),
 	 "Specify number of hardware threads.")
+	("hart-quantum", po::value(&args.hartQuantum),
+	 "Run harts in turn, each executing the given number of instructions "
+	 "per turn, instead of running each hart freely in its own thread. "
+	 "With one host thread (default) runs are reproducible.")
+	("quantum-threads", po::value(&args.quantumThreads),
+	 "Number of host threads running harts in --hart-quantum mode. With "
+	 "more than one thread, harts run in parallel within a quantum and "
+	 "synchronize at quantum boundaries.")
+	("hart-threads", po::value(&args.hartThreads),
+	 "Run harts on a pool of the given number of host threads with work "
+	 "stealing. Harts waiting in wfi or in a spin loop are descheduled "
+	 "until another hart writes memory. Time slice is given by "
+	 "--hart-quantum (default 10000). This is the default, with one "
+	 "thread per host cpu, when there are more harts than host cpus.")
+	("pin-threads", po::bool_switch(&args.pinThreads),
+	 "Pin each --hart-threads host thread to a host cpu.")
 	("target,t", po::value(&args.targets)->multitoken(),
 	 "Target program (ELF file) to load into simulator memory. In newlib "
 	 "emulations mode, program options may follow program name.")
@@ -216,6 +266,9 @@ parseCmdLineArgs(int argc, char* argv[], Args& args)
 	 "Enable interactive mode.")
 	("traceload", po::bool_switch(&args.traceLoad),
 	 "Enable tracing of load instruction data address.")
+	("tracesource", po::bool_switch(&args.traceSource),
+	 "Enable tracing of instruction source file and line (requires DWARF "
+	 "line information in the target program).")
 	("triggers", po::bool_switch(&args.triggers),
 	 "Enable debug triggers (triggers are on in interactive and server modes)")
 	("counters", po::bool_switch(&args.counters),
@@ -223,7 +276,34 @@ parseCmdLineArgs(int argc, char* argv[], Args& args)
 	("gdb", po::bool_switch(&args.gdb),
 	 "Run in gdb mode enabling remote debugging from gdb.")
 	("profileinst", po::value(&args.instFreqFile),
-	 "Report instruction frequency to file.")
+	 "Report instruction frequency to file. With multiple harts, the "
+	 "report covers all harts.")
+	("profileinstjson", po::value(&args.instFreqJsonFile),
+	 "Report instruction frequency and operand histograms to file in "
+	 "JSON format.")
+	("branchpredictor", po::value(&args.branchPredictor),
+	 "Model branch prediction using given predictor: static, bimodal, "
+	 "gshare or swerv. Mispredicts count towards the branch-miss "
+	 "performance event.")
+	("profilebranch", po::value(&args.branchFile),
+	 "Report branch prediction statistics to file (implies "
+	 "--branchpredictor gshare unless a predictor is specified).")
+	("coverage", po::value(&args.coverageFile),
+	 "Collect line and branch coverage of the ELF target program code "
+	 "and report it to file in lcov format. Source lines are obtained "
+	 "from the DWARF line information of the target.")
+	("coveragemap", po::value(&args.coverageMapFile),
+	 "Collect code coverage and save the coverage map (binary) to file. "
+	 "Maps of several runs can be merged using --coveragein.")
+	("coveragein", po::value(&args.coverageInFiles)->multitoken(),
+	 "Merge the given coverage map files (produced by --coveragemap) "
+	 "with the coverage of this run before writing the --coverage and "
+	 "--coveragemap outputs.")
+	("funccoverage", po::value(&args.funcCoverageFile),
+	 "Collect functional coverage (instruction operand classes, rounding "
+	 "modes, misaligned accesses, CSR reads/writes) and save it in binary "
+	 "form to the given file. Use the covmerge tool to merge such files "
+	 "and report coverage.")
 	("setreg", po::value(&args.regInits)->multitoken(),
 	 "Initialize registers. Apply to all harts unless specific prefix "
 	 "present (hart is 1 in 1:x3=0xabc). Example: --setreg x1=4 x2=0xff "
@@ -236,6 +316,45 @@ parseCmdLineArgs(int argc, char* argv[], Args& args)
 	 "Use ABI register names (e.g. sp instead of x2) in instruction disassembly.")
 	("newlib", po::bool_switch(&args.newlib),
 	 "Emulate (some) newlib system calls when true.")
+	("intercept", po::value(&args.intercepts)->multitoken(),
+	 "Perform calls to the given C library routines natively instead of "
+	 "interpreting them. Supported routines are memcpy, memmove, memset, "
+	 "strlen and strcmp (or all); they are located using the ELF symbol "
+	 "table. A call is interpreted when tracing, triggers or gdb are "
+	 "enabled, or when it touches memory-mapped registers, the to-host "
+	 "or console locations, or inaccessible memory. Example: "
+	 "--intercept memcpy memset")
+	("intercept-insts", po::value(&args.interceptInsts),
+	 "Number of retired instructions charged for each intercepted "
+	 "call (default 1).")
+	("intercept-cycles", po::value(&args.interceptCycles),
+	 "Number of cycles charged for each intercepted call (default 1).")
+	("snapshotperiod", po::value(&args.snapshotPeriod),
+	 "Enable reverse execution (interactive bs, bc and goto commands "
+	 "and gdb reverse-step/reverse-continue) by taking a snapshot of "
+	 "the hart every given number of instructions. Going back restores "
+	 "the nearest snapshot and re-executes from there. Single hart "
+	 "only. Disables --intercept.")
+	("snapshotbudget", po::value(&args.snapshotBudget),
+	 "Memory budget in MiB of the reverse execution snapshots (default "
+	 "256). The oldest snapshots are dropped to stay within the budget.")
+	("batch", po::value(&args.batchFile),
+	 "Run the test programs of the given job list file on a pool of "
+	 "threads, each job with its own memory and harts. A job is a line "
+	 "holding a program (ELF file, or hex file if the name ends with "
+	 ".hex) followed by optional command line options and by optional "
+	 "expect=pass, expect=fail or expect=<n> (tohost value or exit "
+	 "code). The other options of the command line apply to all jobs. "
+	 "Output files (--logfile, --profileinst ...) must differ between "
+	 "jobs and are therefore given in the job lines. Lines starting "
+	 "with # are ignored.")
+	("batchthreads", po::value(&args.batchThreads),
+	 "Number of host threads running the jobs of --batch (default: "
+	 "number of host cpus).")
+	("batchreport", po::value(&args.batchReport),
+	 "Write a summary of the --batch jobs (outcome, instruction count, "
+	 "MIPS) to the given file in JUnit XML format if the file name ends "
+	 "with .xml and in JSON format otherwise.")
 	("verbose,v", po::bool_switch(&args.verbose),
 	 "Be verbose.")
 	("version", po::bool_switch(&args.version),
@@ -299,6 +418,8 @@ parseCmdLineArgs(int argc, char* argv[], Args& args)
 	}
       if (varMap.count("xlen"))
 	args.hasRegWidth = true;
+      if (varMap.count("vlen"))
+	args.hasVecRegWidth = true;
       if (args.interactive)
 	args.trace = true;  // Enable instruction tracing in interactive mode.
     }
@@ -430,11 +551,32 @@ applyIsaString(const std::string& isaStr, Core<URV>& core)
   URV isa = 0;
   unsigned errors = 0;
 
-  for (auto c : isaStr)
+  // Single letter extensions followed by multi-letter ones separated
+  // by underscores (e.g. imc_zba_zbb).
+  size_t sep = isaStr.find('_');
+  for (size_t pos = sep; pos != std::string::npos; )
+    {
+      size_t end = isaStr.find('_', pos + 1);
+      std::string ext = isaStr.substr(pos + 1, end == std::string::npos?
+				      end : end - pos - 1);
+      if      (ext == "zba")  core.enableRvzba(true);
+      else if (ext == "zbb")  core.enableRvzbb(true);
+      else if (ext == "zbc")  core.enableRvzbc(true);
+      else if (ext == "zbs")  core.enableRvzbs(true);
+      else
+	{
+	  std::cerr << "Extension \"" << ext << "\" is not supported.\n";
+	  errors++;
+	}
+      pos = end;
+    }
+
+  for (auto c : isaStr.substr(0, sep))
     {
       switch(c)
 	{
 	case 'a':
+	case 'b':
 	case 'c':
 	case 'd':
 	case 'f':
@@ -442,6 +584,7 @@ applyIsaString(const std::string& isaStr, Core<URV>& core)
 	case 'm':
 	case 'u':
 	case 's':
+	case 'v':
 	  isa |= URV(1) << (c -  'a');
 	  break;
 
@@ -494,6 +637,12 @@ applyCmdLineArgs(const Args& args, Core<URV>& core)
 {
   unsigned errors = 0;
 
+  // Vector register width before the ISA: Enabling the vector
+  // extension sizes vlenb.
+  if (args.hasVecRegWidth)
+    if (not core.configVectorLength(args.vecRegWidth))
+      errors++;
+
   if (not args.isa.empty())
     {
       if (not applyIsaString(args.isa, core))
@@ -519,9 +668,31 @@ applyCmdLineArgs(const Args& args, Core<URV>& core)
 	errors++;
     }
 
-  if (not args.instFreqFile.empty())
+  if (not args.instFreqFile.empty() or not args.instFreqJsonFile.empty())
     core.enableInstructionFrequency(true);
 
+  if (not args.branchPredictor.empty() or not args.branchFile.empty())
+    {
+      BranchPredictor::Type type = BranchPredictor::Type::Gshare;
+      if (not args.branchPredictor.empty() and
+	  not BranchPredictor::parseType(args.branchPredictor, type))
+	{
+	  std::cerr << "Invalid branch predictor: " << args.branchPredictor
+		    << " -- expecting static, bimodal, gshare or swerv\n";
+	  errors++;
+	}
+      else
+	core.enableBranchPrediction(type);
+    }
+
+  if (not args.funcCoverageFile.empty())
+    core.enableFunctionalCoverage(true);
+
+  if (not args.coverageFile.empty() or not args.coverageMapFile.empty())
+    for (const auto& target : args.expandedTargets)
+      if (not core.enableCodeCoverage(target.front()))
+	errors++;
+
   // Command line to-host overrides that of ELF and config file.
   if (args.hasToHost)
     core.setToHostAddress(args.toHost);
@@ -543,6 +714,7 @@ applyCmdLineArgs(const Args& args, Core<URV>& core)
 
   // Print load-instruction data-address when tracing instructions.
   core.setTraceLoad(args.traceLoad);
+  core.setTraceSource(args.traceSource);
 
   core.enableTriggers(args.triggers);
   core.enableGdb(args.gdb);
@@ -550,6 +722,24 @@ applyCmdLineArgs(const Args& args, Core<URV>& core)
   core.enableAbiNames(args.abiNames);
   core.enableNewlib(args.newlib);
 
+  if (args.snapshotPeriod)
+    {
+      if (args.harts != 1)
+	{
+	  std::cerr << "Error: Option --snapshotperiod requires a single "
+		    << "hart\n";
+	  errors++;
+	}
+      else
+	core.enableSnapshots(args.snapshotPeriod,
+			     args.snapshotBudget*1024*1024);
+    }
+
+  if (not args.intercepts.empty())
+    if (not core.defineIntercepts(args.intercepts, args.interceptInsts,
+				  args.interceptCycles))
+      errors++;
+
   // Apply register initialization.
   if (not applyCmdLineRegInit(args, core))
     errors++;
@@ -680,11 +870,32 @@ runServer(std::vector<Core<URV>*>& cores, const std::string& serverFile,
 }
 
 
+/// Report the instruction frequency of the given cores merged into
+/// a single profile. Use JSON format if json is true.
 template <typename URV>
 static
 bool
-reportInstructionFrequency(Core<URV>& core, const std::string& outPath)
+reportInstructionFrequency(std::vector<Core<URV>*>& cores,
+			   const std::string& outPath, bool json)
 {
+  std::vector<InstProfile> profile;
+  for (auto corePtr : cores)
+    corePtr->mergeInstructionFrequency(profile);
+
+  Core<URV>& core0 = *cores.front();
+
+  if (json)
+    {
+      std::ofstream out(outPath);
+      if (not out)
+	{
+	  std::cerr << "Failed to open instruction frequency file '"
+		    << outPath << "' for output.\n";
+	  return false;
+	}
+      return core0.reportInstructionFrequencyJson(out, profile);
+    }
+
   FILE* outFile = fopen(outPath.c_str(), "w");
   if (not outFile)
     {
@@ -692,12 +903,96 @@ reportInstructionFrequency(Core<URV>& core, const std::string& outPath)
 		<< "' for output.\n";
       return false;
     }
-  core.reportInstructionFrequency(outFile);
+  core0.reportInstructionFrequency(outFile, profile);
   fclose(outFile);
   return true;
 }
 
 
+template <typename URV>
+static
+bool
+reportBranchPrediction(std::vector<Core<URV>*>& cores,
+		       const std::string& outPath)
+{
+  FILE* outFile = fopen(outPath.c_str(), "w");
+  if (not outFile)
+    {
+      std::cerr << "Failed to open branch prediction file '" << outPath
+		<< "' for output.\n";
+      return false;
+    }
+  for (size_t i = 0; i < cores.size(); ++i)
+    {
+      if (cores.size() > 1)
+	fprintf(outFile, "%sHart %zu\n", i ? "\n" : "", i);
+      cores.at(i)->reportBranchPrediction(outFile);
+    }
+  fclose(outFile);
+  return true;
+}
+
+
+/// Merge the code coverage of the given cores and that of the coverage
+/// map files specified on the command line then write the coverage
+/// report and/or coverage map requested on the command line.
+template <typename URV>
+static
+bool
+reportCodeCoverage(std::vector<Core<URV>*>& cores, const Args& args)
+{
+  CodeCoverage coverage;
+  for (auto corePtr : cores)
+    if (corePtr->codeCoverage())
+      coverage.merge(*corePtr->codeCoverage());
+
+  bool ok = true;
+  for (const auto& path : args.coverageInFiles)
+    ok = coverage.load(path) and ok;
+
+  if (not args.coverageMapFile.empty())
+    ok = coverage.save(args.coverageMapFile) and ok;
+
+  if (args.coverageFile.empty())
+    return ok;
+
+  Core<URV>& core0 = *cores.front();
+  const DwarfLineTable& lines = core0.sourceLineTable();
+  if (lines.empty())
+    std::cerr << "Warning: No DWARF line information in target program: "
+	      << "Coverage report will be empty\n";
+
+  std::ofstream out(args.coverageFile);
+  if (not out)
+    {
+      std::cerr << "Failed to open coverage file '" << args.coverageFile
+		<< "' for output.\n";
+      return false;
+    }
+
+  auto classify = [&core0] (uint64_t addr, bool& isCondBranch) -> unsigned {
+		    return core0.classifyInstruction(size_t(addr), isCondBranch);
+		  };
+  return coverage.writeLcov(out, lines, classify) and ok;
+}
+
+
+/// Merge the functional coverage of the given cores and save it to
+/// the given file.
+template <typename URV>
+static
+bool
+saveFunctionalCoverage(std::vector<Core<URV>*>& cores,
+		       const std::string& outPath)
+{
+  FuncCoverage coverage;
+  for (auto corePtr : cores)
+    if (corePtr->functionalCoverage())
+      coverage.merge(*corePtr->functionalCoverage());
+  return coverage.save(outPath);
+}
+
+
 /// Open the trace-file, command-log and console-output files
 /// specified on the command line. Return true if successful or false
 /// if any specified file fails to open.
@@ -808,6 +1103,164 @@ batchRun(std::vector<Core<URV>*>& cores, FILE* traceFile)
 }
 
 
+/// Print the number of instructions retired by all the given harts
+/// since they had retired count0 instructions at time t0.
+template <typename URV>
+static void
+reportRetired(std::vector<Core<URV>*>& cores, uint64_t count0,
+	      std::chrono::steady_clock::time_point t0)
+{
+  auto t1 = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(t1 - t0).count();
+
+  uint64_t count = 0;
+  for (auto corePtr : cores)
+    count += corePtr->getInstructionCount();
+  count -= count0;
+
+  std::cerr << "Retired " << count << " instruction"
+	    << (count > 1? "s" : "") << " in "
+	    << (boost::format("%.2fs") % elapsed);
+  if (elapsed > 0)
+    std::cerr << "  " << size_t(double(count)/elapsed) << " inst/s";
+  std::cerr << '\n';
+
+  for (auto corePtr : cores)
+    corePtr->printTlbStats(std::cerr);
+}
+
+
+/// Reusable thread barrier.
+class Barrier
+{
+public:
+
+  Barrier(unsigned count)
+    : count_(count)
+  { }
+
+  /// Block until count threads have called this method.
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned generation = generation_;
+    if (++arrived_ == count_)
+      {
+	arrived_ = 0;
+	generation_++;
+	cv_.notify_all();
+      }
+    else
+      cv_.wait(lock, [this, generation] { return generation != generation_; });
+  }
+
+private:
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  unsigned count_;
+  unsigned arrived_ = 0;
+  unsigned generation_ = 0;
+};
+
+
+/// Run the given harts in turn (in hart order), each executing up to
+/// quantum instructions per turn, until all harts are done. With more
+/// than one thread, hart i is run by thread i modulo threadCount and
+/// the threads synchronize at the end of each quantum.
+template <typename URV>
+static bool
+quantumRun(std::vector<Core<URV>*>& cores, FILE* traceFile, uint64_t quantum,
+	   unsigned threadCount)
+{
+  threadCount = std::max(1u, std::min(threadCount, unsigned(cores.size())));
+
+  std::vector<char> done(cores.size(), false);
+  std::vector<char> ok(cores.size(), true);
+  std::atomic<size_t> active(cores.size());
+
+  uint64_t count0 = 0;
+  for (auto corePtr : cores)
+    count0 += corePtr->getInstructionCount();
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  // Run one turn of the harts owned by the given thread.
+  auto runTurn = [&] (unsigned threadIx) {
+		   for (size_t i = threadIx; i < cores.size(); i += threadCount)
+		     {
+		       if (done.at(i))
+			 continue;
+		       bool hartDone = false;
+		       if (not cores.at(i)->runQuantum(quantum, traceFile, hartDone))
+			 ok.at(i) = false;
+		       if (hartDone)
+			 {
+			   done.at(i) = true;
+			   active--;
+			 }
+		     }
+		 };
+
+  if (threadCount == 1)
+    {
+      while (active)
+	runTurn(0);
+    }
+  else
+    {
+      Barrier barrier(threadCount);
+      auto threadFunc = [&] (unsigned threadIx) {
+			  while (true)
+			    {
+			      runTurn(threadIx);
+			      barrier.wait();
+			      bool finished = active == 0;
+			      barrier.wait();  // All threads have read active.
+			      if (finished)
+				break;
+			    }
+			};
+
+      std::vector<std::thread> threadVec;
+      for (unsigned ix = 0; ix < threadCount; ++ix)
+	threadVec.emplace_back(threadFunc, ix);
+      for (auto& t : threadVec)
+	t.join();
+    }
+
+  reportRetired(cores, count0, t0);
+
+  for (auto flag : ok)
+    if (not flag)
+      return false;
+  return true;
+}
+
+
+/// Run the given harts on a pool of threadCount host threads using the
+/// work-stealing hart scheduler.
+template <typename URV>
+static bool
+scheduledRun(std::vector<Core<URV>*>& cores, FILE* traceFile,
+	     unsigned threadCount, uint64_t quantum, bool pin)
+{
+  threadCount = std::max(1u, std::min(threadCount, unsigned(cores.size())));
+
+  uint64_t count0 = 0;
+  for (auto corePtr : cores)
+    count0 += corePtr->getInstructionCount();
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  HartScheduler<URV> scheduler(cores, threadCount, quantum, pin);
+  bool ok = scheduler.run(traceFile);
+
+  reportRetired(cores, count0, t0);
+  return ok;
+}
+
+
 /// Depending on command line args, start a server, run in interactive
 /// mode, or initiate a batch run.
 template <typename URV>
@@ -850,6 +1303,20 @@ sessionRun(std::vector<Core<URV>*>& cores, const Args& args, FILE* traceFile,
       return interactive.interact(traceFile, commandLog);
     }
 
+  // Use the hart scheduler if requested or if there are more harts
+  // than host cpus (unless a reproducible quantum run is requested).
+  unsigned hostCpus = std::thread::hardware_concurrency();
+  bool oversubscribed = hostCpus and cores.size() > hostCpus;
+  if (args.hartThreads or (oversubscribed and not args.hartQuantum))
+    {
+      unsigned threads = args.hartThreads? args.hartThreads : hostCpus;
+      uint64_t quantum = args.hartQuantum? args.hartQuantum : 10000;
+      return scheduledRun(cores, traceFile, threads, quantum, args.pinThreads);
+    }
+
+  if (args.hartQuantum)
+    return quantumRun(cores, traceFile, args.hartQuantum, args.quantumThreads);
+
   return batchRun(cores, traceFile);
 }
 
@@ -877,14 +1344,16 @@ applyDisassemble(Core<URV>& core, const Args& args)
 }
 
 
+/// Run a simulation session with the given arguments and configuration.
+/// If jobResult is non-null, fill it with the outcome of the run.
 template <typename URV>
 static
 bool
-session(const Args& args, const CoreConfig& config)
+session(const Args& args, const CoreConfig& config, JobResult* jobResult)
 {
   unsigned registerCount = 32;
   unsigned harts = args.harts;
-  if (harts == 0 or harts > 64)
+  if (harts == 0)
     {
       std::cerr << "Unreasonable hart count: " << harts << '\n';
       return false;
@@ -946,10 +1415,51 @@ session(const Args& args, const CoreConfig& config)
       corePtr->reset();
     }
 
+  auto t0 = std::chrono::steady_clock::now();
+
   bool result = sessionRun(cores, args, traceFile, commandLog);
 
+  if (jobResult)
+    {
+      auto t1 = std::chrono::steady_clock::now();
+      jobResult->seconds_ = std::chrono::duration<double>(t1 - t0).count();
+      jobResult->ran_ = true;
+      jobResult->ok_ = result;
+      for (auto corePtr : cores)
+	{
+	  uint64_t count = corePtr->getInstructionCount();
+	  jobResult->instCount_ += count;
+	  if (count >= args.instCountLim)
+	    jobResult->limitHit_ = true;
+
+	  uint64_t value = 0;
+	  bool exited = false;
+	  if (not jobResult->finished_ and
+	      corePtr->getTargetProgramStop(value, exited))
+	    {
+	      jobResult->finished_ = true;
+	      jobResult->exited_ = exited;
+	      jobResult->value_ = value;
+	    }
+	}
+    }
+
   if (not args.instFreqFile.empty())
-    result = reportInstructionFrequency(core0, args.instFreqFile) and result;
+    result = reportInstructionFrequency(cores, args.instFreqFile, false) and
+      result;
+
+  if (not args.instFreqJsonFile.empty())
+    result = reportInstructionFrequency(cores, args.instFreqJsonFile, true) and
+      result;
+
+  if (not args.branchFile.empty())
+    result = reportBranchPrediction(cores, args.branchFile) and result;
+
+  if (not args.coverageFile.empty() or not args.coverageMapFile.empty())
+    result = reportCodeCoverage(cores, args) and result;
+
+  if (not args.funcCoverageFile.empty())
+    result = saveFunctionalCoverage(cores, args.funcCoverageFile) and result;
 
   closeUserFiles(traceFile, commandLog, consoleOut);
 
@@ -957,6 +1467,215 @@ session(const Args& args, const CoreConfig& config)
 }
 
 
+/// Expand each target program string into program name and args.
+static void
+expandTargets(Args& args)
+{
+  for (const auto& target : args.targets)
+    {
+      StringVec tokens;
+      boost::split(tokens, target, boost::is_any_of(args.targetSep),
+		   boost::token_compress_on);
+      args.expandedTargets.push_back(tokens);
+    }
+}
+
+
+/// Run a session using the register width (xlen) of the configuration
+/// unless the command line overrides it. See session.
+static bool
+runSession(const Args& args, const CoreConfig& config,
+	   JobResult* jobResult = nullptr)
+{
+  unsigned regWidth = 32;
+  config.getXlen(regWidth);
+  if (args.hasRegWidth)
+    regWidth = args.regWidth;
+
+  if (regWidth == 32)
+    return session<uint32_t>(args, config, jobResult);
+  if (regWidth == 64)
+    return session<uint64_t>(args, config, jobResult);
+
+  std::cerr << "Invalid register width: " << regWidth;
+  std::cerr << " -- expecting 32 or 64\n";
+  return false;
+}
+
+
+/// Run the jobs of the --batch job list on a pool of threads. Each
+/// job is a session of its own (memory and harts) with the command
+/// line options (less the batch ones) followed by the options of the
+/// job. The configuration file is loaded once and shared by the jobs
+/// that do not specify another one. Return true if all jobs match
+/// their expectation.
+static bool
+runJobList(int argc, char* argv[], const Args& args,
+	   const CoreConfig& config)
+{
+  if (not args.targets.empty() or not args.hexFiles.empty() or
+      args.interactive or not args.serverFile.empty() or args.gdb)
+    {
+      std::cerr << "Option --batch cannot be used with a target program, "
+		<< "--hex, --interactive, --server or --gdb\n";
+      return false;
+    }
+
+  std::vector<Job> jobs;
+  if (not loadJobList(args.batchFile, jobs))
+    return false;
+
+  // Command line options common to all jobs.
+  StringVec common;
+  const std::string batchOpts[] = { "--batch", "--batchthreads",
+				    "--batchreport" };
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      bool isBatchOpt = false;
+      for (const auto& opt : batchOpts)
+	{
+	  if (arg == opt)
+	    ++i;  // Skip value.
+	  isBatchOpt = arg == opt or arg.rfind(opt + "=", 0) == 0;
+	  if (isBatchOpt)
+	    break;
+	}
+      if (not isBatchOpt)
+	common.push_back(arg);
+    }
+
+  // Parse the options of all jobs up front.
+  std::vector<Args> jobArgs(jobs.size());
+  std::vector<char> valid(jobs.size(), true);
+  for (size_t i = 0; i < jobs.size(); ++i)
+    {
+      StringVec tokens = common;
+      tokens.insert(tokens.begin(), argv[0]);
+      tokens.insert(tokens.end(), jobs.at(i).args_.begin(),
+		    jobs.at(i).args_.end());
+      std::vector<char*> jobArgv;
+      for (auto& token : tokens)
+	jobArgv.push_back(&token[0]);
+
+      Args& ja = jobArgs.at(i);
+      if (not parseCmdLineArgs(int(jobArgv.size()), jobArgv.data(), ja) or
+	  not ja.batchFile.empty())
+	{
+	  std::cerr << "Invalid job (line " << jobs.at(i).line_ << "): "
+		    << jobs.at(i).name_ << '\n';
+	  valid.at(i) = false;
+	}
+      expandTargets(ja);
+    }
+
+  // Jobs run in parallel: Their output files must differ. An output
+  // option common to all the jobs must be given in the job lines.
+  std::unordered_map<std::string, size_t> outputs;
+  unsigned errors = 0;
+  for (size_t i = 0; i < jobs.size(); ++i)
+    {
+      const Args& ja = jobArgs.at(i);
+      const std::pair<const char*, const std::string*> outFiles[] = {
+	{ "--logfile", &ja.traceFile },
+	{ "--consoleoutfile", &ja.consoleOutFile },
+	{ "--profileinst", &ja.instFreqFile },
+	{ "--profileinstjson", &ja.instFreqJsonFile },
+	{ "--profilebranch", &ja.branchFile },
+	{ "--coverage", &ja.coverageFile },
+	{ "--coveragemap", &ja.coverageMapFile },
+	{ "--funccoverage", &ja.funcCoverageFile } };
+
+      for (const auto& [opt, file] : outFiles)
+	{
+	  if (file->empty())
+	    continue;
+	  auto [iter, fresh] = outputs.emplace(*file, i);
+	  if (fresh)
+	    continue;
+	  std::cerr << "Jobs at lines " << jobs.at(iter->second).line_
+		    << " and " << jobs.at(i).line_ << " write the same file "
+		    << *file << " (" << opt << "): Output files must be "
+		    << "given per job in the job lines\n";
+	  errors++;
+	}
+    }
+  if (errors)
+    return false;
+
+  unsigned threadCount = args.batchThreads;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = unsigned(std::min(size_t(threadCount),
+				  std::max(size_t(1), jobs.size())));
+
+  std::vector<JobResult> results(jobs.size());
+  std::atomic<size_t> nextJob(0);
+
+  auto worker = [&] () {
+		  for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+		    {
+		      const Args& ja = jobArgs.at(i);
+		      JobResult& result = results.at(i);
+		      try
+			{
+			  CoreConfig jobConfig;
+			  bool ownConfig = ja.configFile != args.configFile;
+			  if (valid.at(i) and
+			      (not ownConfig or ja.configFile.empty() or
+			       jobConfig.loadConfigFile(ja.configFile)))
+			    runSession(ja, ownConfig? jobConfig : config,
+				       &result);
+			}
+		      catch (std::exception& e)
+			{
+			  std::cerr << "Job (line " << jobs.at(i).line_
+				    << ") " << jobs.at(i).name_ << ": "
+				    << e.what() << '\n';
+			}
+		      result.passed_ = jobPassed(jobs.at(i), result);
+		    }
+		};
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threadVec;
+  for (unsigned ix = 0; ix < threadCount; ++ix)
+    threadVec.emplace_back(worker);
+  for (auto& t : threadVec)
+    t.join();
+
+  auto t1 = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(t1 - t0).count();
+
+  size_t passed = 0;
+  uint64_t instCount = 0;
+  for (size_t i = 0; i < jobs.size(); ++i)
+    {
+      instCount += results.at(i).instCount_;
+      if (results.at(i).passed_)
+	passed++;
+      else
+	std::cerr << "Failed job (line " << jobs.at(i).line_ << "): "
+		  << jobs.at(i).name_ << " (" << describeJobResult(results.at(i))
+		  << ")\n";
+    }
+
+  std::cerr << "Batch: " << jobs.size() << " job"
+	    << (jobs.size() == 1? "" : "s") << ", " << passed << " passed, "
+	    << jobs.size() - passed << " failed, " << instCount
+	    << " instructions in " << (boost::format("%.2fs") % elapsed);
+  if (elapsed > 0)
+    std::cerr << "  " << size_t(double(instCount)/elapsed) << " inst/s";
+  std::cerr << '\n';
+
+  bool ok = passed == jobs.size();
+  if (not args.batchReport.empty())
+    ok = writeJobReport(args.batchReport, jobs, results, elapsed) and ok;
+  return ok;
+}
+
+
 int
 main(int argc, char* argv[])
 {
@@ -973,14 +1692,7 @@ main(int argc, char* argv[])
   if (args.help)
     return 0;
 
-  // Expand each target program string into program name and args.
-  for (const auto& target : args.targets)
-    {
-      StringVec tokens;
-      boost::split(tokens, target, boost::is_any_of(args.targetSep),
-		   boost::token_compress_on);
-      args.expandedTargets.push_back(tokens);
-    }
+  expandTargets(args);
 
   // Load configuration file.
   CoreConfig config;
@@ -990,27 +1702,14 @@ main(int argc, char* argv[])
 	return 1;
     }
 
-  // Obtain register width (xlen). First from config file then from
-  // command line.
-  unsigned regWidth = 32;
-  config.getXlen(regWidth);
-  if (args.hasRegWidth)
-    regWidth = args.regWidth;
-
   bool ok = true;
 
   try
     {
-      if (regWidth == 32)
-	ok = session<uint32_t>(args, config);
-      else if (regWidth == 64)
-	ok = session<uint64_t>(args, config);
+      if (args.batchFile.empty())
+	ok = runSession(args, config);
       else
-	{
-	  std::cerr << "Invalid register width: " << regWidth;
-	  std::cerr << " -- expecting 32 or 64\n";
-	  ok = false;
-	}
+	ok = runJobList(argc, argv, args, config);
     }
   catch (std::exception& e)
     {